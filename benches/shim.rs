@@ -0,0 +1,233 @@
+//! Latency and throughput of the shim's FFI entry points.
+//!
+//! Run with `cargo bench --bench shim`; pass a filter to run only matching cases, e.g.
+//! `cargo bench --bench shim -- call_function`. Criterion keeps the previous run's results
+//! under `target/criterion` and reports the change, so run it before and after a V8 update.
+//!
+//! Criterion reports the mean; each case also times every call it makes and prints the
+//! p50/p90/p99/max latencies of its last `MAX_SAMPLES` calls, where tail regressions show.
+
+use std::hint::black_box;
+use std::sync::Once;
+use std::time::{Duration, Instant};
+
+use criterion::{Bencher, BenchmarkId, Criterion, Throughput, criterion_group, criterion_main};
+use pacm_v8::{Isolate, JsValue, Script};
+
+const MAX_SAMPLES: usize = 200_000;
+
+/// Per-call latencies of one case, recorded through `iter_custom`.
+struct Latencies {
+    name: String,
+    samples: Vec<Duration>,
+    next: usize,
+}
+
+impl Latencies {
+    fn new(name: impl Into<String>) -> Self {
+        Self {
+            name: name.into(),
+            samples: Vec::new(),
+            next: 0,
+        }
+    }
+
+    /// Lets Criterion drive `op` while timing each call. Once `MAX_SAMPLES` calls are kept,
+    /// newer ones overwrite the oldest, so warmup calls age out of the percentiles.
+    fn bench<O>(&mut self, b: &mut Bencher, mut op: impl FnMut() -> O) {
+        b.iter_custom(|iters| {
+            let mut total = Duration::ZERO;
+            for _ in 0..iters {
+                let start = Instant::now();
+                black_box(op());
+                let elapsed = start.elapsed();
+                total += elapsed;
+                if self.samples.len() < MAX_SAMPLES {
+                    self.samples.push(elapsed);
+                } else {
+                    self.samples[self.next] = elapsed;
+                    self.next = (self.next + 1) % MAX_SAMPLES;
+                }
+            }
+            total
+        });
+    }
+
+    /// Prints the percentiles; cases skipped by the filter recorded nothing and print nothing.
+    fn report(mut self) {
+        if self.samples.is_empty() {
+            return;
+        }
+        static HEADER: Once = Once::new();
+        HEADER.call_once(|| {
+            println!(
+                "{:<40} {:>10} {:>10} {:>10} {:>10}",
+                "latency", "p50", "p90", "p99", "max"
+            );
+        });
+
+        self.samples.sort_unstable();
+        println!(
+            "{:<40} {:>10} {:>10} {:>10} {:>10}",
+            self.name,
+            format_duration(percentile(&self.samples, 0.50)),
+            format_duration(percentile(&self.samples, 0.90)),
+            format_duration(percentile(&self.samples, 0.99)),
+            format_duration(self.samples[self.samples.len() - 1]),
+        );
+    }
+}
+
+fn percentile(sorted: &[Duration], q: f64) -> Duration {
+    let index = ((sorted.len() - 1) as f64 * q).round() as usize;
+    sorted[index]
+}
+
+fn format_duration(duration: Duration) -> String {
+    let nanos = duration.as_nanos();
+    if nanos < 10_000 {
+        format!("{nanos}ns")
+    } else if nanos < 10_000_000 {
+        format!("{:.1}µs", nanos as f64 / 1e3)
+    } else {
+        format!("{:.1}ms", nanos as f64 / 1e6)
+    }
+}
+
+fn lifecycle(c: &mut Criterion) {
+    let mut latencies = Latencies::new("isolate/create_dispose");
+    c.bench_function("isolate/create_dispose", |b| {
+        latencies.bench(b, || Isolate::new().expect("create isolate"))
+    });
+    latencies.report();
+
+    let isolate = Isolate::new().expect("create isolate");
+    let mut latencies = Latencies::new("context/create_dispose");
+    c.bench_function("context/create_dispose", |b| {
+        latencies.bench(b, || isolate.create_context().expect("create context"))
+    });
+    latencies.report();
+}
+
+fn eval(c: &mut Criterion) {
+    let isolate = Isolate::new().expect("create isolate");
+    let context = isolate.create_context().expect("create context");
+
+    // A different source every time misses the script cache and compiles.
+    let mut counter = 0u64;
+    let mut latencies = Latencies::new("eval/cold");
+    c.bench_function("eval/cold", |b| {
+        latencies.bench(b, || {
+            counter += 1;
+            let source = format!("(function(x) {{ return x * 2 + {counter}; }})(21)");
+            context.eval(&source).expect("eval")
+        })
+    });
+    latencies.report();
+
+    let mut latencies = Latencies::new("eval/cached");
+    c.bench_function("eval/cached", |b| {
+        latencies.bench(b, || {
+            context
+                .eval(black_box("(function(x) { return x * 2; })(21)"))
+                .expect("eval")
+        })
+    });
+    latencies.report();
+
+    let script = Script::compile(&isolate, "(function(x) { return x * 2; })(21)").expect("compile");
+    let mut latencies = Latencies::new("script/run");
+    c.bench_function("script/run", |b| {
+        latencies.bench(b, || script.run(&context).expect("run"))
+    });
+    latencies.report();
+}
+
+fn calls(c: &mut Criterion) {
+    let isolate = Isolate::new().expect("create isolate");
+    let context = isolate.create_context().expect("create context");
+    context
+        .eval(
+            "globalThis.sum = function(...values) { let total = 0; for (const v of values) total += v; return total; };",
+        )
+        .expect("define sum");
+    let function = context.function("sum").expect("resolve sum");
+
+    let mut group = c.benchmark_group("call_function");
+    for count in [0usize, 1, 4, 16] {
+        let args: Vec<JsValue> = (0..count).map(|i| JsValue::Number(i as f64)).collect();
+        let mut latencies = Latencies::new(format!("call_function/by_name/{count}"));
+        group.bench_with_input(BenchmarkId::new("by_name", count), &args, |b, args| {
+            latencies.bench(b, || {
+                context.call_function_values("sum", args).expect("call")
+            })
+        });
+        latencies.report();
+
+        let mut latencies = Latencies::new(format!("call_function/resolved/{count}"));
+        group.bench_with_input(BenchmarkId::new("resolved", count), &args, |b, args| {
+            latencies.bench(b, || function.call_values(args).expect("call"))
+        });
+        latencies.report();
+    }
+    group.finish();
+}
+
+fn host_functions(c: &mut Criterion) {
+    let isolate = Isolate::new().expect("create isolate");
+    let mut context = isolate.create_context().expect("create context");
+    context
+        .add_function("host.identity", |args| Ok(args.first().cloned()))
+        .expect("register host function");
+    context
+        .eval(
+            "globalThis.roundTrip = function(n) { let last; for (let i = 0; i < n; i++) last = host.identity(i); return last; };",
+        )
+        .expect("define roundTrip");
+    let round_trip = context.function("roundTrip").expect("resolve roundTrip");
+
+    let iterations = 100;
+    let arg = [JsValue::Int32(iterations)];
+    let mut group = c.benchmark_group("host_function");
+    group.throughput(Throughput::Elements(iterations as u64));
+    let mut latencies = Latencies::new(format!("host_function/round_trip x{iterations}"));
+    group.bench_function("round_trip", |b| {
+        latencies.bench(b, || round_trip.call_values(&arg).expect("call"))
+    });
+    latencies.report();
+    group.finish();
+}
+
+fn marshalling(c: &mut Criterion) {
+    let isolate = Isolate::new().expect("create isolate");
+    let context = isolate.create_context().expect("create context");
+    context
+        .eval("globalThis.length = function(s) { return s.length; };")
+        .expect("define length");
+    let length = context.function("length").expect("resolve length");
+
+    let mut group = c.benchmark_group("marshal");
+    for size in [1usize << 10, 1 << 16, 1 << 20] {
+        group.throughput(Throughput::Bytes(size as u64));
+
+        let arg = [JsValue::String("x".repeat(size))];
+        let mut latencies = Latencies::new(format!("marshal/string_in/{size}"));
+        group.bench_with_input(BenchmarkId::new("string_in", size), &arg, |b, arg| {
+            latencies.bench(b, || length.call_values(arg).expect("call"))
+        });
+        latencies.report();
+
+        context
+            .eval(&format!("globalThis.big = 'x'.repeat({size});"))
+            .expect("define big");
+        let mut latencies = Latencies::new(format!("marshal/string_out/{size}"));
+        group.bench_function(BenchmarkId::new("string_out", size), |b| {
+            latencies.bench(b, || context.eval("big").expect("eval"))
+        });
+        latencies.report();
+    }
+    group.finish();
+}
+
+criterion_group!(benches, lifecycle, eval, calls, host_functions, marshalling);
+criterion_main!(benches);
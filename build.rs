@@ -472,8 +472,21 @@ fn main() {
         "shim_internal.h",
         "runtime.cc",
         "context.cc",
+        "function.cc",
         "script.cc",
+        "script_cache.cc",
+        "snapshot.cc",
         "util.cc",
+        "value.cc",
+        "watchdog.cc",
+        "promise.cc",
+        "fast_api.cc",
+        "module.cc",
+        "streaming.cc",
+        "heap.cc",
+        "profiler.cc",
+        "instrument.cc",
+        "class.cc",
     ] {
         println!("cargo:rerun-if-changed=src/cpp/{file}");
     }
@@ -626,8 +639,21 @@ fn main() {
     for source in [
         "src/cpp/runtime.cc",
         "src/cpp/context.cc",
+        "src/cpp/function.cc",
         "src/cpp/script.cc",
+        "src/cpp/script_cache.cc",
+        "src/cpp/snapshot.cc",
         "src/cpp/util.cc",
+        "src/cpp/value.cc",
+        "src/cpp/watchdog.cc",
+        "src/cpp/promise.cc",
+        "src/cpp/fast_api.cc",
+        "src/cpp/module.cc",
+        "src/cpp/streaming.cc",
+        "src/cpp/heap.cc",
+        "src/cpp/profiler.cc",
+        "src/cpp/instrument.cc",
+        "src/cpp/class.cc",
     ] {
         build.file(source);
     }
@@ -666,6 +692,10 @@ fn main() {
         }
     }
 
+    if env::var_os("CARGO_FEATURE_INSTRUMENTATION").is_some() {
+        build.define("PACM_V8_INSTRUMENTATION", None);
+    }
+
     // If there are additional platform flags, add them via env vars if needed
     if let Ok(extra) = env::var("CXXFLAGS") {
         for flag in extra.split_whitespace() {
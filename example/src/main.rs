@@ -52,7 +52,7 @@ fn run() -> V8Result<()> {
     println!("[Rust] Context::eval -> {}", bootstrap_result);
 
     let description = context.call_function("describeHost", &["Rust entry point"])?;
-    println!("[Rust] Context::call_function -> {}", description.as_str());
+    println!("[Rust] Context::call_function -> {description}");
 
     let mut compiled = Script::compile(&isolate, COMPILED_SNIPPET)?;
     println!("[Rust] script handle: {:?}", compiled.raw_handle());
@@ -80,7 +80,7 @@ fn install_host_bindings(context: &mut Context) -> V8Result<()> {
     context.add_function("console.log", |args| -> V8Result<Option<JsValue>> {
         let message = args
             .iter()
-            .map(|value| value.as_str())
+            .map(|value| value.to_string())
             .collect::<Vec<_>>()
             .join(" ");
         println!("[console.log] {message}");
@@ -90,7 +90,7 @@ fn install_host_bindings(context: &mut Context) -> V8Result<()> {
     context.add_function("host.echo", |args| -> V8Result<Option<JsValue>> {
         let payload = args
             .iter()
-            .map(|value| value.as_str())
+            .map(|value| value.to_string())
             .collect::<Vec<_>>()
             .join(" ");
         println!("[host.echo] {payload}");
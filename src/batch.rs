@@ -0,0 +1,45 @@
+use crate::Script;
+use crate::value::JsValue;
+
+#[derive(Clone, Copy)]
+pub(crate) enum BatchSource<'a> {
+    Source(&'a str),
+    Script(&'a Script),
+}
+
+/// One entry for [`crate::Context::eval_many`].
+///
+/// With arguments, the item's completion value must be a function; it is called with them
+/// and its return value becomes the item's result.
+#[derive(Clone, Copy)]
+pub struct BatchItem<'a> {
+    pub(crate) source: BatchSource<'a>,
+    pub(crate) args: &'a [JsValue],
+}
+
+impl<'a> BatchItem<'a> {
+    pub fn source(source: &'a str) -> Self {
+        Self {
+            source: BatchSource::Source(source),
+            args: &[],
+        }
+    }
+
+    pub fn script(script: &'a Script) -> Self {
+        Self {
+            source: BatchSource::Script(script),
+            args: &[],
+        }
+    }
+
+    pub fn with_args(mut self, args: &'a [JsValue]) -> Self {
+        self.args = args;
+        self
+    }
+}
+
+impl<'a> From<&'a str> for BatchItem<'a> {
+    fn from(source: &'a str) -> Self {
+        Self::source(source)
+    }
+}
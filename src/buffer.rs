@@ -0,0 +1,35 @@
+use std::os::raw::c_void;
+
+// Host memory handed to V8 as an ArrayBuffer backing store. The double box keeps the token a
+// thin pointer while the inner trait object keeps the buffer's heap allocation in place.
+type HostBuffer = Box<dyn AsMut<[u8]> + Send + 'static>;
+
+pub(crate) struct RawHostBuffer {
+    pub(crate) data: *mut u8,
+    pub(crate) length: usize,
+    pub(crate) token: *mut c_void,
+}
+
+pub(crate) fn into_raw<B>(buffer: B) -> RawHostBuffer
+where
+    B: AsMut<[u8]> + Send + 'static,
+{
+    let mut owner: Box<HostBuffer> = Box::new(Box::new(buffer));
+    let bytes = (**owner).as_mut();
+    let data = bytes.as_mut_ptr();
+    let length = bytes.len();
+    RawHostBuffer {
+        data,
+        length,
+        token: Box::into_raw(owner) as *mut c_void,
+    }
+}
+
+// V8 may free backing stores from any thread, so this must not touch thread-local state.
+#[unsafe(no_mangle)]
+pub unsafe extern "C" fn pacm_v8__buffer_release(token: *mut c_void) {
+    if token.is_null() {
+        return;
+    }
+    drop(unsafe { Box::from_raw(token as *mut HostBuffer) });
+}
@@ -0,0 +1,212 @@
+use std::any::Any;
+use std::marker::PhantomData;
+use std::os::raw::c_char;
+use std::ptr;
+
+use crate::error::{Result, V8Error};
+use crate::ffi::{
+    SHIM_CLASS_METHOD, SHIM_CLASS_PROPERTY, ShimClassMember, V8IsolateHandle,
+    shim_context_new_instance, shim_isolate_define_class,
+};
+use crate::native::{self, MemberCallback};
+use crate::support::take_error;
+use crate::value::JsValue;
+use crate::{Context, Isolate};
+
+enum Member {
+    Method(Box<MemberCallback>),
+    Property {
+        get: Box<MemberCallback>,
+        set: Option<Box<MemberCallback>>,
+    },
+}
+
+/// Methods and accessor properties of a host class whose instances wrap a `T`.
+///
+/// Members live on the prototype and are built once per isolate by
+/// [`Isolate::define_class`], so creating an instance in a context costs one object
+/// allocation and property access goes through V8's inline caches. Calling a member on
+/// anything but an instance of the class throws a `TypeError`, as does `new` from JavaScript.
+pub struct ClassBuilder<T> {
+    name: String,
+    members: Vec<(String, Member)>,
+    _marker: PhantomData<fn(T)>,
+}
+
+fn downcast<T: 'static>(instance: &(dyn Any + Send)) -> Result<&T> {
+    instance
+        .downcast_ref::<T>()
+        .ok_or_else(|| V8Error::new("receiver belongs to a different class"))
+}
+
+impl<T: Send + 'static> ClassBuilder<T> {
+    pub fn new(name: impl Into<String>) -> Self {
+        Self {
+            name: name.into(),
+            members: Vec::new(),
+            _marker: PhantomData,
+        }
+    }
+
+    pub fn method<F>(mut self, name: impl Into<String>, method: F) -> Self
+    where
+        F: Fn(&T, &[JsValue]) -> Result<Option<JsValue>> + Send + Sync + 'static,
+    {
+        let callback: Box<MemberCallback> =
+            Box::new(move |instance, args| method(downcast::<T>(instance)?, args));
+        self.members.push((name.into(), Member::Method(callback)));
+        self
+    }
+
+    /// A read-only property; assignments are ignored, or throw in strict mode.
+    pub fn getter<G>(self, name: impl Into<String>, get: G) -> Self
+    where
+        G: Fn(&T) -> Result<JsValue> + Send + Sync + 'static,
+    {
+        self.property(name, get, None)
+    }
+
+    pub fn accessor<G, S>(self, name: impl Into<String>, get: G, set: S) -> Self
+    where
+        G: Fn(&T) -> Result<JsValue> + Send + Sync + 'static,
+        S: Fn(&T, JsValue) -> Result<()> + Send + Sync + 'static,
+    {
+        let set: Box<MemberCallback> = Box::new(move |instance, args| {
+            let value = args.first().cloned().unwrap_or(JsValue::Undefined);
+            set(downcast::<T>(instance)?, value)?;
+            Ok(None)
+        });
+        self.property(name, get, Some(set))
+    }
+
+    fn property<G>(
+        mut self,
+        name: impl Into<String>,
+        get: G,
+        set: Option<Box<MemberCallback>>,
+    ) -> Self
+    where
+        G: Fn(&T) -> Result<JsValue> + Send + Sync + 'static,
+    {
+        let get: Box<MemberCallback> =
+            Box::new(move |instance, _| get(downcast::<T>(instance)?).map(Some));
+        self.members
+            .push((name.into(), Member::Property { get, set }));
+        self
+    }
+}
+
+/// A class defined on an isolate; see [`ClassBuilder`].
+pub struct Class<T> {
+    id: u32,
+    isolate: V8IsolateHandle,
+    _marker: PhantomData<fn(T)>,
+}
+
+impl<T> Clone for Class<T> {
+    fn clone(&self) -> Self {
+        *self
+    }
+}
+
+impl<T> Copy for Class<T> {}
+
+// The class id is plain data; instances are only created on the isolate's thread.
+unsafe impl<T> Send for Class<T> {}
+unsafe impl<T> Sync for Class<T> {}
+
+impl<T: Send + 'static> Class<T> {
+    pub(crate) fn define(isolate: &Isolate, builder: ClassBuilder<T>) -> Result<Self> {
+        if isolate.handle.is_null() {
+            return Err(V8Error::new("isolate was disposed"));
+        }
+
+        // Registered up front; on failure the callbacks stay ours to drop.
+        let entries: Vec<(String, i32, u64, u64)> = builder
+            .members
+            .into_iter()
+            .map(|(name, member)| match member {
+                Member::Method(callback) => (
+                    name,
+                    SHIM_CLASS_METHOD,
+                    native::register_member(callback),
+                    0,
+                ),
+                Member::Property { get, set } => (
+                    name,
+                    SHIM_CLASS_PROPERTY,
+                    native::register_member(get),
+                    set.map_or(0, native::register_member),
+                ),
+            })
+            .collect();
+        let members: Vec<ShimClassMember> = entries
+            .iter()
+            .map(|(name, kind, function_id, setter_id)| ShimClassMember {
+                name: name.as_ptr() as *const c_char,
+                name_length: name.len(),
+                kind: *kind,
+                function_id: *function_id,
+                setter_id: *setter_id,
+            })
+            .collect();
+
+        let mut id = 0u32;
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status = unsafe {
+            shim_isolate_define_class(
+                isolate.handle,
+                builder.name.as_ptr() as *const c_char,
+                builder.name.len(),
+                members.as_ptr(),
+                members.len(),
+                &mut id,
+                &mut error_ptr,
+            )
+        };
+        if status == 0 {
+            for (_, _, function_id, setter_id) in entries {
+                unsafe {
+                    native::drop_function(function_id);
+                    native::drop_function(setter_id);
+                }
+            }
+            return Err(unsafe { take_error(error_ptr, "failed to define class") });
+        }
+
+        Ok(Self {
+            id,
+            isolate: isolate.handle,
+            _marker: PhantomData,
+        })
+    }
+
+    pub(crate) fn instantiate(&self, context: &Context, path: &str, value: T) -> Result<()> {
+        if context.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
+        }
+        if context.isolate != self.isolate {
+            return Err(V8Error::new(
+                "class and context belong to different isolates",
+            ));
+        }
+
+        let token = native::into_instance(Box::new(value));
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status = unsafe {
+            shim_context_new_instance(
+                context.handle,
+                self.id,
+                token,
+                path.as_ptr() as *const c_char,
+                path.len(),
+                &mut error_ptr,
+            )
+        };
+        if status == 0 {
+            unsafe { native::drop_instance(token) };
+            return Err(unsafe { take_error(error_ptr, "failed to create class instance") });
+        }
+        Ok(())
+    }
+}
@@ -0,0 +1,191 @@
+use std::ffi::OsString;
+use std::fs::{self, OpenOptions};
+use std::io::{ErrorKind, Write};
+use std::path::{Path, PathBuf};
+use std::process;
+use std::sync::atomic::{AtomicU64, Ordering};
+
+use crate::error::{Result, V8Error};
+
+const MAGIC: &[u8; 4] = b"PV8C";
+const FORMAT_VERSION: u32 = 1;
+const V8_VERSION: &str = env!("PACM_V8_VERSION");
+
+// Header layout: magic, format version, V8 version length + bytes, source hash, payload length.
+const FIXED_HEADER_LEN: usize = 4 + 4 + 4 + 8 + 8;
+
+/// Serialized V8 code cache for a single script source.
+///
+/// V8 validates the payload against its own version, flags and source length when it is
+/// consumed; the header written by [`CodeCache::to_bytes`] additionally pins the crate's
+/// V8 version and a hash of the full source so stale files on disk are discarded before
+/// they ever reach the compiler.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct CodeCache {
+    source_hash: u64,
+    data: Vec<u8>,
+}
+
+impl CodeCache {
+    pub(crate) fn new(source_hash: u64, data: Vec<u8>) -> Self {
+        Self { source_hash, data }
+    }
+
+    pub fn as_bytes(&self) -> &[u8] {
+        &self.data
+    }
+
+    pub fn len(&self) -> usize {
+        self.data.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.data.is_empty()
+    }
+
+    pub fn matches(&self, source: &str) -> bool {
+        self.matches_hash(source_hash(source))
+    }
+
+    pub(crate) fn matches_hash(&self, source_hash: u64) -> bool {
+        self.source_hash == source_hash
+    }
+
+    pub fn to_bytes(&self) -> Vec<u8> {
+        let mut out = Vec::with_capacity(FIXED_HEADER_LEN + V8_VERSION.len() + self.data.len());
+        out.extend_from_slice(MAGIC);
+        out.extend_from_slice(&FORMAT_VERSION.to_le_bytes());
+        out.extend_from_slice(&(V8_VERSION.len() as u32).to_le_bytes());
+        out.extend_from_slice(V8_VERSION.as_bytes());
+        out.extend_from_slice(&self.source_hash.to_le_bytes());
+        out.extend_from_slice(&(self.data.len() as u64).to_le_bytes());
+        out.extend_from_slice(&self.data);
+        out
+    }
+
+    pub fn from_bytes(bytes: &[u8]) -> Result<Self> {
+        let mut reader = Reader { bytes, offset: 0 };
+        if reader.take(4)? != MAGIC {
+            return Err(V8Error::new("code cache has an invalid header"));
+        }
+        if reader.u32()? != FORMAT_VERSION {
+            return Err(V8Error::new("code cache format version mismatch"));
+        }
+        let version_len = reader.u32()? as usize;
+        if reader.take(version_len)? != V8_VERSION.as_bytes() {
+            return Err(V8Error::new(
+                "code cache was produced by a different V8 version",
+            ));
+        }
+        let source_hash = reader.u64()?;
+        let data_len = reader.u64()? as usize;
+        let data = reader.take(data_len)?.to_vec();
+        if reader.offset != bytes.len() {
+            return Err(V8Error::new("code cache has trailing data"));
+        }
+        Ok(Self { source_hash, data })
+    }
+
+    /// Reads a cache file, returning `None` when it is missing, corrupt or stale for `source`.
+    pub fn load(path: impl AsRef<Path>, source: &str) -> Result<Option<Self>> {
+        let bytes = match fs::read(path.as_ref()) {
+            Ok(bytes) => bytes,
+            Err(err) if err.kind() == ErrorKind::NotFound => return Ok(None),
+            Err(err) => return Err(V8Error::new(err.to_string())),
+        };
+        match Self::from_bytes(&bytes) {
+            Ok(cache) if cache.matches(source) => Ok(Some(cache)),
+            _ => Ok(None),
+        }
+    }
+
+    /// Writes the cache to a temporary file next to `path` and renames it into place, so
+    /// readers never see a partial file and concurrent writers do not clobber each other.
+    pub fn write_to(&self, path: impl AsRef<Path>) -> Result<()> {
+        let path = path.as_ref();
+        let tmp =
+            write_temp(path, &self.to_bytes()).map_err(|err| V8Error::new(err.to_string()))?;
+        fs::rename(&tmp, path).map_err(|err| {
+            let _ = fs::remove_file(&tmp);
+            V8Error::new(err.to_string())
+        })
+    }
+}
+
+// `.<file name>.<pid>.<n>.tmp` in the target's directory; create_new skips names that are
+// already taken, for example by another process.
+fn write_temp(path: &Path, bytes: &[u8]) -> std::io::Result<PathBuf> {
+    static NEXT: AtomicU64 = AtomicU64::new(0);
+
+    let file_name = path
+        .file_name()
+        .ok_or_else(|| std::io::Error::new(ErrorKind::InvalidInput, "path has no file name"))?;
+    loop {
+        let mut name = OsString::from(".");
+        name.push(file_name);
+        name.push(format!(
+            ".{}.{}.tmp",
+            process::id(),
+            NEXT.fetch_add(1, Ordering::Relaxed)
+        ));
+        let tmp = path.with_file_name(name);
+
+        let mut file = match OpenOptions::new().write(true).create_new(true).open(&tmp) {
+            Ok(file) => file,
+            Err(err) if err.kind() == ErrorKind::AlreadyExists => continue,
+            Err(err) => return Err(err),
+        };
+        if let Err(err) = file.write_all(bytes) {
+            drop(file);
+            let _ = fs::remove_file(&tmp);
+            return Err(err);
+        }
+        return Ok(tmp);
+    }
+}
+
+struct Reader<'a> {
+    bytes: &'a [u8],
+    offset: usize,
+}
+
+impl<'a> Reader<'a> {
+    fn take(&mut self, len: usize) -> Result<&'a [u8]> {
+        let end = self
+            .offset
+            .checked_add(len)
+            .filter(|end| *end <= self.bytes.len())
+            .ok_or_else(|| V8Error::new("code cache is truncated"))?;
+        let slice = &self.bytes[self.offset..end];
+        self.offset = end;
+        Ok(slice)
+    }
+
+    fn u32(&mut self) -> Result<u32> {
+        let mut buf = [0u8; 4];
+        buf.copy_from_slice(self.take(4)?);
+        Ok(u32::from_le_bytes(buf))
+    }
+
+    fn u64(&mut self) -> Result<u64> {
+        let mut buf = [0u8; 8];
+        buf.copy_from_slice(self.take(8)?);
+        Ok(u64::from_le_bytes(buf))
+    }
+}
+
+// FNV-1a; only used to tell sources apart, not for anything security sensitive.
+pub(crate) fn source_hash(source: &str) -> u64 {
+    extend_source_hash(SOURCE_HASH_SEED, source.as_bytes())
+}
+
+pub(crate) const SOURCE_HASH_SEED: u64 = 0xcbf2_9ce4_8422_2325;
+
+// Continues source_hash over text that arrives in pieces.
+pub(crate) fn extend_source_hash(mut hash: u64, bytes: &[u8]) -> u64 {
+    for byte in bytes {
+        hash ^= u64::from(*byte);
+        hash = hash.wrapping_mul(0x0100_0000_01b3);
+    }
+    hash
+}
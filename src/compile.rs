@@ -0,0 +1,73 @@
+use crate::ffi::{SHIM_COMPILE_EAGER, SHIM_COMPILE_HINTS_MAGIC_COMMENTS};
+use crate::value::JsValue;
+
+/// How [`crate::Script::compile_with_options`] compiles a script.
+///
+/// By default V8 only pre-parses functions and compiles each on its first call. A consumed
+/// code cache takes precedence over both options, and `eager` over `compile_hints`.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct CompileOptions {
+    /// Compile every function up front.
+    pub eager: bool,
+    /// Compile functions marked by `//# allFunctionsCalledOnLoad` and per-function compile hint
+    /// comments up front. Ignored by V8 versions without compile hints.
+    pub compile_hints: bool,
+}
+
+impl CompileOptions {
+    pub fn eager() -> Self {
+        Self {
+            eager: true,
+            ..Self::default()
+        }
+    }
+
+    pub fn compile_hints() -> Self {
+        Self {
+            compile_hints: true,
+            ..Self::default()
+        }
+    }
+
+    pub(crate) fn flags(&self) -> i32 {
+        let mut flags = 0;
+        if self.eager {
+            flags |= SHIM_COMPILE_EAGER;
+        }
+        if self.compile_hints {
+            flags |= SHIM_COMPILE_HINTS_MAGIC_COMMENTS;
+        }
+        flags
+    }
+}
+
+/// One call made by [`crate::Script::warmup`]: the function at a dotted global path, called
+/// with representative arguments.
+#[derive(Clone, Copy)]
+pub struct WarmupCall<'a> {
+    pub(crate) function: &'a str,
+    pub(crate) args: &'a [JsValue],
+    pub(crate) iterations: u32,
+}
+
+impl<'a> WarmupCall<'a> {
+    pub fn new(function: &'a str) -> Self {
+        Self {
+            function,
+            args: &[],
+            iterations: 1,
+        }
+    }
+
+    pub fn with_args(mut self, args: &'a [JsValue]) -> Self {
+        self.args = args;
+        self
+    }
+
+    /// Calls the function `iterations` times, at least once, so it also tiers up in the
+    /// warmup isolate.
+    pub fn iterations(mut self, iterations: u32) -> Self {
+        self.iterations = iterations.max(1);
+        self
+    }
+}
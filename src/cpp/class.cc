@@ -0,0 +1,241 @@
+#include "shim_internal.h"
+
+namespace pacm_v8 {
+
+static void illegal_constructor(const v8::FunctionCallbackInfo<v8::Value>& info) {
+    v8::Isolate* isolate = info.GetIsolate();
+    isolate->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8Literal(isolate, "Illegal constructor")));
+}
+
+static void class_member_trampoline(const v8::FunctionCallbackInfo<v8::Value>& info) {
+    v8::Isolate* isolate = info.GetIsolate();
+    v8::HandleScope handle_scope(isolate);
+
+    // The member's signature has V8 reject receivers that are not instances of the class,
+    // but an instance whose construction threw, or whose context was disposed, has no host object.
+    auto* member = static_cast<ClassMember*>(info.Data().As<v8::External>()->Value());
+    v8::Local<v8::Object> receiver = info.This();
+    auto* instance = receiver->InternalFieldCount() > 0
+        ? static_cast<ClassInstance*>(receiver->GetAlignedPointerFromInternalField(0))
+        : nullptr;
+    if (!member || !instance) {
+        isolate->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8Literal(isolate, "Illegal invocation")));
+        return;
+    }
+
+    call_host_function(info, instance->context->isolate_wrapper, member->function_id, &instance->token);
+}
+
+static void instance_released(const v8::WeakCallbackInfo<ClassInstance>& info) {
+    ClassInstance* instance = info.GetParameter();
+    ::pacm_v8__class_instance_drop(instance->token);
+    delete instance;
+}
+
+// First pass: only V8 handles may be touched; the host object is dropped in the second pass.
+static void instance_collected(const v8::WeakCallbackInfo<ClassInstance>& info) {
+    ClassInstance* instance = info.GetParameter();
+    instance->object.Reset();
+    instance->context->class_instances.erase(instance);
+    info.SetSecondPassCallback(instance_released);
+}
+
+void dispose_classes(IsolateWrapper* wrapper) {
+    for (auto& cls : wrapper->classes) {
+        cls->constructor.Reset();
+        for (auto& member : cls->members) {
+            ::pacm_v8__host_function_drop(member->function_id);
+        }
+    }
+    wrapper->classes.clear();
+}
+
+void dispose_class_instances(ContextWrapper* context) {
+    // The JS objects can outlive the context; their methods then throw instead of reaching freed memory.
+    if (v8::Isolate* isolate = context->isolate()) {
+        v8::Isolate::Scope isolate_scope(isolate);
+        v8::HandleScope handle_scope(isolate);
+        for (ClassInstance* instance : context->class_instances) {
+            if (!instance->object.IsEmpty()) {
+                v8::Local<v8::Object>::New(isolate, instance->object)->SetAlignedPointerInInternalField(0, nullptr);
+            }
+        }
+    }
+    for (ClassInstance* instance : context->class_instances) {
+        instance->object.Reset();
+        ::pacm_v8__class_instance_drop(instance->token);
+        delete instance;
+    }
+    context->class_instances.clear();
+}
+
+} // namespace pacm_v8
+
+extern "C" {
+
+int shim_isolate_define_class(
+    V8IsolateHandle handle,
+    const char* name,
+    size_t name_length,
+    const ShimClassMember* members,
+    size_t member_count,
+    uint32_t* class_id_out,
+    char** error_out) {
+    if (class_id_out) {
+        *class_id_out = 0;
+    }
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::IsolateWrapper* wrapper = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_isolate(handle, wrapper, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+    if (!name || name_length == 0) {
+        pacm_v8::assign_error(error_out, "class name was empty");
+        return 0;
+    }
+    if (!members && member_count > 0) {
+        pacm_v8::assign_error(error_out, "class members were null");
+        return 0;
+    }
+    if (!class_id_out) {
+        pacm_v8::assign_error(error_out, "class id output was null");
+        return 0;
+    }
+
+    v8::Isolate* isolate = wrapper->isolate;
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+
+    v8::Local<v8::String> class_name;
+    if (!pacm_v8::new_utf8_string(isolate, std::string_view(name, name_length), class_name, v8::NewStringType::kInternalized)) {
+        pacm_v8::assign_error(error_out, "class name was too long");
+        return 0;
+    }
+
+    auto cls = std::make_unique<pacm_v8::ClassTemplate>();
+    v8::Local<v8::FunctionTemplate> constructor = v8::FunctionTemplate::New(isolate, pacm_v8::illegal_constructor);
+    constructor->SetClassName(class_name);
+    constructor->InstanceTemplate()->SetInternalFieldCount(1);
+    v8::Local<v8::Signature> signature = v8::Signature::New(isolate, constructor);
+    v8::Local<v8::ObjectTemplate> prototype = constructor->PrototypeTemplate();
+
+    std::vector<std::unique_ptr<pacm_v8::ClassMember>> owned;
+    owned.reserve(member_count);
+    for (std::size_t i = 0; i < member_count; ++i) {
+        const ShimClassMember& member = members[i];
+        v8::Local<v8::String> key;
+        if (!member.name || member.name_length == 0) {
+            pacm_v8::assign_error(error_out, "class member name was empty");
+            return 0;
+        }
+        if (!pacm_v8::new_utf8_string(isolate, std::string_view(member.name, member.name_length), key, v8::NewStringType::kInternalized)) {
+            pacm_v8::assign_error(error_out, "class member name was too long");
+            return 0;
+        }
+        owned.push_back(std::make_unique<pacm_v8::ClassMember>(pacm_v8::ClassMember{member.function_id}));
+        pacm_v8::ClassMember* data = owned.back().get();
+
+        switch (member.kind) {
+        case SHIM_CLASS_METHOD: {
+            v8::Local<v8::FunctionTemplate> method = v8::FunctionTemplate::New(
+                isolate, pacm_v8::class_member_trampoline, v8::External::New(isolate, data), signature);
+            method->RemovePrototype();
+            prototype->Set(key, method, v8::DontEnum);
+            break;
+        }
+        case SHIM_CLASS_PROPERTY: {
+            v8::Local<v8::FunctionTemplate> getter = v8::FunctionTemplate::New(
+                isolate, pacm_v8::class_member_trampoline, v8::External::New(isolate, data), signature);
+            v8::Local<v8::FunctionTemplate> setter;
+            if (member.setter_id != 0) {
+                owned.push_back(std::make_unique<pacm_v8::ClassMember>(pacm_v8::ClassMember{member.setter_id}));
+                setter = v8::FunctionTemplate::New(
+                    isolate, pacm_v8::class_member_trampoline, v8::External::New(isolate, owned.back().get()), signature);
+            }
+            prototype->SetAccessorProperty(key, getter, setter, v8::DontEnum);
+            break;
+        }
+        default:
+            pacm_v8::assign_error(error_out, "unknown class member kind");
+            return 0;
+        }
+    }
+
+    cls->constructor.Reset(isolate, constructor);
+    cls->members = std::move(owned);
+    wrapper->classes.push_back(std::move(cls));
+    *class_id_out = static_cast<uint32_t>(wrapper->classes.size());
+    return 1;
+}
+
+int shim_context_new_instance(
+    V8ContextHandle handle,
+    uint32_t class_id,
+    uint64_t instance_token,
+    const char* path,
+    size_t path_length,
+    char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::ContextWrapper* context = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_context(handle, context, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+    if (!path || path_length == 0) {
+        pacm_v8::assign_error(error_out, "instance path was empty");
+        return 0;
+    }
+    pacm_v8::IsolateWrapper* wrapper = context->isolate_wrapper;
+    if (class_id == 0 || class_id > wrapper->classes.size()) {
+        pacm_v8::assign_error(error_out, "unknown class id");
+        return 0;
+    }
+
+    v8::Isolate* isolate = context->isolate();
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+    v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context->context);
+    v8::Context::Scope context_scope(ctx);
+    v8::TryCatch try_catch(isolate);
+
+    v8::Local<v8::Object> target;
+    v8::Local<v8::String> key;
+    if (!pacm_v8::ensure_property_path(isolate, ctx, std::string_view(path, path_length), target, key, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+
+    // Instantiating the template does not run the constructor callback.
+    v8::Local<v8::FunctionTemplate> constructor = wrapper->classes[class_id - 1]->constructor.Get(isolate);
+    v8::Local<v8::Object> object;
+    if (!constructor->InstanceTemplate()->NewInstance(ctx).ToLocal(&object)) {
+        pacm_v8::capture_exception(isolate, try_catch, error);
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+    if (!target->Set(ctx, key, object).FromMaybe(false)) {
+        pacm_v8::capture_exception(isolate, try_catch, error);
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+
+    auto* instance = new pacm_v8::ClassInstance();
+    instance->context = context;
+    instance->token = instance_token;
+    instance->object.Reset(isolate, object);
+    instance->object.SetWeak(instance, pacm_v8::instance_collected, v8::WeakCallbackType::kParameter);
+    object->SetAlignedPointerInInternalField(0, instance);
+    context->class_instances.insert(instance);
+    return 1;
+}
+
+} // extern "C"
@@ -1,21 +1,20 @@
 #include "shim_internal.h"
 
+#include <algorithm>
 #include <cstring>
+#include <limits>
 #include <vector>
 
-namespace {
-constexpr std::size_t kMaxCacheableSourceLength = 64 * 1024;
-}
-
 namespace pacm_v8 {
 
-static bool ensure_property_path(
+bool ensure_property_path(
     v8::Isolate* isolate,
     v8::Local<v8::Context> ctx,
     std::string_view path,
     v8::Local<v8::Object>& target_out,
     v8::Local<v8::String>& property_out,
-    std::string& error_out) {
+    std::string& error_out,
+    PropertyPathCache* cache) {
     if (path.empty()) {
         error_out = "property name was empty";
         return false;
@@ -31,8 +30,20 @@ static bool ensure_property_path(
             return false;
         }
 
-        std::string segment_str(segment);
-        v8::Local<v8::String> key = v8::String::NewFromUtf8(isolate, segment_str.c_str(), v8::NewStringType::kNormal).ToLocalChecked();
+        if (dot != std::string_view::npos && cache) {
+            auto cached = cache->find(path.substr(0, dot));
+            if (cached != cache->end()) {
+                current = cached->second;
+                start = dot + 1;
+                continue;
+            }
+        }
+
+        v8::Local<v8::String> key;
+        if (!new_utf8_string(isolate, segment, key, v8::NewStringType::kInternalized)) {
+            error_out = "property path was too long";
+            return false;
+        }
 
         if (dot == std::string_view::npos) {
             target_out = current;
@@ -54,6 +65,9 @@ static bool ensure_property_path(
         } else {
             current = next.As<v8::Object>();
         }
+        if (cache) {
+            cache->emplace(path.substr(0, dot), current);
+        }
 
         start = dot + 1;
     }
@@ -62,48 +76,143 @@ static bool ensure_property_path(
     return false;
 }
 
+HostCallScope::HostCallScope(IsolateWrapper* isolate) : isolate_(isolate) {
+    ++isolate_->host_call_depth;
+}
+
+HostCallScope::~HostCallScope() {
+    if (--isolate_->host_call_depth == 0 && isolate_->release_pending) {
+        release_retired_callbacks(isolate_);
+    }
+}
+
+void retire_native_callback(IsolateWrapper* wrapper, std::unique_ptr<NativeCallbackData> data) {
+    if (!data) {
+        return;
+    }
+    data->retired = true;
+    wrapper->retired_callbacks.push_back(std::move(data));
+    wrapper->release_pending = true;
+    release_retired_callbacks(wrapper);
+}
+
+void release_retired_callbacks(IsolateWrapper* wrapper) {
+    if (wrapper->host_call_depth > 0 || wrapper->releasing_callbacks) {
+        return;
+    }
+    wrapper->releasing_callbacks = true;
+    auto& retired = wrapper->retired_callbacks;
+    // Dropping a host callback runs host code, which may retire further entries.
+    for (std::size_t i = 0; i < retired.size(); ++i) {
+        NativeCallbackData* data = retired[i].get();
+        if (data->function_id != 0) {
+            const uint64_t function_id = data->function_id;
+            data->function_id = 0;
+            ::pacm_v8__host_function_drop(function_id);
+        }
+    }
+    retired.erase(
+        std::remove_if(retired.begin(), retired.end(), [](const std::unique_ptr<NativeCallbackData>& data) { return data->externals.empty(); }),
+        retired.end());
+    wrapper->release_pending = false;
+    wrapper->releasing_callbacks = false;
+}
+
+// First pass only: destroying the CallbackExternal resets its handle. The entry itself is
+// freed by the next release, which runs outside of garbage collection.
+static void callback_external_collected(const v8::WeakCallbackInfo<CallbackExternal>& info) {
+    CallbackExternal* external = info.GetParameter();
+    NativeCallbackData* data = external->data;
+    auto& externals = data->externals;
+    externals.erase(std::find_if(externals.begin(), externals.end(), [external](const std::unique_ptr<CallbackExternal>& entry) {
+        return entry.get() == external;
+    }));
+    if (data->retired && externals.empty()) {
+        data->isolate_wrapper->release_pending = true;
+    }
+}
+
 static void dispose_native_callbacks(ContextWrapper* context) {
     for (auto& entry : context->native_callbacks) {
-        if (entry.second) {
-            ::pacm_v8__host_function_drop(entry.second->function_id);
-        }
+        retire_native_callback(context->isolate_wrapper, std::move(entry.second));
     }
     context->native_callbacks.clear();
+    context->native_callback_order.clear();
 }
 
-static void native_function_trampoline(const v8::FunctionCallbackInfo<v8::Value>& info) {
-    v8::Isolate* isolate = info.GetIsolate();
-    v8::HandleScope handle_scope(isolate);
-
-    if (info.Data().IsEmpty()) {
-        isolate->ThrowException(v8::String::NewFromUtf8(isolate, "host function metadata missing", v8::NewStringType::kNormal).ToLocalChecked());
+// Registers data under path, retiring the entry it replaces.
+static void store_native_callback(ContextWrapper* context, std::string path, std::unique_ptr<NativeCallbackData> data) {
+    auto& order = context->native_callback_order;
+    auto existing = context->native_callbacks.find(path);
+    if (existing != context->native_callbacks.end()) {
+        retire_native_callback(context->isolate_wrapper, std::move(existing->second));
+        existing->second = std::move(data);
+        order.erase(std::find(order.begin(), order.end(), path));
+        order.push_back(std::move(path));
         return;
     }
+    order.push_back(path);
+    context->native_callbacks.emplace(std::move(path), std::move(data));
+}
 
-    auto external = info.Data().As<v8::External>();
-    auto* data = static_cast<NativeCallbackData*>(external->Value());
-    if (!data) {
-        isolate->ThrowException(v8::String::NewFromUtf8(isolate, "host function metadata missing", v8::NewStringType::kNormal).ToLocalChecked());
+// Payloads the host wrote into the scratch buffer stay owned by the arena.
+static void release_host_result(ShimValue& result, const uint8_t* scratch_buffer) {
+    if (result.data == scratch_buffer) {
+        result = ShimValue{};
         return;
     }
+    ::pacm_v8__value_release(&result);
+}
 
-    std::vector<char*> arguments;
-    arguments.reserve(info.Length());
-    for (int i = 0; i < info.Length(); ++i) {
-        arguments.push_back(value_to_utf8(isolate, info[i]));
+// Borrows the call's arguments into scratch; null when there are none.
+static const ShimValue* borrow_arguments(const v8::FunctionCallbackInfo<v8::Value>& info, ScratchArena& scratch) {
+    const auto arg_count = static_cast<std::size_t>(info.Length());
+    if (arg_count == 0) {
+        return nullptr;
+    }
+    auto* arguments = static_cast<ShimValue*>(scratch.allocate(sizeof(ShimValue) * arg_count, alignof(ShimValue)));
+    for (std::size_t i = 0; i < arg_count; ++i) {
+        to_shim_value_borrowed(info.GetIsolate(), info[static_cast<int>(i)], arguments[i], scratch);
     }
+    return arguments;
+}
 
-    const char** argv = arguments.empty() ? nullptr : const_cast<const char**>(arguments.data());
-    char* result_ptr = nullptr;
-    char* error_ptr = nullptr;
+void call_host_function(
+    const v8::FunctionCallbackInfo<v8::Value>& info,
+    IsolateWrapper* isolate_wrapper,
+    uint64_t function_id,
+    const uint64_t* instance_token,
+    int32_t fast_return_type) {
+    v8::Isolate* isolate = info.GetIsolate();
 
-    int status = ::pacm_v8__host_function_invoke(data->function_id, argv, arguments.size(), &result_ptr, &error_ptr);
+    // Arguments and the result buffer live in the thread's scratch arena for this call only.
+    ScratchArena& scratch = thread_scratch();
+    ScratchScope scratch_scope(scratch);
+    const auto arg_count = static_cast<std::size_t>(info.Length());
+    const ShimValue* argv = borrow_arguments(info, scratch);
+
+    // Short string and byte results are written into this buffer instead of a host allocation.
+    auto* result_buffer = static_cast<uint8_t*>(scratch.allocate(kHostResultScratchBytes, 1));
+    ShimValue result{};
+    result.data = result_buffer;
+    result.length = kHostResultScratchBytes;
+    char* error_ptr = nullptr;
 
-    for (char* value : arguments) {
-        shim_free_string(value);
+#ifdef PACM_V8_INSTRUMENTATION
+    auto* context = static_cast<ContextWrapper*>(
+        isolate->GetCurrentContext()->GetAlignedPointerFromEmbedderData(kContextWrapperEmbedderIndex));
+#endif
+    HostCallScope host_call(isolate_wrapper);
+    int status = 0;
+    {
+        PACM_V8_SPAN(context, host, "host");
+        status = instance_token
+            ? ::pacm_v8__class_member_invoke(function_id, *instance_token, argv, arg_count, &result, &error_ptr)
+            : ::pacm_v8__host_function_invoke(function_id, argv, arg_count, &result, &error_ptr);
     }
 
     if (!status) {
+        release_host_result(result, result_buffer);
         std::string message = error_ptr ? std::string(error_ptr) : std::string("host function invocation failed");
         if (error_ptr) {
             ::pacm_v8__string_free(error_ptr);
@@ -116,72 +225,1024 @@ static void native_function_trampoline(const v8::FunctionCallbackInfo<v8::Value>
         ::pacm_v8__string_free(error_ptr);
     }
 
-    if (result_ptr) {
-        v8::Local<v8::String> result = v8::String::NewFromUtf8(isolate, result_ptr, v8::NewStringType::kNormal).ToLocalChecked();
-        ::pacm_v8__string_free(result_ptr);
-        info.GetReturnValue().Set(result);
-    } else {
-        info.GetReturnValue().Set(v8::Undefined(isolate));
-    }
+    // Same result as the fast path would produce; optimizing the caller must not change it.
+    if (fast_return_type == SHIM_FAST_VOID) {
+        release_host_result(result, result_buffer);
+        return;
+    }
+    if (fast_return_type != kNoFastSignature && !coerce_fast_result(fast_return_type, result)) {
+        release_host_result(result, result_buffer);
+        isolate->ThrowError(v8::String::NewFromUtf8Literal(isolate, "host function returned a value that does not match its fast signature"));
+        return;
+    }
+
+    v8::Local<v8::Value> js_result;
+    bool converted = from_shim_value(isolate, result, js_result);
+    release_host_result(result, result_buffer);
+    if (!converted) {
+        isolate->ThrowException(v8::String::NewFromUtf8(isolate, "host function returned an unsupported value", v8::NewStringType::kNormal).ToLocalChecked());
+        return;
+    }
+    info.GetReturnValue().Set(js_result);
+}
+
+static void native_function_trampoline(const v8::FunctionCallbackInfo<v8::Value>& info) {
+    v8::Isolate* isolate = info.GetIsolate();
+    v8::HandleScope handle_scope(isolate);
+
+    if (info.Data().IsEmpty()) {
+        isolate->ThrowException(v8::String::NewFromUtf8(isolate, "host function metadata missing", v8::NewStringType::kNormal).ToLocalChecked());
+        return;
+    }
+
+    NativeCallbackData* data = nullptr;
+    if (info.Data()->IsString()) {
+        // Functions restored from a snapshot carry their path instead of a pointer; the
+        // callback id is bound later through shim_context_bind_host_function.
+        v8::Local<v8::Context> ctx = isolate->GetCurrentContext();
+        auto* context = static_cast<ContextWrapper*>(ctx->GetAlignedPointerFromEmbedderData(kContextWrapperEmbedderIndex));
+        v8::String::Utf8Value path(isolate, info.Data());
+        if (context && *path) {
+            auto bound = context->native_callbacks.find(std::string_view(*path, path.length()));
+            if (bound != context->native_callbacks.end()) {
+                data = bound->second.get();
+            }
+        }
+        if (!data) {
+            std::string message = "host function '";
+            message.append(*path ? *path : "");
+            message.append("' is not bound");
+            isolate->ThrowException(v8::String::NewFromUtf8(isolate, message.c_str(), v8::NewStringType::kNormal).ToLocalChecked());
+            return;
+        }
+    } else {
+        auto external = info.Data().As<v8::External>();
+        data = static_cast<NativeCallbackData*>(external->Value());
+    }
+    if (!data) {
+        isolate->ThrowException(v8::String::NewFromUtf8(isolate, "host function metadata missing", v8::NewStringType::kNormal).ToLocalChecked());
+        return;
+    }
+    if (data->retired) {
+        isolate->ThrowException(v8::String::NewFromUtf8Literal(isolate, "host function was released"));
+        return;
+    }
+
+    if (data->async) {
+        v8::Local<v8::Context> ctx = isolate->GetCurrentContext();
+        auto* context = static_cast<ContextWrapper*>(ctx->GetAlignedPointerFromEmbedderData(kContextWrapperEmbedderIndex));
+        if (!context) {
+            isolate->ThrowException(v8::String::NewFromUtf8Literal(isolate, "context was disposed"));
+            return;
+        }
+        ScratchArena& scratch = thread_scratch();
+        ScratchScope scratch_scope(scratch);
+        const ShimValue* argv = borrow_arguments(info, scratch);
+        v8::Local<v8::Promise> promise;
+        if (start_host_promise(context, ctx, data->function_id, argv, static_cast<std::size_t>(info.Length()), promise)) {
+            info.GetReturnValue().Set(promise);
+        }
+        return;
+    }
+
+    call_host_function(info, data->isolate_wrapper, data->function_id, nullptr, data->fast_return_type);
+}
+
+const intptr_t* external_references() {
+    static const intptr_t references[] = {
+        reinterpret_cast<intptr_t>(native_function_trampoline),
+        0,
+    };
+    return references;
+}
+
+bool install_host_function_stub(v8::Isolate* isolate, v8::Local<v8::Context> ctx, const char* name, std::string& error_out) {
+    v8::TryCatch try_catch(isolate);
+
+    v8::Local<v8::Object> target;
+    v8::Local<v8::String> key;
+    if (!ensure_property_path(isolate, ctx, name, target, key, error_out)) {
+        return false;
+    }
+
+    v8::Local<v8::String> metadata = v8::String::NewFromUtf8(isolate, name, v8::NewStringType::kNormal).ToLocalChecked();
+    v8::Local<v8::FunctionTemplate> tpl = v8::FunctionTemplate::New(isolate, native_function_trampoline, metadata);
+    v8::Local<v8::Function> function;
+    if (!tpl->GetFunction(ctx).ToLocal(&function)) {
+        capture_exception(isolate, try_catch, error_out);
+        return false;
+    }
+
+    function->SetName(key);
+
+    if (!target->Set(ctx, key, function).FromMaybe(false)) {
+        capture_exception(isolate, try_catch, error_out);
+        return false;
+    }
+    return true;
+}
+
+static bool eval_source(
+    ContextWrapper* context,
+    v8::Local<v8::Context> ctx,
+    SourceText& source,
+    v8::TryCatch& try_catch,
+    v8::Local<v8::Value>& result_out,
+    std::string& error_out) {
+    v8::Isolate* isolate = context->isolate();
+
+    const bool cacheable = source.byte_length() <= kMaxCacheableSourceLength;
+    ScriptCacheKey key;
+    if (cacheable) {
+        key = source.cache_key();
+    }
+
+    v8::Local<v8::Script> script;
+    v8::Local<v8::UnboundScript> unbound;
+    ScriptCache& cache = context->isolate_wrapper->script_cache;
+    if (cacheable && cache.lookup(isolate, key, &context->cache_user, unbound)) {
+        PACM_V8_COUNT(context, cache_hits);
+        script = unbound->BindToCurrentContext();
+    } else {
+        if (cacheable) {
+            PACM_V8_COUNT(context, cache_misses);
+        }
+        PACM_V8_SPAN(context, compile, "compile");
+        v8::Local<v8::String> src;
+        if (!source.to_string(isolate, src)) {
+            error_out = "source was too long";
+            return false;
+        }
+        if (!v8::Script::Compile(ctx, src).ToLocal(&script)) {
+            capture_exception(isolate, try_catch, error_out);
+            return false;
+        }
+
+        if (cacheable) {
+            cache.insert(isolate, key, &context->cache_user, script->GetUnboundScript());
+        }
+    }
+
+    bool ran = false;
+    {
+        PACM_V8_SPAN(context, run, "run");
+        ran = script->Run(ctx).ToLocal(&result_out);
+    }
+    if (!ran) {
+        capture_exception(isolate, try_catch, error_out);
+        return false;
+    }
+    return true;
+}
+
+static bool lookup_global_function(
+    v8::Isolate* isolate,
+    v8::Local<v8::Context> ctx,
+    std::string_view fn_name,
+    v8::Local<v8::Function>& function_out,
+    std::string& error_out) {
+    v8::Local<v8::Object> global = ctx->Global();
+    v8::Local<v8::String> key;
+    v8::Local<v8::Value> maybe_function;
+    if (!new_utf8_string(isolate, fn_name, key) || !global->Get(ctx, key).ToLocal(&maybe_function) || !maybe_function->IsFunction()) {
+        error_out = "global function not found";
+        return false;
+    }
+    function_out = maybe_function.As<v8::Function>();
+    return true;
+}
+
+static bool own_global_keys(v8::Local<v8::Context> ctx, v8::Local<v8::Array>& keys_out) {
+    return ctx->Global()
+        ->GetPropertyNames(
+            ctx,
+            v8::KeyCollectionMode::kOwnOnly,
+            v8::PropertyFilter::ALL_PROPERTIES,
+            v8::IndexFilter::kIncludeIndices)
+        .ToLocal(&keys_out);
+}
+
+static bool record_baseline(ContextWrapper* context, v8::Local<v8::Context> ctx, std::string& error_out) {
+    v8::Isolate* isolate = context->isolate();
+    v8::Local<v8::Object> global = ctx->Global();
+
+    v8::Local<v8::Array> keys;
+    if (!own_global_keys(ctx, keys)) {
+        error_out = "failed to enumerate global properties";
+        return false;
+    }
+
+    v8::Local<v8::Map> baseline = v8::Map::New(isolate);
+    for (uint32_t i = 0; i < keys->Length(); ++i) {
+        v8::Local<v8::Value> key;
+        v8::Local<v8::Value> value;
+        if (!keys->Get(ctx, i).ToLocal(&key) || !global->Get(ctx, key).ToLocal(&value)) {
+            error_out = "failed to read global property";
+            return false;
+        }
+        if (baseline->Set(ctx, key, value).IsEmpty()) {
+            error_out = "failed to record global property";
+            return false;
+        }
+    }
+
+    if (context->baseline) {
+        context->baseline->Reset();
+    }
+    context->baseline = std::make_unique<v8::Global<v8::Map>>(isolate, baseline);
+    return true;
+}
+
+// Top-level let/const/class bindings live in the script context rather than on the global
+// object, so they survive a restore; callers that need those gone must use a fresh context.
+static bool restore_baseline(ContextWrapper* context, v8::Local<v8::Context> ctx, std::string& error_out) {
+    v8::Isolate* isolate = context->isolate();
+    if (!context->baseline) {
+        error_out = "context has no recorded baseline";
+        return false;
+    }
+
+    v8::Local<v8::Object> global = ctx->Global();
+    v8::Local<v8::Map> baseline = v8::Local<v8::Map>::New(isolate, *context->baseline);
+
+    v8::Local<v8::Array> keys;
+    if (!own_global_keys(ctx, keys)) {
+        error_out = "failed to enumerate global properties";
+        return false;
+    }
+    for (uint32_t i = 0; i < keys->Length(); ++i) {
+        v8::Local<v8::Value> key;
+        if (!keys->Get(ctx, i).ToLocal(&key)) {
+            continue;
+        }
+        if (!baseline->Has(ctx, key).FromMaybe(true)) {
+            // Non-configurable properties (top-level var) cannot be deleted; they are reset below if recorded.
+            global->Delete(ctx, key).FromMaybe(false);
+        }
+    }
+
+    v8::Local<v8::Array> entries = baseline->AsArray();
+    for (uint32_t i = 0; i + 1 < entries->Length(); i += 2) {
+        v8::Local<v8::Value> key;
+        v8::Local<v8::Value> original;
+        if (!entries->Get(ctx, i).ToLocal(&key) || !entries->Get(ctx, i + 1).ToLocal(&original)) {
+            continue;
+        }
+        v8::Local<v8::Value> current;
+        if (global->Get(ctx, key).ToLocal(&current) && current->StrictEquals(original)) {
+            continue;
+        }
+        global->Set(ctx, key, original).FromMaybe(false);
+    }
+    return true;
+}
+
+static bool eval_batch_item(
+    ContextWrapper* context,
+    v8::Local<v8::Context> ctx,
+    const ShimBatchItem& item,
+    v8::TryCatch& try_catch,
+    ShimBatchResult& result_out,
+    std::string& error_out) {
+    v8::Isolate* isolate = context->isolate();
+
+    v8::Local<v8::Value> value;
+    if (item.script) {
+        ScriptWrapper* script = nullptr;
+        if (!ensure_script(item.script, script, error_out)) {
+            return false;
+        }
+        if (script->isolate_wrapper != context->isolate_wrapper) {
+            error_out = "script and context belong to different isolates";
+            return false;
+        }
+        if (!run_script(script, context, ctx, try_catch, value, error_out)) {
+            return false;
+        }
+    } else if (item.source) {
+        SourceText source(std::string_view{item.source, item.source_length});
+        if (!eval_source(context, ctx, source, try_catch, value, error_out)) {
+            return false;
+        }
+    } else {
+        error_out = "batch item had neither source nor script";
+        return false;
+    }
+
+    if (item.arg_count > 0) {
+        if (!item.args) {
+            error_out = "arguments were null";
+            return false;
+        }
+        if (!value->IsFunction()) {
+            error_out = "batch item with arguments did not evaluate to a function";
+            return false;
+        }
+        std::vector<v8::Local<v8::Value>> js_args(item.arg_count);
+        {
+            PACM_V8_SPAN(context, marshal, "marshal");
+            for (std::size_t i = 0; i < item.arg_count; ++i) {
+                if (!from_shim_value(isolate, item.args[i], js_args[i])) {
+                    error_out = "argument could not be converted";
+                    return false;
+                }
+            }
+        }
+        v8::Local<v8::Value> called;
+        bool ok = false;
+        {
+            PACM_V8_SPAN(context, call, "call");
+            ok = value.As<v8::Function>()->Call(ctx, ctx->Global(), static_cast<int>(js_args.size()), js_args.data()).ToLocal(&called);
+        }
+        if (!ok) {
+            capture_exception(isolate, try_catch, error_out);
+            return false;
+        }
+        value = called;
+    }
+
+    PACM_V8_SPAN(context, marshal, "marshal");
+    if (!to_shim_value_owned(isolate, value, result_out.value)) {
+        error_out = "failed to allocate result buffer";
+        return false;
+    }
+    return true;
+}
+
+bool ensure_context(V8ContextHandle handle, ContextWrapper*& out, std::string& error_out) {
+    out = unwrap_context(handle);
+    if (!out || !out->isolate()) {
+        error_out = "invalid V8 context handle";
+        return false;
+    }
+    return true;
+}
+
+static int call_global_function(
+    V8ContextHandle handle,
+    const char* fn_name,
+    std::size_t name_length,
+    const ShimValue* args,
+    std::size_t arg_count,
+    const ResultOut& result_out,
+    char** error_out) {
+    result_out.reset();
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    ContextWrapper* context = nullptr;
+    std::string error;
+    if (!ensure_context(handle, context, error)) {
+        assign_error(error_out, error);
+        return 0;
+    }
+    if (!fn_name) {
+        assign_error(error_out, "function name was null");
+        return 0;
+    }
+    if (!args && arg_count > 0) {
+        assign_error(error_out, "arguments were null");
+        return 0;
+    }
+
+    v8::Isolate* isolate = context->isolate();
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+    v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context->context);
+    v8::Context::Scope context_scope(ctx);
+    v8::TryCatch try_catch(isolate);
+    ExecutionGuard guard(context->isolate_wrapper, context);
+    if (guard.refused()) {
+        return guard.reject(error_out);
+    }
+
+    v8::Local<v8::Function> function;
+    if (!lookup_global_function(isolate, ctx, std::string_view{fn_name, name_length}, function, error)) {
+        assign_error(error_out, error);
+        return 0;
+    }
+
+    std::vector<v8::Local<v8::Value>> js_args(arg_count);
+    {
+        PACM_V8_SPAN(context, marshal, "marshal");
+        for (std::size_t i = 0; i < arg_count; ++i) {
+            if (!from_shim_value(isolate, args[i], js_args[i])) {
+                assign_error(error_out, "argument could not be converted");
+                return 0;
+            }
+        }
+    }
+
+    v8::Local<v8::Value> result;
+    bool called = false;
+    {
+        PACM_V8_SPAN(context, call, "call");
+        called = function->Call(ctx, ctx->Global(), static_cast<int>(js_args.size()), js_args.data()).ToLocal(&result);
+    }
+    if (!called) {
+        std::string message;
+        capture_exception(isolate, try_catch, message);
+        int status = execution_failure(context->isolate_wrapper, message);
+        assign_error(error_out, message);
+        return status;
+    }
+
+    PACM_V8_SPAN(context, marshal, "marshal");
+    if (!result_out.assign(isolate, ctx, result, try_catch, error)) {
+        assign_error(error_out, error);
+        return 0;
+    }
+
+    return 1;
+}
+
+static int eval_value(
+    V8ContextHandle handle,
+    SourceText& source,
+    bool await_result,
+    const ResultOut& result_out,
+    char** error_out) {
+    result_out.reset();
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    ContextWrapper* context = nullptr;
+    std::string error;
+    if (!ensure_context(handle, context, error)) {
+        assign_error(error_out, error);
+        return 0;
+    }
+    if (source.is_null()) {
+        assign_error(error_out, "source was null");
+        return 0;
+    }
+    if (!source.has_valid_encoding()) {
+        assign_error(error_out, "unsupported source encoding");
+        return 0;
+    }
+
+    v8::Isolate* isolate = context->isolate();
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+    v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context->context);
+    v8::Context::Scope context_scope(ctx);
+
+    v8::TryCatch try_catch(isolate);
+    ExecutionGuard guard(context->isolate_wrapper, context);
+    if (guard.refused()) {
+        return guard.reject(error_out);
+    }
+
+    v8::Local<v8::Value> result;
+    if (!eval_source(context, ctx, source, try_catch, result, error)) {
+        int status = execution_failure(context->isolate_wrapper, error);
+        assign_error(error_out, error);
+        return status;
+    }
+    if (await_result) {
+        int status = settle_value(context, ctx, try_catch, result, error);
+        if (status != SHIM_STATUS_OK) {
+            assign_error(error_out, error);
+            return status;
+        }
+    }
+
+    PACM_V8_SPAN(context, marshal, "marshal");
+    if (!result_out.assign(isolate, ctx, result, try_catch, error)) {
+        assign_error(error_out, error);
+        return 0;
+    }
+
+    return 1;
+}
+
+// Creates the function object for data at name; shim_context_reset calls it again for the
+// replacement context.
+static bool install_host_function(
+    v8::Isolate* isolate,
+    v8::Local<v8::Context> ctx,
+    const char* name,
+    NativeCallbackData* data,
+    std::string& error_out) {
+    v8::TryCatch try_catch(isolate);
+
+    v8::Local<v8::Object> target;
+    v8::Local<v8::String> key;
+    if (!ensure_property_path(isolate, ctx, name, target, key, error_out)) {
+        return false;
+    }
+
+    v8::Local<v8::External> metadata = v8::External::New(isolate, data);
+    auto external = std::make_unique<CallbackExternal>();
+    external->data = data;
+    external->handle.Reset(isolate, metadata);
+    external->handle.SetWeak(external.get(), callback_external_collected, v8::WeakCallbackType::kParameter);
+    data->externals.push_back(std::move(external));
+    // With a fast path, optimized code calls fast_function directly and the trampoline only
+    // serves the interpreter and calls whose arguments do not match the signature.
+    v8::Local<v8::FunctionTemplate> tpl = v8::FunctionTemplate::New(
+        isolate,
+        native_function_trampoline,
+        metadata,
+        v8::Local<v8::Signature>(),
+        0,
+        data->fast_function ? v8::ConstructorBehavior::kThrow : v8::ConstructorBehavior::kAllow,
+        v8::SideEffectType::kHasSideEffect,
+        data->fast_function);
+    v8::Local<v8::Function> function;
+    if (!tpl->GetFunction(ctx).ToLocal(&function)) {
+        capture_exception(isolate, try_catch, error_out);
+        return false;
+    }
+
+    function->SetName(key);
+
+    if (!target->Set(ctx, key, function).FromMaybe(false)) {
+        capture_exception(isolate, try_catch, error_out);
+        return false;
+    }
+    return true;
+}
+
+static int register_host_function(
+    V8ContextHandle handle,
+    const char* name,
+    uint64_t function_id,
+    bool async,
+    const v8::CFunction* fast_function,
+    int32_t fast_return_type,
+    char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    ContextWrapper* context = nullptr;
+    std::string error;
+    if (!ensure_context(handle, context, error)) {
+        assign_error(error_out, error);
+        return 0;
+    }
+
+    if (!name) {
+        assign_error(error_out, "function name was null");
+        return 0;
+    }
+
+    v8::Isolate* isolate = context->isolate();
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+    v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context->context);
+    v8::Context::Scope context_scope(ctx);
+
+    auto data = std::make_unique<NativeCallbackData>();
+    data->isolate_wrapper = context->isolate_wrapper;
+    data->function_id = function_id;
+    data->async = async;
+    data->fast_function = fast_function;
+    data->fast_return_type = fast_return_type;
+
+    if (!install_host_function(isolate, ctx, name, data.get(), error)) {
+        // A function object may have been created before the failure; the caller keeps the id.
+        data->function_id = 0;
+        retire_native_callback(context->isolate_wrapper, std::move(data));
+        assign_error(error_out, error);
+        return 0;
+    }
+
+    store_native_callback(context, name, std::move(data));
+    return 1;
+}
+
+// Swaps a brand-new V8 context in behind the wrapper. Host callbacks, the script cache
+// registration and the limits stay with the wrapper; functions bound to snapshot stubs find
+// their callbacks by path, the others are installed again.
+static bool recreate_context(ContextWrapper* context, std::string& error_out) {
+    v8::Isolate* isolate = context->isolate();
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+
+    v8::Local<v8::Context> fresh;
+    if (context->isolate_wrapper->has_snapshot()) {
+        if (!v8::Context::FromSnapshot(isolate, kSnapshotContextIndex).ToLocal(&fresh)) {
+            error_out = "failed to create context from snapshot";
+            return false;
+        }
+    } else {
+        fresh = v8::Context::New(isolate);
+    }
+
+    {
+        v8::Context::Scope context_scope(fresh);
+        for (const std::string& path : context->native_callback_order) {
+            NativeCallbackData* data = context->native_callbacks.find(path)->second.get();
+            if (!data || data->bound) {
+                continue;
+            }
+            if (!install_host_function(isolate, fresh, path.c_str(), data, error_out)) {
+                return false;
+            }
+        }
+    }
+
+    // Function handles may keep the old context alive; they see it as disposed from now on.
+    v8::Local<v8::Context> old = v8::Local<v8::Context>::New(isolate, *context->context);
+    old->SetAlignedPointerInEmbedderData(kContextWrapperEmbedderIndex, nullptr);
+    fresh->SetAlignedPointerInEmbedderData(kContextWrapperEmbedderIndex, context);
+    context->context->Reset(isolate, fresh);
+
+    // Everything below referred to objects of the old context.
+    if (context->baseline) {
+        context->baseline->Reset();
+        context->baseline.reset();
+    }
+    context->modules.clear();
+    context->module_names.clear();
+    return true;
+}
+
+} // namespace pacm_v8
+
+extern "C" {
+
+V8ContextHandle shim_create_context(V8IsolateHandle handle) {
+    pacm_v8::IsolateWrapper* isolate_wrapper = pacm_v8::unwrap_isolate(handle);
+    if (!isolate_wrapper || !isolate_wrapper->isolate) {
+        return nullptr;
+    }
+
+    v8::Isolate* isolate = isolate_wrapper->isolate;
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+    v8::Local<v8::Context> local_context;
+    if (isolate_wrapper->has_snapshot()) {
+        if (!v8::Context::FromSnapshot(isolate, pacm_v8::kSnapshotContextIndex).ToLocal(&local_context)) {
+            return nullptr;
+        }
+    } else {
+        local_context = v8::Context::New(isolate);
+    }
+    auto persistent = std::make_unique<v8::Global<v8::Context>>(isolate, local_context);
+
+    auto* wrapper = new pacm_v8::ContextWrapper();
+    wrapper->isolate_wrapper = isolate_wrapper;
+    wrapper->context = std::move(persistent);
+    local_context->SetAlignedPointerInEmbedderData(pacm_v8::kContextWrapperEmbedderIndex, wrapper);
+    return reinterpret_cast<V8ContextHandle>(wrapper);
+}
+
+void shim_dispose_context(V8ContextHandle handle) {
+    pacm_v8::ContextWrapper* context = pacm_v8::unwrap_context(handle);
+    if (!context) {
+        return;
+    }
+
+    if (context->isolate_wrapper) {
+        context->isolate_wrapper->script_cache.release(context->cache_user);
+    }
+
+    pacm_v8::dispose_native_callbacks(context);
+    pacm_v8::dispose_class_instances(context);
+    pacm_v8::close_completions(context);
+    context->modules.clear();
+    context->module_names.clear();
+
+    if (context->baseline) {
+        context->baseline->Reset();
+    }
+
+    if (context->context) {
+        v8::Isolate* isolate = context->isolate();
+        if (isolate) {
+            // Function handles may keep the V8 context alive past this wrapper.
+            v8::Isolate::Scope isolate_scope(isolate);
+            v8::HandleScope handle_scope(isolate);
+            v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context->context);
+            ctx->SetAlignedPointerInEmbedderData(pacm_v8::kContextWrapperEmbedderIndex, nullptr);
+        }
+        context->context->Reset();
+    }
+
+    delete context;
+}
+
+int shim_context_eval(V8ContextHandle handle, const char* source, char** result_out, char** error_out) {
+    if (result_out) {
+        *result_out = nullptr;
+    }
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::ContextWrapper* context = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_context(handle, context, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+    if (!source) {
+        pacm_v8::assign_error(error_out, "source was null");
+        return 0;
+    }
+
+    v8::Isolate* isolate = context->isolate();
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+    v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context->context);
+    v8::Context::Scope context_scope(ctx);
+
+    v8::TryCatch try_catch(isolate);
+    pacm_v8::ExecutionGuard guard(context->isolate_wrapper, context);
+    if (guard.refused()) {
+        return pacm_v8::legacy_status(guard.reject(error_out));
+    }
+
+    v8::Local<v8::Value> result;
+    pacm_v8::SourceText text(std::string_view{source, std::strlen(source)});
+    if (!pacm_v8::eval_source(context, ctx, text, try_catch, result, error)) {
+        int status = pacm_v8::execution_failure(context->isolate_wrapper, error);
+        pacm_v8::assign_error(error_out, error);
+        return pacm_v8::legacy_status(status);
+    }
+
+    if (result_out) {
+        PACM_V8_SPAN(context, marshal, "marshal");
+        *result_out = pacm_v8::value_to_utf8(isolate, result);
+    }
+
+    return 1;
+}
+
+int shim_context_eval_value(V8ContextHandle handle, const char* source, ShimValue* result_out, char** error_out) {
+    return shim_context_eval_utf8(handle, source, source ? std::strlen(source) : 0, result_out, error_out);
+}
+
+int shim_context_eval_value_await(V8ContextHandle handle, const char* source, ShimValue* result_out, char** error_out) {
+    return shim_context_eval_utf8_await(handle, source, source ? std::strlen(source) : 0, result_out, error_out);
+}
+
+int shim_context_eval_utf8(V8ContextHandle handle, const char* source, size_t source_length, ShimValue* result_out, char** error_out) {
+    pacm_v8::SourceText text(std::string_view{source, source ? source_length : 0});
+    pacm_v8::ResultOut out;
+    out.value = result_out;
+    return pacm_v8::eval_value(handle, text, false, out, error_out);
+}
+
+int shim_context_eval_utf8_await(V8ContextHandle handle, const char* source, size_t source_length, ShimValue* result_out, char** error_out) {
+    pacm_v8::SourceText text(std::string_view{source, source ? source_length : 0});
+    pacm_v8::ResultOut out;
+    out.value = result_out;
+    return pacm_v8::eval_value(handle, text, true, out, error_out);
+}
+
+int shim_context_eval_external(V8ContextHandle handle, const ShimExternalSource* source, ShimValue* result_out, char** error_out) {
+    ShimExternalSource empty{};
+    pacm_v8::SourceText text(source ? *source : empty);
+    pacm_v8::ResultOut out;
+    out.value = result_out;
+    return pacm_v8::eval_value(handle, text, false, out, error_out);
+}
+
+int shim_context_eval_serialized(
+    V8ContextHandle handle,
+    const char* source,
+    std::size_t source_length,
+    uint8_t** data_out,
+    std::size_t* length_out,
+    char** error_out) {
+    pacm_v8::SourceText text(std::string_view{source, source ? source_length : 0});
+    pacm_v8::ResultOut out;
+    out.data = data_out;
+    out.length = length_out;
+    return pacm_v8::eval_value(handle, text, false, out, error_out);
+}
+
+int shim_context_eval_streamed(
+    V8ContextHandle handle,
+    const char* source,
+    std::size_t source_length,
+    int32_t flags,
+    void* sink,
+    char** error_out) {
+    if (!sink) {
+        if (error_out) {
+            *error_out = nullptr;
+        }
+        pacm_v8::assign_error(error_out, "output sink was null");
+        return 0;
+    }
+    pacm_v8::SourceText text(std::string_view{source, source ? source_length : 0});
+    pacm_v8::ResultOut out;
+    out.sink = sink;
+    out.output_flags = flags;
+    return pacm_v8::eval_value(handle, text, false, out, error_out);
+}
+
+int shim_context_eval_batch(
+    V8ContextHandle handle,
+    const ShimBatchItem* items,
+    std::size_t item_count,
+    ShimBatchResult* results_out,
+    char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::ContextWrapper* context = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_context(handle, context, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+    if (item_count > 0 && (!items || !results_out)) {
+        pacm_v8::assign_error(error_out, "batch items were null");
+        return 0;
+    }
+
+    v8::Isolate* isolate = context->isolate();
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+    v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context->context);
+    v8::Context::Scope context_scope(ctx);
+    v8::TryCatch try_catch(isolate);
+    pacm_v8::ExecutionGuard guard(context->isolate_wrapper, context);
+
+    // A timeout, exhausted budget or heap limit applies to the whole batch, not just the item it hit.
+    // A call refused before the batch started is reported per item like any other.
+    int abort_status = guard.refusal_status();
+    std::string abort_error = guard.refused() ? guard.refusal_message() : "";
+    for (std::size_t i = 0; i < item_count; ++i) {
+        // Per-item handle scope so a large batch does not pin every intermediate value.
+        v8::HandleScope item_scope(isolate);
+        ShimBatchResult& result = results_out[i];
+        result = ShimBatchResult{};
+        if (abort_status != SHIM_STATUS_OK) {
+            result.status = abort_status;
+            result.error = pacm_v8::copy_string(abort_error);
+            continue;
+        }
+
+        error.clear();
+        if (pacm_v8::eval_batch_item(context, ctx, items[i], try_catch, result, error)) {
+            result.status = SHIM_STATUS_OK;
+        } else {
+            result.status = pacm_v8::execution_failure(context->isolate_wrapper, error);
+            result.error = pacm_v8::copy_string(error);
+            if (result.status == SHIM_STATUS_TIMEOUT || result.status == SHIM_STATUS_CPU_BUDGET ||
+                result.status == SHIM_STATUS_HEAP_LIMIT) {
+                abort_status = result.status;
+                abort_error = error;
+            }
+        }
+        try_catch.Reset();
+    }
+
+    return 1;
+}
+
+int shim_context_set_global_string(V8ContextHandle handle, const char* name, const char* value, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::ContextWrapper* context = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_context(handle, context, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+
+    if (!name) {
+        pacm_v8::assign_error(error_out, "property name was null");
+        return 0;
+    }
+
+    v8::Isolate* isolate = context->isolate();
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+    v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context->context);
+    v8::Context::Scope context_scope(ctx);
+    v8::TryCatch try_catch(isolate);
+
+    v8::Local<v8::Object> target;
+    v8::Local<v8::String> key;
+    if (!pacm_v8::ensure_property_path(isolate, ctx, name, target, key, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+    v8::Local<v8::Value> js_value = v8::String::NewFromUtf8(isolate, value ? value : "", v8::NewStringType::kNormal).ToLocalChecked();
+
+    if (!target->Set(ctx, key, js_value).FromMaybe(false)) {
+        std::string message;
+        pacm_v8::capture_exception(isolate, try_catch, message);
+        pacm_v8::assign_error(error_out, message);
+        return 0;
+    }
+
+    return 1;
+}
+
+int shim_context_set_global_number(V8ContextHandle handle, const char* name, double value, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::ContextWrapper* context = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_context(handle, context, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+    if (!name) {
+        pacm_v8::assign_error(error_out, "property name was null");
+        return 0;
+    }
+
+    v8::Isolate* isolate = context->isolate();
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+    v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context->context);
+    v8::Context::Scope context_scope(ctx);
+    v8::TryCatch try_catch(isolate);
+
+    v8::Local<v8::Object> target;
+    v8::Local<v8::String> key;
+    if (!pacm_v8::ensure_property_path(isolate, ctx, name, target, key, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+    v8::Local<v8::Number> js_value = v8::Number::New(isolate, value);
+
+    if (!target->Set(ctx, key, js_value).FromMaybe(false)) {
+        std::string message;
+        pacm_v8::capture_exception(isolate, try_catch, message);
+        pacm_v8::assign_error(error_out, message);
+        return 0;
+    }
+
+    return 1;
 }
 
-bool ensure_context(V8ContextHandle handle, ContextWrapper*& out, std::string& error_out) {
-    out = unwrap_context(handle);
-    if (!out || !out->isolate()) {
-        error_out = "invalid V8 context handle";
-        return false;
+int shim_context_set_global_value_utf8(
+    V8ContextHandle handle,
+    const char* name,
+    std::size_t name_length,
+    const ShimValue* value,
+    char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
     }
-    return true;
-}
-
-} // namespace pacm_v8
-
-extern "C" {
 
-V8ContextHandle shim_create_context(V8IsolateHandle handle) {
-    pacm_v8::IsolateWrapper* isolate_wrapper = pacm_v8::unwrap_isolate(handle);
-    if (!isolate_wrapper || !isolate_wrapper->isolate) {
-        return nullptr;
+    pacm_v8::ContextWrapper* context = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_context(handle, context, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+    if (!name) {
+        pacm_v8::assign_error(error_out, "property name was null");
+        return 0;
+    }
+    if (!value) {
+        pacm_v8::assign_error(error_out, "value was null");
+        return 0;
     }
 
-    v8::Isolate* isolate = isolate_wrapper->isolate;
+    v8::Isolate* isolate = context->isolate();
     v8::Isolate::Scope isolate_scope(isolate);
     v8::HandleScope handle_scope(isolate);
-    v8::Local<v8::Context> local_context = v8::Context::New(isolate);
-    auto persistent = std::make_unique<v8::Global<v8::Context>>(isolate, local_context);
-
-    auto* wrapper = new pacm_v8::ContextWrapper();
-    wrapper->isolate_wrapper = isolate_wrapper;
-    wrapper->context = std::move(persistent);
-    return reinterpret_cast<V8ContextHandle>(wrapper);
-}
+    v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context->context);
+    v8::Context::Scope context_scope(ctx);
+    v8::TryCatch try_catch(isolate);
 
-void shim_dispose_context(V8ContextHandle handle) {
-    pacm_v8::ContextWrapper* context = pacm_v8::unwrap_context(handle);
-    if (!context) {
-        return;
+    v8::Local<v8::Object> target;
+    v8::Local<v8::String> key;
+    if (!pacm_v8::ensure_property_path(isolate, ctx, std::string_view{name, name_length}, target, key, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
     }
-
-    for (auto& entry : context->cache) {
-        if (entry.second) {
-            entry.second->Reset();
-        }
+    v8::Local<v8::Value> js_value;
+    if (!pacm_v8::from_shim_value(isolate, *value, js_value)) {
+        pacm_v8::assign_error(error_out, "value could not be converted");
+        return 0;
     }
-    context->cache.clear();
-
-    pacm_v8::dispose_native_callbacks(context);
 
-    if (context->context) {
-        context->context->Reset();
+    if (!target->Set(ctx, key, js_value).FromMaybe(false)) {
+        std::string message;
+        pacm_v8::capture_exception(isolate, try_catch, message);
+        pacm_v8::assign_error(error_out, message);
+        return 0;
     }
 
-    delete context;
+    return 1;
 }
 
-int shim_context_eval(V8ContextHandle handle, const char* source, char** result_out, char** error_out) {
-    if (result_out) {
-        *result_out = nullptr;
-    }
+int shim_context_set_globals(
+    V8ContextHandle handle,
+    const ShimGlobalEntry* entries,
+    std::size_t entry_count,
+    char** error_out) {
     if (error_out) {
         *error_out = nullptr;
     }
@@ -192,8 +1253,8 @@ int shim_context_eval(V8ContextHandle handle, const char* source, char** result_
         pacm_v8::assign_error(error_out, error);
         return 0;
     }
-    if (!source) {
-        pacm_v8::assign_error(error_out, "source was null");
+    if (entry_count > 0 && !entries) {
+        pacm_v8::assign_error(error_out, "global entries were null");
         return 0;
     }
 
@@ -202,47 +1263,52 @@ int shim_context_eval(V8ContextHandle handle, const char* source, char** result_
     v8::HandleScope handle_scope(isolate);
     v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context->context);
     v8::Context::Scope context_scope(ctx);
-
     v8::TryCatch try_catch(isolate);
 
-    v8::Local<v8::Script> script;
-    auto cached = context->cache.find(source);
-    if (cached != context->cache.end()) {
-        v8::Local<v8::UnboundScript> unbound = v8::Local<v8::UnboundScript>::New(isolate, *cached->second);
-        script = unbound->BindToCurrentContext();
-    } else {
-        v8::Local<v8::String> src = v8::String::NewFromUtf8(isolate, source, v8::NewStringType::kNormal).ToLocalChecked();
-        if (!v8::Script::Compile(ctx, src).ToLocal(&script)) {
+    // Entries sharing a prefix resolve it once; keys point into the caller's path buffers.
+    pacm_v8::PropertyPathCache objects;
+    for (std::size_t i = 0; i < entry_count; ++i) {
+        const ShimGlobalEntry& entry = entries[i];
+        if (!entry.path) {
+            pacm_v8::assign_error(error_out, "property name was null");
+            return 0;
+        }
+        std::string_view path{entry.path, entry.path_length};
+
+        v8::Local<v8::Object> target;
+        v8::Local<v8::String> key;
+        if (!pacm_v8::ensure_property_path(isolate, ctx, path, target, key, error, &objects)) {
+            pacm_v8::assign_error(error_out, error + ": " + std::string(path));
+            return 0;
+        }
+        v8::Local<v8::Value> js_value;
+        if (!pacm_v8::from_shim_value(isolate, entry.value, js_value)) {
+            pacm_v8::assign_error(error_out, "value could not be converted: " + std::string(path));
+            return 0;
+        }
+
+        if (!target->Set(ctx, key, js_value).FromMaybe(false)) {
             std::string message;
             pacm_v8::capture_exception(isolate, try_catch, message);
             pacm_v8::assign_error(error_out, message);
             return 0;
         }
-
-        const std::size_t len = std::strlen(source);
-        if (len <= kMaxCacheableSourceLength) {
-            v8::Local<v8::UnboundScript> unbound = script->GetUnboundScript();
-            auto persistent = std::make_unique<v8::Global<v8::UnboundScript>>(isolate, unbound);
-            context->cache.emplace(std::string{source, len}, std::move(persistent));
+        // Overwriting a cached prefix leaves every path below it stale.
+        if (objects.count(path) > 0) {
+            objects.clear();
         }
     }
 
-    v8::Local<v8::Value> result;
-    if (!script->Run(ctx).ToLocal(&result)) {
-        std::string message;
-        pacm_v8::capture_exception(isolate, try_catch, message);
-        pacm_v8::assign_error(error_out, message);
-        return 0;
-    }
-
-    if (result_out) {
-        *result_out = pacm_v8::value_to_utf8(isolate, result);
-    }
-
     return 1;
 }
 
-int shim_context_set_global_string(V8ContextHandle handle, const char* name, const char* value, char** error_out) {
+int shim_context_set_global_buffer(
+    V8ContextHandle handle,
+    const char* name,
+    uint8_t* data,
+    std::size_t length,
+    void* release_token,
+    char** error_out) {
     if (error_out) {
         *error_out = nullptr;
     }
@@ -250,11 +1316,12 @@ int shim_context_set_global_string(V8ContextHandle handle, const char* name, con
     pacm_v8::ContextWrapper* context = nullptr;
     std::string error;
     if (!pacm_v8::ensure_context(handle, context, error)) {
+        ::pacm_v8__buffer_release(release_token);
         pacm_v8::assign_error(error_out, error);
         return 0;
     }
-
     if (!name) {
+        ::pacm_v8__buffer_release(release_token);
         pacm_v8::assign_error(error_out, "property name was null");
         return 0;
     }
@@ -266,13 +1333,15 @@ int shim_context_set_global_string(V8ContextHandle handle, const char* name, con
     v8::Context::Scope context_scope(ctx);
     v8::TryCatch try_catch(isolate);
 
+    // Wrap first so the token is owned by a backing store on every path below.
+    v8::Local<v8::Uint8Array> js_value = pacm_v8::wrap_host_buffer(isolate, data, length, release_token);
+
     v8::Local<v8::Object> target;
     v8::Local<v8::String> key;
     if (!pacm_v8::ensure_property_path(isolate, ctx, name, target, key, error)) {
         pacm_v8::assign_error(error_out, error);
         return 0;
     }
-    v8::Local<v8::Value> js_value = v8::String::NewFromUtf8(isolate, value ? value : "", v8::NewStringType::kNormal).ToLocalChecked();
 
     if (!target->Set(ctx, key, js_value).FromMaybe(false)) {
         std::string message;
@@ -284,10 +1353,18 @@ int shim_context_set_global_string(V8ContextHandle handle, const char* name, con
     return 1;
 }
 
-int shim_context_set_global_number(V8ContextHandle handle, const char* name, double value, char** error_out) {
+int shim_context_alloc_global_buffer(
+    V8ContextHandle handle,
+    const char* name,
+    std::size_t length,
+    uint8_t** data_out,
+    char** error_out) {
     if (error_out) {
         *error_out = nullptr;
     }
+    if (data_out) {
+        *data_out = nullptr;
+    }
 
     pacm_v8::ContextWrapper* context = nullptr;
     std::string error;
@@ -295,8 +1372,12 @@ int shim_context_set_global_number(V8ContextHandle handle, const char* name, dou
         pacm_v8::assign_error(error_out, error);
         return 0;
     }
-    if (!name) {
-        pacm_v8::assign_error(error_out, "property name was null");
+    if (!name || !data_out) {
+        pacm_v8::assign_error(error_out, "property name or data pointer was null");
+        return 0;
+    }
+    if (length > v8::Uint8Array::kMaxLength) {
+        pacm_v8::assign_error(error_out, "buffer is longer than a Uint8Array can be");
         return 0;
     }
 
@@ -313,7 +1394,12 @@ int shim_context_set_global_number(V8ContextHandle handle, const char* name, dou
         pacm_v8::assign_error(error_out, error);
         return 0;
     }
-    v8::Local<v8::Number> js_value = v8::Number::New(isolate, value);
+
+    // Allocated by the isolate, so the memory is inside the sandbox when there is one.
+    std::unique_ptr<v8::BackingStore> store = v8::ArrayBuffer::NewBackingStore(isolate, length);
+    auto* data = static_cast<uint8_t*>(store->Data());
+    v8::Local<v8::ArrayBuffer> buffer = v8::ArrayBuffer::New(isolate, std::move(store));
+    v8::Local<v8::Uint8Array> js_value = v8::Uint8Array::New(buffer, 0, length);
 
     if (!target->Set(ctx, key, js_value).FromMaybe(false)) {
         std::string message;
@@ -322,10 +1408,38 @@ int shim_context_set_global_number(V8ContextHandle handle, const char* name, dou
         return 0;
     }
 
+    *data_out = data;
     return 1;
 }
 
 int shim_context_register_host_function(V8ContextHandle handle, const char* name, uint64_t function_id, char** error_out) {
+    return pacm_v8::register_host_function(handle, name, function_id, false, nullptr, pacm_v8::kNoFastSignature, error_out);
+}
+
+int shim_context_register_async_host_function(V8ContextHandle handle, const char* name, uint64_t function_id, char** error_out) {
+    return pacm_v8::register_host_function(handle, name, function_id, true, nullptr, pacm_v8::kNoFastSignature, error_out);
+}
+
+int shim_context_register_fast_host_function(
+    V8ContextHandle handle,
+    const char* name,
+    uint64_t function_id,
+    int32_t return_type,
+    const int32_t* arg_types,
+    std::size_t arg_count,
+    char** error_out) {
+    if (!pacm_v8::fast_signature_supported(return_type, arg_types, arg_count)) {
+        if (error_out) {
+            *error_out = nullptr;
+        }
+        pacm_v8::assign_error(error_out, "unsupported fast function signature");
+        return 0;
+    }
+    const v8::CFunction* fast_function = pacm_v8::select_fast_function(return_type, arg_types, arg_count);
+    return pacm_v8::register_host_function(handle, name, function_id, false, fast_function, return_type, error_out);
+}
+
+int shim_context_bind_host_function(V8ContextHandle handle, const char* name, uint64_t function_id, char** error_out) {
     if (error_out) {
         *error_out = nullptr;
     }
@@ -336,11 +1450,35 @@ int shim_context_register_host_function(V8ContextHandle handle, const char* name
         pacm_v8::assign_error(error_out, error);
         return 0;
     }
-
     if (!name) {
         pacm_v8::assign_error(error_out, "function name was null");
         return 0;
     }
+    if (!context->isolate_wrapper->has_snapshot()) {
+        pacm_v8::assign_error(error_out, "context was not created from a snapshot");
+        return 0;
+    }
+
+    auto data = std::make_unique<pacm_v8::NativeCallbackData>();
+    data->isolate_wrapper = context->isolate_wrapper;
+    data->function_id = function_id;
+    data->bound = true;
+
+    pacm_v8::store_native_callback(context, name, std::move(data));
+    return 1;
+}
+
+int shim_context_record_baseline(V8ContextHandle handle, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::ContextWrapper* context = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_context(handle, context, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
 
     v8::Isolate* isolate = context->isolate();
     v8::Isolate::Scope isolate_scope(isolate);
@@ -349,46 +1487,84 @@ int shim_context_register_host_function(V8ContextHandle handle, const char* name
     v8::Context::Scope context_scope(ctx);
     v8::TryCatch try_catch(isolate);
 
-    v8::Local<v8::Object> target;
-    v8::Local<v8::String> key;
-    if (!pacm_v8::ensure_property_path(isolate, ctx, name, target, key, error)) {
+    if (!pacm_v8::record_baseline(context, ctx, error)) {
         pacm_v8::assign_error(error_out, error);
         return 0;
     }
+    return 1;
+}
 
-    auto data = std::make_unique<pacm_v8::NativeCallbackData>();
-    data->function_id = function_id;
+int shim_context_restore_baseline(V8ContextHandle handle, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
 
-    v8::Local<v8::External> metadata = v8::External::New(isolate, data.get());
-    v8::Local<v8::FunctionTemplate> tpl = v8::FunctionTemplate::New(isolate, pacm_v8::native_function_trampoline, metadata);
-    v8::Local<v8::Function> function;
-    if (!tpl->GetFunction(ctx).ToLocal(&function)) {
-        std::string message;
-        pacm_v8::capture_exception(isolate, try_catch, message);
-        pacm_v8::assign_error(error_out, message);
+    pacm_v8::ContextWrapper* context = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_context(handle, context, error)) {
+        pacm_v8::assign_error(error_out, error);
         return 0;
     }
 
-    function->SetName(key);
+    v8::Isolate* isolate = context->isolate();
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+    v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context->context);
+    v8::Context::Scope context_scope(ctx);
+    v8::TryCatch try_catch(isolate);
 
-    if (!target->Set(ctx, key, function).FromMaybe(false)) {
-        std::string message;
-        pacm_v8::capture_exception(isolate, try_catch, message);
-        pacm_v8::assign_error(error_out, message);
+    if (!pacm_v8::restore_baseline(context, ctx, error)) {
+        pacm_v8::assign_error(error_out, error);
         return 0;
     }
+    return 1;
+}
 
-    std::string path_key(name);
-    auto existing = context->native_callbacks.find(path_key);
-    if (existing != context->native_callbacks.end()) {
-        if (existing->second) {
-            ::pacm_v8__host_function_drop(existing->second->function_id);
-        }
-        context->native_callbacks.erase(existing);
+int shim_context_reset(V8ContextHandle handle, int32_t mode, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::ContextWrapper* context = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_context(handle, context, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+    if (context->isolate_wrapper->execution_depth > 0) {
+        pacm_v8::assign_error(error_out, "cannot reset a context while JavaScript is running");
+        return 0;
     }
 
-    context->native_callbacks.emplace(std::move(path_key), std::move(data));
+    switch (mode) {
+    case SHIM_CONTEXT_RESET_BASELINE: {
+        v8::Isolate* isolate = context->isolate();
+        v8::Isolate::Scope isolate_scope(isolate);
+        v8::HandleScope handle_scope(isolate);
+        v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context->context);
+        v8::Context::Scope context_scope(ctx);
+        v8::TryCatch try_catch(isolate);
+
+        if (!pacm_v8::restore_baseline(context, ctx, error)) {
+            pacm_v8::assign_error(error_out, error);
+            return 0;
+        }
+        break;
+    }
+    case SHIM_CONTEXT_RESET_RECREATE:
+        if (!pacm_v8::recreate_context(context, error)) {
+            pacm_v8::assign_error(error_out, error);
+            return 0;
+        }
+        break;
+    default:
+        pacm_v8::assign_error(error_out, "unknown context reset mode");
+        return 0;
+    }
 
+    // Completions still owed to the previous user are discarded when they arrive.
+    pacm_v8::reset_completions(context);
+    context->cpu_used_ns = 0;
     return 1;
 }
 
@@ -417,17 +1593,17 @@ int shim_context_call_function(V8ContextHandle handle, const char* fn_name, cons
     v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context->context);
     v8::Context::Scope context_scope(ctx);
     v8::TryCatch try_catch(isolate);
+    pacm_v8::ExecutionGuard guard(context->isolate_wrapper, context);
+    if (guard.refused()) {
+        return pacm_v8::legacy_status(guard.reject(error_out));
+    }
 
-    v8::Local<v8::Object> global = ctx->Global();
-    v8::Local<v8::String> key = v8::String::NewFromUtf8(isolate, fn_name, v8::NewStringType::kNormal).ToLocalChecked();
-    v8::Local<v8::Value> maybe_function;
-    if (!global->Get(ctx, key).ToLocal(&maybe_function) || !maybe_function->IsFunction()) {
-        pacm_v8::assign_error(error_out, "global function not found");
+    v8::Local<v8::Function> function;
+    if (!pacm_v8::lookup_global_function(isolate, ctx, fn_name, function, error)) {
+        pacm_v8::assign_error(error_out, error);
         return 0;
     }
 
-    v8::Local<v8::Function> function = maybe_function.As<v8::Function>();
-
     std::vector<v8::Local<v8::Value>> js_args;
     js_args.reserve(arg_count);
     for (std::size_t i = 0; i < arg_count; ++i) {
@@ -440,18 +1616,140 @@ int shim_context_call_function(V8ContextHandle handle, const char* fn_name, cons
     }
 
     v8::Local<v8::Value> result;
-    if (!function->Call(ctx, global, static_cast<int>(js_args.size()), js_args.data()).ToLocal(&result)) {
+    bool called = false;
+    {
+        PACM_V8_SPAN(context, call, "call");
+        called = function->Call(ctx, ctx->Global(), static_cast<int>(js_args.size()), js_args.data()).ToLocal(&result);
+    }
+    if (!called) {
         std::string message;
         pacm_v8::capture_exception(isolate, try_catch, message);
+        int status = pacm_v8::execution_failure(context->isolate_wrapper, message);
         pacm_v8::assign_error(error_out, message);
-        return 0;
+        return pacm_v8::legacy_status(status);
     }
 
     if (result_out) {
+        PACM_V8_SPAN(context, marshal, "marshal");
         *result_out = pacm_v8::value_to_utf8(isolate, result);
     }
 
     return 1;
 }
 
+int shim_context_call_function_values(
+    V8ContextHandle handle,
+    const char* fn_name,
+    const ShimValue* args,
+    std::size_t arg_count,
+    ShimValue* result_out,
+    char** error_out) {
+    return shim_context_call_function_values_utf8(handle, fn_name, fn_name ? std::strlen(fn_name) : 0, args, arg_count, result_out, error_out);
+}
+
+int shim_context_call_function_values_utf8(
+    V8ContextHandle handle,
+    const char* fn_name,
+    std::size_t name_length,
+    const ShimValue* args,
+    std::size_t arg_count,
+    ShimValue* result_out,
+    char** error_out) {
+    pacm_v8::ResultOut out;
+    out.value = result_out;
+    return pacm_v8::call_global_function(handle, fn_name, name_length, args, arg_count, out, error_out);
+}
+
+int shim_context_call_function_serialized(
+    V8ContextHandle handle,
+    const char* fn_name,
+    std::size_t name_length,
+    const ShimValue* args,
+    std::size_t arg_count,
+    uint8_t** data_out,
+    std::size_t* length_out,
+    char** error_out) {
+    pacm_v8::ResultOut out;
+    out.data = data_out;
+    out.length = length_out;
+    return pacm_v8::call_global_function(handle, fn_name, name_length, args, arg_count, out, error_out);
+}
+
+int shim_context_call_function_streamed(
+    V8ContextHandle handle,
+    const char* fn_name,
+    std::size_t name_length,
+    const ShimValue* args,
+    std::size_t arg_count,
+    int32_t flags,
+    void* sink,
+    char** error_out) {
+    if (!sink) {
+        if (error_out) {
+            *error_out = nullptr;
+        }
+        pacm_v8::assign_error(error_out, "output sink was null");
+        return 0;
+    }
+    pacm_v8::ResultOut out;
+    out.sink = sink;
+    out.output_flags = flags;
+    return pacm_v8::call_global_function(handle, fn_name, name_length, args, arg_count, out, error_out);
+}
+
+int shim_context_set_timeout(V8ContextHandle handle, uint64_t timeout_ms, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::ContextWrapper* context = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_context(handle, context, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+
+    context->timeout_ms = timeout_ms;
+    return 1;
+}
+
+int shim_context_set_cpu_budget(V8ContextHandle handle, uint64_t cpu_budget_us, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::ContextWrapper* context = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_context(handle, context, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+
+    // Saturates, so a huge budget does not wrap around to a tiny one.
+    constexpr uint64_t kMaxBudgetUs = std::numeric_limits<uint64_t>::max() / 1000;
+    context->cpu_budget_ns = cpu_budget_us > kMaxBudgetUs ? std::numeric_limits<uint64_t>::max() : cpu_budget_us * 1000;
+    context->cpu_used_ns = 0;
+    return 1;
+}
+
+int shim_context_cpu_time_used(V8ContextHandle handle, uint64_t* cpu_time_us_out, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::ContextWrapper* context = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_context(handle, context, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+    if (!cpu_time_us_out) {
+        pacm_v8::assign_error(error_out, "output was null");
+        return 0;
+    }
+
+    *cpu_time_us_out = context->cpu_used_ns / 1000;
+    return 1;
+}
+
 } // extern "C"
@@ -0,0 +1,214 @@
+#include "shim_internal.h"
+
+#include <type_traits>
+
+// Some V8 header distributions (e.g. Node's) leave out the fast API; functions registered
+// with a fast signature then only use the regular trampoline.
+#if __has_include("v8-fast-api-calls.h")
+#include "v8-fast-api-calls.h"
+#define PACM_V8_HAS_FAST_API 1
+#else
+#define PACM_V8_HAS_FAST_API 0
+#endif
+
+namespace pacm_v8 {
+
+// Signatures are instantiated per combination, so the arity is kept small.
+constexpr std::size_t kMaxFastArgs = 3;
+
+bool fast_signature_supported(int32_t return_type, const int32_t* arg_types, std::size_t arg_count) {
+    if (return_type < SHIM_FAST_VOID || return_type > SHIM_FAST_FLOAT64) {
+        return false;
+    }
+    if (arg_count > kMaxFastArgs || (arg_count > 0 && !arg_types)) {
+        return false;
+    }
+    for (std::size_t i = 0; i < arg_count; ++i) {
+        if (arg_types[i] != SHIM_FAST_INT32 && arg_types[i] != SHIM_FAST_FLOAT64) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool coerce_fast_result(int32_t return_type, ShimValue& value) {
+    switch (return_type) {
+    case SHIM_FAST_BOOL:
+        return value.kind == SHIM_VALUE_BOOL;
+    case SHIM_FAST_INT32:
+        if (value.kind == SHIM_VALUE_INT32) {
+            return true;
+        }
+        if (value.kind == SHIM_VALUE_DOUBLE && value.number >= -2147483648.0 && value.number <= 2147483647.0 &&
+            static_cast<double>(static_cast<int32_t>(value.number)) == value.number) {
+            const auto integer = static_cast<int32_t>(value.number);
+            value = ShimValue{};
+            value.kind = SHIM_VALUE_INT32;
+            value.integer = integer;
+            return true;
+        }
+        return false;
+    case SHIM_FAST_FLOAT64:
+        if (value.kind == SHIM_VALUE_DOUBLE) {
+            return true;
+        }
+        if (value.kind == SHIM_VALUE_INT32) {
+            const auto number = static_cast<double>(value.integer);
+            value = ShimValue{};
+            value.kind = SHIM_VALUE_DOUBLE;
+            value.number = number;
+            return true;
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+#if PACM_V8_HAS_FAST_API
+
+namespace {
+
+ShimValue fast_argument(int32_t value) {
+    ShimValue out{};
+    out.kind = SHIM_VALUE_INT32;
+    out.integer = value;
+    return out;
+}
+
+ShimValue fast_argument(double value) {
+    ShimValue out{};
+    out.kind = SHIM_VALUE_DOUBLE;
+    out.number = value;
+    return out;
+}
+
+bool fast_result(const ShimValue& value, double& out) {
+    if (value.kind == SHIM_VALUE_DOUBLE) {
+        out = value.number;
+        return true;
+    }
+    if (value.kind == SHIM_VALUE_INT32) {
+        out = static_cast<double>(value.integer);
+        return true;
+    }
+    return false;
+}
+
+bool fast_result(const ShimValue& value, int32_t& out) {
+    if (value.kind == SHIM_VALUE_INT32) {
+        out = static_cast<int32_t>(value.integer);
+        return true;
+    }
+    return false;
+}
+
+bool fast_result(const ShimValue& value, bool& out) {
+    if (value.kind == SHIM_VALUE_BOOL) {
+        out = value.integer != 0;
+        return true;
+    }
+    return false;
+}
+
+void throw_fast_error(v8::Isolate* isolate, const char* message) {
+    v8::HandleScope handle_scope(isolate);
+    isolate->ThrowError(v8::String::NewFromUtf8(isolate, message, v8::NewStringType::kNormal).ToLocalChecked());
+}
+
+// Calls the host directly from optimized code. Arguments and results are numbers only, so
+// nothing here touches the V8 heap unless the host reports an error.
+template <typename R, typename... A>
+R fast_host_call(v8::Local<v8::Value>, A... args, v8::FastApiCallbackOptions& options) {
+    auto* data = static_cast<NativeCallbackData*>(options.data.As<v8::External>()->Value());
+    if (data->retired) {
+        throw_fast_error(options.isolate, "host function was released");
+        return R();
+    }
+    ShimValue argv[sizeof...(A) + 1] = {fast_argument(args)...};
+    ShimValue result{};
+    char* error_ptr = nullptr;
+
+    int status = 0;
+    {
+        HostCallScope host_call(data->isolate_wrapper);
+        status = ::pacm_v8__host_function_invoke(data->function_id, argv, sizeof...(A), &result, &error_ptr);
+    }
+    if (!status) {
+        ::pacm_v8__value_release(&result);
+        throw_fast_error(options.isolate, error_ptr ? error_ptr : "host function invocation failed");
+        if (error_ptr) {
+            ::pacm_v8__string_free(error_ptr);
+        }
+        return R();
+    }
+    if (error_ptr) {
+        ::pacm_v8__string_free(error_ptr);
+    }
+
+    if constexpr (std::is_void_v<R>) {
+        ::pacm_v8__value_release(&result);
+    } else {
+        R out{};
+        bool converted = coerce_fast_result(data->fast_return_type, result) && fast_result(result, out);
+        ::pacm_v8__value_release(&result);
+        if (!converted) {
+            throw_fast_error(options.isolate, "host function returned a value that does not match its fast signature");
+        }
+        return out;
+    }
+}
+
+template <typename R, typename... A>
+const v8::CFunction* fast_function() {
+    static const v8::CFunction function = v8::CFunction::Make(fast_host_call<R, A...>);
+    return &function;
+}
+
+template <typename R, typename... A>
+const v8::CFunction* select_arguments(const int32_t* arg_types, std::size_t remaining) {
+    if (remaining == 0) {
+        return fast_function<R, A...>();
+    }
+    if constexpr (sizeof...(A) < kMaxFastArgs) {
+        switch (arg_types[0]) {
+        case SHIM_FAST_INT32:
+            return select_arguments<R, A..., int32_t>(arg_types + 1, remaining - 1);
+        case SHIM_FAST_FLOAT64:
+            return select_arguments<R, A..., double>(arg_types + 1, remaining - 1);
+        default:
+            break;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+const v8::CFunction* select_fast_function(int32_t return_type, const int32_t* arg_types, std::size_t arg_count) {
+    if (!fast_signature_supported(return_type, arg_types, arg_count)) {
+        return nullptr;
+    }
+    switch (return_type) {
+    case SHIM_FAST_VOID:
+        return select_arguments<void>(arg_types, arg_count);
+    case SHIM_FAST_BOOL:
+        return select_arguments<bool>(arg_types, arg_count);
+    case SHIM_FAST_INT32:
+        return select_arguments<int32_t>(arg_types, arg_count);
+    case SHIM_FAST_FLOAT64:
+        return select_arguments<double>(arg_types, arg_count);
+    default:
+        return nullptr;
+    }
+}
+
+#else
+
+const v8::CFunction* select_fast_function(int32_t, const int32_t*, std::size_t) {
+    return nullptr;
+}
+
+#endif
+
+} // namespace pacm_v8
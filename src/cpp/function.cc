@@ -0,0 +1,258 @@
+#include "shim_internal.h"
+
+#include <cstring>
+
+namespace pacm_v8 {
+
+// Up to this many arguments are converted on the stack instead of a heap-allocated vector.
+constexpr std::size_t kInlineCallArgs = 8;
+
+// Walks a dotted path like ensure_property_path, but never creates intermediate objects.
+bool resolve_function_path(
+    v8::Isolate* isolate,
+    v8::Local<v8::Context> ctx,
+    std::string_view path,
+    v8::Local<v8::Object>& owner_out,
+    v8::Local<v8::Function>& function_out,
+    std::string& error_out) {
+    if (path.empty()) {
+        error_out = "function name was empty";
+        return false;
+    }
+
+    v8::Local<v8::Object> current = ctx->Global();
+    std::size_t start = 0;
+    while (start <= path.size()) {
+        std::size_t dot = path.find('.', start);
+        std::string_view segment = dot == std::string_view::npos ? path.substr(start) : path.substr(start, dot - start);
+        if (segment.empty()) {
+            error_out = "function path contained an empty segment";
+            return false;
+        }
+
+        v8::Local<v8::String> key;
+        if (!v8::String::NewFromUtf8(isolate, segment.data(), v8::NewStringType::kNormal, static_cast<int>(segment.size())).ToLocal(&key)) {
+            error_out = "function path segment was too long";
+            return false;
+        }
+
+        v8::Local<v8::Value> next;
+        if (!current->Get(ctx, key).ToLocal(&next)) {
+            error_out = "failed to read function path";
+            return false;
+        }
+
+        if (dot == std::string_view::npos) {
+            if (!next->IsFunction()) {
+                error_out = "function not found";
+                return false;
+            }
+            owner_out = current;
+            function_out = next.As<v8::Function>();
+            return true;
+        }
+
+        if (!next->IsObject()) {
+            error_out = "function not found";
+            return false;
+        }
+        current = next.As<v8::Object>();
+        start = dot + 1;
+    }
+
+    error_out = "function not found";
+    return false;
+}
+
+static bool ensure_function(V8FunctionHandle handle, FunctionWrapper*& out, std::string& error_out) {
+    out = unwrap_function(handle);
+    if (!out || !out->isolate_wrapper || !out->isolate_wrapper->isolate || !out->function || !out->context) {
+        error_out = "invalid function handle";
+        return false;
+    }
+    return true;
+}
+
+static int call_function_values(
+    V8FunctionHandle handle,
+    const ShimValue* args,
+    std::size_t arg_count,
+    bool await_result,
+    ShimValue* result_out,
+    char** error_out) {
+    if (result_out) {
+        *result_out = ShimValue{};
+    }
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    FunctionWrapper* wrapper = nullptr;
+    std::string error;
+    if (!ensure_function(handle, wrapper, error)) {
+        assign_error(error_out, error);
+        return 0;
+    }
+    if (!args && arg_count > 0) {
+        assign_error(error_out, "arguments were null");
+        return 0;
+    }
+
+    v8::Isolate* isolate = wrapper->isolate_wrapper->isolate;
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+    v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *wrapper->context);
+    v8::Context::Scope context_scope(ctx);
+    v8::TryCatch try_catch(isolate);
+    // The context's limits apply as long as its wrapper is alive; dispose clears the slot.
+    auto* context = static_cast<ContextWrapper*>(ctx->GetAlignedPointerFromEmbedderData(kContextWrapperEmbedderIndex));
+    ExecutionGuard guard(wrapper->isolate_wrapper, context);
+    if (guard.refused()) {
+        return guard.reject(error_out);
+    }
+
+    v8::Local<v8::Value> inline_args[kInlineCallArgs];
+    std::vector<v8::Local<v8::Value>> heap_args;
+    v8::Local<v8::Value>* js_args = inline_args;
+    if (arg_count > kInlineCallArgs) {
+        heap_args.resize(arg_count);
+        js_args = heap_args.data();
+    }
+    {
+        PACM_V8_SPAN(context, marshal, "marshal");
+        for (std::size_t i = 0; i < arg_count; ++i) {
+            if (!from_shim_value(isolate, args[i], js_args[i])) {
+                assign_error(error_out, "argument could not be converted");
+                return 0;
+            }
+        }
+    }
+
+    v8::Local<v8::Function> function = v8::Local<v8::Function>::New(isolate, *wrapper->function);
+    v8::Local<v8::Value> receiver = v8::Local<v8::Value>::New(isolate, *wrapper->receiver);
+    v8::Local<v8::Value> result;
+    bool called = false;
+    {
+        PACM_V8_SPAN(context, call, "call");
+        called = function->Call(ctx, receiver, static_cast<int>(arg_count), js_args).ToLocal(&result);
+    }
+    if (!called) {
+        std::string message;
+        capture_exception(isolate, try_catch, message);
+        int status = execution_failure(wrapper->isolate_wrapper, message);
+        assign_error(error_out, message);
+        return status;
+    }
+    if (await_result) {
+        if (!context) {
+            assign_error(error_out, "context was disposed");
+            return 0;
+        }
+        int status = settle_value(context, ctx, try_catch, result, error);
+        if (status != SHIM_STATUS_OK) {
+            assign_error(error_out, error);
+            return status;
+        }
+    }
+
+    PACM_V8_SPAN(context, marshal, "marshal");
+    if (result_out && !to_shim_value_owned(isolate, result, *result_out)) {
+        assign_error(error_out, "failed to allocate result buffer");
+        return 0;
+    }
+
+    return 1;
+}
+
+} // namespace pacm_v8
+
+extern "C" {
+
+V8FunctionHandle shim_context_get_function(V8ContextHandle handle, const char* path, int bind_receiver, char** error_out) {
+    return shim_context_get_function_utf8(handle, path, path ? std::strlen(path) : 0, bind_receiver, error_out);
+}
+
+V8FunctionHandle shim_context_get_function_utf8(
+    V8ContextHandle handle,
+    const char* path,
+    std::size_t path_length,
+    int bind_receiver,
+    char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::ContextWrapper* context = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_context(handle, context, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return nullptr;
+    }
+    if (!path) {
+        pacm_v8::assign_error(error_out, "function name was null");
+        return nullptr;
+    }
+
+    v8::Isolate* isolate = context->isolate();
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+    v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context->context);
+    v8::Context::Scope context_scope(ctx);
+    v8::TryCatch try_catch(isolate);
+
+    v8::Local<v8::Object> owner;
+    v8::Local<v8::Function> function;
+    if (!pacm_v8::resolve_function_path(isolate, ctx, std::string_view{path, path_length}, owner, function, error)) {
+        if (try_catch.HasCaught()) {
+            pacm_v8::capture_exception(isolate, try_catch, error);
+        }
+        pacm_v8::assign_error(error_out, error);
+        return nullptr;
+    }
+
+    auto* wrapper = new pacm_v8::FunctionWrapper{};
+    wrapper->isolate_wrapper = context->isolate_wrapper;
+    wrapper->context = std::make_unique<v8::Global<v8::Context>>(isolate, ctx);
+    wrapper->function = std::make_unique<v8::Global<v8::Function>>(isolate, function);
+    wrapper->receiver = std::make_unique<v8::Global<v8::Value>>(isolate, bind_receiver ? v8::Local<v8::Value>(owner) : v8::Local<v8::Value>(ctx->Global()));
+    return wrapper;
+}
+
+int shim_function_call_values(
+    V8FunctionHandle handle,
+    const ShimValue* args,
+    std::size_t arg_count,
+    ShimValue* result_out,
+    char** error_out) {
+    return pacm_v8::call_function_values(handle, args, arg_count, false, result_out, error_out);
+}
+
+int shim_function_call_values_await(
+    V8FunctionHandle handle,
+    const ShimValue* args,
+    std::size_t arg_count,
+    ShimValue* result_out,
+    char** error_out) {
+    return pacm_v8::call_function_values(handle, args, arg_count, true, result_out, error_out);
+}
+
+void shim_function_dispose(V8FunctionHandle handle) {
+    pacm_v8::FunctionWrapper* wrapper = pacm_v8::unwrap_function(handle);
+    if (!wrapper) {
+        return;
+    }
+
+    if (wrapper->receiver) {
+        wrapper->receiver->Reset();
+    }
+    if (wrapper->function) {
+        wrapper->function->Reset();
+    }
+    if (wrapper->context) {
+        wrapper->context->Reset();
+    }
+
+    delete wrapper;
+}
+
+} // extern "C"
@@ -0,0 +1,190 @@
+#include "shim_internal.h"
+
+#include <algorithm>
+
+namespace pacm_v8 {
+
+void GcStats::begin() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (depth_++ == 0) {
+        started_ = std::chrono::steady_clock::now();
+    }
+}
+
+void GcStats::end(v8::GCType type) {
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (depth_ == 0 || --depth_ > 0) {
+        return;
+    }
+
+    const auto pause_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - started_).count());
+    ++stats_.collections;
+    if (type & (v8::kGCTypeScavenge | v8::kGCTypeMinorMarkSweep)) {
+        ++stats_.minor_collections;
+    } else if (type & v8::kGCTypeMarkSweepCompact) {
+        ++stats_.major_collections;
+    }
+    stats_.total_pause_ns += pause_ns;
+    stats_.max_pause_ns = std::max(stats_.max_pause_ns, pause_ns);
+
+    std::size_t bucket = 0;
+    for (uint64_t bound_us = 1; bucket + 1 < SHIM_GC_PAUSE_BUCKETS && pause_ns >= bound_us * 1000; bound_us <<= 1) {
+        ++bucket;
+    }
+    ++stats_.pause_buckets[bucket];
+}
+
+ShimGcStats GcStats::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+static void gc_prologue(v8::Isolate*, v8::GCType, v8::GCCallbackFlags, void* data) {
+    static_cast<IsolateWrapper*>(data)->gc_stats.begin();
+}
+
+static void gc_epilogue(v8::Isolate*, v8::GCType type, v8::GCCallbackFlags, void* data) {
+    static_cast<IsolateWrapper*>(data)->gc_stats.end(type);
+}
+
+void install_gc_callbacks(IsolateWrapper* wrapper) {
+    wrapper->isolate->AddGCPrologueCallback(gc_prologue, wrapper);
+    wrapper->isolate->AddGCEpilogueCallback(gc_epilogue, wrapper);
+}
+
+} // namespace pacm_v8
+
+extern "C" {
+
+int shim_isolate_heap_stats(
+    V8IsolateHandle handle,
+    ShimHeapStats* stats_out,
+    ShimHeapSpaceStats* spaces_out,
+    size_t space_capacity,
+    size_t* space_count_out,
+    char** error_out) {
+    if (space_count_out) {
+        *space_count_out = 0;
+    }
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::IsolateWrapper* wrapper = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_isolate(handle, wrapper, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+    if (!stats_out) {
+        pacm_v8::assign_error(error_out, "stats output was null");
+        return 0;
+    }
+
+    v8::Isolate* isolate = wrapper->isolate;
+    v8::Isolate::Scope isolate_scope(isolate);
+
+    v8::HeapStatistics heap;
+    isolate->GetHeapStatistics(&heap);
+    *stats_out = ShimHeapStats{};
+    stats_out->total_heap_size = heap.total_heap_size();
+    stats_out->total_heap_size_executable = heap.total_heap_size_executable();
+    stats_out->total_physical_size = heap.total_physical_size();
+    stats_out->total_available_size = heap.total_available_size();
+    stats_out->used_heap_size = heap.used_heap_size();
+    stats_out->heap_size_limit = heap.heap_size_limit();
+    stats_out->malloced_memory = heap.malloced_memory();
+    stats_out->peak_malloced_memory = heap.peak_malloced_memory();
+    stats_out->external_memory = heap.external_memory();
+    stats_out->number_of_native_contexts = heap.number_of_native_contexts();
+    stats_out->number_of_detached_contexts = heap.number_of_detached_contexts();
+
+    const std::size_t space_count = isolate->NumberOfHeapSpaces();
+    if (space_count_out) {
+        *space_count_out = space_count;
+    }
+    if (!spaces_out) {
+        return 1;
+    }
+    for (std::size_t i = 0; i < space_count && i < space_capacity; ++i) {
+        v8::HeapSpaceStatistics space;
+        if (!isolate->GetHeapSpaceStatistics(&space, i)) {
+            spaces_out[i] = ShimHeapSpaceStats{};
+            continue;
+        }
+        spaces_out[i].space_name = space.space_name();
+        spaces_out[i].space_size = space.space_size();
+        spaces_out[i].space_used_size = space.space_used_size();
+        spaces_out[i].space_available_size = space.space_available_size();
+        spaces_out[i].physical_space_size = space.physical_space_size();
+    }
+    return 1;
+}
+
+int shim_isolate_gc_stats(V8IsolateHandle handle, ShimGcStats* stats_out, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::IsolateWrapper* wrapper = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_isolate(handle, wrapper, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+    if (!stats_out) {
+        pacm_v8::assign_error(error_out, "stats output was null");
+        return 0;
+    }
+
+    *stats_out = wrapper->gc_stats.snapshot();
+    return 1;
+}
+
+int shim_isolate_memory_pressure(V8IsolateHandle handle, int32_t level, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::IsolateWrapper* wrapper = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_isolate(handle, wrapper, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+
+    switch (level) {
+    case SHIM_MEMORY_PRESSURE_NONE:
+        wrapper->isolate->MemoryPressureNotification(v8::MemoryPressureLevel::kNone);
+        return 1;
+    case SHIM_MEMORY_PRESSURE_MODERATE:
+        wrapper->isolate->MemoryPressureNotification(v8::MemoryPressureLevel::kModerate);
+        return 1;
+    case SHIM_MEMORY_PRESSURE_CRITICAL:
+        wrapper->isolate->MemoryPressureNotification(v8::MemoryPressureLevel::kCritical);
+        return 1;
+    default:
+        pacm_v8::assign_error(error_out, "unknown memory pressure level");
+        return 0;
+    }
+}
+
+int shim_isolate_low_memory_notification(V8IsolateHandle handle, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::IsolateWrapper* wrapper = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_isolate(handle, wrapper, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+
+    v8::Isolate::Scope isolate_scope(wrapper->isolate);
+    wrapper->isolate->LowMemoryNotification();
+    return 1;
+}
+
+} // extern "C"
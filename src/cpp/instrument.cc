@@ -0,0 +1,109 @@
+#include "shim_internal.h"
+
+namespace pacm_v8 {
+
+static ShimSpanCounter load(const TimedCounter& counter) {
+    return ShimSpanCounter{
+        counter.count.load(std::memory_order_relaxed),
+        counter.total_ns.load(std::memory_order_relaxed),
+    };
+}
+
+ShimCounters Counters::snapshot() const {
+    ShimCounters out{};
+    out.compile = load(compile);
+    out.run = load(run);
+    out.call = load(call);
+    out.marshal = load(marshal);
+    out.host = load(host);
+    out.cache_hits = cache_hits.load(std::memory_order_relaxed);
+    out.cache_misses = cache_misses.load(std::memory_order_relaxed);
+    return out;
+}
+
+#ifdef PACM_V8_INSTRUMENTATION
+std::atomic<bool> g_trace_spans{false};
+
+Span::~Span() {
+    if (!counter_) {
+        return;
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - started_;
+    const auto duration_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    counter_->count.fetch_add(1, std::memory_order_relaxed);
+    counter_->total_ns.fetch_add(duration_ns, std::memory_order_relaxed);
+    if (g_trace_spans.load(std::memory_order_relaxed)) {
+        const auto start_ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(started_.time_since_epoch()).count());
+        ::pacm_v8__trace_span(name_, owner_, start_ns, duration_ns);
+    }
+}
+#endif
+
+} // namespace pacm_v8
+
+extern "C" {
+
+int shim_context_counters(V8ContextHandle handle, ShimCounters* counters_out, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::ContextWrapper* context = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_context(handle, context, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+    if (!counters_out) {
+        pacm_v8::assign_error(error_out, "counters output was null");
+        return 0;
+    }
+
+    *counters_out = context->counters.snapshot();
+    return 1;
+}
+
+int shim_isolate_counters(V8IsolateHandle handle, ShimCounters* counters_out, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::IsolateWrapper* wrapper = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_isolate(handle, wrapper, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+    if (!counters_out) {
+        pacm_v8::assign_error(error_out, "counters output was null");
+        return 0;
+    }
+
+    *counters_out = wrapper->counters.snapshot();
+    return 1;
+}
+
+int shim_instrumentation_enabled(void) {
+#ifdef PACM_V8_INSTRUMENTATION
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+int shim_set_trace_spans(int enabled, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+#ifdef PACM_V8_INSTRUMENTATION
+    pacm_v8::g_trace_spans.store(enabled != 0, std::memory_order_relaxed);
+    return 1;
+#else
+    (void)enabled;
+    pacm_v8::assign_error(error_out, "the shim was built without instrumentation");
+    return 0;
+#endif
+}
+
+} // extern "C"
@@ -0,0 +1,370 @@
+#include "shim_internal.h"
+
+namespace pacm_v8 {
+
+const std::vector<uint8_t>* ModuleCodeCache::lookup(const ScriptCacheKey& key) {
+    auto found = index_.find(key);
+    if (found == index_.end()) {
+        return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, found->second);
+    return &found->second->data;
+}
+
+void ModuleCodeCache::insert(const ScriptCacheKey& key, const uint8_t* data, std::size_t length) {
+    if (length > capacity_ || index_.count(key) > 0) {
+        return;
+    }
+    while (bytes_ + length > capacity_ && !lru_.empty()) {
+        bytes_ -= lru_.back().data.size();
+        index_.erase(lru_.back().key);
+        lru_.pop_back();
+    }
+
+    lru_.push_front(Entry{key, std::vector<uint8_t>(data, data + length)});
+    index_.emplace(key, lru_.begin());
+    bytes_ += length;
+}
+
+void ModuleCodeCache::erase(const ScriptCacheKey& key) {
+    auto found = index_.find(key);
+    if (found == index_.end()) {
+        return;
+    }
+    bytes_ -= found->second->data.size();
+    lru_.erase(found->second);
+    index_.erase(found);
+}
+
+void ModuleCodeCache::clear() {
+    index_.clear();
+    lru_.clear();
+    bytes_ = 0;
+}
+
+namespace {
+
+// Releases the host's answers however the load ends.
+class ModuleSources {
+public:
+    explicit ModuleSources(std::size_t count) : sources_(count) {}
+    ~ModuleSources() {
+        for (ShimModuleSource& source : sources_) {
+            ::pacm_v8__value_release(&source.name);
+            ::pacm_v8__value_release(&source.source);
+        }
+    }
+    ModuleSources(const ModuleSources&) = delete;
+    ModuleSources& operator=(const ModuleSources&) = delete;
+
+    ShimModuleSource* data() { return sources_.data(); }
+    ShimModuleSource& operator[](std::size_t index) { return sources_[index]; }
+
+private:
+    std::vector<ShimModuleSource> sources_;
+};
+
+std::string_view shim_string(const ShimValue& value) {
+    if (value.kind != SHIM_VALUE_STRING || (!value.data && value.length > 0)) {
+        return {};
+    }
+    return std::string_view{reinterpret_cast<const char*>(value.data), value.length};
+}
+
+bool compile_module(
+    ContextWrapper* context,
+    std::string_view name,
+    std::string_view source,
+    v8::TryCatch& try_catch,
+    v8::Local<v8::Module>& module_out,
+    std::string& error_out) {
+    v8::Isolate* isolate = context->isolate();
+    v8::Local<v8::String> resource_name;
+    v8::Local<v8::String> text;
+    if (!new_utf8_string(isolate, name, resource_name) || !new_utf8_string(isolate, source, text)) {
+        error_out = "module source was too long";
+        return false;
+    }
+
+    // The key covers the name as well: V8 only checks the source hash of a code cache.
+    ScriptCacheKey key = ScriptCacheKey::from_source(source);
+    const ScriptCacheKey name_key = ScriptCacheKey::from_source(name);
+    key.hash ^= name_key.hash * 0x9e3779b97f4a7c15ull;
+    key.check ^= name_key.check;
+
+    ModuleCodeCache& cache = context->isolate_wrapper->module_cache;
+    v8::ScriptCompiler::CachedData* cached = nullptr;
+    if (const std::vector<uint8_t>* bytes = cache.lookup(key)) {
+        cached = new v8::ScriptCompiler::CachedData(bytes->data(), static_cast<int>(bytes->size()), v8::ScriptCompiler::CachedData::BufferNotOwned);
+    }
+
+    v8::ScriptOrigin origin(resource_name, 0, 0, false, -1, v8::Local<v8::Value>(), false, false, true);
+    v8::ScriptCompiler::Source module_source(text, origin, cached);
+    v8::ScriptCompiler::CompileOptions options =
+        cached ? v8::ScriptCompiler::kConsumeCodeCache : v8::ScriptCompiler::kNoCompileOptions;
+    if (!v8::ScriptCompiler::CompileModule(isolate, &module_source, options).ToLocal(&module_out)) {
+        capture_exception(isolate, try_catch, error_out);
+        return false;
+    }
+
+    if (!cached || module_source.GetCachedData()->rejected) {
+        // A rejected entry would otherwise be offered again on every compile of this source.
+        if (cached) {
+            cache.erase(key);
+        }
+        std::unique_ptr<v8::ScriptCompiler::CachedData> created(
+            v8::ScriptCompiler::CreateCodeCache(module_out->GetUnboundModuleScript()));
+        if (created && created->data && created->length > 0) {
+            cache.insert(key, created->data, static_cast<std::size_t>(created->length));
+        }
+    }
+    return true;
+}
+
+const std::string* module_name(ContextWrapper* context, v8::Local<v8::Module> module) {
+    auto range = context->module_names.equal_range(module->GetIdentityHash());
+    for (auto it = range.first; it != range.second; ++it) {
+        auto record = context->modules.find(it->second);
+        if (record != context->modules.end() && record->second.module == module) {
+            return &record->first;
+        }
+    }
+    return nullptr;
+}
+
+v8::MaybeLocal<v8::Module> resolve_module(
+    v8::Local<v8::Context> ctx,
+    v8::Local<v8::String> specifier,
+    v8::Local<v8::FixedArray>,
+    v8::Local<v8::Module> referrer) {
+    v8::Isolate* isolate = ctx->GetIsolate();
+    auto* context = static_cast<ContextWrapper*>(ctx->GetAlignedPointerFromEmbedderData(kContextWrapperEmbedderIndex));
+    const std::string* referrer_name = context ? module_name(context, referrer) : nullptr;
+    if (referrer_name) {
+        v8::String::Utf8Value text(isolate, specifier);
+        const ModuleRecord& record = context->modules.find(*referrer_name)->second;
+        auto resolved = record.imports.find(std::string_view{*text ? *text : "", static_cast<std::size_t>(text.length())});
+        if (resolved != record.imports.end()) {
+            auto target = context->modules.find(resolved->second);
+            if (target != context->modules.end()) {
+                return v8::Local<v8::Module>::New(isolate, target->second.module);
+            }
+        }
+    }
+    isolate->ThrowError(v8::String::NewFromUtf8Literal(isolate, "module import was not loaded"));
+    return v8::MaybeLocal<v8::Module>();
+}
+
+// Modules added by a load that failed before instantiation, so a retry fetches them again.
+class PendingModules {
+public:
+    explicit PendingModules(ContextWrapper* context) : context_(context) {}
+    ~PendingModules() {
+        if (committed_) {
+            return;
+        }
+        for (const auto& [hash, name] : added_) {
+            auto range = context_->module_names.equal_range(hash);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second == name) {
+                    context_->module_names.erase(it);
+                    break;
+                }
+            }
+            context_->modules.erase(name);
+        }
+    }
+    PendingModules(const PendingModules&) = delete;
+    PendingModules& operator=(const PendingModules&) = delete;
+
+    void add(std::string name, v8::Local<v8::Module> module) {
+        const int hash = module->GetIdentityHash();
+        context_->module_names.emplace(hash, name);
+        context_->modules[name].module.Reset(context_->isolate(), module);
+        added_.emplace_back(hash, std::move(name));
+    }
+    void commit() { committed_ = true; }
+
+private:
+    ContextWrapper* context_;
+    std::vector<std::pair<int, std::string>> added_;
+    bool committed_ = false;
+};
+
+// Loads the import graph below root level by level; each level is one host call.
+bool load_imports(
+    ContextWrapper* context,
+    const std::string& root,
+    void* loader,
+    v8::TryCatch& try_catch,
+    PendingModules& pending,
+    std::string& error_out) {
+    v8::Isolate* isolate = context->isolate();
+    std::vector<std::string> frontier{root};
+
+    while (!frontier.empty()) {
+        std::vector<std::string> specifiers;
+        std::vector<const std::string*> referrers;
+        for (const std::string& name : frontier) {
+            v8::Local<v8::Module> module = v8::Local<v8::Module>::New(isolate, context->modules.find(name)->second.module);
+            v8::Local<v8::FixedArray> requests = module->GetModuleRequests();
+            for (int i = 0; i < requests->Length(); ++i) {
+                v8::Local<v8::ModuleRequest> request = requests->Get(isolate->GetCurrentContext(), i).As<v8::ModuleRequest>();
+                v8::String::Utf8Value specifier(isolate, request->GetSpecifier());
+                specifiers.emplace_back(*specifier ? *specifier : "", specifier.length());
+                referrers.push_back(&name);
+            }
+        }
+        if (specifiers.empty()) {
+            return true;
+        }
+
+        std::vector<ShimModuleRequest> requests(specifiers.size());
+        for (std::size_t i = 0; i < specifiers.size(); ++i) {
+            requests[i] = ShimModuleRequest{specifiers[i].data(), specifiers[i].size(), referrers[i]->data(), referrers[i]->size()};
+        }
+        ModuleSources sources(requests.size());
+        char* host_error = nullptr;
+        if (!::pacm_v8__module_load(loader, requests.data(), requests.size(), sources.data(), &host_error)) {
+            error_out = host_error ? host_error : "failed to load module imports";
+            if (host_error) {
+                ::pacm_v8__string_free(host_error);
+            }
+            return false;
+        }
+
+        std::vector<std::string> next;
+        for (std::size_t i = 0; i < requests.size(); ++i) {
+            std::string_view name = shim_string(sources[i].name);
+            if (name.empty()) {
+                error_out = "module loader returned no name for '" + specifiers[i] + "'";
+                return false;
+            }
+            context->modules.find(*referrers[i])->second.imports.emplace(specifiers[i], name);
+            if (context->modules.find(name) != context->modules.end()) {
+                continue;
+            }
+            if (sources[i].source.kind != SHIM_VALUE_STRING) {
+                error_out = "module loader returned no source for '" + std::string(name) + "'";
+                return false;
+            }
+
+            v8::Local<v8::Module> module;
+            if (!compile_module(context, name, shim_string(sources[i].source), try_catch, module, error_out)) {
+                return false;
+            }
+            pending.add(std::string(name), module);
+            next.emplace_back(name);
+        }
+        frontier.swap(next);
+    }
+    return true;
+}
+
+} // namespace
+
+} // namespace pacm_v8
+
+extern "C" {
+
+int shim_context_load_module(
+    V8ContextHandle handle,
+    const char* name,
+    size_t name_length,
+    const char* source,
+    size_t source_length,
+    void* loader,
+    ShimValue* result_out,
+    char** error_out) {
+    if (result_out) {
+        *result_out = ShimValue{};
+    }
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::ContextWrapper* context = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_context(handle, context, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return SHIM_STATUS_ERROR;
+    }
+    if (!name || name_length == 0) {
+        pacm_v8::assign_error(error_out, "module name was empty");
+        return SHIM_STATUS_ERROR;
+    }
+    if (!source) {
+        pacm_v8::assign_error(error_out, "source was null");
+        return SHIM_STATUS_ERROR;
+    }
+
+    v8::Isolate* isolate = context->isolate();
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+    v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context->context);
+    v8::Context::Scope context_scope(ctx);
+    v8::TryCatch try_catch(isolate);
+    pacm_v8::ExecutionGuard guard(context->isolate_wrapper, context);
+    if (guard.refused()) {
+        return guard.reject(error_out);
+    }
+
+    // A module that is already loaded is not evaluated again.
+    std::string root(name, name_length);
+    v8::Local<v8::Module> module;
+    auto loaded = context->modules.find(root);
+    if (loaded != context->modules.end()) {
+        module = v8::Local<v8::Module>::New(isolate, loaded->second.module);
+    } else {
+        pacm_v8::PendingModules pending(context);
+        if (!pacm_v8::compile_module(context, root, std::string_view{source, source_length}, try_catch, module, error)) {
+            pacm_v8::assign_error(error_out, error);
+            return SHIM_STATUS_ERROR;
+        }
+        pending.add(root, module);
+        if (!pacm_v8::load_imports(context, root, loader, try_catch, pending, error)) {
+            pacm_v8::assign_error(error_out, error);
+            return SHIM_STATUS_ERROR;
+        }
+        if (!module->InstantiateModule(ctx, pacm_v8::resolve_module).FromMaybe(false)) {
+            pacm_v8::capture_exception(isolate, try_catch, error);
+            pacm_v8::assign_error(error_out, error);
+            return SHIM_STATUS_ERROR;
+        }
+        pending.commit();
+    }
+
+    if (module->GetStatus() == v8::Module::kErrored) {
+        v8::String::Utf8Value exception(isolate, module->GetException());
+        pacm_v8::assign_error(error_out, *exception ? std::string(*exception, exception.length()) : std::string("module evaluation failed"));
+        return SHIM_STATUS_ERROR;
+    }
+
+    v8::Local<v8::Value> completion;
+    if (!module->Evaluate(ctx).ToLocal(&completion)) {
+        pacm_v8::capture_exception(isolate, try_catch, error);
+        int status = pacm_v8::execution_failure(context->isolate_wrapper, error);
+        pacm_v8::assign_error(error_out, error);
+        return status;
+    }
+    int status = pacm_v8::settle_value(context, ctx, try_catch, completion, error);
+    if (status != SHIM_STATUS_OK) {
+        pacm_v8::assign_error(error_out, error);
+        return status;
+    }
+
+    v8::Local<v8::Object> exports = module->GetModuleNamespace().As<v8::Object>();
+    v8::Local<v8::Value> result;
+    if (!exports->Get(ctx, v8::String::NewFromUtf8Literal(isolate, "default")).ToLocal(&result)) {
+        pacm_v8::capture_exception(isolate, try_catch, error);
+        pacm_v8::assign_error(error_out, error);
+        return SHIM_STATUS_ERROR;
+    }
+    if (result_out && !pacm_v8::to_shim_value_owned(isolate, result, *result_out)) {
+        pacm_v8::assign_error(error_out, "failed to allocate result buffer");
+        return SHIM_STATUS_ERROR;
+    }
+    return SHIM_STATUS_OK;
+}
+
+} // extern "C"
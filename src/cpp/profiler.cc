@@ -0,0 +1,183 @@
+#include "shim_internal.h"
+
+#include <limits>
+
+namespace pacm_v8 {
+
+namespace {
+
+class StringOutputStream : public v8::OutputStream {
+public:
+    explicit StringOutputStream(std::string& out) : out_(out) {}
+
+    void EndOfStream() override {}
+
+    int GetChunkSize() override { return 64 * 1024; }
+
+    WriteResult WriteAsciiChunk(char* data, int size) override {
+        out_.append(data, static_cast<std::size_t>(size));
+        return kContinue;
+    }
+
+private:
+    std::string& out_;
+};
+
+} // namespace
+
+void dispose_cpu_profiler(IsolateWrapper* wrapper) {
+    if (!wrapper->cpu_profiler) {
+        return;
+    }
+    v8::Isolate::Scope isolate_scope(wrapper->isolate);
+    // Disposing the profiler also deletes profiles that were never stopped.
+    wrapper->cpu_profiler->Dispose();
+    wrapper->cpu_profiler = nullptr;
+    wrapper->active_cpu_profiles = 0;
+}
+
+} // namespace pacm_v8
+
+extern "C" {
+
+int shim_v8_set_flags(const char* flags, size_t flags_length, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+    if (!flags && flags_length > 0) {
+        pacm_v8::assign_error(error_out, "flags were null");
+        return 0;
+    }
+    if (pacm_v8::g_v8_initialized) {
+        pacm_v8::assign_error(error_out, "V8 flags must be set before V8 is initialized");
+        return 0;
+    }
+
+    v8::V8::SetFlagsFromString(flags ? flags : "", flags_length);
+    return 1;
+}
+
+int shim_context_start_cpu_profile(
+    V8ContextHandle handle,
+    const char* title,
+    size_t title_length,
+    uint32_t sampling_interval_us,
+    char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::ContextWrapper* context = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_context(handle, context, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+    if (sampling_interval_us > static_cast<uint32_t>(std::numeric_limits<int>::max())) {
+        pacm_v8::assign_error(error_out, "sampling interval was too long");
+        return 0;
+    }
+
+    pacm_v8::IsolateWrapper* wrapper = context->isolate_wrapper;
+    v8::Isolate* isolate = context->isolate();
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+    v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context->context);
+    v8::Context::Scope context_scope(ctx);
+
+    v8::Local<v8::String> profile_title;
+    if (!pacm_v8::new_utf8_string(isolate, std::string_view(title ? title : "", title_length), profile_title)) {
+        pacm_v8::assign_error(error_out, "profile title was too long");
+        return 0;
+    }
+
+    if (!wrapper->cpu_profiler) {
+        wrapper->cpu_profiler = v8::CpuProfiler::New(isolate);
+    }
+    // The profiler-wide interval can only change while nothing is recorded.
+    const int interval = static_cast<int>(sampling_interval_us);
+    if (wrapper->active_cpu_profiles == 0 && interval > 0) {
+        wrapper->cpu_profiler->SetSamplingInterval(interval);
+    }
+
+    v8::CpuProfilingOptions options(
+        v8::kLeafNodeLineNumbers,
+        v8::CpuProfilingOptions::kNoSampleLimit,
+        interval,
+        ctx);
+    switch (wrapper->cpu_profiler->StartProfiling(profile_title, std::move(options))) {
+    case v8::CpuProfilingStatus::kStarted:
+        ++wrapper->active_cpu_profiles;
+        return 1;
+    case v8::CpuProfilingStatus::kAlreadyStarted:
+        pacm_v8::assign_error(error_out, "a CPU profile with this title is already running");
+        return 0;
+    case v8::CpuProfilingStatus::kErrorTooManyProfilers:
+        break;
+    }
+    pacm_v8::assign_error(error_out, "too many CPU profiles are running");
+    return 0;
+}
+
+int shim_context_stop_cpu_profile(
+    V8ContextHandle handle,
+    const char* title,
+    size_t title_length,
+    uint8_t** json_out,
+    size_t* json_length_out,
+    char** error_out) {
+    if (json_out) {
+        *json_out = nullptr;
+    }
+    if (json_length_out) {
+        *json_length_out = 0;
+    }
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::ContextWrapper* context = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_context(handle, context, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+    if (!json_out || !json_length_out) {
+        pacm_v8::assign_error(error_out, "profile output was null");
+        return 0;
+    }
+
+    pacm_v8::IsolateWrapper* wrapper = context->isolate_wrapper;
+    v8::Isolate* isolate = context->isolate();
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+
+    v8::Local<v8::String> profile_title;
+    if (!pacm_v8::new_utf8_string(isolate, std::string_view(title ? title : "", title_length), profile_title)) {
+        pacm_v8::assign_error(error_out, "profile title was too long");
+        return 0;
+    }
+
+    v8::CpuProfile* profile =
+        wrapper->cpu_profiler ? wrapper->cpu_profiler->StopProfiling(profile_title) : nullptr;
+    if (!profile) {
+        pacm_v8::assign_error(error_out, "no CPU profile with this title is running");
+        return 0;
+    }
+    --wrapper->active_cpu_profiles;
+
+    std::string json;
+    pacm_v8::StringOutputStream stream(json);
+    profile->Serialize(&stream, v8::CpuProfile::kJSON);
+    profile->Delete();
+
+    *json_out = pacm_v8::copy_bytes(reinterpret_cast<const uint8_t*>(json.data()), json.size());
+    if (!*json_out) {
+        pacm_v8::assign_error(error_out, "failed to allocate profile buffer");
+        return 0;
+    }
+    *json_length_out = json.size();
+    return 1;
+}
+
+} // extern "C"
@@ -0,0 +1,263 @@
+#include "shim_internal.h"
+
+namespace pacm_v8 {
+
+namespace {
+
+void discard_completion(PromiseCompletion& completion) {
+    if (completion.value.kind == SHIM_VALUE_EXTERNAL_BYTES) {
+        ::pacm_v8__buffer_release(reinterpret_cast<void*>(static_cast<intptr_t>(completion.value.integer)));
+        completion.value = ShimValue{};
+        return;
+    }
+    ::pacm_v8__value_release(&completion.value);
+}
+
+void complete(V8PromiseCompleterHandle handle, PromiseCompletion completion) {
+    auto* completer = reinterpret_cast<PromiseCompleter*>(handle);
+    if (!completer) {
+        discard_completion(completion);
+        return;
+    }
+    std::shared_ptr<CompletionQueue> queue = std::move(completer->queue);
+    completion.promise_id = completer->promise_id;
+    const uint64_t generation = completer->generation;
+    delete completer;
+
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        const bool current = generation == queue->generation;
+        if (current) {
+            --queue->outstanding;
+        }
+        if (current && !queue->closed) {
+            queue->items.push_back(std::move(completion));
+            queued = true;
+        }
+    }
+    if (queued) {
+        queue->ready.notify_all();
+    } else {
+        discard_completion(completion);
+    }
+}
+
+v8::Local<v8::Value> rejection_error(v8::Isolate* isolate, const std::string& message) {
+    v8::Local<v8::String> text;
+    if (!v8::String::NewFromUtf8(isolate, message.data(), v8::NewStringType::kNormal, static_cast<int>(message.size())).ToLocal(&text)) {
+        text = v8::String::NewFromUtf8Literal(isolate, "host function failed");
+    }
+    return v8::Exception::Error(text);
+}
+
+void drain_completions(ContextWrapper* context, v8::Local<v8::Context> ctx) {
+    std::vector<PromiseCompletion> items;
+    {
+        std::lock_guard<std::mutex> lock(context->completions->mutex);
+        items.swap(context->completions->items);
+    }
+
+    v8::Isolate* isolate = context->isolate();
+    for (PromiseCompletion& completion : items) {
+        auto pending = context->pending_promises.find(completion.promise_id);
+        if (pending == context->pending_promises.end()) {
+            discard_completion(completion);
+            continue;
+        }
+
+        v8::HandleScope handle_scope(isolate);
+        v8::Local<v8::Promise::Resolver> resolver = v8::Local<v8::Promise::Resolver>::New(isolate, pending->second);
+        context->pending_promises.erase(pending);
+
+        if (!completion.fulfilled) {
+            resolver->Reject(ctx, rejection_error(isolate, completion.error)).FromMaybe(false);
+            continue;
+        }
+        v8::Local<v8::Value> value;
+        bool converted = from_shim_value(isolate, completion.value, value);
+        ::pacm_v8__value_release(&completion.value);
+        if (converted) {
+            resolver->Resolve(ctx, value).FromMaybe(false);
+        } else {
+            resolver->Reject(ctx, rejection_error(isolate, "host function returned an unsupported value")).FromMaybe(false);
+        }
+    }
+}
+
+} // namespace
+
+bool start_host_promise(
+    ContextWrapper* context,
+    v8::Local<v8::Context> ctx,
+    uint64_t function_id,
+    const ShimValue* args,
+    std::size_t arg_count,
+    v8::Local<v8::Promise>& promise_out) {
+    v8::Local<v8::Promise::Resolver> resolver;
+    if (!v8::Promise::Resolver::New(ctx).ToLocal(&resolver)) {
+        return false;
+    }
+
+    uint64_t promise_id = ++context->next_promise_id;
+    context->pending_promises.emplace(promise_id, v8::Global<v8::Promise::Resolver>(context->isolate(), resolver));
+    uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(context->completions->mutex);
+        ++context->completions->outstanding;
+        generation = context->completions->generation;
+    }
+
+    // The host may settle the completer before this returns; it is applied on the next drain.
+    auto* completer = new PromiseCompleter{context->completions, promise_id, generation};
+    {
+        HostCallScope host_call(context->isolate_wrapper);
+        ::pacm_v8__host_function_invoke_async(function_id, args, arg_count, completer);
+    }
+    promise_out = resolver->GetPromise();
+    return true;
+}
+
+int pump_context(ContextWrapper* context, v8::Local<v8::Context> ctx, v8::TryCatch& try_catch, std::string& error_out) {
+    v8::Isolate* isolate = context->isolate();
+    drain_completions(context, ctx);
+    isolate->PerformMicrotaskCheckpoint();
+    while (!isolate->IsExecutionTerminating() && v8::platform::PumpMessageLoop(g_platform.get(), isolate)) {
+        isolate->PerformMicrotaskCheckpoint();
+    }
+
+    if (isolate->IsExecutionTerminating() || try_catch.HasTerminated()) {
+        error_out = "V8 execution failed";
+        return execution_failure(context->isolate_wrapper, error_out);
+    }
+    return SHIM_STATUS_OK;
+}
+
+int settle_value(ContextWrapper* context, v8::Local<v8::Context> ctx, v8::TryCatch& try_catch, v8::Local<v8::Value>& value, std::string& error_out) {
+    if (value.IsEmpty() || !value->IsPromise()) {
+        return SHIM_STATUS_OK;
+    }
+
+    v8::Isolate* isolate = context->isolate();
+    v8::Local<v8::Promise> promise = value.As<v8::Promise>();
+    CompletionQueue& queue = *context->completions;
+    const bool bounded = context->timeout_ms > 0;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(context->timeout_ms);
+    auto has_work = [&queue]() { return !queue.items.empty() || queue.outstanding == 0; };
+
+    while (true) {
+        int status = pump_context(context, ctx, try_catch, error_out);
+        if (status != SHIM_STATUS_OK) {
+            return status;
+        }
+
+        switch (promise->State()) {
+        case v8::Promise::kFulfilled:
+            value = promise->Result();
+            return SHIM_STATUS_OK;
+        case v8::Promise::kRejected: {
+            promise->MarkAsHandled();
+            v8::String::Utf8Value reason(isolate, promise->Result());
+            error_out = *reason ? std::string(*reason, reason.length()) : std::string("promise was rejected");
+            return SHIM_STATUS_ERROR;
+        }
+        case v8::Promise::kPending:
+            break;
+        }
+
+        // Platform tasks are run above but never waited for; only host completions can
+        // still settle the promise from here.
+        std::unique_lock<std::mutex> lock(queue.mutex);
+        if (queue.items.empty() && queue.outstanding == 0) {
+            error_out = "promise did not settle and no host operation is pending";
+            return SHIM_STATUS_ERROR;
+        }
+        if (!bounded) {
+            queue.ready.wait(lock, has_work);
+        } else if (!queue.ready.wait_until(lock, deadline, has_work)) {
+            lock.unlock();
+            int expected = static_cast<int>(TerminationReason::kNone);
+            context->isolate_wrapper->termination_reason.compare_exchange_strong(expected, static_cast<int>(TerminationReason::kTimeout));
+            return execution_failure(context->isolate_wrapper, error_out);
+        }
+    }
+}
+
+void close_completions(ContextWrapper* context) {
+    std::vector<PromiseCompletion> items;
+    {
+        std::lock_guard<std::mutex> lock(context->completions->mutex);
+        context->completions->closed = true;
+        items.swap(context->completions->items);
+    }
+    for (PromiseCompletion& completion : items) {
+        discard_completion(completion);
+    }
+    context->pending_promises.clear();
+}
+
+void reset_completions(ContextWrapper* context) {
+    std::vector<PromiseCompletion> items;
+    {
+        std::lock_guard<std::mutex> lock(context->completions->mutex);
+        ++context->completions->generation;
+        context->completions->outstanding = 0;
+        items.swap(context->completions->items);
+    }
+    for (PromiseCompletion& completion : items) {
+        discard_completion(completion);
+    }
+    context->pending_promises.clear();
+}
+
+} // namespace pacm_v8
+
+extern "C" {
+
+void shim_promise_resolve(V8PromiseCompleterHandle completer, const ShimValue* value) {
+    pacm_v8::PromiseCompletion completion{};
+    completion.fulfilled = true;
+    if (value) {
+        completion.value = *value;
+    }
+    pacm_v8::complete(completer, std::move(completion));
+}
+
+void shim_promise_reject(V8PromiseCompleterHandle completer, const char* message) {
+    pacm_v8::PromiseCompletion completion{};
+    completion.fulfilled = false;
+    completion.error = message ? message : "host function failed";
+    pacm_v8::complete(completer, std::move(completion));
+}
+
+int shim_context_pump(V8ContextHandle handle, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::ContextWrapper* context = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_context(handle, context, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+
+    v8::Isolate* isolate = context->isolate();
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+    v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context->context);
+    v8::Context::Scope context_scope(ctx);
+    v8::TryCatch try_catch(isolate);
+    pacm_v8::ExecutionGuard guard(context->isolate_wrapper, context);
+    if (guard.refused()) {
+        return guard.reject(error_out);
+    }
+
+    int status = pacm_v8::pump_context(context, ctx, try_catch, error);
+    if (status != SHIM_STATUS_OK) {
+        pacm_v8::assign_error(error_out, error);
+    }
+    return status;
+}
+
+} // extern "C"
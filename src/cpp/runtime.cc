@@ -1,11 +1,102 @@
 #include "shim_internal.h"
 
+#include <algorithm>
 #include <stdexcept>
 
 namespace pacm_v8 {
 
 std::unique_ptr<v8::Platform> g_platform;
 std::once_flag g_v8_once;
+std::atomic<bool> g_v8_initialized{false};
+
+// Extra room granted past the limit so the terminated script can unwind.
+constexpr std::size_t kMinHeapLimitHeadroom = 4 * 1024 * 1024;
+
+// The limit only ever grows relative to the configured one, by at most two headrooms: once
+// for the terminated script to unwind and once more if unwinding itself allocates. The
+// isolate is poisoned, so no later call can push it further.
+static std::size_t near_heap_limit(void* data, std::size_t current_heap_limit, std::size_t initial_heap_limit) {
+    auto* wrapper = static_cast<IsolateWrapper*>(data);
+    wrapper->poisoned.store(true);
+    int expected = static_cast<int>(TerminationReason::kNone);
+    wrapper->termination_reason.compare_exchange_strong(expected, static_cast<int>(TerminationReason::kHeapLimit));
+    wrapper->isolate->TerminateExecution();
+    const std::size_t headroom = std::max(initial_heap_limit / 4, kMinHeapLimitHeadroom);
+    const std::size_t cap = initial_heap_limit + 2 * headroom;
+    return std::max(current_heap_limit, std::min(current_heap_limit + headroom, cap));
+}
+
+V8IsolateHandle create_isolate(const ShimIsolateOptions& options) {
+    auto wrapper = std::make_unique<IsolateWrapper>();
+
+    v8::Isolate::CreateParams params;
+    params.array_buffer_allocator = v8::ArrayBuffer::Allocator::NewDefaultAllocator();
+    params.external_references = external_references();
+    if (options.initial_old_generation_bytes > 0) {
+        params.constraints.set_initial_old_generation_size_in_bytes(options.initial_old_generation_bytes);
+    }
+    if (options.max_old_generation_bytes > 0) {
+        params.constraints.set_max_old_generation_size_in_bytes(options.max_old_generation_bytes);
+    }
+    if (options.initial_young_generation_bytes > 0) {
+        params.constraints.set_initial_young_generation_size_in_bytes(options.initial_young_generation_bytes);
+    }
+    if (options.max_young_generation_bytes > 0) {
+        params.constraints.set_max_young_generation_size_in_bytes(options.max_young_generation_bytes);
+    }
+
+    const uint8_t* snapshot = options.snapshot;
+    const std::size_t snapshot_length = options.snapshot_length;
+    if (snapshot && snapshot_length > 0) {
+        wrapper->snapshot_blob.assign(reinterpret_cast<const char*>(snapshot), reinterpret_cast<const char*>(snapshot) + snapshot_length);
+        wrapper->startup_data.data = wrapper->snapshot_blob.data();
+        wrapper->startup_data.raw_size = static_cast<int>(wrapper->snapshot_blob.size());
+        if (!wrapper->startup_data.IsValid()) {
+            delete params.array_buffer_allocator;
+            return nullptr;
+        }
+        params.snapshot_blob = &wrapper->startup_data;
+    }
+
+    v8::Isolate* isolate = v8::Isolate::New(params);
+    if (!isolate) {
+        delete params.array_buffer_allocator;
+        return nullptr;
+    }
+
+    wrapper->isolate = isolate;
+    wrapper->allocator = params.array_buffer_allocator;
+    isolate->AddNearHeapLimitCallback(near_heap_limit, wrapper.get());
+    install_gc_callbacks(wrapper.get());
+    // Drop back to the configured limit once a terminated script's garbage has been collected.
+    isolate->AutomaticallyRestoreInitialHeapLimit();
+    return reinterpret_cast<V8IsolateHandle>(wrapper.release());
+}
+
+int execution_failure(IsolateWrapper* wrapper, std::string& error_out) {
+    if (!wrapper || !wrapper->isolate) {
+        return SHIM_STATUS_ERROR;
+    }
+    auto reason = static_cast<TerminationReason>(wrapper->termination_reason.exchange(static_cast<int>(TerminationReason::kNone)));
+    if (reason == TerminationReason::kNone) {
+        return SHIM_STATUS_ERROR;
+    }
+    wrapper->isolate->CancelTerminateExecution();
+    switch (reason) {
+    case TerminationReason::kHeapLimit:
+        error_out = "JavaScript heap limit reached";
+        return SHIM_STATUS_HEAP_LIMIT;
+    case TerminationReason::kTimeout:
+        error_out = "script execution timed out";
+        return SHIM_STATUS_TIMEOUT;
+    case TerminationReason::kCpuBudget:
+        error_out = "CPU budget exhausted";
+        return SHIM_STATUS_CPU_BUDGET;
+    case TerminationReason::kNone:
+        break;
+    }
+    return SHIM_STATUS_ERROR;
+}
 
 } // namespace pacm_v8
 
@@ -24,6 +115,7 @@ int shim_v8_initialize(const char* icu_data_path) {
                 throw std::runtime_error("ICU initialization failed");
             }
 
+            pacm_v8::g_v8_initialized = true;
             pacm_v8::g_platform = v8::platform::NewDefaultPlatform();
             v8::V8::InitializePlatform(pacm_v8::g_platform.get());
             v8::V8::Initialize();
@@ -36,19 +128,21 @@ int shim_v8_initialize(const char* icu_data_path) {
 }
 
 V8IsolateHandle shim_create_isolate() {
-    v8::Isolate::CreateParams params;
-    params.array_buffer_allocator = v8::ArrayBuffer::Allocator::NewDefaultAllocator();
+    return pacm_v8::create_isolate(ShimIsolateOptions{});
+}
 
-    v8::Isolate* isolate = v8::Isolate::New(params);
-    if (!isolate) {
-        delete params.array_buffer_allocator;
+V8IsolateHandle shim_create_isolate_from_snapshot(const uint8_t* blob, size_t length) {
+    if (!blob || length == 0) {
         return nullptr;
     }
+    ShimIsolateOptions options{};
+    options.snapshot = blob;
+    options.snapshot_length = length;
+    return pacm_v8::create_isolate(options);
+}
 
-    auto* wrapper = new pacm_v8::IsolateWrapper();
-    wrapper->isolate = isolate;
-    wrapper->allocator = params.array_buffer_allocator;
-    return reinterpret_cast<V8IsolateHandle>(wrapper);
+V8IsolateHandle shim_create_isolate_with_options(const ShimIsolateOptions* options) {
+    return pacm_v8::create_isolate(options ? *options : ShimIsolateOptions{});
 }
 
 void shim_dispose_isolate(V8IsolateHandle handle) {
@@ -58,6 +152,11 @@ void shim_dispose_isolate(V8IsolateHandle handle) {
     }
 
     if (wrapper->isolate) {
+        pacm_v8::dispose_cpu_profiler(wrapper);
+        pacm_v8::dispose_classes(wrapper);
+        pacm_v8::release_retired_callbacks(wrapper);
+        wrapper->retired_callbacks.clear();
+        wrapper->script_cache.clear();
         wrapper->isolate->Dispose();
         wrapper->isolate = nullptr;
     }
@@ -66,4 +165,74 @@ void shim_dispose_isolate(V8IsolateHandle handle) {
     delete wrapper;
 }
 
+int shim_isolate_set_script_cache_limit(V8IsolateHandle handle, std::size_t capacity_bytes, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::IsolateWrapper* wrapper = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_isolate(handle, wrapper, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+
+    wrapper->script_cache.set_capacity(capacity_bytes);
+    return 1;
+}
+
+int shim_isolate_script_cache_stats(V8IsolateHandle handle, ShimScriptCacheStats* stats_out, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::IsolateWrapper* wrapper = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_isolate(handle, wrapper, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+    if (!stats_out) {
+        pacm_v8::assign_error(error_out, "stats output was null");
+        return 0;
+    }
+
+    *stats_out = wrapper->script_cache.stats();
+    return 1;
+}
+
+int shim_isolate_is_poisoned(V8IsolateHandle handle) {
+    auto* wrapper = pacm_v8::unwrap_isolate(handle);
+    return wrapper && wrapper->poisoned.load() ? 1 : 0;
+}
+
+int shim_isolate_lock(V8IsolateHandle handle, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::IsolateWrapper* wrapper = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_isolate(handle, wrapper, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+
+    // Blocks while another thread holds the lock, so locker is only touched by its holder.
+    auto locker = std::make_unique<v8::Locker>(wrapper->isolate);
+    if (wrapper->locker) {
+        pacm_v8::assign_error(error_out, "isolate is already locked by this thread");
+        return 0;
+    }
+    wrapper->locker = std::move(locker);
+    return 1;
+}
+
+void shim_isolate_unlock(V8IsolateHandle handle) {
+    pacm_v8::IsolateWrapper* wrapper = pacm_v8::unwrap_isolate(handle);
+    if (wrapper) {
+        wrapper->locker.reset();
+    }
+}
+
 } // extern "C"
@@ -1,7 +1,98 @@
 #include "shim_internal.h"
 
+#include <cstring>
+
+// kFollowCompileHintsMagicComment arrived with V8 13.
+#if V8_MAJOR_VERSION >= 13
+#define PACM_V8_HAS_COMPILE_HINT_COMMENTS 1
+#else
+#define PACM_V8_HAS_COMPILE_HINT_COMMENTS 0
+#endif
+
 namespace pacm_v8 {
 
+namespace {
+
+// Distinguishes the cache keys of encodings whose bytes could coincide for different texts.
+constexpr uint64_t kOneByteKeySalt = 0x9e3779b97f4a7c15ull;
+constexpr uint64_t kTwoByteKeySalt = 0xc2b2ae3d27d4eb4full;
+
+class OneByteSourceResource : public v8::String::ExternalOneByteStringResource {
+public:
+    OneByteSourceResource(const char* data, std::size_t length, void* release_token)
+        : data_(data), length_(length), release_token_(release_token) {}
+    ~OneByteSourceResource() override { ::pacm_v8__external_source_release(release_token_); }
+
+    const char* data() const override { return data_; }
+    std::size_t length() const override { return length_; }
+
+private:
+    const char* data_;
+    std::size_t length_;
+    void* release_token_;
+};
+
+class TwoByteSourceResource : public v8::String::ExternalStringResource {
+public:
+    TwoByteSourceResource(const uint16_t* data, std::size_t length, void* release_token)
+        : data_(data), length_(length), release_token_(release_token) {}
+    ~TwoByteSourceResource() override { ::pacm_v8__external_source_release(release_token_); }
+
+    const uint16_t* data() const override { return data_; }
+    std::size_t length() const override { return length_; }
+
+private:
+    const uint16_t* data_;
+    std::size_t length_;
+    void* release_token_;
+};
+
+} // namespace
+
+SourceText::SourceText(const ShimExternalSource& source)
+    : external_(true), encoding_(source.encoding), release_token_(source.release_token) {
+    if (source.data) {
+        const std::size_t unit = encoding_ == SHIM_SOURCE_TWO_BYTE ? sizeof(uint16_t) : 1;
+        bytes_ = std::string_view{static_cast<const char*>(source.data), source.length * unit};
+    }
+}
+
+SourceText::~SourceText() {
+    if (release_token_) {
+        ::pacm_v8__external_source_release(release_token_);
+    }
+}
+
+ScriptCacheKey SourceText::cache_key() const {
+    ScriptCacheKey key = ScriptCacheKey::from_source(bytes_);
+    if (external_) {
+        key.check ^= encoding_ == SHIM_SOURCE_TWO_BYTE ? kTwoByteKeySalt : kOneByteKeySalt;
+    }
+    return key;
+}
+
+bool SourceText::to_string(v8::Isolate* isolate, v8::Local<v8::String>& out) {
+    if (!external_) {
+        return new_utf8_string(isolate, bytes_, out);
+    }
+
+    const bool two_byte = encoding_ == SHIM_SOURCE_TWO_BYTE;
+    const std::size_t length = two_byte ? bytes_.size() / sizeof(uint16_t) : bytes_.size();
+    if (length > static_cast<std::size_t>(v8::String::kMaxLength)) {
+        return false;
+    }
+    // From here on the resource owns the token: V8 disposes it with the string, or right
+    // away if it does not need it (e.g. for empty text).
+    void* token = release_token_;
+    release_token_ = nullptr;
+    if (two_byte) {
+        auto* resource = new TwoByteSourceResource(reinterpret_cast<const uint16_t*>(bytes_.data()), length, token);
+        return v8::String::NewExternalTwoByte(isolate, resource).ToLocal(&out);
+    }
+    auto* resource = new OneByteSourceResource(bytes_.data(), length, token);
+    return v8::String::NewExternalOneByte(isolate, resource).ToLocal(&out);
+}
+
 bool ensure_script(V8ScriptHandle handle, ScriptWrapper*& out, std::string& error_out) {
     out = unwrap_script(handle);
     if (!out || !out->script) {
@@ -11,54 +102,232 @@ bool ensure_script(V8ScriptHandle handle, ScriptWrapper*& out, std::string& erro
     return true;
 }
 
-} // namespace pacm_v8
+static bool ensure_script_and_context(
+    V8ScriptHandle script_handle,
+    V8ContextHandle context_handle,
+    ScriptWrapper*& script_out,
+    ContextWrapper*& context_out,
+    std::string& error_out) {
+    if (!ensure_script(script_handle, script_out, error_out)) {
+        return false;
+    }
+    if (!ensure_context(context_handle, context_out, error_out)) {
+        return false;
+    }
 
-extern "C" {
+    v8::Isolate* isolate = context_out->isolate();
+    if (!isolate || isolate != script_out->isolate_wrapper->isolate) {
+        error_out = "script and context belong to different isolates";
+        return false;
+    }
+    return true;
+}
 
-V8ScriptHandle shim_compile_script(V8IsolateHandle handle, const char* source, char** error_out) {
+bool run_script(
+    ScriptWrapper* script_wrapper,
+    ContextWrapper* context_wrapper,
+    v8::Local<v8::Context> ctx,
+    v8::TryCatch& try_catch,
+    v8::Local<v8::Value>& result_out,
+    std::string& error_out) {
+    v8::Isolate* isolate = context_wrapper->isolate();
+
+    v8::Local<v8::UnboundScript> unbound = v8::Local<v8::UnboundScript>::New(isolate, *script_wrapper->script);
+    v8::Local<v8::Script> script = unbound->BindToCurrentContext();
+
+    bool ran = false;
+    {
+        PACM_V8_SPAN(context_wrapper, run, "run");
+        ran = script->Run(ctx).ToLocal(&result_out);
+    }
+    if (!ran) {
+        capture_exception(isolate, try_catch, error_out);
+        return false;
+    }
+
+    // Seed the context cache so a later eval of the same source skips compilation.
+    if (script_wrapper->cache_key.length > 0 && script_wrapper->cache_key.length <= kMaxCacheableSourceLength) {
+        context_wrapper->isolate_wrapper->script_cache.insert(isolate, script_wrapper->cache_key, &context_wrapper->cache_user, unbound);
+    }
+    return true;
+}
+
+static v8::ScriptCompiler::CompileOptions compile_options(bool consume_cache, int32_t flags) {
+    if (consume_cache) {
+        return v8::ScriptCompiler::kConsumeCodeCache;
+    }
+    if (flags & SHIM_COMPILE_EAGER) {
+        return v8::ScriptCompiler::kEagerCompile;
+    }
+#if PACM_V8_HAS_COMPILE_HINT_COMMENTS
+    if (flags & SHIM_COMPILE_HINTS_MAGIC_COMMENTS) {
+        return v8::ScriptCompiler::kFollowCompileHintsMagicComment;
+    }
+#endif
+    return v8::ScriptCompiler::kNoCompileOptions;
+}
+
+static V8ScriptHandle compile_script(
+    V8IsolateHandle handle,
+    SourceText& source,
+    const uint8_t* cache_data,
+    size_t cache_length,
+    int32_t flags,
+    int* cache_rejected_out,
+    char** error_out) {
     if (error_out) {
         *error_out = nullptr;
     }
+    if (cache_rejected_out) {
+        *cache_rejected_out = 0;
+    }
 
-    pacm_v8::IsolateWrapper* isolate_wrapper = pacm_v8::unwrap_isolate(handle);
+    IsolateWrapper* isolate_wrapper = unwrap_isolate(handle);
     if (!isolate_wrapper || !isolate_wrapper->isolate) {
-        pacm_v8::assign_error(error_out, "invalid isolate handle");
+        assign_error(error_out, "invalid isolate handle");
         return nullptr;
     }
-    if (!source) {
-        pacm_v8::assign_error(error_out, "source was null");
+    if (source.is_null()) {
+        assign_error(error_out, "source was null");
+        return nullptr;
+    }
+    if (!source.has_valid_encoding()) {
+        assign_error(error_out, "unsupported source encoding");
         return nullptr;
     }
 
     v8::Isolate* isolate = isolate_wrapper->isolate;
     v8::Isolate::Scope isolate_scope(isolate);
     v8::HandleScope handle_scope(isolate);
-    v8::Local<v8::Context> context = isolate->GetCurrentContext();
-    if (context.IsEmpty()) {
-        context = v8::Context::New(isolate);
-    }
-    v8::Context::Scope context_scope(context);
     v8::TryCatch try_catch(isolate);
 
-    v8::Local<v8::String> src = v8::String::NewFromUtf8(isolate, source, v8::NewStringType::kNormal).ToLocalChecked();
-    v8::Local<v8::Script> compiled;
-    if (!v8::Script::Compile(context, src).ToLocal(&compiled)) {
+    const ScriptCacheKey key = source.cache_key();
+    const bool cacheable = source.byte_length() > 0 && source.byte_length() <= kMaxCacheableSourceLength;
+
+    // Another context on this isolate may already have compiled the same source. A requested
+    // mode compiles anew; the result then replaces the shared entry.
+    v8::Local<v8::UnboundScript> shared;
+    if (cacheable && flags == 0 && isolate_wrapper->script_cache.lookup(isolate, key, nullptr, shared)) {
+        PACM_V8_COUNT(isolate_wrapper, cache_hits);
+        auto* wrapper = new ScriptWrapper();
+        wrapper->isolate_wrapper = isolate_wrapper;
+        wrapper->cache_key = key;
+        wrapper->script = std::make_unique<v8::Global<v8::UnboundScript>>(isolate, shared);
+        return reinterpret_cast<V8ScriptHandle>(wrapper);
+    }
+    if (cacheable) {
+        PACM_V8_COUNT(isolate_wrapper, cache_misses);
+    }
+    PACM_V8_SPAN(isolate_wrapper, compile, "compile");
+
+    v8::Local<v8::String> src;
+    if (!source.to_string(isolate, src)) {
+        assign_error(error_out, "source was too long");
+        return nullptr;
+    }
+
+    // The cached data only borrows the caller's buffer; Source takes ownership of the CachedData object itself.
+    v8::ScriptCompiler::CachedData* cached = nullptr;
+    if (cache_data && cache_length > 0) {
+        cached = new v8::ScriptCompiler::CachedData(
+            cache_data,
+            static_cast<int>(cache_length),
+            v8::ScriptCompiler::CachedData::BufferNotOwned);
+        if (cached->CompatibilityCheck(isolate) != v8::ScriptCompiler::CachedData::kSuccess) {
+            delete cached;
+            cached = nullptr;
+            if (cache_rejected_out) {
+                *cache_rejected_out = 1;
+            }
+        }
+    }
+
+    v8::ScriptCompiler::Source script_source(src, cached);
+    v8::ScriptCompiler::CompileOptions options = compile_options(cached != nullptr, flags);
+
+    v8::Local<v8::UnboundScript> unbound;
+    if (!v8::ScriptCompiler::CompileUnboundScript(isolate, &script_source, options).ToLocal(&unbound)) {
         std::string message;
-        pacm_v8::capture_exception(isolate, try_catch, message);
-        pacm_v8::assign_error(error_out, message);
+        capture_exception(isolate, try_catch, message);
+        assign_error(error_out, message);
         return nullptr;
     }
 
-    auto* wrapper = new pacm_v8::ScriptWrapper();
+    if (cached && script_source.GetCachedData()->rejected && cache_rejected_out) {
+        *cache_rejected_out = 1;
+    }
+
+    if (cacheable) {
+        isolate_wrapper->script_cache.insert(isolate, key, nullptr, unbound);
+    }
+
+    auto* wrapper = new ScriptWrapper();
     wrapper->isolate_wrapper = isolate_wrapper;
-    wrapper->cache_key.assign(source);
-    wrapper->script = std::make_unique<v8::Global<v8::UnboundScript>>(isolate, compiled->GetUnboundScript());
+    wrapper->cache_key = key;
+    wrapper->script = std::make_unique<v8::Global<v8::UnboundScript>>(isolate, unbound);
     return reinterpret_cast<V8ScriptHandle>(wrapper);
 }
+} // namespace pacm_v8
 
-int shim_script_run(V8ScriptHandle script_handle, V8ContextHandle context_handle, char** result_out, char** error_out) {
-    if (result_out) {
-        *result_out = nullptr;
+extern "C" {
+
+
+V8ScriptHandle shim_compile_script(V8IsolateHandle handle, const char* source, char** error_out) {
+    return shim_compile_script_utf8(handle, source, source ? std::strlen(source) : 0, nullptr, 0, nullptr, error_out);
+}
+
+V8ScriptHandle shim_compile_script_with_cache(
+    V8IsolateHandle handle,
+    const char* source,
+    const uint8_t* cache_data,
+    size_t cache_length,
+    int* cache_rejected_out,
+    char** error_out) {
+    return shim_compile_script_utf8(handle, source, source ? std::strlen(source) : 0, cache_data, cache_length, cache_rejected_out, error_out);
+}
+
+V8ScriptHandle shim_compile_script_utf8(
+    V8IsolateHandle handle,
+    const char* source,
+    size_t source_length,
+    const uint8_t* cache_data,
+    size_t cache_length,
+    int* cache_rejected_out,
+    char** error_out) {
+    return shim_compile_script_with_options(handle, source, source_length, cache_data, cache_length, 0, cache_rejected_out, error_out);
+}
+
+V8ScriptHandle shim_compile_script_with_options(
+    V8IsolateHandle handle,
+    const char* source,
+    size_t source_length,
+    const uint8_t* cache_data,
+    size_t cache_length,
+    int32_t flags,
+    int* cache_rejected_out,
+    char** error_out) {
+    pacm_v8::SourceText text(std::string_view{source, source ? source_length : 0});
+    return pacm_v8::compile_script(handle, text, cache_data, cache_length, flags, cache_rejected_out, error_out);
+}
+
+V8ScriptHandle shim_compile_script_external(
+    V8IsolateHandle handle,
+    const ShimExternalSource* source,
+    const uint8_t* cache_data,
+    size_t cache_length,
+    int* cache_rejected_out,
+    char** error_out) {
+    ShimExternalSource empty{};
+    pacm_v8::SourceText text(source ? *source : empty);
+    return pacm_v8::compile_script(handle, text, cache_data, cache_length, 0, cache_rejected_out, error_out);
+}
+
+int shim_script_create_code_cache(V8ScriptHandle script_handle, uint8_t** data_out, size_t* length_out, char** error_out) {
+    if (data_out) {
+        *data_out = nullptr;
+    }
+    if (length_out) {
+        *length_out = 0;
     }
     if (error_out) {
         *error_out = nullptr;
@@ -70,46 +339,213 @@ int shim_script_run(V8ScriptHandle script_handle, V8ContextHandle context_handle
         pacm_v8::assign_error(error_out, error);
         return 0;
     }
+    if (!data_out || !length_out) {
+        pacm_v8::assign_error(error_out, "code cache output was null");
+        return 0;
+    }
 
+    v8::Isolate* isolate = script_wrapper->isolate_wrapper->isolate;
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+
+    v8::Local<v8::UnboundScript> unbound = v8::Local<v8::UnboundScript>::New(isolate, *script_wrapper->script);
+    std::unique_ptr<v8::ScriptCompiler::CachedData> cached(v8::ScriptCompiler::CreateCodeCache(unbound));
+    if (!cached || !cached->data || cached->length <= 0) {
+        pacm_v8::assign_error(error_out, "failed to create code cache");
+        return 0;
+    }
+
+    *data_out = pacm_v8::copy_bytes(cached->data, static_cast<std::size_t>(cached->length));
+    if (!*data_out) {
+        pacm_v8::assign_error(error_out, "failed to allocate code cache buffer");
+        return 0;
+    }
+    *length_out = static_cast<std::size_t>(cached->length);
+    return 1;
+}
+
+int shim_script_run(V8ScriptHandle script_handle, V8ContextHandle context_handle, char** result_out, char** error_out) {
+    if (result_out) {
+        *result_out = nullptr;
+    }
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::ScriptWrapper* script_wrapper = nullptr;
     pacm_v8::ContextWrapper* context_wrapper = nullptr;
-    if (!pacm_v8::ensure_context(context_handle, context_wrapper, error)) {
+    std::string error;
+    if (!pacm_v8::ensure_script_and_context(script_handle, context_handle, script_wrapper, context_wrapper, error)) {
         pacm_v8::assign_error(error_out, error);
         return 0;
     }
 
     v8::Isolate* isolate = context_wrapper->isolate();
-    if (!isolate || isolate != script_wrapper->isolate_wrapper->isolate) {
-        pacm_v8::assign_error(error_out, "script and context belong to different isolates");
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+    v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context_wrapper->context);
+    v8::Context::Scope context_scope(ctx);
+    v8::TryCatch try_catch(isolate);
+    pacm_v8::ExecutionGuard guard(context_wrapper->isolate_wrapper, context_wrapper);
+    if (guard.refused()) {
+        return pacm_v8::legacy_status(guard.reject(error_out));
+    }
+
+    v8::Local<v8::Value> result;
+    if (!pacm_v8::run_script(script_wrapper, context_wrapper, ctx, try_catch, result, error)) {
+        int status = pacm_v8::execution_failure(context_wrapper->isolate_wrapper, error);
+        pacm_v8::assign_error(error_out, error);
+        return pacm_v8::legacy_status(status);
+    }
+
+    if (result_out) {
+        *result_out = pacm_v8::value_to_utf8(isolate, result);
+    }
+
+    return 1;
+}
+
+int shim_script_run_value(V8ScriptHandle script_handle, V8ContextHandle context_handle, ShimValue* result_out, char** error_out) {
+    if (result_out) {
+        *result_out = ShimValue{};
+    }
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::ScriptWrapper* script_wrapper = nullptr;
+    pacm_v8::ContextWrapper* context_wrapper = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_script_and_context(script_handle, context_handle, script_wrapper, context_wrapper, error)) {
+        pacm_v8::assign_error(error_out, error);
         return 0;
     }
 
+    v8::Isolate* isolate = context_wrapper->isolate();
     v8::Isolate::Scope isolate_scope(isolate);
     v8::HandleScope handle_scope(isolate);
     v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context_wrapper->context);
     v8::Context::Scope context_scope(ctx);
     v8::TryCatch try_catch(isolate);
-
-    v8::Local<v8::UnboundScript> unbound = v8::Local<v8::UnboundScript>::New(isolate, *script_wrapper->script);
-    v8::Local<v8::Script> script = unbound->BindToCurrentContext();
+    pacm_v8::ExecutionGuard guard(context_wrapper->isolate_wrapper, context_wrapper);
+    if (guard.refused()) {
+        return guard.reject(error_out);
+    }
 
     v8::Local<v8::Value> result;
-    if (!script->Run(ctx).ToLocal(&result)) {
-        std::string message;
-        pacm_v8::capture_exception(isolate, try_catch, message);
-        pacm_v8::assign_error(error_out, message);
+    if (!pacm_v8::run_script(script_wrapper, context_wrapper, ctx, try_catch, result, error)) {
+        int status = pacm_v8::execution_failure(context_wrapper->isolate_wrapper, error);
+        pacm_v8::assign_error(error_out, error);
+        return status;
+    }
+
+    if (result_out && !pacm_v8::to_shim_value_owned(isolate, result, *result_out)) {
+        pacm_v8::assign_error(error_out, "failed to allocate result buffer");
         return 0;
     }
 
-    if (result_out) {
-        *result_out = pacm_v8::value_to_utf8(isolate, result);
+    return 1;
+}
+
+int shim_script_warmup(
+    V8ScriptHandle script_handle,
+    V8ContextHandle context_handle,
+    const ShimWarmupCall* calls,
+    size_t call_count,
+    uint8_t** cache_out,
+    size_t* cache_length_out,
+    char** error_out) {
+    if (cache_out) {
+        *cache_out = nullptr;
+    }
+    if (cache_length_out) {
+        *cache_length_out = 0;
+    }
+    if (error_out) {
+        *error_out = nullptr;
     }
 
-    if (!script_wrapper->cache_key.empty()) {
-        auto persistent = std::make_unique<v8::Global<v8::UnboundScript>>(isolate, unbound);
-        context_wrapper->cache.insert_or_assign(script_wrapper->cache_key, std::move(persistent));
+    pacm_v8::ScriptWrapper* script_wrapper = nullptr;
+    pacm_v8::ContextWrapper* context_wrapper = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_script_and_context(script_handle, context_handle, script_wrapper, context_wrapper, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return SHIM_STATUS_ERROR;
+    }
+    if (!cache_out || !cache_length_out) {
+        pacm_v8::assign_error(error_out, "code cache output was null");
+        return SHIM_STATUS_ERROR;
+    }
+    if (!calls && call_count > 0) {
+        pacm_v8::assign_error(error_out, "warmup calls were null");
+        return SHIM_STATUS_ERROR;
     }
 
-    return 1;
+    v8::Isolate* isolate = context_wrapper->isolate();
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+    v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context_wrapper->context);
+    v8::Context::Scope context_scope(ctx);
+    v8::TryCatch try_catch(isolate);
+    pacm_v8::ExecutionGuard guard(context_wrapper->isolate_wrapper, context_wrapper);
+    if (guard.refused()) {
+        return guard.reject(error_out);
+    }
+
+    v8::Local<v8::Value> result;
+    if (!pacm_v8::run_script(script_wrapper, context_wrapper, ctx, try_catch, result, error)) {
+        int status = pacm_v8::execution_failure(context_wrapper->isolate_wrapper, error);
+        pacm_v8::assign_error(error_out, error);
+        return status;
+    }
+
+    for (std::size_t i = 0; i < call_count; ++i) {
+        const ShimWarmupCall& call = calls[i];
+        if (!call.function || (!call.args && call.arg_count > 0)) {
+            pacm_v8::assign_error(error_out, "warmup call was incomplete");
+            return SHIM_STATUS_ERROR;
+        }
+
+        v8::Local<v8::Object> owner;
+        v8::Local<v8::Function> function;
+        std::string_view path{call.function, call.function_length};
+        if (!pacm_v8::resolve_function_path(isolate, ctx, path, owner, function, error)) {
+            pacm_v8::assign_error(error_out, error + ": " + std::string(path));
+            return SHIM_STATUS_ERROR;
+        }
+        std::vector<v8::Local<v8::Value>> args(call.arg_count);
+        for (std::size_t j = 0; j < call.arg_count; ++j) {
+            if (!pacm_v8::from_shim_value(isolate, call.args[j], args[j])) {
+                pacm_v8::assign_error(error_out, "argument could not be converted");
+                return SHIM_STATUS_ERROR;
+            }
+        }
+
+        const uint32_t iterations = call.iterations > 0 ? call.iterations : 1;
+        for (uint32_t n = 0; n < iterations; ++n) {
+            v8::HandleScope call_scope(isolate);
+            if (function->Call(ctx, owner, static_cast<int>(args.size()), args.data()).IsEmpty()) {
+                pacm_v8::capture_exception(isolate, try_catch, error);
+                int status = pacm_v8::execution_failure(context_wrapper->isolate_wrapper, error);
+                pacm_v8::assign_error(error_out, error);
+                return status;
+            }
+        }
+    }
+
+    v8::Local<v8::UnboundScript> unbound = v8::Local<v8::UnboundScript>::New(isolate, *script_wrapper->script);
+    std::unique_ptr<v8::ScriptCompiler::CachedData> cached(v8::ScriptCompiler::CreateCodeCache(unbound));
+    if (!cached || !cached->data || cached->length <= 0) {
+        pacm_v8::assign_error(error_out, "failed to create code cache");
+        return SHIM_STATUS_ERROR;
+    }
+    *cache_out = pacm_v8::copy_bytes(cached->data, static_cast<std::size_t>(cached->length));
+    if (!*cache_out) {
+        pacm_v8::assign_error(error_out, "failed to allocate code cache buffer");
+        return SHIM_STATUS_ERROR;
+    }
+    *cache_length_out = static_cast<std::size_t>(cached->length);
+    return SHIM_STATUS_OK;
 }
 
 void shim_script_dispose(V8ScriptHandle handle) {
@@ -0,0 +1,199 @@
+#include "shim_internal.h"
+
+#include <algorithm>
+#include <random>
+
+namespace pacm_v8 {
+
+namespace {
+
+// SipHash-2-4 keys drawn once per process, so colliding sources cannot be prepared offline
+// and one tenant's script cannot be made to stand in for another's.
+struct SipKey {
+    uint64_t k0;
+    uint64_t k1;
+};
+
+struct ProcessKeys {
+    SipKey hash;
+    SipKey check;
+};
+
+const ProcessKeys& process_keys() {
+    static const ProcessKeys keys = [] {
+        std::random_device device;
+        auto draw = [&device] {
+            return (static_cast<uint64_t>(device()) << 32) ^ static_cast<uint64_t>(device());
+        };
+        ProcessKeys drawn;
+        drawn.hash = {draw(), draw()};
+        drawn.check = {draw(), draw()};
+        return drawn;
+    }();
+    return keys;
+}
+
+inline uint64_t rotl(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline void sip_round(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3) {
+    v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+    v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+    v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+    v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+}
+
+uint64_t siphash24(const SipKey& key, std::string_view bytes) {
+    uint64_t v0 = key.k0 ^ 0x736f6d6570736575ull;
+    uint64_t v1 = key.k1 ^ 0x646f72616e646f6dull;
+    uint64_t v2 = key.k0 ^ 0x6c7967656e657261ull;
+    uint64_t v3 = key.k1 ^ 0x7465646279746573ull;
+
+    const auto* data = reinterpret_cast<const unsigned char*>(bytes.data());
+    const std::size_t length = bytes.size();
+    const std::size_t full = length - length % 8;
+    for (std::size_t offset = 0; offset < full; offset += 8) {
+        uint64_t word = 0;
+        for (int i = 7; i >= 0; --i) {
+            word = (word << 8) | data[offset + i];
+        }
+        v3 ^= word;
+        sip_round(v0, v1, v2, v3);
+        sip_round(v0, v1, v2, v3);
+        v0 ^= word;
+    }
+
+    uint64_t last = static_cast<uint64_t>(length & 0xff) << 56;
+    for (std::size_t i = length % 8; i > 0; --i) {
+        last |= static_cast<uint64_t>(data[full + i - 1]) << (8 * (i - 1));
+    }
+    v3 ^= last;
+    sip_round(v0, v1, v2, v3);
+    sip_round(v0, v1, v2, v3);
+    v0 ^= last;
+
+    v2 ^= 0xff;
+    for (int i = 0; i < 4; ++i) {
+        sip_round(v0, v1, v2, v3);
+    }
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+} // namespace
+
+ScriptCacheKey ScriptCacheKey::from_source(std::string_view source) {
+    // Two independently keyed digests: 128 bits an attacker cannot steer without the keys.
+    const ProcessKeys& keys = process_keys();
+    ScriptCacheKey key;
+    key.hash = siphash24(keys.hash, source);
+    key.check = siphash24(keys.check, source);
+    key.length = source.size();
+    return key;
+}
+
+bool ScriptCache::lookup(v8::Isolate* isolate, const ScriptCacheKey& key, ScriptCacheUser* user, v8::Local<v8::UnboundScript>& out) {
+    auto found = index_.find(key);
+    if (found == index_.end()) {
+        ++misses_;
+        return false;
+    }
+
+    ++hits_;
+    lru_.splice(lru_.begin(), lru_, found->second);
+    add_user(*found->second, user);
+    out = v8::Local<v8::UnboundScript>::New(isolate, found->second->script);
+    return true;
+}
+
+void ScriptCache::insert(v8::Isolate* isolate, const ScriptCacheKey& key, ScriptCacheUser* user, v8::Local<v8::UnboundScript> script) {
+    auto found = index_.find(key);
+    if (found != index_.end()) {
+        found->second->script.Reset(isolate, script);
+        lru_.splice(lru_.begin(), lru_, found->second);
+        add_user(*found->second, user);
+        return;
+    }
+
+    const std::size_t entry_cost = cost(key);
+    if (entry_cost > capacity_) {
+        return;
+    }
+    evict_to(capacity_ - entry_cost);
+
+    lru_.push_front(Entry{key, v8::Global<v8::UnboundScript>(isolate, script), {}});
+    index_.emplace(key, lru_.begin());
+    add_user(lru_.front(), user);
+    bytes_ += entry_cost;
+    ++insertions_;
+}
+
+void ScriptCache::release(ScriptCacheUser& user) {
+    for (const ScriptCacheKey& key : user.keys) {
+        auto found = index_.find(key);
+        if (found == index_.end()) {
+            continue;
+        }
+        std::vector<ScriptCacheUser*>& users = found->second->users;
+        users.erase(std::remove(users.begin(), users.end(), &user), users.end());
+        if (users.empty()) {
+            lru_.splice(lru_.end(), lru_, found->second);
+        }
+    }
+    user.keys.clear();
+}
+
+void ScriptCache::set_capacity(std::size_t capacity_bytes) {
+    capacity_ = capacity_bytes;
+    evict_to(capacity_);
+}
+
+void ScriptCache::clear() {
+    for (Entry& entry : lru_) {
+        for (ScriptCacheUser* user : entry.users) {
+            user->keys.erase(entry.key);
+        }
+    }
+    index_.clear();
+    lru_.clear();
+    bytes_ = 0;
+}
+
+ShimScriptCacheStats ScriptCache::stats() const {
+    ShimScriptCacheStats out{};
+    out.hits = hits_;
+    out.misses = misses_;
+    out.insertions = insertions_;
+    out.evictions = evictions_;
+    out.entries = index_.size();
+    out.bytes = bytes_;
+    out.capacity_bytes = capacity_;
+    return out;
+}
+
+void ScriptCache::add_user(Entry& entry, ScriptCacheUser* user) {
+    if (!user || !user->keys.insert(entry.key).second) {
+        return;
+    }
+    entry.users.push_back(user);
+}
+
+void ScriptCache::erase(EntryList::iterator entry) {
+    bytes_ -= cost(entry->key);
+    index_.erase(entry->key);
+    lru_.erase(entry);
+}
+
+void ScriptCache::evict_to(std::size_t budget) {
+    while (bytes_ > budget && !lru_.empty()) {
+        Entry& victim = lru_.back();
+        // Keep the users' key sets bounded by what is actually cached.
+        for (ScriptCacheUser* user : victim.users) {
+            user->keys.erase(victim.key);
+        }
+        erase(std::prev(lru_.end()));
+        ++evictions_;
+    }
+}
+
+} // namespace pacm_v8
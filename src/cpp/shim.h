@@ -9,13 +9,364 @@ extern "C" {
 typedef void* V8IsolateHandle;
 typedef void* V8ContextHandle;
 typedef void* V8ScriptHandle;
+typedef void* V8FunctionHandle;
+typedef void* V8PromiseCompleterHandle;
+typedef void* V8StreamHandle;
+
+// Return codes of calls that run JavaScript. Everything else returns 1 on success and 0 on
+// failure, including the char* result calls shim_context_eval, shim_context_call_function and
+// shim_script_run, which report a heap limit, timeout or exhausted budget as 0 with the reason
+// in error_out.
+typedef enum ShimStatus {
+	SHIM_STATUS_CPU_BUDGET = -3,
+	SHIM_STATUS_TIMEOUT = -2,
+	SHIM_STATUS_HEAP_LIMIT = -1,
+	SHIM_STATUS_ERROR = 0,
+	SHIM_STATUS_OK = 1
+} ShimStatus;
+
+// Heap sizes in bytes; 0 keeps V8's default. The snapshot is optional and copied.
+typedef struct ShimIsolateOptions {
+	size_t initial_old_generation_bytes;
+	size_t max_old_generation_bytes;
+	size_t initial_young_generation_bytes;
+	size_t max_young_generation_bytes;
+	const uint8_t* snapshot;
+	size_t snapshot_length;
+} ShimIsolateOptions;
+
+// Tagged value passed across the FFI without stringifying.
+typedef enum ShimValueKind {
+	SHIM_VALUE_UNDEFINED = 0,
+	SHIM_VALUE_NULL = 1,
+	SHIM_VALUE_BOOL = 2,
+	SHIM_VALUE_INT32 = 3,
+	SHIM_VALUE_DOUBLE = 4,
+	SHIM_VALUE_BIGINT = 5,
+	SHIM_VALUE_STRING = 6,
+	SHIM_VALUE_BYTES = 7,
+	SHIM_VALUE_EXTERNAL_BYTES = 8,
+	SHIM_VALUE_SERIALIZED = 9
+} ShimValueKind;
+
+// integer holds BOOL, INT32 and BIGINT payloads, number holds DOUBLE, data/length hold
+// STRING (UTF-8, not NUL terminated) and BYTES. BigInts outside the int64 range are
+// passed as STRING with their decimal representation. EXTERNAL_BYTES wraps host memory
+// without copying (V8_ENABLE_SANDBOX builds copy it once); integer then carries the release
+// token handed to pacm_v8__buffer_release.
+// SERIALIZED is accepted as input only: data/length hold v8::ValueSerializer output
+// (header included), which is deserialized into a structured value in the current context.
+typedef struct ShimValue {
+	int32_t kind;
+	int64_t integer;
+	double number;
+	const uint8_t* data;
+	size_t length;
+} ShimValue;
+
+// One entry of shim_context_eval_batch. script takes precedence over source, which is
+// source_length bytes of UTF-8; when args are given, the item's completion value must be a
+// function and is called with them.
+typedef struct ShimBatchItem {
+	const char* source;
+	size_t source_length;
+	V8ScriptHandle script;
+	const ShimValue* args;
+	size_t arg_count;
+} ShimBatchItem;
+
+// One entry of shim_context_set_globals: path is path_length bytes of UTF-8, dotted like
+// the name given to shim_context_set_global_value_utf8.
+typedef struct ShimGlobalEntry {
+	const char* path;
+	size_t path_length;
+	ShimValue value;
+} ShimGlobalEntry;
+
+// status is SHIM_STATUS_OK with value set, or a failure status with error set; both are owned by the caller.
+typedef struct ShimBatchResult {
+	int32_t status;
+	ShimValue value;
+	char* error;
+} ShimBatchResult;
+
+// C types of fast host function signatures. Arguments may be INT32 or FLOAT64.
+typedef enum ShimFastType {
+	SHIM_FAST_VOID = 0,
+	SHIM_FAST_BOOL = 1,
+	SHIM_FAST_INT32 = 2,
+	SHIM_FAST_FLOAT64 = 3
+} ShimFastType;
+
+// Counters of an isolate's compiled-script cache; bytes include a fixed per-entry overhead.
+typedef struct ShimScriptCacheStats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t insertions;
+	uint64_t evictions;
+	size_t entries;
+	size_t bytes;
+	size_t capacity_bytes;
+} ShimScriptCacheStats;
+
+// Flags of shim_compile_script_with_options. A consumed code cache takes precedence over
+// both, and EAGER over HINTS_MAGIC_COMMENTS; V8 does not combine them.
+typedef enum ShimCompileFlags {
+	// Compile every function up front instead of on its first call.
+	SHIM_COMPILE_EAGER = 1,
+	// Honour "//# allFunctionsCalledOnLoad" and per-function compile hint comments; ignored
+	// by V8 versions without compile hints.
+	SHIM_COMPILE_HINTS_MAGIC_COMMENTS = 2
+} ShimCompileFlags;
+
+// One function shim_script_warmup calls: a dotted global path, called iterations times
+// (at least once) with args.
+typedef struct ShimWarmupCall {
+	const char* function;
+	size_t function_length;
+	const ShimValue* args;
+	size_t arg_count;
+	uint32_t iterations;
+} ShimWarmupCall;
+
+// Snapshot of v8::HeapStatistics, in bytes except for the context counts.
+typedef struct ShimHeapStats {
+	size_t total_heap_size;
+	size_t total_heap_size_executable;
+	size_t total_physical_size;
+	size_t total_available_size;
+	size_t used_heap_size;
+	size_t heap_size_limit;
+	size_t malloced_memory;
+	size_t peak_malloced_memory;
+	size_t external_memory;
+	size_t number_of_native_contexts;
+	size_t number_of_detached_contexts;
+} ShimHeapStats;
+
+// One v8::HeapSpaceStatistics entry; space_name is a static V8 string.
+typedef struct ShimHeapSpaceStats {
+	const char* space_name;
+	size_t space_size;
+	size_t space_used_size;
+	size_t space_available_size;
+	size_t physical_space_size;
+} ShimHeapSpaceStats;
+
+// Bucket i of ShimGcStats.pause_buckets counts pauses shorter than 2^i microseconds that
+// no earlier bucket counts; the last bucket also takes every longer pause.
+#define SHIM_GC_PAUSE_BUCKETS 24
+
+// Garbage collections of an isolate since it was created, timed from the GC prologue to the
+// epilogue callback on the isolate's thread.
+typedef struct ShimGcStats {
+	uint64_t collections;
+	uint64_t minor_collections;
+	uint64_t major_collections;
+	uint64_t total_pause_ns;
+	uint64_t max_pause_ns;
+	uint64_t pause_buckets[SHIM_GC_PAUSE_BUCKETS];
+} ShimGcStats;
+
+// Number of times a shim hot path ran and the time spent in it.
+typedef struct ShimSpanCounter {
+	uint64_t count;
+	uint64_t total_ns;
+} ShimSpanCounter;
+
+// Hot-path counters of a context or isolate. Only collected when the shim is compiled with
+// PACM_V8_INSTRUMENTATION. compile and the cache counters cover script cache lookups, run
+// script execution, call function calls, marshal value conversion at the boundary and host
+// time spent in host function callbacks.
+typedef struct ShimCounters {
+	ShimSpanCounter compile;
+	ShimSpanCounter run;
+	ShimSpanCounter call;
+	ShimSpanCounter marshal;
+	ShimSpanCounter host;
+	uint64_t cache_hits;
+	uint64_t cache_misses;
+} ShimCounters;
+
+typedef enum ShimOutputFlags {
+	SHIM_OUTPUT_TEXT = 0,
+	SHIM_OUTPUT_JSON = 1
+} ShimOutputFlags;
+
+typedef enum ShimContextResetMode {
+	SHIM_CONTEXT_RESET_BASELINE = 0,
+	SHIM_CONTEXT_RESET_RECREATE = 1
+} ShimContextResetMode;
+
+typedef enum ShimMemoryPressure {
+	SHIM_MEMORY_PRESSURE_NONE = 0,
+	SHIM_MEMORY_PRESSURE_MODERATE = 1,
+	SHIM_MEMORY_PRESSURE_CRITICAL = 2
+} ShimMemoryPressure;
+
+// Encodings V8 can reference in place: Latin-1 (so also ASCII) or UTF-16 code units.
+typedef enum ShimSourceEncoding {
+	SHIM_SOURCE_ONE_BYTE = 0,
+	SHIM_SOURCE_TWO_BYTE = 1
+} ShimSourceEncoding;
+
+// Host-owned source text that V8 uses without copying it into its heap. length counts code
+// units. The shim owns release_token from the call that receives it on, including on
+// failure, and passes it to pacm_v8__external_source_release, possibly from another thread,
+// once V8 no longer needs the text.
+typedef struct ShimExternalSource {
+	const void* data;
+	size_t length;
+	int32_t encoding;
+	void* release_token;
+} ShimExternalSource;
+
+// An import the host is asked to resolve: specifier as written in the module named referrer.
+typedef struct ShimModuleRequest {
+	const char* specifier;
+	size_t specifier_length;
+	const char* referrer;
+	size_t referrer_length;
+} ShimModuleRequest;
+
+// The host's answer to one ShimModuleRequest, released through pacm_v8__value_release.
+// name is the resolved module name (a STRING) that identifies the module within the
+// context; source is its UTF-8 text, and may stay undefined if name was loaded before.
+typedef struct ShimModuleSource {
+	ShimValue name;
+	ShimValue source;
+} ShimModuleSource;
 
 // einmalige Initialisierung. Optionaler Pfad zu icudtl.dat (UTF-8 kodiert).
 int shim_v8_initialize(const char* icu_data_path);
+// Passes command-line style flags such as "--perf-basic-prof" to V8. Only possible before
+// shim_v8_initialize; V8 freezes its flags once initialized.
+int shim_v8_set_flags(const char* flags, size_t flags_length, char** error_out);
 
 // Isolate erzeugen / zerstören
 V8IsolateHandle shim_create_isolate();
+V8IsolateHandle shim_create_isolate_from_snapshot(const uint8_t* blob, size_t length);
+// Every isolate terminates running JavaScript when it nears its heap limit instead of
+// aborting the process; the interrupted call returns SHIM_STATUS_HEAP_LIMIT. The isolate is
+// then poisoned: later calls that run JavaScript return SHIM_STATUS_HEAP_LIMIT without
+// running, and it should be disposed and replaced.
+V8IsolateHandle shim_create_isolate_with_options(const ShimIsolateOptions* options);
 void shim_dispose_isolate(V8IsolateHandle isolate);
+// Returns 1 once the isolate has hit its heap limit, 0 otherwise.
+int shim_isolate_is_poisoned(V8IsolateHandle isolate);
+
+// Lets an isolate move between threads. Once an isolate has been locked, every use of it,
+// including its contexts and scripts, must happen between lock and unlock on one thread.
+int shim_isolate_lock(V8IsolateHandle isolate, char** error_out);
+void shim_isolate_unlock(V8IsolateHandle isolate);
+
+// Compiled-script cache shared by all contexts of the isolate: byte budget (0 disables
+// caching) and counters.
+int shim_isolate_set_script_cache_limit(V8IsolateHandle isolate, size_t capacity_bytes, char** error_out);
+int shim_isolate_script_cache_stats(V8IsolateHandle isolate, ShimScriptCacheStats* stats_out, char** error_out);
+
+// Heap statistics; called on the isolate's thread. spaces_out may be null; otherwise up to
+// space_capacity entries are written and space_count_out receives the number of heap spaces.
+int shim_isolate_heap_stats(
+	V8IsolateHandle isolate,
+	ShimHeapStats* stats_out,
+	ShimHeapSpaceStats* spaces_out,
+	size_t space_capacity,
+	size_t* space_count_out,
+	char** error_out
+);
+// GC counters may be read from any thread.
+int shim_isolate_gc_stats(V8IsolateHandle isolate, ShimGcStats* stats_out, char** error_out);
+// May be called from any thread; V8 schedules the collections it implies.
+int shim_isolate_memory_pressure(V8IsolateHandle isolate, int32_t level, char** error_out);
+// Collects as much garbage as possible right away, on the isolate's thread. Slow.
+int shim_isolate_low_memory_notification(V8IsolateHandle isolate, char** error_out);
+
+// Kinds of ShimClassMember.
+typedef enum ShimClassMemberKind {
+	SHIM_CLASS_METHOD = 0,
+	// Read through function_id; written through setter_id unless it is 0. Methods pass 0.
+	SHIM_CLASS_PROPERTY = 1,
+} ShimClassMemberKind;
+
+// A method or accessor property on a class prototype. The ids are host tokens like those of
+// shim_context_register_host_function, called through pacm_v8__class_member_invoke together
+// with the receiver's instance token.
+typedef struct ShimClassMember {
+	const char* name;
+	size_t name_length;
+	int32_t kind;
+	uint64_t function_id;
+	uint64_t setter_id;
+} ShimClassMember;
+
+// Builds a class's templates once per isolate so every context instantiates it from the same
+// maps and inline caches. On success the isolate owns all member ids and releases them through
+// pacm_v8__host_function_drop when disposed; on failure they stay with the caller.
+// class_id_out receives a non-zero id valid in every context of the isolate.
+int shim_isolate_define_class(
+	V8IsolateHandle isolate,
+	const char* name,
+	size_t name_length,
+	const ShimClassMember* members,
+	size_t member_count,
+	uint32_t* class_id_out,
+	char** error_out
+);
+// Creates an instance of class_id carrying instance_token and stores it at the dotted path.
+// On success the context owns the token and releases it through pacm_v8__class_instance_drop
+// once the object is collected or the context is disposed; on failure it stays with the caller.
+int shim_context_new_instance(
+	V8ContextHandle ctx,
+	uint32_t class_id,
+	uint64_t instance_token,
+	const char* path,
+	size_t path_length,
+	char** error_out
+);
+
+// Counters may be read from any thread while the context or isolate is in use. Scripts
+// compiled through shim_compile_script_* are counted on the isolate, evals on the context.
+int shim_context_counters(V8ContextHandle ctx, ShimCounters* counters_out, char** error_out);
+int shim_isolate_counters(V8IsolateHandle isolate, ShimCounters* counters_out, char** error_out);
+// Whether the shim was compiled with PACM_V8_INSTRUMENTATION.
+int shim_instrumentation_enabled(void);
+// Reports every completed span to pacm_v8__trace_span while enabled is non-zero. Fails when
+// instrumentation is compiled out.
+int shim_set_trace_spans(int enabled, char** error_out);
+
+// Starts sampling the isolate's stack for the profile title, keeping only frames of ctx.
+// Titles are shared by all contexts of the isolate.
+// sampling_interval_us of 0 keeps V8's default of 1ms. Profiles with different titles may
+// overlap; the interval of the first one running applies to all of them.
+int shim_context_start_cpu_profile(
+	V8ContextHandle ctx,
+	const char* title,
+	size_t title_length,
+	uint32_t sampling_interval_us,
+	char** error_out
+);
+// Stops the profile title and returns it as .cpuprofile JSON, released with shim_free_buffer.
+int shim_context_stop_cpu_profile(
+	V8ContextHandle ctx,
+	const char* title,
+	size_t title_length,
+	uint8_t** json_out,
+	size_t* json_length_out,
+	char** error_out
+);
+
+// Startup snapshots: run the bootstrap sources once and serialize the resulting heap.
+// host_functions are installed as stubs and bound per context through shim_context_bind_host_function.
+int shim_snapshot_create(
+	const char** sources,
+	size_t source_count,
+	const char** host_functions,
+	size_t host_function_count,
+	uint8_t** blob_out,
+	size_t* length_out,
+	char** error_out
+);
 
 // Context erzeugen / zerstören
 V8ContextHandle shim_create_context(V8IsolateHandle isolate);
@@ -25,7 +376,170 @@ void shim_dispose_context(V8ContextHandle ctx);
 int shim_context_eval(V8ContextHandle ctx, const char* source, char** result_out, char** error_out);
 int shim_context_set_global_string(V8ContextHandle ctx, const char* name, const char* value, char** error_out);
 int shim_context_set_global_number(V8ContextHandle ctx, const char* name, double value, char** error_out);
+// Exposes host memory as a Uint8Array without copying. The shim owns release_token from
+// this call on, including on failure, and passes it to pacm_v8__buffer_release once V8
+// frees the backing store. V8_ENABLE_SANDBOX builds cannot reference memory outside the
+// sandbox, so there the bytes are copied once and the token is released right away.
+int shim_context_set_global_buffer(
+	V8ContextHandle ctx,
+	const char* name,
+	uint8_t* data,
+	size_t length,
+	void* release_token,
+	char** error_out
+);
+// Allocates a zero-filled Uint8Array of length bytes through the isolate, sets it at name,
+// and stores its bytes in data_out for the host to fill in place. The pointer stays valid
+// while the array is reachable; fill it before running script or changing the global.
+int shim_context_alloc_global_buffer(
+	V8ContextHandle ctx,
+	const char* name,
+	size_t length,
+	uint8_t** data_out,
+	char** error_out
+);
+// function_id is an opaque host token. On success the context owns it and releases it
+// exactly once through pacm_v8__host_function_drop; on failure it stays with the caller.
 int shim_context_register_host_function(V8ContextHandle ctx, const char* name, uint64_t function_id, char** error_out);
+// Registers a host function that optimized code calls through a v8::CFunction with the
+// given signature (at most three arguments), skipping the generic trampoline. Calls the JIT
+// cannot make fast, such as from the interpreter, still go through the trampoline, so the
+// host callback must accept any argument values.
+int shim_context_register_fast_host_function(
+	V8ContextHandle ctx,
+	const char* name,
+	uint64_t function_id,
+	int32_t return_type,
+	const int32_t* arg_types,
+	size_t arg_count,
+	char** error_out
+);
+int shim_context_bind_host_function(V8ContextHandle ctx, const char* name, uint64_t function_id, char** error_out);
+
+// Async host functions return a promise and hand a completer to
+// pacm_v8__host_function_invoke_async. The host settles it from any thread with exactly one
+// call to shim_promise_resolve or shim_promise_reject, which take ownership of the payload
+// (released through pacm_v8__value_release). Completions are applied on the isolate's
+// thread by shim_context_pump and while an _await call waits.
+int shim_context_register_async_host_function(V8ContextHandle ctx, const char* name, uint64_t function_id, char** error_out);
+void shim_promise_resolve(V8PromiseCompleterHandle completer, const ShimValue* value);
+void shim_promise_reject(V8PromiseCompleterHandle completer, const char* message);
+// Settles completed host promises, runs microtasks and pending platform tasks without blocking.
+int shim_context_pump(V8ContextHandle ctx, char** error_out);
+// Like shim_context_eval_value, but a returned promise is awaited: the call pumps and blocks
+// for host completions until it settles, at most for the context timeout.
+int shim_context_eval_value_await(V8ContextHandle ctx, const char* source, ShimValue* result_out, char** error_out);
+
+// Typed variants; STRING/BYTES results are owned by the caller and released with shim_value_release.
+int shim_context_eval_value(V8ContextHandle ctx, const char* source, ShimValue* result_out, char** error_out);
+// The _utf8 entry points take text as a pointer and a byte length instead of a
+// NUL-terminated string, so callers can pass slices of larger buffers without copying.
+int shim_context_eval_utf8(V8ContextHandle ctx, const char* source, size_t source_length, ShimValue* result_out, char** error_out);
+int shim_context_eval_utf8_await(V8ContextHandle ctx, const char* source, size_t source_length, ShimValue* result_out, char** error_out);
+int shim_context_eval_external(V8ContextHandle ctx, const ShimExternalSource* source, ShimValue* result_out, char** error_out);
+// Return the result as v8::ValueSerializer output instead of a ShimValue, so objects and
+// arrays cross without a JSON round trip. The buffer is owned by the caller and released
+// with shim_free_buffer; values the serializer cannot clone, such as functions, fail.
+int shim_context_eval_serialized(
+	V8ContextHandle ctx,
+	const char* source,
+	size_t source_length,
+	uint8_t** data_out,
+	size_t* length_out,
+	char** error_out
+);
+int shim_context_call_function_serialized(
+	V8ContextHandle ctx,
+	const char* fn_name,
+	size_t name_length,
+	const ShimValue* args,
+	size_t arg_count,
+	uint8_t** data_out,
+	size_t* length_out,
+	char** error_out
+);
+// Stream the result as UTF-8 to the host instead of returning a copy: pacm_v8__output_begin
+// (sink, length) announces the exact byte length, then pacm_v8__output_write(sink, chunk,
+// chunk_length) receives the text in order. Either may return 0 to abort the call. Results
+// are stringified like shim_context_eval, or with JSON.stringify under SHIM_OUTPUT_JSON. The
+// sink runs inside the call and must not use the isolate.
+int shim_context_eval_streamed(
+	V8ContextHandle ctx,
+	const char* source,
+	size_t source_length,
+	int32_t flags,
+	void* sink,
+	char** error_out
+);
+int shim_context_call_function_streamed(
+	V8ContextHandle ctx,
+	const char* fn_name,
+	size_t name_length,
+	const ShimValue* args,
+	size_t arg_count,
+	int32_t flags,
+	void* sink,
+	char** error_out
+);
+// Assigns any value kind to a dotted property path; STRING and BYTES payloads are copied.
+int shim_context_set_global_value_utf8(
+	V8ContextHandle ctx,
+	const char* name,
+	size_t name_length,
+	const ShimValue* value,
+	char** error_out
+);
+// Assigns every entry under a single scope entry, creating each intermediate object once.
+// Stops at the first failing entry; the entries before it stay assigned.
+int shim_context_set_globals(
+	V8ContextHandle ctx,
+	const ShimGlobalEntry* entries,
+	size_t entry_count,
+	char** error_out
+);
+// Evaluates all items under a single scope entry. Returns 0 only if the batch itself could
+// not run; per-item failures are reported through results_out.
+int shim_context_eval_batch(
+	V8ContextHandle ctx,
+	const ShimBatchItem* items,
+	size_t item_count,
+	ShimBatchResult* results_out,
+	char** error_out
+);
+int shim_context_call_function_values(
+	V8ContextHandle ctx,
+	const char* fn_name,
+	const ShimValue* args,
+	size_t arg_count,
+	ShimValue* result_out,
+	char** error_out
+);
+int shim_context_call_function_values_utf8(
+	V8ContextHandle ctx,
+	const char* fn_name,
+	size_t name_length,
+	const ShimValue* args,
+	size_t arg_count,
+	ShimValue* result_out,
+	char** error_out
+);
+// Limits for every call into the context, enforced by one shared watchdog thread. A call
+// running longer than timeout_ms returns SHIM_STATUS_TIMEOUT; once the context has used
+// cpu_budget_us of CPU time in total, calls return SHIM_STATUS_CPU_BUDGET. 0 disables a
+// limit; setting the budget also resets the CPU time used so far.
+int shim_context_set_timeout(V8ContextHandle ctx, uint64_t timeout_ms, char** error_out);
+int shim_context_set_cpu_budget(V8ContextHandle ctx, uint64_t cpu_budget_us, char** error_out);
+int shim_context_cpu_time_used(V8ContextHandle ctx, uint64_t* cpu_time_us_out, char** error_out);
+// Records the global object's own properties so shim_context_restore_baseline can drop
+// everything added afterwards and put overwritten values back.
+int shim_context_record_baseline(V8ContextHandle ctx, char** error_out);
+int shim_context_restore_baseline(V8ContextHandle ctx, char** error_out);
+// Prepares a context for its next user without disposing it. BASELINE restores the recorded
+// globals; RECREATE replaces the V8 context with a new one (from the isolate's snapshot, if
+// any), reinstalling registered host functions and dropping modules and the baseline. Both keep
+// the script cache and host callbacks, discard unsettled async host promises and zero the CPU
+// time used.
+int shim_context_reset(V8ContextHandle ctx, int32_t mode, char** error_out);
 int shim_context_call_function(
 	V8ContextHandle ctx,
 	const char* fn_name,
@@ -35,14 +549,118 @@ int shim_context_call_function(
 	char** error_out
 );
 
+// Function handles: resolve a dotted path once and call it without further lookups.
+// With bind_receiver set, the object owning the function (e.g. pkg for "pkg.resolve") is
+// used as this; otherwise the global object is. Dispose handles before their isolate.
+V8FunctionHandle shim_context_get_function(V8ContextHandle ctx, const char* path, int bind_receiver, char** error_out);
+V8FunctionHandle shim_context_get_function_utf8(
+	V8ContextHandle ctx,
+	const char* path,
+	size_t path_length,
+	int bind_receiver,
+	char** error_out
+);
+int shim_function_call_values(
+	V8FunctionHandle function,
+	const ShimValue* args,
+	size_t arg_count,
+	ShimValue* result_out,
+	char** error_out
+);
+// Awaits a returned promise like shim_context_eval_value_await.
+int shim_function_call_values_await(
+	V8FunctionHandle function,
+	const ShimValue* args,
+	size_t arg_count,
+	ShimValue* result_out,
+	char** error_out
+);
+void shim_function_dispose(V8FunctionHandle function);
+
 // Script helpers
 V8ScriptHandle shim_compile_script(V8IsolateHandle isolate, const char* source, char** error_out);
+V8ScriptHandle shim_compile_script_with_cache(
+	V8IsolateHandle isolate,
+	const char* source,
+	const uint8_t* cache_data,
+	size_t cache_length,
+	int* cache_rejected_out,
+	char** error_out
+);
+V8ScriptHandle shim_compile_script_utf8(
+	V8IsolateHandle isolate,
+	const char* source,
+	size_t source_length,
+	const uint8_t* cache_data,
+	size_t cache_length,
+	int* cache_rejected_out,
+	char** error_out
+);
+V8ScriptHandle shim_compile_script_with_options(
+	V8IsolateHandle isolate,
+	const char* source,
+	size_t source_length,
+	const uint8_t* cache_data,
+	size_t cache_length,
+	int32_t flags,
+	int* cache_rejected_out,
+	char** error_out
+);
+V8ScriptHandle shim_compile_script_external(
+	V8IsolateHandle isolate,
+	const ShimExternalSource* source,
+	const uint8_t* cache_data,
+	size_t cache_length,
+	int* cache_rejected_out,
+	char** error_out
+);
+// Streaming compilation: UTF-8 chunks pushed from any thread are parsed on a platform worker
+// while more arrive. Once the worker is done, which also happens when parsing fails, it
+// passes ready_token (if not null) to pacm_v8__compile_stream_ready, from the worker thread.
+// finish ends the input, waits for the worker and completes the compile on the isolate's
+// thread; finish and dispose both consume the stream.
+V8StreamHandle shim_compile_stream_start(V8IsolateHandle isolate, void* ready_token, char** error_out);
+int shim_compile_stream_push(V8StreamHandle stream, const uint8_t* data, size_t length, char** error_out);
+V8ScriptHandle shim_compile_stream_finish(V8StreamHandle stream, V8ContextHandle ctx, char** error_out);
+void shim_compile_stream_dispose(V8StreamHandle stream);
+int shim_script_create_code_cache(V8ScriptHandle script, uint8_t** data_out, size_t* length_out, char** error_out);
 int shim_script_run(V8ScriptHandle script, V8ContextHandle ctx, char** result_out, char** error_out);
+int shim_script_run_value(V8ScriptHandle script, V8ContextHandle ctx, ShimValue* result_out, char** error_out);
+// Runs script in ctx, calls each warmup function, and then creates the script's code cache,
+// which now also covers every function those calls compiled. Returns a ShimStatus; the
+// cache buffer is released with shim_free_buffer.
+int shim_script_warmup(
+	V8ScriptHandle script,
+	V8ContextHandle ctx,
+	const ShimWarmupCall* calls,
+	size_t call_count,
+	uint8_t** cache_out,
+	size_t* cache_length_out,
+	char** error_out
+);
 void shim_script_dispose(V8ScriptHandle script);
 
+// Compiles the ES module name and everything it imports, then evaluates it, awaiting top-level
+// await like an _await call. Imports are resolved by pacm_v8__module_load, which receives
+// loader along with all unresolved imports of one level of the module graph at once, so the
+// host can fetch them concurrently. Each resolved name is loaded once per context. result_out
+// receives the module's default export. Code caches of compiled modules are kept per isolate.
+int shim_context_load_module(
+	V8ContextHandle ctx,
+	const char* name,
+	size_t name_length,
+	const char* source,
+	size_t source_length,
+	void* loader,
+	ShimValue* result_out,
+	char** error_out
+);
+
 // Legacy eval helper for backwards compatibility
 char* shim_eval(V8ContextHandle ctx, const char* source);
 void shim_free_string(char* s);
+void shim_free_buffer(uint8_t* data);
+void shim_value_release(ShimValue* value);
 
 #ifdef __cplusplus
 }
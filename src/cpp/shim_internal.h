@@ -2,8 +2,10 @@
 
 #include "shim.h"
 #include "v8.h"
+#include "v8-profiler.h"
 #include "libplatform/libplatform.h"
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
@@ -11,37 +13,352 @@
 #include <mutex>
 #include <string>
 #include <string_view>
+#include <list>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <chrono>
+#include <condition_variable>
 
 namespace pacm_v8 {
 
-struct ScriptCacheHash {
+struct StringKeyHash {
     using is_transparent = void;
     std::size_t operator()(std::string_view value) const noexcept {
         return std::hash<std::string_view>{}(value);
     }
 };
 
-struct ScriptCacheEq {
+struct StringKeyEq {
     using is_transparent = void;
     bool operator()(std::string_view lhs, std::string_view rhs) const noexcept {
         return lhs == rhs;
     }
 };
 
+// Identifies a cached script without keeping a copy of its source: two independent
+// 64-bit hashes plus the length, so a false hit needs a double collision of equal length.
+struct ScriptCacheKey {
+    uint64_t hash = 0;
+    uint64_t check = 0;
+    std::size_t length = 0;
+
+    static ScriptCacheKey from_source(std::string_view source);
+
+    bool operator==(const ScriptCacheKey& other) const noexcept {
+        return hash == other.hash && check == other.check && length == other.length;
+    }
+};
+
+struct ScriptCacheKeyHash {
+    std::size_t operator()(const ScriptCacheKey& key) const noexcept {
+        return static_cast<std::size_t>(key.hash);
+    }
+};
+
+// Text of a script to compile: UTF-8 that is copied into the V8 heap, or a host buffer that
+// V8 references in place as an external string. Owns the external release token until V8
+// takes it over, so a cache hit or an early failure still releases it.
+class SourceText {
+public:
+    explicit SourceText(std::string_view utf8) : bytes_(utf8) {}
+    explicit SourceText(const ShimExternalSource& source);
+    ~SourceText();
+    SourceText(const SourceText&) = delete;
+    SourceText& operator=(const SourceText&) = delete;
+
+    bool is_null() const { return !bytes_.data(); }
+    bool has_valid_encoding() const {
+        return !external_ || encoding_ == SHIM_SOURCE_ONE_BYTE || encoding_ == SHIM_SOURCE_TWO_BYTE;
+    }
+    std::size_t byte_length() const { return bytes_.size(); }
+    ScriptCacheKey cache_key() const;
+    // False if the text is longer than a V8 string can be.
+    bool to_string(v8::Isolate* isolate, v8::Local<v8::String>& out);
+
+private:
+    std::string_view bytes_;
+    bool external_ = false;
+    int32_t encoding_ = SHIM_SOURCE_ONE_BYTE;
+    void* release_token_ = nullptr;
+};
+
+// Per-entry cost on top of the source length, which V8 keeps alive with the script.
+constexpr std::size_t kScriptCacheEntryOverhead = 256;
+constexpr std::size_t kDefaultScriptCacheBytes = 16 * 1024 * 1024;
+// Larger sources are compiled but never cached.
+constexpr std::size_t kMaxCacheableSourceLength = 64 * 1024;
+
+// Keys of the shared cache entries a context has used; released when the context is disposed.
+struct ScriptCacheUser {
+    std::unordered_set<ScriptCacheKey, ScriptCacheKeyHash> keys;
+};
+
+// Compiled scripts shared by all contexts of an isolate, under a byte budget with LRU
+// eviction. UnboundScripts are context independent, so one compile serves every context.
+// Once the last context that used an entry is disposed, the entry moves to the cold end
+// and is the next to be evicted; a replacement context can still pick it up until then.
+class ScriptCache {
+public:
+    bool lookup(v8::Isolate* isolate, const ScriptCacheKey& key, ScriptCacheUser* user, v8::Local<v8::UnboundScript>& out);
+    void insert(v8::Isolate* isolate, const ScriptCacheKey& key, ScriptCacheUser* user, v8::Local<v8::UnboundScript> script);
+    void release(ScriptCacheUser& user);
+    void set_capacity(std::size_t capacity_bytes);
+    void clear();
+    ShimScriptCacheStats stats() const;
+
+private:
+    struct Entry {
+        ScriptCacheKey key;
+        v8::Global<v8::UnboundScript> script;
+        std::vector<ScriptCacheUser*> users;
+    };
+    using EntryList = std::list<Entry>;
+
+    static std::size_t cost(const ScriptCacheKey& key) { return key.length + kScriptCacheEntryOverhead; }
+    static void add_user(Entry& entry, ScriptCacheUser* user);
+    void erase(EntryList::iterator entry);
+    void evict_to(std::size_t budget);
+
+    EntryList lru_;
+    std::unordered_map<ScriptCacheKey, EntryList::iterator, ScriptCacheKeyHash> index_;
+    std::size_t bytes_ = 0;
+    std::size_t capacity_ = kDefaultScriptCacheBytes;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t insertions_ = 0;
+    uint64_t evictions_ = 0;
+};
+
+constexpr std::size_t kDefaultModuleCacheBytes = 16 * 1024 * 1024;
+
+// Code caches of compiled ES modules, shared by all contexts of an isolate under a byte
+// budget with LRU eviction. Unlike scripts, a v8::Module is bound to the context that
+// instantiates it, so what is shared is the compile work, not the module.
+class ModuleCodeCache {
+public:
+    // The returned bytes stay valid until the next insert.
+    const std::vector<uint8_t>* lookup(const ScriptCacheKey& key);
+    void insert(const ScriptCacheKey& key, const uint8_t* data, std::size_t length);
+    void erase(const ScriptCacheKey& key);
+    void clear();
+
+private:
+    struct Entry {
+        ScriptCacheKey key;
+        std::vector<uint8_t> data;
+    };
+    using EntryList = std::list<Entry>;
+
+    EntryList lru_;
+    std::unordered_map<ScriptCacheKey, EntryList::iterator, ScriptCacheKeyHash> index_;
+    std::size_t bytes_ = 0;
+    std::size_t capacity_ = kDefaultModuleCacheBytes;
+};
+
+// Size of the scratch buffer offered to host functions for their result payload.
+constexpr std::size_t kHostResultScratchBytes = 1024;
+
+// Embedder data slot holding the owning ContextWrapper; slot 0 is reserved for the debugger.
+constexpr int kContextWrapperEmbedderIndex = 1;
+
+// Index passed to SnapshotCreator::AddContext for the bootstrapped context.
+constexpr std::size_t kSnapshotContextIndex = 0;
+
+// Why the isolate's current execution was terminated by the shim.
+enum class TerminationReason : int {
+    kNone = 0,
+    kHeapLimit,
+    kTimeout,
+    kCpuBudget,
+};
+
+// Pause times recorded by the GC callbacks install_gc_callbacks registers.
+class GcStats {
+public:
+    void begin();
+    void end(v8::GCType type);
+    ShimGcStats snapshot() const;
+
+private:
+    mutable std::mutex mutex_;
+    ShimGcStats stats_{};
+    // GCs can nest, e.g. a scavenge inside a full collection; only the outermost is timed.
+    int depth_ = 0;
+    std::chrono::steady_clock::time_point started_;
+};
+
+struct TimedCounter {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_ns{0};
+};
+
+// Hot-path counters of one context or isolate. Updated with relaxed atomics, so a snapshot
+// taken during a call may pair a count with a slightly older total.
+struct Counters {
+    TimedCounter compile;
+    TimedCounter run;
+    TimedCounter call;
+    TimedCounter marshal;
+    TimedCounter host;
+    std::atomic<uint64_t> cache_hits{0};
+    std::atomic<uint64_t> cache_misses{0};
+
+    ShimCounters snapshot() const;
+};
+
+#ifdef PACM_V8_INSTRUMENTATION
+// Whether completed spans are reported to pacm_v8__trace_span.
+extern std::atomic<bool> g_trace_spans;
+
+// Times its scope into one of the counters; owner is the wrapper reported with the span.
+class Span {
+public:
+    Span(Counters* counters, TimedCounter Counters::*counter, const char* name, const void* owner)
+        : counter_(counters ? &(counters->*counter) : nullptr), name_(name), owner_(owner), started_(std::chrono::steady_clock::now()) {}
+    ~Span();
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    TimedCounter* counter_;
+    const char* name_;
+    const void* owner_;
+    std::chrono::steady_clock::time_point started_;
+};
+
+#define PACM_V8_CONCAT_INNER(a, b) a##b
+#define PACM_V8_CONCAT(a, b) PACM_V8_CONCAT_INNER(a, b)
+// wrapper is a ContextWrapper* or IsolateWrapper* and may be null.
+#define PACM_V8_SPAN(wrapper, counter, name) \
+    ::pacm_v8::Span PACM_V8_CONCAT(pacm_v8_span_, __LINE__)( \
+        (wrapper) ? &(wrapper)->counters : nullptr, &::pacm_v8::Counters::counter, name, (wrapper))
+#define PACM_V8_COUNT(wrapper, counter) ((wrapper)->counters.counter.fetch_add(1, std::memory_order_relaxed))
+#else
+#define PACM_V8_SPAN(wrapper, counter, name) ((void)0)
+#define PACM_V8_COUNT(wrapper, counter) ((void)0)
+#endif
+
+// Data of one FunctionTemplate of a ClassTemplate; accessor properties have one per getter
+// and setter.
+struct ClassMember {
+    uint64_t function_id;
+};
+
+// A class defined by shim_isolate_define_class; instances carry a ClassInstance in
+// internal field 0.
+struct ClassTemplate {
+    v8::Global<v8::FunctionTemplate> constructor;
+    std::vector<std::unique_ptr<ClassMember>> members;
+};
+
+struct ContextWrapper;
+
+struct ClassInstance {
+    ContextWrapper* context;
+    uint64_t token;
+    // Weak; the host object is released once V8 collects it.
+    v8::Global<v8::Object> object;
+};
+
+struct NativeCallbackData;
+
 struct IsolateWrapper {
     v8::Isolate* isolate;
     v8::ArrayBuffer::Allocator* allocator;
+    // Owned copy of the startup snapshot; V8 requires it to outlive the isolate.
+    std::vector<char> snapshot_blob;
+    v8::StartupData startup_data{};
+    ScriptCache script_cache;
+    ModuleCodeCache module_cache;
+    GcStats gc_stats;
+    Counters counters;
+    // Indexed by class id - 1.
+    std::vector<std::unique_ptr<ClassTemplate>> classes;
+    // Created by the first CPU profile; disposed with the isolate.
+    v8::CpuProfiler* cpu_profiler = nullptr;
+    std::size_t active_cpu_profiles = 0;
+    // A TerminationReason set by the near-heap-limit callback or the watchdog thread;
+    // consumed by execution_failure and ExecutionGuard.
+    std::atomic<int> termination_reason{0};
+    // Set on the first near-heap-limit callback. The memory that filled the heap may still be
+    // reachable, so the isolate refuses further calls and has to be recycled.
+    std::atomic<bool> poisoned{false};
+    // Nesting of ExecutionGuards; only the outermost call arms limits.
+    int execution_depth = 0;
+    // Held between shim_isolate_lock and shim_isolate_unlock by the thread using the isolate.
+    std::unique_ptr<v8::Locker> locker;
+    // Host callbacks taken out of service. Function objects may outlive their registration
+    // and still point at the entry, so an entry stays until V8 has collected all of them; its
+    // host callback is dropped as soon as no host call is running.
+    std::vector<std::unique_ptr<NativeCallbackData>> retired_callbacks;
+    // Set when an entry was retired or lost its last function object since the last release.
+    bool release_pending = false;
+    bool releasing_callbacks = false;
+    // Host callbacks running on the isolate's thread, counted by HostCallScope.
+    int host_call_depth = 0;
+
+    bool has_snapshot() const { return !snapshot_blob.empty(); }
 };
 
-struct NativeCallbackData;
+// A host result for a promise handed out by an async host function.
+struct PromiseCompletion {
+    uint64_t promise_id;
+    bool fulfilled;
+    // Owned by the host; released through pacm_v8__value_release once converted.
+    ShimValue value;
+    std::string error;
+};
+
+// Filled from any thread by shim_promise_resolve/shim_promise_reject and drained on the
+// isolate's thread. Shared with outstanding completers so it outlives a disposed context.
+struct CompletionQueue {
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::vector<PromiseCompletion> items;
+    // Completers of the current generation handed to the host and not used yet.
+    std::size_t outstanding = 0;
+    // Advanced by shim_context_reset; completers of earlier generations are discarded.
+    uint64_t generation = 0;
+    bool closed = false;
+};
+
+struct PromiseCompleter {
+    std::shared_ptr<CompletionQueue> queue;
+    uint64_t promise_id;
+    uint64_t generation;
+};
+
+// An ES module loaded into a context, with the resolved names of its imports by specifier.
+struct ModuleRecord {
+    v8::Global<v8::Module> module;
+    std::unordered_map<std::string, std::string, StringKeyHash, StringKeyEq> imports;
+};
 
 struct ContextWrapper {
     IsolateWrapper* isolate_wrapper;
     std::unique_ptr<v8::Global<v8::Context>> context;
-    std::unordered_map<std::string, std::unique_ptr<v8::Global<v8::UnboundScript>>, ScriptCacheHash, ScriptCacheEq> cache;
-    std::unordered_map<std::string, std::unique_ptr<NativeCallbackData>, ScriptCacheHash, ScriptCacheEq> native_callbacks;
+    ScriptCacheUser cache_user;
+    std::unordered_map<std::string, std::unique_ptr<NativeCallbackData>, StringKeyHash, StringKeyEq> native_callbacks;
+    // Paths of native_callbacks, latest registration last, so a recreated context installs them
+    // the way they were applied ("a" and "a.b" overwrite each other).
+    std::vector<std::string> native_callback_order;
+    // Own properties of the global object (key -> value) captured by shim_context_record_baseline.
+    std::unique_ptr<v8::Global<v8::Map>> baseline;
+    // Limits applied to every call into this context; 0 disables them.
+    uint64_t timeout_ms = 0;
+    uint64_t cpu_budget_ns = 0;
+    uint64_t cpu_used_ns = 0;
+    // Promises returned by async host functions, settled by drain_completions.
+    std::shared_ptr<CompletionQueue> completions = std::make_shared<CompletionQueue>();
+    std::unordered_map<uint64_t, v8::Global<v8::Promise::Resolver>> pending_promises;
+    uint64_t next_promise_id = 0;
+    // ES modules by resolved name, and the names by module identity hash for the resolve callback.
+    std::unordered_map<std::string, ModuleRecord, StringKeyHash, StringKeyEq> modules;
+    std::unordered_multimap<int, std::string> module_names;
+    Counters counters;
+    // Live instances created by shim_context_new_instance.
+    std::unordered_set<ClassInstance*> class_instances;
 
     v8::Isolate* isolate() const { return isolate_wrapper ? isolate_wrapper->isolate : nullptr; }
 };
@@ -49,11 +366,81 @@ struct ContextWrapper {
 struct ScriptWrapper {
     IsolateWrapper* isolate_wrapper;
     std::unique_ptr<v8::Global<v8::UnboundScript>> script;
-    std::string cache_key;
+    ScriptCacheKey cache_key;
+};
+
+// A function resolved once by shim_context_get_function; keeps its creation context alive.
+struct FunctionWrapper {
+    IsolateWrapper* isolate_wrapper;
+    std::unique_ptr<v8::Global<v8::Context>> context;
+    std::unique_ptr<v8::Global<v8::Function>> function;
+    std::unique_ptr<v8::Global<v8::Value>> receiver;
+};
+
+// fast_return_type of host functions registered without a fast signature.
+constexpr int32_t kNoFastSignature = -1;
+
+// Weak handle to the v8::External an installed host function carries as its data.
+struct CallbackExternal {
+    NativeCallbackData* data = nullptr;
+    v8::Global<v8::External> handle;
 };
 
 struct NativeCallbackData {
-    uint64_t function_id;
+    IsolateWrapper* isolate_wrapper = nullptr;
+    // One per function object created for this entry; removed as V8 collects them.
+    std::vector<std::unique_ptr<CallbackExternal>> externals;
+    // Host callback token owned by this entry; released through pacm_v8__host_function_drop.
+    // 0 once a retired entry has released it.
+    uint64_t function_id = 0;
+    // Replaced, or its context disposed; function objects still pointing here throw.
+    bool retired = false;
+    // Returns a promise and hands a completer to pacm_v8__host_function_invoke_async.
+    bool async = false;
+    // Set by shim_context_bind_host_function: the function itself comes from the snapshot.
+    bool bound = false;
+    const v8::CFunction* fast_function = nullptr;
+    // The registered fast return type, also applied by the trampoline.
+    int32_t fast_return_type = kNoFastSignature;
+};
+
+// Arms the context's timeout and CPU budget on the shared watchdog for the duration of the
+// outermost JavaScript call, and charges the CPU time used to the context. Declare it after
+// the TryCatch so it is destroyed first.
+class ExecutionGuard {
+public:
+    ExecutionGuard(IsolateWrapper* isolate, ContextWrapper* context);
+    ~ExecutionGuard();
+    ExecutionGuard(const ExecutionGuard&) = delete;
+    ExecutionGuard& operator=(const ExecutionGuard&) = delete;
+
+    // True if the call must not run: the context's CPU budget was used up before it started,
+    // or the isolate hit its heap limit earlier. reject reports why as a ShimStatus.
+    bool refused() const { return refusal_ != SHIM_STATUS_OK; }
+    int refusal_status() const { return refusal_; }
+    const char* refusal_message() const;
+    int reject(char** error_out) const;
+
+private:
+    IsolateWrapper* isolate_;
+    ContextWrapper* context_;
+    bool outermost_ = false;
+    int refusal_ = SHIM_STATUS_OK;
+    uint64_t deadline_timer_ = 0;
+    uint64_t cpu_timer_ = 0;
+    uint64_t cpu_start_ns_ = 0;
+};
+
+// Marks a call into a host callback, so retired callbacks are not dropped while it runs.
+class HostCallScope {
+public:
+    explicit HostCallScope(IsolateWrapper* isolate);
+    ~HostCallScope();
+    HostCallScope(const HostCallScope&) = delete;
+    HostCallScope& operator=(const HostCallScope&) = delete;
+
+private:
+    IsolateWrapper* isolate_;
 };
 
 inline IsolateWrapper* unwrap_isolate(V8IsolateHandle handle) {
@@ -68,21 +455,193 @@ inline ScriptWrapper* unwrap_script(V8ScriptHandle handle) {
     return reinterpret_cast<ScriptWrapper*>(handle);
 }
 
+inline FunctionWrapper* unwrap_function(V8FunctionHandle handle) {
+    return reinterpret_cast<FunctionWrapper*>(handle);
+}
+
 char* copy_string(const std::string& value);
 char* copy_string(const char* data, std::size_t length);
+uint8_t* copy_bytes(const uint8_t* data, std::size_t length);
 char* value_to_utf8(v8::Isolate* isolate, v8::Local<v8::Value> value);
+// False if text is longer than a V8 string can be.
+bool new_utf8_string(v8::Isolate* isolate, std::string_view text, v8::Local<v8::String>& out, v8::NewStringType type = v8::NewStringType::kNormal);
 void assign_error(char** error_out, const std::string& message);
+
+// Bump allocator for data that only lives for one host call: argument payloads and the
+// buffer a result is written into. Blocks are kept for reuse, so a warmed-up arena does not
+// allocate. ScratchScope rewinds to where it started, which keeps nested calls safe.
+class ScratchArena {
+public:
+    struct Mark {
+        std::size_t block;
+        std::size_t used;
+    };
+
+    Mark mark() const { return {current_, blocks_.empty() ? 0 : blocks_[current_].used}; }
+    void release(Mark mark);
+    void* allocate(std::size_t size, std::size_t align = alignof(std::max_align_t));
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+        std::size_t used;
+    };
+
+    std::vector<Block> blocks_;
+    std::size_t current_ = 0;
+};
+
+// One arena per thread; an isolate only runs on one thread at a time.
+ScratchArena& thread_scratch();
+
+class ScratchScope {
+public:
+    explicit ScratchScope(ScratchArena& arena) : arena_(arena), mark_(arena.mark()) {}
+    ~ScratchScope() { arena_.release(mark_); }
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+private:
+    ScratchArena& arena_;
+    ScratchArena::Mark mark_;
+};
+
+// String and byte payloads point into V8's memory or into scratch and are only valid
+// until the enclosing ScratchScope ends.
+void to_shim_value_borrowed(v8::Isolate* isolate, v8::Local<v8::Value> value, ShimValue& out, ScratchArena& scratch);
+bool to_shim_value_owned(v8::Isolate* isolate, v8::Local<v8::Value> value, ShimValue& out);
+bool from_shim_value(v8::Isolate* isolate, const ShimValue& value, v8::Local<v8::Value>& out);
+// Writes value with v8::ValueSerializer into a malloc'd buffer for shim_free_buffer.
+bool serialize_value(
+    v8::Isolate* isolate,
+    v8::Local<v8::Context> ctx,
+    v8::Local<v8::Value> value,
+    v8::TryCatch& try_catch,
+    uint8_t*& data_out,
+    std::size_t& length_out,
+    std::string& error_out);
+
+// Where an entry point stores its result: a ShimValue, or, when data is set, a
+// ValueSerializer buffer of length bytes.
+struct ResultOut {
+    ShimValue* value = nullptr;
+    uint8_t** data = nullptr;
+    std::size_t* length = nullptr;
+    // Streams the result to pacm_v8__output_begin/pacm_v8__output_write instead; ShimOutputFlags.
+    void* sink = nullptr;
+    int32_t output_flags = SHIM_OUTPUT_TEXT;
+
+    void reset() const;
+    bool assign(v8::Isolate* isolate, v8::Local<v8::Context> ctx, v8::Local<v8::Value> result, v8::TryCatch& try_catch, std::string& error_out) const;
+};
+v8::Local<v8::Uint8Array> wrap_host_buffer(v8::Isolate* isolate, uint8_t* data, std::size_t length, void* release_token);
 bool capture_exception(v8::Isolate* isolate, v8::TryCatch& try_catch, std::string& message_out);
 
+// Intermediate objects already resolved by ensure_property_path, keyed by path prefix.
+using PropertyPathCache = std::unordered_map<std::string_view, v8::Local<v8::Object>>;
+
+bool ensure_property_path(
+    v8::Isolate* isolate,
+    v8::Local<v8::Context> ctx,
+    std::string_view path,
+    v8::Local<v8::Object>& target_out,
+    v8::Local<v8::String>& property_out,
+    std::string& error_out,
+    PropertyPathCache* cache = nullptr);
+// Finds the function at a dotted path without creating anything; owner_out is its receiver.
+bool resolve_function_path(
+    v8::Isolate* isolate,
+    v8::Local<v8::Context> ctx,
+    std::string_view path,
+    v8::Local<v8::Object>& owner_out,
+    v8::Local<v8::Function>& function_out,
+    std::string& error_out);
+// Calls a host function with info's arguments and returns its result to JavaScript. A
+// non-null instance_token calls a class member through pacm_v8__class_member_invoke. A
+// function registered with a fast signature passes its return type, so the result is
+// checked and converted exactly as on the fast path.
+void call_host_function(
+    const v8::FunctionCallbackInfo<v8::Value>& info,
+    IsolateWrapper* isolate_wrapper,
+    uint64_t function_id,
+    const uint64_t* instance_token,
+    int32_t fast_return_type = kNoFastSignature);
+void dispose_classes(IsolateWrapper* wrapper);
+// Takes a host callback out of service; see IsolateWrapper::retired_callbacks.
+void retire_native_callback(IsolateWrapper* wrapper, std::unique_ptr<NativeCallbackData> data);
+// Unless a host call is running, drops the host callbacks of retired entries and frees the
+// entries no function object refers to any more.
+void release_retired_callbacks(IsolateWrapper* wrapper);
+void dispose_class_instances(ContextWrapper* context);
+bool install_host_function_stub(v8::Isolate* isolate, v8::Local<v8::Context> ctx, const char* name, std::string& error_out);
+const intptr_t* external_references();
+
+// Creates a pending promise for an async host call and passes its completer to the host.
+bool start_host_promise(
+    ContextWrapper* context,
+    v8::Local<v8::Context> ctx,
+    uint64_t function_id,
+    const ShimValue* args,
+    std::size_t arg_count,
+    v8::Local<v8::Promise>& promise_out);
+// Settles promises completed by the host, then runs microtasks and pending platform tasks.
+// Returns a ShimStatus; a termination inside a microtask is reported like a failed call.
+int pump_context(ContextWrapper* context, v8::Local<v8::Context> ctx, v8::TryCatch& try_catch, std::string& error_out);
+// Pumps until value, if it is a promise, settles and replaces it with the fulfilled value.
+// Blocks for host completions while any are outstanding, bounded by the context timeout.
+int settle_value(ContextWrapper* context, v8::Local<v8::Context> ctx, v8::TryCatch& try_catch, v8::Local<v8::Value>& value, std::string& error_out);
+void close_completions(ContextWrapper* context);
+// Forgets the promises and completers of the context's previous user.
+void reset_completions(ContextWrapper* context);
+
+bool fast_signature_supported(int32_t return_type, const int32_t* arg_types, std::size_t arg_count);
+// Checks a host result against a non-void fast return type and converts it in place the way
+// the fast path reads it: doubles holding an exact int32 count as Int32, and Int32 as Float64.
+bool coerce_fast_result(int32_t return_type, ShimValue& value);
+// The fast-call entry for a supported signature, or null if this build has no fast API.
+const v8::CFunction* select_fast_function(int32_t return_type, const int32_t* arg_types, std::size_t arg_count);
+
+V8IsolateHandle create_isolate(const ShimIsolateOptions& options);
+void install_gc_callbacks(IsolateWrapper* wrapper);
+void dispose_cpu_profiler(IsolateWrapper* wrapper);
+// Status for a failed JavaScript call; replaces error_out and clears the pending termination
+// when the failure was caused by the near-heap-limit callback or the watchdog.
+int execution_failure(IsolateWrapper* wrapper, std::string& error_out);
+// The 1/0 result of the char* result calls, which predate ShimStatus.
+inline int legacy_status(int status) { return status == SHIM_STATUS_OK ? 1 : 0; }
+
 bool ensure_isolate(V8IsolateHandle handle, IsolateWrapper*& out, std::string& error_out);
 bool ensure_context(V8ContextHandle handle, ContextWrapper*& out, std::string& error_out);
 bool ensure_script(V8ScriptHandle handle, ScriptWrapper*& out, std::string& error_out);
+bool run_script(
+    ScriptWrapper* script_wrapper,
+    ContextWrapper* context_wrapper,
+    v8::Local<v8::Context> ctx,
+    v8::TryCatch& try_catch,
+    v8::Local<v8::Value>& result_out,
+    std::string& error_out);
 
 extern std::unique_ptr<v8::Platform> g_platform;
 extern std::once_flag g_v8_once;
+extern std::atomic<bool> g_v8_initialized;
 
 } // namespace pacm_v8
 
-extern "C" int pacm_v8__host_function_invoke(uint64_t function_id, const char** args, std::size_t arg_count, char** result_out, char** error_out);
+// result_out may arrive with data/length describing a scratch buffer. The host can write a
+// STRING or BYTES payload into it and point data at it; such payloads are not released.
+extern "C" int pacm_v8__host_function_invoke(uint64_t function_id, const ShimValue* args, std::size_t arg_count, ShimValue* result_out, char** error_out);
+extern "C" void pacm_v8__host_function_invoke_async(uint64_t function_id, const ShimValue* args, std::size_t arg_count, V8PromiseCompleterHandle completer);
+extern "C" void pacm_v8__value_release(ShimValue* value);
+extern "C" void pacm_v8__buffer_release(void* release_token);
+extern "C" void pacm_v8__external_source_release(void* release_token);
 extern "C" void pacm_v8__host_function_drop(uint64_t function_id);
+extern "C" void pacm_v8__compile_stream_ready(void* ready_token);
+extern "C" int pacm_v8__output_begin(void* sink, std::size_t length);
+extern "C" int pacm_v8__output_write(void* sink, const char* data, std::size_t length);
+// Fills one sources_out entry per request; returns 0 with error_out set if any import fails.
+extern "C" int pacm_v8__module_load(void* loader, const ShimModuleRequest* requests, std::size_t count, ShimModuleSource* sources_out, char** error_out);
 extern "C" void pacm_v8__string_free(char* value);
+extern "C" int pacm_v8__class_member_invoke(uint64_t function_id, uint64_t instance_token, const ShimValue* args, std::size_t arg_count, ShimValue* result_out, char** error_out);
+extern "C" void pacm_v8__class_instance_drop(uint64_t instance_token);
+extern "C" void pacm_v8__trace_span(const char* name, const void* owner, uint64_t start_ns, uint64_t duration_ns);
@@ -0,0 +1,116 @@
+#include "shim_internal.h"
+
+namespace pacm_v8 {
+
+static bool run_bootstrap_source(v8::Isolate* isolate, v8::Local<v8::Context> ctx, const char* source, std::string& error_out) {
+    v8::TryCatch try_catch(isolate);
+
+    v8::Local<v8::String> src = v8::String::NewFromUtf8(isolate, source, v8::NewStringType::kNormal).ToLocalChecked();
+    v8::Local<v8::Script> script;
+    if (!v8::Script::Compile(ctx, src).ToLocal(&script)) {
+        capture_exception(isolate, try_catch, error_out);
+        return false;
+    }
+
+    v8::Local<v8::Value> result;
+    if (!script->Run(ctx).ToLocal(&result)) {
+        capture_exception(isolate, try_catch, error_out);
+        return false;
+    }
+    return true;
+}
+
+} // namespace pacm_v8
+
+extern "C" {
+
+int shim_snapshot_create(
+    const char** sources,
+    size_t source_count,
+    const char** host_functions,
+    size_t host_function_count,
+    uint8_t** blob_out,
+    size_t* length_out,
+    char** error_out) {
+    if (blob_out) {
+        *blob_out = nullptr;
+    }
+    if (length_out) {
+        *length_out = 0;
+    }
+    if (error_out) {
+        *error_out = nullptr;
+    }
+    if (!blob_out || !length_out) {
+        pacm_v8::assign_error(error_out, "snapshot output was null");
+        return 0;
+    }
+
+    std::unique_ptr<v8::ArrayBuffer::Allocator> allocator(v8::ArrayBuffer::Allocator::NewDefaultAllocator());
+    v8::Isolate::CreateParams params;
+    params.array_buffer_allocator = allocator.get();
+    params.external_references = pacm_v8::external_references();
+
+    std::string error;
+    bool ok = true;
+    v8::StartupData blob{};
+    {
+        v8::SnapshotCreator creator(params);
+        v8::Isolate* isolate = creator.GetIsolate();
+        {
+            v8::Isolate::Scope isolate_scope(isolate);
+            v8::HandleScope handle_scope(isolate);
+            creator.SetDefaultContext(v8::Context::New(isolate));
+
+            v8::Local<v8::Context> ctx = v8::Context::New(isolate);
+            {
+                v8::Context::Scope context_scope(ctx);
+                for (std::size_t i = 0; ok && i < host_function_count; ++i) {
+                    const char* name = host_functions ? host_functions[i] : nullptr;
+                    if (!name) {
+                        error = "host function name was null";
+                        ok = false;
+                        break;
+                    }
+                    ok = pacm_v8::install_host_function_stub(isolate, ctx, name, error);
+                }
+                for (std::size_t i = 0; ok && i < source_count; ++i) {
+                    const char* source = sources ? sources[i] : nullptr;
+                    if (!source) {
+                        error = "source was null";
+                        ok = false;
+                        break;
+                    }
+                    ok = pacm_v8::run_bootstrap_source(isolate, ctx, source, error);
+                }
+            }
+            creator.AddContext(ctx);
+        }
+        // The creator must always produce a blob before it is destroyed, even on failure.
+        blob = creator.CreateBlob(v8::SnapshotCreator::FunctionCodeHandling::kKeep);
+    }
+
+    if (ok && (!blob.data || blob.raw_size <= 0)) {
+        error = "failed to serialize snapshot";
+        ok = false;
+    }
+
+    if (ok) {
+        *blob_out = pacm_v8::copy_bytes(reinterpret_cast<const uint8_t*>(blob.data), static_cast<std::size_t>(blob.raw_size));
+        if (*blob_out) {
+            *length_out = static_cast<std::size_t>(blob.raw_size);
+        } else {
+            error = "failed to allocate snapshot buffer";
+            ok = false;
+        }
+    }
+    delete[] blob.data;
+
+    if (!ok) {
+        pacm_v8::assign_error(error_out, error);
+        return 0;
+    }
+    return 1;
+}
+
+} // extern "C"
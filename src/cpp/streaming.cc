@@ -0,0 +1,222 @@
+#include "shim_internal.h"
+
+#include <cstring>
+#include <deque>
+
+namespace pacm_v8 {
+
+namespace {
+
+// Shared by the host pushing chunks, the worker parsing them and the finishing thread.
+struct StreamState {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::pair<std::unique_ptr<uint8_t[]>, std::size_t>> chunks;
+    // V8 needs the complete text again to finish the compile.
+    std::string full_source;
+    bool ended = false;
+    bool parsed = false;
+};
+
+class ChunkStream : public v8::ScriptCompiler::ExternalSourceStream {
+public:
+    explicit ChunkStream(std::shared_ptr<StreamState> state) : state_(std::move(state)) {}
+
+    // Runs on the worker and blocks until the host pushes more text or ends the stream.
+    std::size_t GetMoreData(const uint8_t** src) override {
+        std::unique_lock<std::mutex> lock(state_->mutex);
+        state_->changed.wait(lock, [this]() { return !state_->chunks.empty() || state_->ended; });
+        if (state_->chunks.empty()) {
+            *src = nullptr;
+            return 0;
+        }
+        auto chunk = std::move(state_->chunks.front());
+        state_->chunks.pop_front();
+        *src = chunk.first.release();
+        return chunk.second;
+    }
+
+private:
+    std::shared_ptr<StreamState> state_;
+};
+
+class StreamingTask : public v8::Task {
+public:
+    StreamingTask(v8::ScriptCompiler::ScriptStreamingTask* task, std::shared_ptr<StreamState> state, void* ready_token)
+        : task_(task), state_(std::move(state)), ready_token_(ready_token) {}
+
+    void Run() override {
+        task_->Run();
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            state_->parsed = true;
+            state_->changed.notify_all();
+        }
+        // Only after parsed is published, so the callback may itself call finish().
+        if (ready_token_) {
+            ::pacm_v8__compile_stream_ready(ready_token_);
+        }
+    }
+
+private:
+    // Owned by the StreamWrapper, which waits for this task before it is destroyed.
+    v8::ScriptCompiler::ScriptStreamingTask* task_;
+    std::shared_ptr<StreamState> state_;
+    void* ready_token_;
+};
+
+} // namespace
+
+struct StreamWrapper {
+    IsolateWrapper* isolate_wrapper;
+    std::shared_ptr<StreamState> state;
+    std::unique_ptr<v8::ScriptCompiler::StreamedSource> source;
+    std::unique_ptr<v8::ScriptCompiler::ScriptStreamingTask> task;
+
+    // Ends the input and waits for the worker to stop parsing.
+    void wait_parsed() {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->ended = true;
+        state->changed.notify_all();
+        state->changed.wait(lock, [this]() { return state->parsed; });
+    }
+};
+
+static StreamWrapper* unwrap_stream(V8StreamHandle handle) {
+    return reinterpret_cast<StreamWrapper*>(handle);
+}
+
+} // namespace pacm_v8
+
+extern "C" {
+
+V8StreamHandle shim_compile_stream_start(V8IsolateHandle handle, void* ready_token, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::IsolateWrapper* isolate_wrapper = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_isolate(handle, isolate_wrapper, error)) {
+        pacm_v8::assign_error(error_out, error);
+        if (ready_token) {
+            ::pacm_v8__compile_stream_ready(ready_token);
+        }
+        return nullptr;
+    }
+
+    v8::Isolate* isolate = isolate_wrapper->isolate;
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+
+    auto* wrapper = new pacm_v8::StreamWrapper();
+    wrapper->isolate_wrapper = isolate_wrapper;
+    wrapper->state = std::make_shared<pacm_v8::StreamState>();
+    wrapper->source = std::make_unique<v8::ScriptCompiler::StreamedSource>(
+        std::make_unique<pacm_v8::ChunkStream>(wrapper->state),
+        v8::ScriptCompiler::StreamedSource::UTF8);
+    wrapper->task.reset(v8::ScriptCompiler::StartStreaming(isolate, wrapper->source.get()));
+
+    pacm_v8::g_platform->CallOnWorkerThread(
+        std::make_unique<pacm_v8::StreamingTask>(wrapper->task.get(), wrapper->state, ready_token));
+    return reinterpret_cast<V8StreamHandle>(wrapper);
+}
+
+int shim_compile_stream_push(V8StreamHandle handle, const uint8_t* data, size_t length, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    pacm_v8::StreamWrapper* wrapper = pacm_v8::unwrap_stream(handle);
+    if (!wrapper) {
+        pacm_v8::assign_error(error_out, "invalid V8 stream handle");
+        return 0;
+    }
+    if (length == 0) {
+        return 1;
+    }
+    if (!data) {
+        pacm_v8::assign_error(error_out, "source chunk was null");
+        return 0;
+    }
+
+    std::unique_ptr<uint8_t[]> chunk(new uint8_t[length]);
+    std::memcpy(chunk.get(), data, length);
+    std::lock_guard<std::mutex> lock(wrapper->state->mutex);
+    if (wrapper->state->ended) {
+        pacm_v8::assign_error(error_out, "source stream was already finished");
+        return 0;
+    }
+    wrapper->state->full_source.append(reinterpret_cast<const char*>(data), length);
+    wrapper->state->chunks.emplace_back(std::move(chunk), length);
+    wrapper->state->changed.notify_all();
+    return 1;
+}
+
+V8ScriptHandle shim_compile_stream_finish(V8StreamHandle handle, V8ContextHandle context_handle, char** error_out) {
+    if (error_out) {
+        *error_out = nullptr;
+    }
+
+    std::unique_ptr<pacm_v8::StreamWrapper> wrapper(pacm_v8::unwrap_stream(handle));
+    if (!wrapper) {
+        pacm_v8::assign_error(error_out, "invalid V8 stream handle");
+        return nullptr;
+    }
+    wrapper->wait_parsed();
+
+    pacm_v8::ContextWrapper* context = nullptr;
+    std::string error;
+    if (!pacm_v8::ensure_context(context_handle, context, error)) {
+        pacm_v8::assign_error(error_out, error);
+        return nullptr;
+    }
+    if (context->isolate_wrapper != wrapper->isolate_wrapper) {
+        pacm_v8::assign_error(error_out, "stream and context belong to different isolates");
+        return nullptr;
+    }
+
+    v8::Isolate* isolate = context->isolate();
+    v8::Isolate::Scope isolate_scope(isolate);
+    v8::HandleScope handle_scope(isolate);
+    v8::Local<v8::Context> ctx = v8::Local<v8::Context>::New(isolate, *context->context);
+    v8::Context::Scope context_scope(ctx);
+    v8::TryCatch try_catch(isolate);
+
+    const std::string& full_source = wrapper->state->full_source;
+    v8::Local<v8::String> source;
+    if (!pacm_v8::new_utf8_string(isolate, full_source, source)) {
+        pacm_v8::assign_error(error_out, "source was too long");
+        return nullptr;
+    }
+
+    v8::ScriptOrigin origin(v8::String::Empty(isolate));
+    v8::Local<v8::Script> script;
+    if (!v8::ScriptCompiler::Compile(ctx, wrapper->source.get(), source, origin).ToLocal(&script)) {
+        pacm_v8::capture_exception(isolate, try_catch, error);
+        pacm_v8::assign_error(error_out, error);
+        return nullptr;
+    }
+
+    // Like shim_compile_script, make the result visible to evals of the same source.
+    v8::Local<v8::UnboundScript> unbound = script->GetUnboundScript();
+    const pacm_v8::ScriptCacheKey key = pacm_v8::ScriptCacheKey::from_source(full_source);
+    if (!full_source.empty() && full_source.size() <= pacm_v8::kMaxCacheableSourceLength) {
+        context->isolate_wrapper->script_cache.insert(isolate, key, nullptr, unbound);
+    }
+
+    auto* script_wrapper = new pacm_v8::ScriptWrapper();
+    script_wrapper->isolate_wrapper = context->isolate_wrapper;
+    script_wrapper->cache_key = key;
+    script_wrapper->script = std::make_unique<v8::Global<v8::UnboundScript>>(isolate, unbound);
+    return reinterpret_cast<V8ScriptHandle>(script_wrapper);
+}
+
+void shim_compile_stream_dispose(V8StreamHandle handle) {
+    std::unique_ptr<pacm_v8::StreamWrapper> wrapper(pacm_v8::unwrap_stream(handle));
+    if (wrapper) {
+        wrapper->wait_parsed();
+    }
+}
+
+} // extern "C"
@@ -1,10 +1,60 @@
 #include "shim_internal.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 
 namespace pacm_v8 {
 
+// Blocks of this size cover typical argument lists; larger payloads get a block of their own.
+constexpr std::size_t kScratchBlockBytes = 16 * 1024;
+
+void* ScratchArena::allocate(std::size_t size, std::size_t align) {
+    while (current_ < blocks_.size()) {
+        Block& block = blocks_[current_];
+        std::size_t offset = (block.used + align - 1) & ~(align - 1);
+        if (offset + size <= block.size) {
+            block.used = offset + size;
+            return block.data.get() + offset;
+        }
+        if (current_ + 1 == blocks_.size()) {
+            break;
+        }
+        ++current_;
+    }
+
+    std::size_t block_size = std::max(kScratchBlockBytes, size + align);
+    blocks_.push_back(Block{std::unique_ptr<char[]>(new char[block_size]), block_size, size});
+    current_ = blocks_.size() - 1;
+    return blocks_[current_].data.get();
+}
+
+void ScratchArena::release(Mark mark) {
+    if (blocks_.empty()) {
+        return;
+    }
+    if (mark.block == 0 && mark.used == 0) {
+        // Back at the outermost level: drop oversized blocks so one huge string does not
+        // stay pinned for the life of the thread.
+        blocks_.erase(
+            std::remove_if(blocks_.begin(), blocks_.end(), [](const Block& block) { return block.size > kScratchBlockBytes; }),
+            blocks_.end());
+        blocks_.resize(std::min<std::size_t>(blocks_.size(), 1));
+    }
+    for (std::size_t i = mark.block + 1; i < blocks_.size(); ++i) {
+        blocks_[i].used = 0;
+    }
+    current_ = std::min(mark.block, blocks_.empty() ? 0 : blocks_.size() - 1);
+    if (!blocks_.empty()) {
+        blocks_[current_].used = mark.used;
+    }
+}
+
+ScratchArena& thread_scratch() {
+    thread_local ScratchArena arena;
+    return arena;
+}
+
 char* copy_string(const std::string& value) {
     return copy_string(value.data(), value.size());
 }
@@ -24,6 +74,17 @@ char* copy_string(const char* data, std::size_t length) {
     return buffer;
 }
 
+uint8_t* copy_bytes(const uint8_t* data, std::size_t length) {
+    auto* buffer = static_cast<uint8_t*>(std::malloc(length > 0 ? length : 1));
+    if (!buffer) {
+        return nullptr;
+    }
+    if (length > 0 && data) {
+        std::memcpy(buffer, data, length);
+    }
+    return buffer;
+}
+
 char* value_to_utf8(v8::Isolate* isolate, v8::Local<v8::Value> value) {
     if (!isolate || value.IsEmpty()) {
         return copy_string("");
@@ -35,6 +96,13 @@ char* value_to_utf8(v8::Isolate* isolate, v8::Local<v8::Value> value) {
     return copy_string("");
 }
 
+bool new_utf8_string(v8::Isolate* isolate, std::string_view text, v8::Local<v8::String>& out, v8::NewStringType type) {
+    if (text.size() > static_cast<std::size_t>(v8::String::kMaxLength)) {
+        return false;
+    }
+    return v8::String::NewFromUtf8(isolate, text.empty() ? "" : text.data(), type, static_cast<int>(text.size())).ToLocal(&out);
+}
+
 void assign_error(char** error_out, const std::string& message) {
     if (!error_out) {
         return;
@@ -91,6 +159,12 @@ void shim_free_string(char* value) {
     }
 }
 
+void shim_free_buffer(uint8_t* data) {
+    if (data) {
+        std::free(data);
+    }
+}
+
 char* shim_eval(V8ContextHandle handle, const char* source) {
     char* result = nullptr;
     char* error = nullptr;
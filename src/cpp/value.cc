@@ -0,0 +1,444 @@
+#include "shim_internal.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace pacm_v8 {
+
+namespace {
+
+enum class Payload {
+    kNone,
+    kString,
+    kBytes,
+};
+
+// Fills scalar kinds directly and reports which payload, if any, still has to be attached.
+Payload classify(v8::Isolate* isolate, v8::Local<v8::Value> value, ShimValue& out, const uint8_t*& bytes, std::size_t& byte_length) {
+    out = ShimValue{};
+    if (value.IsEmpty() || value->IsUndefined()) {
+        out.kind = SHIM_VALUE_UNDEFINED;
+        return Payload::kNone;
+    }
+    if (value->IsNull()) {
+        out.kind = SHIM_VALUE_NULL;
+        return Payload::kNone;
+    }
+    if (value->IsBoolean()) {
+        out.kind = SHIM_VALUE_BOOL;
+        out.integer = value->BooleanValue(isolate) ? 1 : 0;
+        return Payload::kNone;
+    }
+    if (value->IsInt32()) {
+        out.kind = SHIM_VALUE_INT32;
+        out.integer = value.As<v8::Int32>()->Value();
+        return Payload::kNone;
+    }
+    if (value->IsNumber()) {
+        out.kind = SHIM_VALUE_DOUBLE;
+        out.number = value.As<v8::Number>()->Value();
+        return Payload::kNone;
+    }
+    if (value->IsBigInt()) {
+        bool lossless = false;
+        int64_t integer = value.As<v8::BigInt>()->Int64Value(&lossless);
+        if (lossless) {
+            out.kind = SHIM_VALUE_BIGINT;
+            out.integer = integer;
+            return Payload::kNone;
+        }
+        out.kind = SHIM_VALUE_STRING;
+        return Payload::kString;
+    }
+    if (value->IsArrayBuffer()) {
+        v8::Local<v8::ArrayBuffer> buffer = value.As<v8::ArrayBuffer>();
+        out.kind = SHIM_VALUE_BYTES;
+        bytes = static_cast<const uint8_t*>(buffer->Data());
+        byte_length = buffer->ByteLength();
+        return Payload::kBytes;
+    }
+    if (value->IsArrayBufferView()) {
+        v8::Local<v8::ArrayBufferView> view = value.As<v8::ArrayBufferView>();
+        out.kind = SHIM_VALUE_BYTES;
+        const auto* base = static_cast<const uint8_t*>(view->Buffer()->Data());
+        bytes = base ? base + view->ByteOffset() : nullptr;
+        byte_length = view->ByteLength();
+        return Payload::kBytes;
+    }
+    out.kind = SHIM_VALUE_STRING;
+    return Payload::kString;
+}
+
+// Keeps serializer output in malloc memory so callers can release it with shim_free_buffer.
+class MallocSerializerDelegate : public v8::ValueSerializer::Delegate {
+public:
+    explicit MallocSerializerDelegate(v8::Isolate* isolate) : isolate_(isolate) {}
+
+    void ThrowDataCloneError(v8::Local<v8::String> message) override {
+        isolate_->ThrowException(v8::Exception::Error(message));
+    }
+
+    void* ReallocateBufferMemory(void* old_buffer, std::size_t size, std::size_t* actual_size) override {
+        void* buffer = std::realloc(old_buffer, size);
+        *actual_size = buffer ? size : 0;
+        return buffer;
+    }
+
+    void FreeBufferMemory(void* buffer) override { std::free(buffer); }
+
+private:
+    v8::Isolate* isolate_;
+};
+
+void release_host_buffer(void*, std::size_t, void* release_token) {
+    ::pacm_v8__buffer_release(release_token);
+}
+
+// Like Utf8Value, stringifies non-strings and swallows a throwing toString.
+bool as_string(v8::Isolate* isolate, v8::Local<v8::Value> value, v8::Local<v8::String>& out) {
+    if (value->IsString()) {
+        out = value.As<v8::String>();
+        return true;
+    }
+    v8::TryCatch try_catch(isolate);
+    return value->ToString(isolate->GetCurrentContext()).ToLocal(&out);
+}
+
+// UTF-8 with lone surrogates replaced, as Utf8Value produces, but into a buffer of the
+// caller's choosing.
+#if V8_MAJOR_VERSION > 13 || (V8_MAJOR_VERSION == 13 && V8_MINOR_VERSION >= 3)
+std::size_t utf8_length(v8::Isolate* isolate, v8::Local<v8::String> string) {
+    return string->Utf8LengthV2(isolate);
+}
+
+std::size_t write_utf8(v8::Isolate* isolate, v8::Local<v8::String> string, char* buffer, std::size_t capacity) {
+    return string->WriteUtf8V2(isolate, buffer, capacity, v8::String::WriteFlags::kReplaceInvalidUtf8);
+}
+#else
+std::size_t utf8_length(v8::Isolate* isolate, v8::Local<v8::String> string) {
+    return static_cast<std::size_t>(string->Utf8Length(isolate));
+}
+
+std::size_t write_utf8(v8::Isolate* isolate, v8::Local<v8::String> string, char* buffer, std::size_t capacity) {
+    int written = string->WriteUtf8(
+        isolate,
+        buffer,
+        static_cast<int>(capacity),
+        nullptr,
+        v8::String::NO_NULL_TERMINATION | v8::String::REPLACE_INVALID_UTF8);
+    return written > 0 ? static_cast<std::size_t>(written) : 0;
+}
+#endif
+
+#if V8_MAJOR_VERSION > 13 || (V8_MAJOR_VERSION == 13 && V8_MINOR_VERSION >= 3)
+void read_units(v8::Isolate* isolate, v8::Local<v8::String> string, uint32_t offset, uint32_t length, uint16_t* buffer) {
+    string->WriteV2(isolate, offset, length, buffer);
+}
+
+void read_one_byte(v8::Isolate* isolate, v8::Local<v8::String> string, uint32_t offset, uint32_t length, uint8_t* buffer) {
+    string->WriteOneByteV2(isolate, offset, length, buffer);
+}
+#else
+void read_units(v8::Isolate* isolate, v8::Local<v8::String> string, uint32_t offset, uint32_t length, uint16_t* buffer) {
+    string->Write(isolate, buffer, static_cast<int>(offset), static_cast<int>(length), v8::String::NO_NULL_TERMINATION);
+}
+
+void read_one_byte(v8::Isolate* isolate, v8::Local<v8::String> string, uint32_t offset, uint32_t length, uint8_t* buffer) {
+    string->WriteOneByte(isolate, buffer, static_cast<int>(offset), static_cast<int>(length), v8::String::NO_NULL_TERMINATION);
+}
+#endif
+
+// Code units read per chunk; the UTF-8 chunk is at most three times as many bytes.
+constexpr uint32_t kOutputChunkUnits = 16 * 1024;
+
+char* encode_utf8(uint32_t code_point, char* out) {
+    if (code_point < 0x80) {
+        *out++ = static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        *out++ = static_cast<char>(0xC0 | (code_point >> 6));
+        *out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        *out++ = static_cast<char>(0xE0 | (code_point >> 12));
+        *out++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+        *out++ = static_cast<char>(0xF0 | (code_point >> 18));
+        *out++ = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+        *out++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+    return out;
+}
+
+// Hands string to the host's output sink as UTF-8, a chunk at a time, so the text is never
+// copied out of the V8 heap as a whole. Lone surrogates become U+FFFD, as in write_utf8.
+bool stream_utf8(v8::Isolate* isolate, v8::Local<v8::String> string, void* sink, std::string& error_out) {
+    if (!::pacm_v8__output_begin(sink, utf8_length(isolate, string))) {
+        error_out = "output sink refused the result";
+        return false;
+    }
+
+    const auto total = static_cast<uint32_t>(string->Length());
+    const bool one_byte = string->IsOneByte();
+    std::vector<uint16_t> units(one_byte ? 0 : kOutputChunkUnits);
+    std::vector<uint8_t> bytes(one_byte ? kOutputChunkUnits : 0);
+    std::vector<char> chunk(static_cast<std::size_t>(kOutputChunkUnits) * 3);
+
+    for (uint32_t offset = 0; offset < total;) {
+        uint32_t count = std::min(kOutputChunkUnits, total - offset);
+        char* out = chunk.data();
+        if (one_byte) {
+            read_one_byte(isolate, string, offset, count, bytes.data());
+            for (uint32_t i = 0; i < count; ++i) {
+                out = encode_utf8(bytes[i], out);
+            }
+        } else {
+            read_units(isolate, string, offset, count, units.data());
+            // A pair split by the chunk boundary is read again with the next chunk.
+            if (count > 1 && offset + count < total && (units[count - 1] & 0xFC00) == 0xD800) {
+                --count;
+            }
+            for (uint32_t i = 0; i < count; ++i) {
+                uint32_t unit = units[i];
+                if ((unit & 0xFC00) == 0xD800 && i + 1 < count && (units[i + 1] & 0xFC00) == 0xDC00) {
+                    unit = 0x10000 + ((unit - 0xD800) << 10) + (units[++i] - 0xDC00);
+                } else if ((unit & 0xF800) == 0xD800) {
+                    unit = 0xFFFD;
+                }
+                out = encode_utf8(unit, out);
+            }
+        }
+        offset += count;
+
+        const auto length = static_cast<std::size_t>(out - chunk.data());
+        if (!::pacm_v8__output_write(sink, chunk.data(), length)) {
+            error_out = "output sink failed";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+v8::Local<v8::Uint8Array> wrap_host_buffer(v8::Isolate* isolate, uint8_t* data, std::size_t length, void* release_token) {
+#ifdef V8_ENABLE_SANDBOX
+    // Sandboxed builds only accept backing stores allocated inside the sandbox, so the
+    // bytes have to be copied and the host buffer can be released right away.
+    std::unique_ptr<v8::BackingStore> store = v8::ArrayBuffer::NewBackingStore(isolate, length);
+    if (length > 0 && data) {
+        std::memcpy(store->Data(), data, length);
+    }
+    ::pacm_v8__buffer_release(release_token);
+#else
+    std::unique_ptr<v8::BackingStore> store = v8::ArrayBuffer::NewBackingStore(data, length, release_host_buffer, release_token);
+#endif
+    v8::Local<v8::ArrayBuffer> buffer = v8::ArrayBuffer::New(isolate, std::move(store));
+    return v8::Uint8Array::New(buffer, 0, length);
+}
+
+void to_shim_value_borrowed(v8::Isolate* isolate, v8::Local<v8::Value> value, ShimValue& out, ScratchArena& scratch) {
+    const uint8_t* bytes = nullptr;
+    std::size_t byte_length = 0;
+    switch (classify(isolate, value, out, bytes, byte_length)) {
+    case Payload::kNone:
+        return;
+    case Payload::kBytes:
+        out.data = bytes;
+        out.length = bytes ? byte_length : 0;
+        return;
+    case Payload::kString: {
+        v8::Local<v8::String> string;
+        if (!as_string(isolate, value, string)) {
+            return;
+        }
+        std::size_t length = utf8_length(isolate, string);
+        auto* buffer = static_cast<char*>(scratch.allocate(length, 1));
+        out.length = write_utf8(isolate, string, buffer, length);
+        out.data = reinterpret_cast<const uint8_t*>(buffer);
+        return;
+    }
+    }
+}
+
+bool to_shim_value_owned(v8::Isolate* isolate, v8::Local<v8::Value> value, ShimValue& out) {
+    const uint8_t* bytes = nullptr;
+    std::size_t byte_length = 0;
+    switch (classify(isolate, value, out, bytes, byte_length)) {
+    case Payload::kNone:
+        return true;
+    case Payload::kBytes:
+        out.length = bytes ? byte_length : 0;
+        out.data = copy_bytes(bytes, out.length);
+        return out.data != nullptr;
+    case Payload::kString: {
+        // Written straight into the result allocation instead of through a Utf8Value copy.
+        v8::Local<v8::String> string;
+        std::size_t length = as_string(isolate, value, string) ? utf8_length(isolate, string) : 0;
+        auto* buffer = static_cast<uint8_t*>(std::malloc(length > 0 ? length : 1));
+        if (!buffer) {
+            return false;
+        }
+        out.length = length > 0 ? write_utf8(isolate, string, reinterpret_cast<char*>(buffer), length) : 0;
+        out.data = buffer;
+        return true;
+    }
+    }
+    return false;
+}
+
+bool from_shim_value(v8::Isolate* isolate, const ShimValue& value, v8::Local<v8::Value>& out) {
+    switch (value.kind) {
+    case SHIM_VALUE_UNDEFINED:
+        out = v8::Undefined(isolate);
+        return true;
+    case SHIM_VALUE_NULL:
+        out = v8::Null(isolate);
+        return true;
+    case SHIM_VALUE_BOOL:
+        out = v8::Boolean::New(isolate, value.integer != 0);
+        return true;
+    case SHIM_VALUE_INT32:
+        out = v8::Integer::New(isolate, static_cast<int32_t>(value.integer));
+        return true;
+    case SHIM_VALUE_DOUBLE:
+        out = v8::Number::New(isolate, value.number);
+        return true;
+    case SHIM_VALUE_BIGINT:
+        out = v8::BigInt::New(isolate, value.integer);
+        return true;
+    case SHIM_VALUE_STRING: {
+        if (value.length > static_cast<std::size_t>(v8::String::kMaxLength)) {
+            return false;
+        }
+        v8::Local<v8::String> string;
+        if (!v8::String::NewFromUtf8(
+                 isolate,
+                 reinterpret_cast<const char*>(value.data ? value.data : reinterpret_cast<const uint8_t*>("")),
+                 v8::NewStringType::kNormal,
+                 static_cast<int>(value.length))
+                 .ToLocal(&string)) {
+            return false;
+        }
+        out = string;
+        return true;
+    }
+    case SHIM_VALUE_BYTES: {
+        std::unique_ptr<v8::BackingStore> store = v8::ArrayBuffer::NewBackingStore(isolate, value.length);
+        if (value.length > 0 && value.data) {
+            std::memcpy(store->Data(), value.data, value.length);
+        }
+        v8::Local<v8::ArrayBuffer> buffer = v8::ArrayBuffer::New(isolate, std::move(store));
+        out = v8::Uint8Array::New(buffer, 0, value.length);
+        return true;
+    }
+    case SHIM_VALUE_EXTERNAL_BYTES:
+        out = wrap_host_buffer(
+            isolate,
+            const_cast<uint8_t*>(value.data),
+            value.length,
+            reinterpret_cast<void*>(static_cast<intptr_t>(value.integer)));
+        return true;
+    case SHIM_VALUE_SERIALIZED: {
+        v8::Local<v8::Context> ctx = isolate->GetCurrentContext();
+        if (ctx.IsEmpty() || !value.data) {
+            return false;
+        }
+        v8::ValueDeserializer deserializer(isolate, value.data, value.length);
+        return deserializer.ReadHeader(ctx).FromMaybe(false) && deserializer.ReadValue(ctx).ToLocal(&out);
+    }
+    default:
+        return false;
+    }
+}
+
+bool serialize_value(
+    v8::Isolate* isolate,
+    v8::Local<v8::Context> ctx,
+    v8::Local<v8::Value> value,
+    v8::TryCatch& try_catch,
+    uint8_t*& data_out,
+    std::size_t& length_out,
+    std::string& error_out) {
+    MallocSerializerDelegate delegate(isolate);
+    v8::ValueSerializer serializer(isolate, &delegate);
+    serializer.WriteHeader();
+    if (!serializer.WriteValue(ctx, value).FromMaybe(false)) {
+        if (!capture_exception(isolate, try_catch, error_out)) {
+            error_out = "failed to serialize value";
+        }
+        return false;
+    }
+    std::pair<uint8_t*, std::size_t> buffer = serializer.Release();
+    data_out = buffer.first;
+    length_out = buffer.second;
+    return true;
+}
+
+void ResultOut::reset() const {
+    if (value) {
+        *value = ShimValue{};
+    }
+    if (data) {
+        *data = nullptr;
+    }
+    if (length) {
+        *length = 0;
+    }
+}
+
+bool ResultOut::assign(
+    v8::Isolate* isolate,
+    v8::Local<v8::Context> ctx,
+    v8::Local<v8::Value> result,
+    v8::TryCatch& try_catch,
+    std::string& error_out) const {
+    if (data) {
+        uint8_t* buffer = nullptr;
+        std::size_t buffer_length = 0;
+        if (!serialize_value(isolate, ctx, result, try_catch, buffer, buffer_length, error_out)) {
+            return false;
+        }
+        *data = buffer;
+        if (length) {
+            *length = buffer_length;
+        }
+        return true;
+    }
+    if (sink) {
+        v8::Local<v8::String> text;
+        if (output_flags & SHIM_OUTPUT_JSON) {
+            if (!v8::JSON::Stringify(ctx, result).ToLocal(&text)) {
+                if (!capture_exception(isolate, try_catch, error_out)) {
+                    error_out = "failed to stringify result";
+                }
+                return false;
+            }
+        } else if (!as_string(isolate, result, text)) {
+            text = v8::String::Empty(isolate);
+        }
+        return stream_utf8(isolate, text, sink, error_out);
+    }
+    if (value && !to_shim_value_owned(isolate, result, *value)) {
+        error_out = "failed to allocate result buffer";
+        return false;
+    }
+    return true;
+}
+
+} // namespace pacm_v8
+
+extern "C" {
+
+void shim_value_release(ShimValue* value) {
+    if (!value) {
+        return;
+    }
+    if ((value->kind == SHIM_VALUE_STRING || value->kind == SHIM_VALUE_BYTES) && value->data) {
+        std::free(const_cast<uint8_t*>(value->data));
+    }
+    *value = ShimValue{};
+}
+
+} // extern "C"
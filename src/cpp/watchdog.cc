@@ -0,0 +1,330 @@
+#include "shim_internal.h"
+
+#include <condition_variable>
+#include <limits>
+#include <list>
+#include <thread>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#include <pthread.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+namespace pacm_v8 {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Leaves headroom in Clock's nanosecond range for the watchdog's tick arithmetic.
+constexpr uint64_t kMaxTimeoutMs =
+    static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::nanoseconds::max()).count() / 4);
+
+#if defined(_WIN32)
+using NativeThread = HANDLE;
+#elif defined(__APPLE__)
+using NativeThread = mach_port_t;
+#else
+using NativeThread = clockid_t;
+#endif
+
+// Nanoseconds of user and system time, or 0 if the platform cannot tell.
+uint64_t thread_cpu_ns(NativeThread thread) {
+#if defined(_WIN32)
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(thread, &creation, &exit, &kernel, &user)) {
+        return 0;
+    }
+    auto ticks = [](const FILETIME& time) {
+        return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return (ticks(kernel) + ticks(user)) * 100;
+#elif defined(__APPLE__)
+    thread_basic_info_data_t info;
+    mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+    if (thread_info(thread, THREAD_BASIC_INFO, reinterpret_cast<thread_info_t>(&info), &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    auto nanos = [](const time_value_t& time) {
+        return static_cast<uint64_t>(time.seconds) * 1000000000ull + static_cast<uint64_t>(time.microseconds) * 1000ull;
+    };
+    return nanos(info.user_time) + nanos(info.system_time);
+#else
+    timespec spec{};
+    if (clock_gettime(thread, &spec) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(spec.tv_sec) * 1000000000ull + static_cast<uint64_t>(spec.tv_nsec);
+#endif
+}
+
+uint64_t current_thread_cpu_ns() {
+#if defined(_WIN32)
+    return thread_cpu_ns(GetCurrentThread());
+#elif defined(__APPLE__)
+    return thread_cpu_ns(pthread_mach_thread_np(pthread_self()));
+#else
+    return thread_cpu_ns(CLOCK_THREAD_CPUTIME_ID);
+#endif
+}
+
+// Handle to the calling thread's CPU clock that stays valid on the watchdog thread.
+class ThreadCpuClock {
+public:
+    static ThreadCpuClock current() {
+        ThreadCpuClock clock;
+#if defined(_WIN32)
+        clock.thread_ = OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, GetCurrentThreadId());
+        clock.valid_ = clock.thread_ != nullptr;
+#elif defined(__APPLE__)
+        clock.thread_ = pthread_mach_thread_np(pthread_self());
+        clock.valid_ = clock.thread_ != MACH_PORT_NULL;
+#else
+        clock.valid_ = pthread_getcpuclockid(pthread_self(), &clock.thread_) == 0;
+#endif
+        return clock;
+    }
+
+    ThreadCpuClock() = default;
+    ThreadCpuClock(const ThreadCpuClock&) = delete;
+    ThreadCpuClock& operator=(const ThreadCpuClock&) = delete;
+    ThreadCpuClock(ThreadCpuClock&& other) noexcept : thread_(other.thread_), valid_(other.valid_) {
+        other.valid_ = false;
+    }
+    ThreadCpuClock& operator=(ThreadCpuClock&&) = delete;
+    ~ThreadCpuClock() {
+#if defined(_WIN32)
+        if (valid_) {
+            CloseHandle(thread_);
+        }
+#endif
+    }
+
+    uint64_t now_ns() const { return valid_ ? thread_cpu_ns(thread_) : 0; }
+
+private:
+    NativeThread thread_{};
+    bool valid_ = false;
+};
+
+// One thread for every armed deadline. Wall-clock deadlines live in a timer wheel of
+// kSlots buckets of kTick each; CPU budgets cannot be scheduled ahead of time and are
+// polled on every tick instead.
+class Watchdog {
+public:
+    static Watchdog& instance() {
+        // Leaked on purpose: the thread may still be parked when static destructors run.
+        static Watchdog* watchdog = new Watchdog();
+        return *watchdog;
+    }
+
+    uint64_t arm_deadline(IsolateWrapper* isolate, Clock::time_point deadline) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        start_locked();
+        const uint64_t tick = std::max(tick_of(deadline), current_tick_ + 1);
+        const uint64_t id = next_id_++;
+        auto& slot = slots_[tick % kSlots];
+        slot.push_front(Timer{id, isolate, tick});
+        deadlines_.emplace(id, std::make_pair(tick % kSlots, slot.begin()));
+        wake_.notify_one();
+        return id;
+    }
+
+    uint64_t arm_cpu_budget(IsolateWrapper* isolate, uint64_t limit_ns) {
+        ThreadCpuClock clock = ThreadCpuClock::current();
+        std::lock_guard<std::mutex> lock(mutex_);
+        start_locked();
+        const uint64_t id = next_id_++;
+        cpu_timers_.emplace(id, CpuTimer{isolate, std::move(clock), limit_ns});
+        wake_.notify_one();
+        return id;
+    }
+
+    void disarm(uint64_t id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto deadline = deadlines_.find(id);
+        if (deadline != deadlines_.end()) {
+            slots_[deadline->second.first].erase(deadline->second.second);
+            deadlines_.erase(deadline);
+            return;
+        }
+        cpu_timers_.erase(id);
+    }
+
+private:
+    static constexpr std::chrono::milliseconds kTick{5};
+    static constexpr std::size_t kSlots = 512;
+
+    struct Timer {
+        uint64_t id;
+        IsolateWrapper* isolate;
+        uint64_t tick;
+    };
+
+    struct CpuTimer {
+        IsolateWrapper* isolate;
+        ThreadCpuClock clock;
+        uint64_t limit_ns;
+    };
+
+    Watchdog() : epoch_(Clock::now()), slots_(kSlots) {}
+
+    uint64_t tick_of(Clock::time_point time) const {
+        if (time <= epoch_) {
+            return 0;
+        }
+        // Round up so a deadline never fires early.
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(time - epoch_);
+        auto tick = std::chrono::duration_cast<std::chrono::nanoseconds>(kTick);
+        return static_cast<uint64_t>((elapsed.count() + tick.count() - 1) / tick.count());
+    }
+
+    bool idle_locked() const { return deadlines_.empty() && cpu_timers_.empty(); }
+
+    void start_locked() {
+        if (idle_locked()) {
+            // Nothing was pending, so there is nothing to fire between the old tick and now.
+            current_tick_ = std::max(current_tick_, tick_of(Clock::now()));
+        }
+        if (!started_) {
+            started_ = true;
+            std::thread([this] { run(); }).detach();
+        }
+    }
+
+    static void terminate(IsolateWrapper* isolate, TerminationReason reason) {
+        int expected = static_cast<int>(TerminationReason::kNone);
+        isolate->termination_reason.compare_exchange_strong(expected, static_cast<int>(reason));
+        isolate->isolate->TerminateExecution();
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            if (idle_locked()) {
+                wake_.wait(lock);
+                continue;
+            }
+            wake_.wait_until(lock, epoch_ + kTick * (current_tick_ + 1));
+
+            const uint64_t now = tick_of(Clock::now());
+            while (current_tick_ < now && !deadlines_.empty()) {
+                ++current_tick_;
+                auto& slot = slots_[current_tick_ % kSlots];
+                for (auto timer = slot.begin(); timer != slot.end();) {
+                    if (timer->tick > current_tick_) {
+                        ++timer;
+                        continue;
+                    }
+                    terminate(timer->isolate, TerminationReason::kTimeout);
+                    deadlines_.erase(timer->id);
+                    timer = slot.erase(timer);
+                }
+            }
+            current_tick_ = std::max(current_tick_, now);
+
+            for (auto timer = cpu_timers_.begin(); timer != cpu_timers_.end();) {
+                const uint64_t used = timer->second.clock.now_ns();
+                if (used != 0 && used >= timer->second.limit_ns) {
+                    terminate(timer->second.isolate, TerminationReason::kCpuBudget);
+                    timer = cpu_timers_.erase(timer);
+                } else {
+                    ++timer;
+                }
+            }
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    const Clock::time_point epoch_;
+    std::vector<std::list<Timer>> slots_;
+    std::unordered_map<uint64_t, std::pair<std::size_t, std::list<Timer>::iterator>> deadlines_;
+    std::unordered_map<uint64_t, CpuTimer> cpu_timers_;
+    uint64_t current_tick_ = 0;
+    uint64_t next_id_ = 1;
+    bool started_ = false;
+};
+
+} // namespace
+
+ExecutionGuard::ExecutionGuard(IsolateWrapper* isolate, ContextWrapper* context)
+    : isolate_(isolate), context_(context) {
+    if (!isolate_ || isolate_->execution_depth++ > 0 || !context_) {
+        return;
+    }
+    outermost_ = true;
+
+    if (isolate_->poisoned.load()) {
+        refusal_ = SHIM_STATUS_HEAP_LIMIT;
+        return;
+    }
+    if (context_->cpu_budget_ns > 0) {
+        if (context_->cpu_used_ns >= context_->cpu_budget_ns) {
+            refusal_ = SHIM_STATUS_CPU_BUDGET;
+            return;
+        }
+        cpu_start_ns_ = current_thread_cpu_ns();
+        if (cpu_start_ns_ != 0) {
+            const uint64_t remaining = context_->cpu_budget_ns - context_->cpu_used_ns;
+            const uint64_t limit_ns = remaining > std::numeric_limits<uint64_t>::max() - cpu_start_ns_
+                ? std::numeric_limits<uint64_t>::max()
+                : cpu_start_ns_ + remaining;
+            cpu_timer_ = Watchdog::instance().arm_cpu_budget(isolate_, limit_ns);
+        }
+    }
+    // A timeout beyond what the steady clock can represent never fires, so it is not armed.
+    if (context_->timeout_ms > 0 && context_->timeout_ms <= kMaxTimeoutMs) {
+        deadline_timer_ = Watchdog::instance().arm_deadline(isolate_, Clock::now() + std::chrono::milliseconds(context_->timeout_ms));
+    }
+}
+
+ExecutionGuard::~ExecutionGuard() {
+    if (!isolate_) {
+        return;
+    }
+    --isolate_->execution_depth;
+    if (!outermost_) {
+        return;
+    }
+
+    if (deadline_timer_) {
+        Watchdog::instance().disarm(deadline_timer_);
+    }
+    if (cpu_timer_) {
+        Watchdog::instance().disarm(cpu_timer_);
+    }
+    if (cpu_start_ns_ != 0) {
+        const uint64_t end = current_thread_cpu_ns();
+        if (end > cpu_start_ns_) {
+            context_->cpu_used_ns += end - cpu_start_ns_;
+        }
+    }
+
+    // A timer may have fired after the script finished; its termination must not leak
+    // into the next call.
+    if (isolate_->termination_reason.exchange(static_cast<int>(TerminationReason::kNone)) != static_cast<int>(TerminationReason::kNone)) {
+        isolate_->isolate->CancelTerminateExecution();
+    }
+}
+
+const char* ExecutionGuard::refusal_message() const {
+    return refusal_ == SHIM_STATUS_HEAP_LIMIT
+        ? "isolate reached its heap limit and must be recycled"
+        : "CPU budget exhausted";
+}
+
+int ExecutionGuard::reject(char** error_out) const {
+    assign_error(error_out, refusal_message());
+    return refusal_;
+}
+
+} // namespace pacm_v8
@@ -1,20 +1,56 @@
 use std::fmt;
 
+/// Why an operation failed, for errors that callers may want to handle differently.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum ErrorKind {
+    #[default]
+    Other,
+    /// The isolate neared its heap limit and the running script was terminated.
+    HeapLimit,
+    /// The call ran past the context's timeout.
+    Timeout,
+    /// The context used up its CPU budget.
+    CpuBudget,
+}
+
 #[derive(Debug, Clone, PartialEq, Eq)]
 pub struct V8Error {
     message: String,
+    kind: ErrorKind,
 }
 
 impl V8Error {
     pub fn new(message: impl Into<String>) -> Self {
         Self {
             message: message.into(),
+            kind: ErrorKind::Other,
         }
     }
 
+    pub(crate) fn with_kind(mut self, kind: ErrorKind) -> Self {
+        self.kind = kind;
+        self
+    }
+
     pub fn message(&self) -> &str {
         &self.message
     }
+
+    pub fn kind(&self) -> ErrorKind {
+        self.kind
+    }
+
+    pub fn is_heap_limit(&self) -> bool {
+        self.kind == ErrorKind::HeapLimit
+    }
+
+    pub fn is_timeout(&self) -> bool {
+        self.kind == ErrorKind::Timeout
+    }
+
+    pub fn is_cpu_budget(&self) -> bool {
+        self.kind == ErrorKind::CpuBudget
+    }
 }
 
 impl fmt::Display for V8Error {
@@ -0,0 +1,549 @@
+use std::cell::UnsafeCell;
+use std::collections::HashMap;
+use std::future::Future;
+use std::os::raw::c_char;
+use std::panic::{self, AssertUnwindSafe};
+use std::pin::Pin;
+use std::ptr;
+use std::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering, fence};
+use std::sync::{Arc, Condvar, Mutex};
+use std::task::{Context as TaskContext, Poll, Waker};
+use std::thread::{self, JoinHandle};
+
+use crate::error::{Result, V8Error};
+use crate::ffi::{V8IsolateHandle, shim_isolate_lock, shim_isolate_unlock};
+use crate::isolate::IsolateBuilder;
+use crate::queue::{JobQueue, RunQueue};
+use crate::support::take_error;
+use crate::value::JsValue;
+use crate::{Context, Isolate};
+
+// Jobs run per isolate before it goes back to a run queue, so one busy isolate cannot
+// starve the others on its worker.
+const JOBS_PER_TURN: usize = 32;
+
+type Job = Box<dyn FnOnce(&mut IsolateState) + Send>;
+
+/// Identifies a context created through [`Executor::create_context`].
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub struct ContextKey {
+    isolate: usize,
+    id: u64,
+}
+
+impl ContextKey {
+    pub fn isolate(&self) -> usize {
+        self.isolate
+    }
+}
+
+pub struct ExecutorBuilder {
+    workers: usize,
+    isolates: usize,
+    isolate: IsolateBuilder,
+}
+
+impl ExecutorBuilder {
+    pub fn workers(mut self, workers: usize) -> Self {
+        self.workers = workers.max(1);
+        self
+    }
+
+    pub fn isolates(mut self, isolates: usize) -> Self {
+        self.isolates = isolates.max(1);
+        self
+    }
+
+    /// Heap limits, snapshot and other options for every isolate of the executor.
+    pub fn isolate(mut self, isolate: IsolateBuilder) -> Self {
+        self.isolate = isolate;
+        self
+    }
+
+    pub fn build(self) -> Result<Executor> {
+        let mut slots = Vec::with_capacity(self.isolates);
+        for index in 0..self.isolates {
+            slots.push(IsolateSlot {
+                jobs: JobQueue::new(),
+                scheduled: AtomicBool::new(false),
+                home: index % self.workers,
+                state: UnsafeCell::new(IsolateState {
+                    contexts: HashMap::new(),
+                    isolate: self.isolate.build()?,
+                }),
+            });
+        }
+
+        let inner = Arc::new(Inner {
+            slots: slots.into_boxed_slice(),
+            run_queues: (0..self.workers)
+                .map(|_| RunQueue::with_capacity(self.isolates))
+                .collect(),
+            parking: Mutex::new(()),
+            unparked: Condvar::new(),
+            sleepers: AtomicUsize::new(0),
+            shutdown: AtomicBool::new(false),
+            next_context: AtomicU64::new(1),
+        });
+
+        let mut workers = Vec::with_capacity(self.workers);
+        for worker in 0..self.workers {
+            let inner = Arc::clone(&inner);
+            let handle = thread::Builder::new()
+                .name(format!("pacm-v8-worker-{worker}"))
+                .spawn(move || inner.run_worker(worker))
+                .map_err(|err| V8Error::new(err.to_string()))?;
+            workers.push(handle);
+        }
+
+        Ok(Executor { inner, workers })
+    }
+}
+
+/// A fixed set of worker threads running JavaScript on a fixed set of isolates.
+///
+/// Every job is pinned to one isolate and queued on it through a lock-free queue; jobs of an
+/// isolate run in submission order. Isolates with pending jobs sit in their home worker's
+/// run queue, and idle workers steal them from other workers. A worker holds the isolate's
+/// `v8::Locker` while it runs a turn of its jobs, so an isolate only ever runs on one
+/// thread at a time.
+pub struct Executor {
+    inner: Arc<Inner>,
+    workers: Vec<JoinHandle<()>>,
+}
+
+impl Executor {
+    pub fn builder() -> ExecutorBuilder {
+        let workers = thread::available_parallelism().map_or(1, usize::from);
+        ExecutorBuilder {
+            workers,
+            isolates: workers,
+            isolate: IsolateBuilder::default(),
+        }
+    }
+
+    pub fn isolate_count(&self) -> usize {
+        self.inner.slots.len()
+    }
+
+    pub fn worker_count(&self) -> usize {
+        self.workers.len()
+    }
+
+    pub fn create_context(&self, isolate: usize) -> Result<JobHandle<ContextKey>> {
+        let id = self.inner.next_context.fetch_add(1, Ordering::Relaxed);
+        self.submit(isolate, move |state| {
+            let context = state.isolate.create_context()?;
+            state.contexts.insert(id, context);
+            Ok(ContextKey { isolate, id })
+        })
+    }
+
+    pub fn dispose_context(&self, key: ContextKey) -> Result<JobHandle<()>> {
+        self.submit(key.isolate, move |state| {
+            state.contexts.remove(&key.id);
+            Ok(())
+        })
+    }
+
+    /// Runs `job` on the isolate that owns `key`, with its context.
+    pub fn run<F, T>(&self, key: ContextKey, job: F) -> Result<JobHandle<T>>
+    where
+        F: FnOnce(&mut Context) -> Result<T> + Send + 'static,
+        T: Send + 'static,
+    {
+        self.submit(key.isolate, move |state| {
+            match state.contexts.get_mut(&key.id) {
+                Some(context) => job(context),
+                None => Err(V8Error::new("context was disposed")),
+            }
+        })
+    }
+
+    /// Runs `job` on `isolate` without a context, e.g. to compile scripts.
+    pub fn run_on_isolate<F, T>(&self, isolate: usize, job: F) -> Result<JobHandle<T>>
+    where
+        F: FnOnce(&Isolate) -> Result<T> + Send + 'static,
+        T: Send + 'static,
+    {
+        self.submit(isolate, move |state| job(&state.isolate))
+    }
+
+    pub fn eval(&self, key: ContextKey, source: impl Into<String>) -> Result<JobHandle<JsValue>> {
+        let source = source.into();
+        self.run(key, move |context| context.eval(&source))
+    }
+
+    pub fn call(
+        &self,
+        key: ContextKey,
+        fn_name: impl Into<String>,
+        args: Vec<JsValue>,
+    ) -> Result<JobHandle<JsValue>> {
+        let fn_name = fn_name.into();
+        self.run(key, move |context| {
+            context.call_function_values(&fn_name, &args)
+        })
+    }
+
+    fn submit<F, T>(&self, isolate: usize, job: F) -> Result<JobHandle<T>>
+    where
+        F: FnOnce(&mut IsolateState) -> Result<T> + Send + 'static,
+        T: Send + 'static,
+    {
+        if isolate >= self.inner.slots.len() {
+            return Err(V8Error::new("isolate index out of range"));
+        }
+        if self.inner.shutdown.load(Ordering::Acquire) {
+            return Err(V8Error::new("executor was shut down"));
+        }
+
+        let (completer, handle) = JobHandle::pair();
+        self.inner.slots[isolate].jobs.push(Box::new(move |state| {
+            let result = panic::catch_unwind(AssertUnwindSafe(|| job(state)))
+                .unwrap_or_else(|_| Err(V8Error::new("executor job panicked")));
+            completer.complete(result);
+        }));
+        self.inner.schedule(isolate, self.inner.slots[isolate].home);
+        Ok(handle)
+    }
+}
+
+impl Drop for Executor {
+    fn drop(&mut self) {
+        self.inner.shutdown.store(true, Ordering::Release);
+        {
+            let _parking = self
+                .inner
+                .parking
+                .lock()
+                .unwrap_or_else(|err| err.into_inner());
+            self.inner.unparked.notify_all();
+        }
+        for worker in self.workers.drain(..) {
+            let _ = worker.join();
+        }
+
+        // Workers are gone; tear the isolates down here, contexts first.
+        for slot in self.inner.slots.iter() {
+            let state = unsafe { &mut *slot.state.get() };
+            if state.contexts.is_empty() {
+                continue;
+            }
+            if let Ok(_lock) = IsolateLock::acquire(&state.isolate) {
+                state.contexts.clear();
+            }
+        }
+    }
+}
+
+/// Completion of a job submitted to an [`Executor`].
+///
+/// Await it from async code or block on it with [`JobHandle::wait`].
+pub struct JobHandle<T> {
+    shared: Arc<JobShared<T>>,
+}
+
+struct JobShared<T> {
+    state: Mutex<JobState<T>>,
+    finished: Condvar,
+}
+
+struct JobState<T> {
+    result: Option<Result<T>>,
+    waker: Option<Waker>,
+}
+
+impl<T> JobHandle<T> {
+    fn pair() -> (Completer<T>, Self) {
+        let shared = Arc::new(JobShared {
+            state: Mutex::new(JobState {
+                result: None,
+                waker: None,
+            }),
+            finished: Condvar::new(),
+        });
+        (
+            Completer {
+                shared: Some(Arc::clone(&shared)),
+            },
+            Self { shared },
+        )
+    }
+
+    pub fn wait(self) -> Result<T> {
+        let mut state = self
+            .shared
+            .state
+            .lock()
+            .unwrap_or_else(|err| err.into_inner());
+        loop {
+            if let Some(result) = state.result.take() {
+                return result;
+            }
+            state = self
+                .shared
+                .finished
+                .wait(state)
+                .unwrap_or_else(|err| err.into_inner());
+        }
+    }
+}
+
+impl<T> Future for JobHandle<T> {
+    type Output = Result<T>;
+
+    fn poll(self: Pin<&mut Self>, cx: &mut TaskContext<'_>) -> Poll<Self::Output> {
+        let mut state = self
+            .shared
+            .state
+            .lock()
+            .unwrap_or_else(|err| err.into_inner());
+        match state.result.take() {
+            Some(result) => Poll::Ready(result),
+            None => {
+                state.waker = Some(cx.waker().clone());
+                Poll::Pending
+            }
+        }
+    }
+}
+
+// Resolves the handle with an error if the job is dropped unrun, e.g. on shutdown.
+struct Completer<T> {
+    shared: Option<Arc<JobShared<T>>>,
+}
+
+impl<T> Completer<T> {
+    fn complete(mut self, result: Result<T>) {
+        if let Some(shared) = self.shared.take() {
+            Self::resolve(&shared, result);
+        }
+    }
+
+    fn resolve(shared: &JobShared<T>, result: Result<T>) {
+        let waker = {
+            let mut state = shared.state.lock().unwrap_or_else(|err| err.into_inner());
+            state.result = Some(result);
+            state.waker.take()
+        };
+        shared.finished.notify_all();
+        if let Some(waker) = waker {
+            waker.wake();
+        }
+    }
+}
+
+impl<T> Drop for Completer<T> {
+    fn drop(&mut self) {
+        if let Some(shared) = self.shared.take() {
+            Self::resolve(&shared, Err(V8Error::new("executor was shut down")));
+        }
+    }
+}
+
+struct IsolateState {
+    // Declared first so contexts are disposed before their isolate.
+    contexts: HashMap<u64, Context>,
+    isolate: Isolate,
+}
+
+struct IsolateSlot {
+    jobs: JobQueue<Job>,
+    // Set while the isolate sits in a run queue or is being run; whoever flips it from
+    // false to true owns the right to schedule it, and only the worker running it touches
+    // `state` or pops `jobs`.
+    scheduled: AtomicBool,
+    home: usize,
+    state: UnsafeCell<IsolateState>,
+}
+
+unsafe impl Send for IsolateSlot {}
+unsafe impl Sync for IsolateSlot {}
+
+struct Inner {
+    slots: Box<[IsolateSlot]>,
+    run_queues: Box<[RunQueue]>,
+    parking: Mutex<()>,
+    unparked: Condvar,
+    sleepers: AtomicUsize,
+    shutdown: AtomicBool,
+    next_context: AtomicU64,
+}
+
+impl Inner {
+    fn schedule(&self, isolate: usize, worker: usize) {
+        if self.slots[isolate].scheduled.swap(true, Ordering::SeqCst) {
+            return;
+        }
+        self.enqueue(isolate, worker);
+    }
+
+    fn enqueue(&self, isolate: usize, worker: usize) {
+        let pushed = self.run_queues[worker].push(isolate);
+        debug_assert!(pushed, "run queues are sized for every isolate");
+        fence(Ordering::SeqCst);
+        if self.sleepers.load(Ordering::SeqCst) > 0 {
+            let _parking = self.parking.lock().unwrap_or_else(|err| err.into_inner());
+            self.unparked.notify_one();
+        }
+    }
+
+    fn find_work(&self, worker: usize) -> Option<usize> {
+        let count = self.run_queues.len();
+        (0..count).find_map(|offset| self.run_queues[(worker + offset) % count].pop())
+    }
+
+    fn run_worker(&self, worker: usize) {
+        loop {
+            if let Some(isolate) = self.find_work(worker) {
+                self.run_turn(isolate, worker);
+                continue;
+            }
+            if self.shutdown.load(Ordering::Acquire) {
+                return;
+            }
+
+            let parking = self.parking.lock().unwrap_or_else(|err| err.into_inner());
+            self.sleepers.fetch_add(1, Ordering::SeqCst);
+            if let Some(isolate) = self.find_work(worker) {
+                self.sleepers.fetch_sub(1, Ordering::SeqCst);
+                drop(parking);
+                self.run_turn(isolate, worker);
+                continue;
+            }
+            if self.shutdown.load(Ordering::Acquire) {
+                self.sleepers.fetch_sub(1, Ordering::SeqCst);
+                return;
+            }
+            let parking = self
+                .unparked
+                .wait(parking)
+                .unwrap_or_else(|err| err.into_inner());
+            self.sleepers.fetch_sub(1, Ordering::SeqCst);
+            drop(parking);
+        }
+    }
+
+    fn run_turn(&self, isolate: usize, worker: usize) {
+        let slot = &self.slots[isolate];
+        // Safety: the scheduled flag makes this worker the only one touching the slot.
+        let state = unsafe { &mut *slot.state.get() };
+
+        match IsolateLock::acquire(&state.isolate) {
+            Ok(_lock) => {
+                let mut ran = 0;
+                while ran < JOBS_PER_TURN {
+                    match unsafe { slot.jobs.pop() } {
+                        Some(job) => {
+                            job(state);
+                            ran += 1;
+                        }
+                        None if slot.jobs.is_empty() => break,
+                        // A producer is between swapping the head and linking its node.
+                        None => std::hint::spin_loop(),
+                    }
+                }
+            }
+            Err(_) => {
+                // Dropping the jobs resolves their handles with an error.
+                while unsafe { slot.jobs.pop() }.is_some() {}
+            }
+        }
+
+        if !slot.jobs.is_empty() {
+            self.enqueue(isolate, worker);
+            return;
+        }
+        slot.scheduled.store(false, Ordering::SeqCst);
+        if !slot.jobs.is_empty() {
+            self.schedule(isolate, worker);
+        }
+    }
+}
+
+// Holds the isolate's v8::Locker; keeps only the raw handle so the isolate's state stays
+// mutably borrowable by the jobs run under the lock.
+struct IsolateLock {
+    handle: V8IsolateHandle,
+}
+
+impl IsolateLock {
+    fn acquire(isolate: &Isolate) -> Result<Self> {
+        let handle = isolate.raw_handle();
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status = unsafe { shim_isolate_lock(handle, &mut error_ptr) };
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to lock isolate") });
+        }
+        Ok(Self { handle })
+    }
+}
+
+impl Drop for IsolateLock {
+    fn drop(&mut self) {
+        unsafe { shim_isolate_unlock(self.handle) };
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    use std::sync::mpsc;
+    use std::time::Duration;
+
+    #[test]
+    fn jobs_dropped_unrun_resolve_their_handles() {
+        let queue: JobQueue<Job> = JobQueue::new();
+        let handles: Vec<JobHandle<()>> = (0..8)
+            .map(|_| {
+                let (completer, handle) = JobHandle::pair();
+                queue.push(Box::new(move |_| completer.complete(Ok(()))));
+                handle
+            })
+            .collect();
+        drop(queue);
+
+        for handle in handles {
+            let error = handle.wait().unwrap_err();
+            assert_eq!(error.message(), "executor was shut down");
+        }
+    }
+
+    // Dropping the executor while an isolate is busy and more jobs wait behind it: the
+    // workers drain what was queued before they exit, every isolate of the executor.
+    #[test]
+    fn shutdown_finishes_jobs_already_queued() {
+        let executor = Executor::builder().workers(2).isolates(3).build().unwrap();
+        let (started_tx, started_rx) = mpsc::channel();
+        let (release_tx, release_rx) = mpsc::channel::<()>();
+        let blocker = executor
+            .run_on_isolate(0, move |_| {
+                started_tx.send(()).unwrap();
+                release_rx.recv().unwrap();
+                Ok(())
+            })
+            .unwrap();
+        started_rx.recv().unwrap();
+
+        let queued: Vec<_> = (0..300)
+            .map(|index| {
+                executor
+                    .run_on_isolate(index % 3, move |_| Ok(index))
+                    .unwrap()
+            })
+            .collect();
+
+        let dropper = thread::spawn(move || drop(executor));
+        // Let the drop raise the shutdown flag while isolate 0 is still blocked.
+        thread::sleep(Duration::from_millis(20));
+        release_tx.send(()).unwrap();
+        dropper.join().unwrap();
+
+        blocker.wait().unwrap();
+        for (index, handle) in queued.into_iter().enumerate() {
+            assert_eq!(handle.wait().unwrap(), index);
+        }
+    }
+}
@@ -3,34 +3,399 @@ use std::os::raw::{c_char, c_double};
 pub type V8IsolateHandle = *mut std::ffi::c_void;
 pub type V8ContextHandle = *mut std::ffi::c_void;
 pub type V8ScriptHandle = *mut std::ffi::c_void;
+pub type V8FunctionHandle = *mut std::ffi::c_void;
+pub type V8PromiseCompleterHandle = *mut std::ffi::c_void;
+pub type V8StreamHandle = *mut std::ffi::c_void;
+
+pub const SHIM_VALUE_UNDEFINED: i32 = 0;
+pub const SHIM_VALUE_NULL: i32 = 1;
+pub const SHIM_VALUE_BOOL: i32 = 2;
+pub const SHIM_VALUE_INT32: i32 = 3;
+pub const SHIM_VALUE_DOUBLE: i32 = 4;
+pub const SHIM_VALUE_BIGINT: i32 = 5;
+pub const SHIM_VALUE_STRING: i32 = 6;
+pub const SHIM_VALUE_BYTES: i32 = 7;
+pub const SHIM_VALUE_EXTERNAL_BYTES: i32 = 8;
+pub const SHIM_VALUE_SERIALIZED: i32 = 9;
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct ShimValue {
+    pub kind: i32,
+    pub integer: i64,
+    pub number: c_double,
+    pub data: *const u8,
+    pub length: usize,
+}
+
+pub const SHIM_FAST_VOID: i32 = 0;
+pub const SHIM_FAST_BOOL: i32 = 1;
+pub const SHIM_FAST_INT32: i32 = 2;
+pub const SHIM_FAST_FLOAT64: i32 = 3;
+
+pub const SHIM_STATUS_CPU_BUDGET: i32 = -3;
+pub const SHIM_STATUS_TIMEOUT: i32 = -2;
+pub const SHIM_STATUS_HEAP_LIMIT: i32 = -1;
+pub const SHIM_STATUS_OK: i32 = 1;
+
+#[repr(C)]
+pub struct ShimIsolateOptions {
+    pub initial_old_generation_bytes: usize,
+    pub max_old_generation_bytes: usize,
+    pub initial_young_generation_bytes: usize,
+    pub max_young_generation_bytes: usize,
+    pub snapshot: *const u8,
+    pub snapshot_length: usize,
+}
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct ShimHeapStats {
+    pub total_heap_size: usize,
+    pub total_heap_size_executable: usize,
+    pub total_physical_size: usize,
+    pub total_available_size: usize,
+    pub used_heap_size: usize,
+    pub heap_size_limit: usize,
+    pub malloced_memory: usize,
+    pub peak_malloced_memory: usize,
+    pub external_memory: usize,
+    pub number_of_native_contexts: usize,
+    pub number_of_detached_contexts: usize,
+}
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct ShimHeapSpaceStats {
+    pub space_name: *const c_char,
+    pub space_size: usize,
+    pub space_used_size: usize,
+    pub space_available_size: usize,
+    pub physical_space_size: usize,
+}
+
+impl Default for ShimHeapSpaceStats {
+    fn default() -> Self {
+        Self {
+            space_name: std::ptr::null(),
+            space_size: 0,
+            space_used_size: 0,
+            space_available_size: 0,
+            physical_space_size: 0,
+        }
+    }
+}
+
+pub const SHIM_GC_PAUSE_BUCKETS: usize = 24;
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct ShimGcStats {
+    pub collections: u64,
+    pub minor_collections: u64,
+    pub major_collections: u64,
+    pub total_pause_ns: u64,
+    pub max_pause_ns: u64,
+    pub pause_buckets: [u64; SHIM_GC_PAUSE_BUCKETS],
+}
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct ShimSpanCounter {
+    pub count: u64,
+    pub total_ns: u64,
+}
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct ShimCounters {
+    pub compile: ShimSpanCounter,
+    pub run: ShimSpanCounter,
+    pub call: ShimSpanCounter,
+    pub marshal: ShimSpanCounter,
+    pub host: ShimSpanCounter,
+    pub cache_hits: u64,
+    pub cache_misses: u64,
+}
+
+pub const SHIM_OUTPUT_TEXT: i32 = 0;
+pub const SHIM_OUTPUT_JSON: i32 = 1;
+
+pub const SHIM_CONTEXT_RESET_BASELINE: i32 = 0;
+pub const SHIM_CONTEXT_RESET_RECREATE: i32 = 1;
+
+pub const SHIM_MEMORY_PRESSURE_NONE: i32 = 0;
+pub const SHIM_MEMORY_PRESSURE_MODERATE: i32 = 1;
+pub const SHIM_MEMORY_PRESSURE_CRITICAL: i32 = 2;
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct ShimScriptCacheStats {
+    pub hits: u64,
+    pub misses: u64,
+    pub insertions: u64,
+    pub evictions: u64,
+    pub entries: usize,
+    pub bytes: usize,
+    pub capacity_bytes: usize,
+}
+
+#[repr(C)]
+pub struct ShimBatchItem {
+    pub source: *const c_char,
+    pub source_length: usize,
+    pub script: V8ScriptHandle,
+    pub args: *const ShimValue,
+    pub arg_count: usize,
+}
+
+#[repr(C)]
+pub struct ShimGlobalEntry {
+    pub path: *const c_char,
+    pub path_length: usize,
+    pub value: ShimValue,
+}
+
+pub const SHIM_CLASS_METHOD: i32 = 0;
+pub const SHIM_CLASS_PROPERTY: i32 = 1;
+
+#[repr(C)]
+pub struct ShimClassMember {
+    pub name: *const c_char,
+    pub name_length: usize,
+    pub kind: i32,
+    pub function_id: u64,
+    pub setter_id: u64,
+}
+
+pub const SHIM_COMPILE_EAGER: i32 = 1;
+pub const SHIM_COMPILE_HINTS_MAGIC_COMMENTS: i32 = 2;
+
+#[repr(C)]
+pub struct ShimWarmupCall {
+    pub function: *const c_char,
+    pub function_length: usize,
+    pub args: *const ShimValue,
+    pub arg_count: usize,
+    pub iterations: u32,
+}
+
+pub const SHIM_SOURCE_ONE_BYTE: i32 = 0;
+pub const SHIM_SOURCE_TWO_BYTE: i32 = 1;
+
+#[repr(C)]
+pub struct ShimExternalSource {
+    pub data: *const std::ffi::c_void,
+    pub length: usize,
+    pub encoding: i32,
+    pub release_token: *mut std::ffi::c_void,
+}
+
+#[repr(C)]
+pub struct ShimBatchResult {
+    pub status: i32,
+    pub value: ShimValue,
+    pub error: *mut c_char,
+}
+
+#[repr(C)]
+pub struct ShimModuleRequest {
+    pub specifier: *const c_char,
+    pub specifier_length: usize,
+    pub referrer: *const c_char,
+    pub referrer_length: usize,
+}
+
+#[repr(C)]
+pub struct ShimModuleSource {
+    pub name: ShimValue,
+    pub source: ShimValue,
+}
 
 unsafe extern "C" {
     pub fn shim_v8_initialize(icu_data_path: *const c_char) -> i32;
+    pub fn shim_v8_set_flags(
+        flags: *const c_char,
+        flags_length: usize,
+        error_out: *mut *mut c_char,
+    ) -> i32;
 
     pub fn shim_create_isolate() -> V8IsolateHandle;
+    pub fn shim_create_isolate_from_snapshot(blob: *const u8, length: usize) -> V8IsolateHandle;
+    pub fn shim_create_isolate_with_options(options: *const ShimIsolateOptions) -> V8IsolateHandle;
     pub fn shim_dispose_isolate(isolate: V8IsolateHandle);
+    pub fn shim_isolate_is_poisoned(isolate: V8IsolateHandle) -> i32;
+    pub fn shim_isolate_lock(isolate: V8IsolateHandle, error_out: *mut *mut c_char) -> i32;
+    pub fn shim_isolate_unlock(isolate: V8IsolateHandle);
+
+    pub fn shim_snapshot_create(
+        sources: *const *const c_char,
+        source_count: usize,
+        host_functions: *const *const c_char,
+        host_function_count: usize,
+        blob_out: *mut *mut u8,
+        length_out: *mut usize,
+        error_out: *mut *mut c_char,
+    ) -> i32;
 
     pub fn shim_create_context(isolate: V8IsolateHandle) -> V8ContextHandle;
     pub fn shim_dispose_context(context: V8ContextHandle);
 
-    pub fn shim_context_eval(
+    pub fn shim_context_eval_batch(
+        context: V8ContextHandle,
+        items: *const ShimBatchItem,
+        item_count: usize,
+        results_out: *mut ShimBatchResult,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_isolate_set_script_cache_limit(
+        isolate: V8IsolateHandle,
+        capacity_bytes: usize,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_isolate_script_cache_stats(
+        isolate: V8IsolateHandle,
+        stats_out: *mut ShimScriptCacheStats,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_isolate_heap_stats(
+        isolate: V8IsolateHandle,
+        stats_out: *mut ShimHeapStats,
+        spaces_out: *mut ShimHeapSpaceStats,
+        space_capacity: usize,
+        space_count_out: *mut usize,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_isolate_gc_stats(
+        isolate: V8IsolateHandle,
+        stats_out: *mut ShimGcStats,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_isolate_memory_pressure(
+        isolate: V8IsolateHandle,
+        level: i32,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_isolate_low_memory_notification(
+        isolate: V8IsolateHandle,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_set_timeout(
+        context: V8ContextHandle,
+        timeout_ms: u64,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_set_cpu_budget(
         context: V8ContextHandle,
+        cpu_budget_us: u64,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_cpu_time_used(
+        context: V8ContextHandle,
+        cpu_time_us_out: *mut u64,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_isolate_define_class(
+        isolate: V8IsolateHandle,
+        name: *const c_char,
+        name_length: usize,
+        members: *const ShimClassMember,
+        member_count: usize,
+        class_id_out: *mut u32,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_new_instance(
+        context: V8ContextHandle,
+        class_id: u32,
+        instance_token: u64,
+        path: *const c_char,
+        path_length: usize,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_counters(
+        context: V8ContextHandle,
+        counters_out: *mut ShimCounters,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_isolate_counters(
+        isolate: V8IsolateHandle,
+        counters_out: *mut ShimCounters,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_instrumentation_enabled() -> i32;
+    pub fn shim_set_trace_spans(enabled: i32, error_out: *mut *mut c_char) -> i32;
+
+    pub fn shim_context_start_cpu_profile(
+        context: V8ContextHandle,
+        title: *const c_char,
+        title_length: usize,
+        sampling_interval_us: u32,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_stop_cpu_profile(
+        context: V8ContextHandle,
+        title: *const c_char,
+        title_length: usize,
+        json_out: *mut *mut u8,
+        json_length_out: *mut usize,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_set_global_value_utf8(
+        context: V8ContextHandle,
+        name: *const c_char,
+        name_length: usize,
+        value: *const ShimValue,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_load_module(
+        context: V8ContextHandle,
+        name: *const c_char,
+        name_length: usize,
         source: *const c_char,
-        result_out: *mut *mut c_char,
+        source_length: usize,
+        loader: *mut std::ffi::c_void,
+        result_out: *mut ShimValue,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_set_globals(
+        context: V8ContextHandle,
+        entries: *const ShimGlobalEntry,
+        entry_count: usize,
         error_out: *mut *mut c_char,
     ) -> i32;
 
-    pub fn shim_context_set_global_string(
+    pub fn shim_context_set_global_buffer(
         context: V8ContextHandle,
         name: *const c_char,
-        value: *const c_char,
+        data: *mut u8,
+        length: usize,
+        release_token: *mut std::ffi::c_void,
         error_out: *mut *mut c_char,
     ) -> i32;
 
-    pub fn shim_context_set_global_number(
+    pub fn shim_context_alloc_global_buffer(
         context: V8ContextHandle,
         name: *const c_char,
-        value: c_double,
+        length: usize,
+        data_out: *mut *mut u8,
         error_out: *mut *mut c_char,
     ) -> i32;
 
@@ -41,28 +406,227 @@ unsafe extern "C" {
         error_out: *mut *mut c_char,
     ) -> i32;
 
-    pub fn shim_context_call_function(
+    pub fn shim_context_register_async_host_function(
+        context: V8ContextHandle,
+        name: *const c_char,
+        function_id: u64,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_register_fast_host_function(
+        context: V8ContextHandle,
+        name: *const c_char,
+        function_id: u64,
+        return_type: i32,
+        arg_types: *const i32,
+        arg_count: usize,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_promise_resolve(completer: V8PromiseCompleterHandle, value: *const ShimValue);
+    pub fn shim_promise_reject(completer: V8PromiseCompleterHandle, message: *const c_char);
+
+    pub fn shim_context_pump(context: V8ContextHandle, error_out: *mut *mut c_char) -> i32;
+
+    pub fn shim_context_eval_utf8(
+        context: V8ContextHandle,
+        source: *const c_char,
+        source_length: usize,
+        result_out: *mut ShimValue,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_eval_utf8_await(
+        context: V8ContextHandle,
+        source: *const c_char,
+        source_length: usize,
+        result_out: *mut ShimValue,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_eval_serialized(
+        context: V8ContextHandle,
+        source: *const c_char,
+        source_length: usize,
+        data_out: *mut *mut u8,
+        length_out: *mut usize,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_call_function_serialized(
         context: V8ContextHandle,
         fn_name: *const c_char,
-        args: *const *const c_char,
+        name_length: usize,
+        args: *const ShimValue,
         arg_count: usize,
-        result_out: *mut *mut c_char,
+        data_out: *mut *mut u8,
+        length_out: *mut usize,
         error_out: *mut *mut c_char,
     ) -> i32;
 
-    pub fn shim_compile_script(
+    pub fn shim_context_eval_external(
+        context: V8ContextHandle,
+        source: *const ShimExternalSource,
+        result_out: *mut ShimValue,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_bind_host_function(
+        context: V8ContextHandle,
+        name: *const c_char,
+        function_id: u64,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_record_baseline(
+        context: V8ContextHandle,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_restore_baseline(
+        context: V8ContextHandle,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_eval_streamed(
+        context: V8ContextHandle,
+        source: *const c_char,
+        source_length: usize,
+        flags: i32,
+        sink: *mut std::ffi::c_void,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_call_function_streamed(
+        context: V8ContextHandle,
+        fn_name: *const c_char,
+        name_length: usize,
+        args: *const ShimValue,
+        arg_count: usize,
+        flags: i32,
+        sink: *mut std::ffi::c_void,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_reset(
+        context: V8ContextHandle,
+        mode: i32,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_context_call_function_values_utf8(
+        context: V8ContextHandle,
+        fn_name: *const c_char,
+        name_length: usize,
+        args: *const ShimValue,
+        arg_count: usize,
+        result_out: *mut ShimValue,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_compile_script_utf8(
+        isolate: V8IsolateHandle,
+        source: *const c_char,
+        source_length: usize,
+        cache_data: *const u8,
+        cache_length: usize,
+        cache_rejected_out: *mut i32,
+        error_out: *mut *mut c_char,
+    ) -> V8ScriptHandle;
+
+    pub fn shim_compile_script_with_options(
         isolate: V8IsolateHandle,
         source: *const c_char,
+        source_length: usize,
+        cache_data: *const u8,
+        cache_length: usize,
+        flags: i32,
+        cache_rejected_out: *mut i32,
+        error_out: *mut *mut c_char,
+    ) -> V8ScriptHandle;
+
+    pub fn shim_script_warmup(
+        script: V8ScriptHandle,
+        context: V8ContextHandle,
+        calls: *const ShimWarmupCall,
+        call_count: usize,
+        cache_out: *mut *mut u8,
+        cache_length_out: *mut usize,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_compile_script_external(
+        isolate: V8IsolateHandle,
+        source: *const ShimExternalSource,
+        cache_data: *const u8,
+        cache_length: usize,
+        cache_rejected_out: *mut i32,
         error_out: *mut *mut c_char,
     ) -> V8ScriptHandle;
 
-    pub fn shim_script_run(
+    pub fn shim_compile_stream_start(
+        isolate: V8IsolateHandle,
+        ready_token: *mut std::ffi::c_void,
+        error_out: *mut *mut c_char,
+    ) -> V8StreamHandle;
+
+    pub fn shim_compile_stream_push(
+        stream: V8StreamHandle,
+        data: *const u8,
+        length: usize,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_compile_stream_finish(
+        stream: V8StreamHandle,
+        context: V8ContextHandle,
+        error_out: *mut *mut c_char,
+    ) -> V8ScriptHandle;
+
+    pub fn shim_compile_stream_dispose(stream: V8StreamHandle);
+
+    pub fn shim_script_create_code_cache(
+        script: V8ScriptHandle,
+        data_out: *mut *mut u8,
+        length_out: *mut usize,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_script_run_value(
         script: V8ScriptHandle,
         context: V8ContextHandle,
-        result_out: *mut *mut c_char,
+        result_out: *mut ShimValue,
         error_out: *mut *mut c_char,
     ) -> i32;
 
     pub fn shim_script_dispose(script: V8ScriptHandle);
+
+    pub fn shim_context_get_function_utf8(
+        context: V8ContextHandle,
+        path: *const c_char,
+        path_length: usize,
+        bind_receiver: i32,
+        error_out: *mut *mut c_char,
+    ) -> V8FunctionHandle;
+
+    pub fn shim_function_call_values(
+        function: V8FunctionHandle,
+        args: *const ShimValue,
+        arg_count: usize,
+        result_out: *mut ShimValue,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_function_call_values_await(
+        function: V8FunctionHandle,
+        args: *const ShimValue,
+        arg_count: usize,
+        result_out: *mut ShimValue,
+        error_out: *mut *mut c_char,
+    ) -> i32;
+
+    pub fn shim_function_dispose(function: V8FunctionHandle);
     pub fn shim_free_string(ptr: *mut c_char);
+    pub fn shim_free_buffer(ptr: *mut u8);
+    pub fn shim_value_release(value: *mut ShimValue);
 }
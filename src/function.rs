@@ -0,0 +1,127 @@
+use std::os::raw::c_char;
+use std::ptr;
+
+use crate::Context;
+use crate::error::{Result, V8Error};
+use crate::ffi::{
+    SHIM_STATUS_OK, ShimValue, V8FunctionHandle, V8IsolateHandle, shim_context_get_function_utf8,
+    shim_function_call_values, shim_function_call_values_await, shim_function_dispose,
+};
+use crate::support::{take_error, take_status_error, take_value};
+use crate::value::{JsValue, ShimArgs};
+
+type CallFn = unsafe extern "C" fn(
+    V8FunctionHandle,
+    *const ShimValue,
+    usize,
+    *mut ShimValue,
+    *mut *mut c_char,
+) -> i32;
+
+/// A JavaScript function resolved once and kept alive for repeated calls.
+///
+/// Calls skip the name lookup on the global object entirely. The handle keeps its creation
+/// context alive and must be dropped before the isolate it came from.
+pub struct Function {
+    handle: V8FunctionHandle,
+    isolate: V8IsolateHandle,
+}
+
+impl Function {
+    pub(crate) fn resolve(context: &Context, path: &str) -> Result<Self> {
+        if context.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
+        }
+
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+
+        let handle = unsafe {
+            shim_context_get_function_utf8(
+                context.handle,
+                path.as_ptr().cast(),
+                path.len(),
+                1,
+                &mut error_ptr,
+            )
+        };
+
+        if handle.is_null() {
+            return Err(unsafe { take_error(error_ptr, "failed to resolve function") });
+        }
+
+        Ok(Self {
+            handle,
+            isolate: context.isolate,
+        })
+    }
+
+    pub fn isolate_handle(&self) -> V8IsolateHandle {
+        self.isolate
+    }
+
+    pub fn call(&self, args: &[&str]) -> Result<JsValue> {
+        let shim_args: Vec<ShimValue> = args
+            .iter()
+            .map(|value| ShimValue::borrowed_str(value))
+            .collect();
+        self.call_with_shim_args(&shim_args, shim_function_call_values)
+    }
+
+    pub fn call_values(&self, args: &[JsValue]) -> Result<JsValue> {
+        let shim_args = ShimArgs::new(args);
+        self.call_with_shim_args(shim_args.as_slice(), shim_function_call_values)
+    }
+
+    /// Like [`Function::call_values`], but a returned promise is awaited the way
+    /// [`Context::eval_and_await`] does.
+    pub fn call_and_await(&self, args: &[JsValue]) -> Result<JsValue> {
+        let shim_args = ShimArgs::new(args);
+        self.call_with_shim_args(shim_args.as_slice(), shim_function_call_values_await)
+    }
+
+    fn call_with_shim_args(&self, args: &[ShimValue], call: CallFn) -> Result<JsValue> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("function was disposed"));
+        }
+
+        let arg_ptr = if args.is_empty() {
+            ptr::null()
+        } else {
+            args.as_ptr()
+        };
+        let mut result = ShimValue::default();
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+
+        let status = unsafe {
+            call(
+                self.handle,
+                arg_ptr,
+                args.len(),
+                &mut result,
+                &mut error_ptr,
+            )
+        };
+
+        if status != SHIM_STATUS_OK {
+            return Err(unsafe { take_status_error(status, error_ptr, "failed to call function") });
+        }
+
+        Ok(unsafe { take_value(&mut result) })
+    }
+
+    pub fn dispose(&mut self) {
+        if self.handle.is_null() {
+            return;
+        }
+        unsafe {
+            shim_function_dispose(self.handle);
+        }
+        self.handle = ptr::null_mut();
+    }
+}
+
+impl Drop for Function {
+    fn drop(&mut self) {
+        self.dispose();
+    }
+}
@@ -0,0 +1,73 @@
+use std::ptr;
+
+use crate::error::{Result, V8Error};
+use crate::ffi::{ShimIsolateOptions, shim_create_isolate_with_options};
+use crate::snapshot::Snapshot;
+use crate::{Isolate, ensure_v8_initialized};
+
+/// Heap sizing and startup options for an [`Isolate`].
+///
+/// Sizes are in bytes; unset values keep V8's defaults. Whatever the limits, a script that
+/// runs the isolate close to its heap limit is terminated and fails with
+/// [`crate::ErrorKind::HeapLimit`] instead of aborting the process. The isolate is poisoned
+/// from then on (see [`Isolate::is_poisoned`]) and should be replaced.
+#[derive(Debug, Clone, Default)]
+pub struct IsolateBuilder {
+    initial_old_generation: usize,
+    max_old_generation: usize,
+    initial_young_generation: usize,
+    max_young_generation: usize,
+    snapshot: Option<Snapshot>,
+}
+
+impl IsolateBuilder {
+    pub fn initial_old_generation_size(mut self, bytes: usize) -> Self {
+        self.initial_old_generation = bytes;
+        self
+    }
+
+    pub fn max_old_generation_size(mut self, bytes: usize) -> Self {
+        self.max_old_generation = bytes;
+        self
+    }
+
+    pub fn initial_young_generation_size(mut self, bytes: usize) -> Self {
+        self.initial_young_generation = bytes;
+        self
+    }
+
+    pub fn max_young_generation_size(mut self, bytes: usize) -> Self {
+        self.max_young_generation = bytes;
+        self
+    }
+
+    pub fn snapshot(mut self, snapshot: Snapshot) -> Self {
+        self.snapshot = Some(snapshot);
+        self
+    }
+
+    pub fn build(&self) -> Result<Isolate> {
+        ensure_v8_initialized()?;
+
+        let blob = self.snapshot.as_ref().map(Snapshot::as_bytes);
+        if blob.is_some_and(<[u8]>::is_empty) {
+            return Err(V8Error::new("snapshot was empty"));
+        }
+
+        let options = ShimIsolateOptions {
+            initial_old_generation_bytes: self.initial_old_generation,
+            max_old_generation_bytes: self.max_old_generation,
+            initial_young_generation_bytes: self.initial_young_generation,
+            max_young_generation_bytes: self.max_young_generation,
+            snapshot: blob.map_or(ptr::null(), <[u8]>::as_ptr),
+            snapshot_length: blob.map_or(0, <[u8]>::len),
+        };
+
+        let handle = unsafe { shim_create_isolate_with_options(&options) };
+        if handle.is_null() {
+            return Err(V8Error::new("failed to create V8 isolate"));
+        }
+
+        Ok(Isolate { handle })
+    }
+}
@@ -1,30 +1,131 @@
+mod batch;
+mod buffer;
+mod class;
+mod code_cache;
+mod compile;
 mod error;
+mod executor;
 mod ffi;
+mod function;
+mod isolate;
+mod module;
 mod native;
+mod output;
+mod pool;
+mod profiler;
+mod promise;
+mod queue;
+mod serialize;
+mod snapshot;
+mod source;
+mod stats;
+mod stream;
 mod support;
+mod trace;
 mod value;
 
-pub use crate::error::{Result, V8Error};
-pub use crate::value::JsValue;
+pub use crate::batch::BatchItem;
+pub use crate::class::{Class, ClassBuilder};
+pub use crate::code_cache::CodeCache;
+pub use crate::compile::{CompileOptions, WarmupCall};
+pub use crate::error::{ErrorKind, Result, V8Error};
+pub use crate::executor::{ContextKey, Executor, ExecutorBuilder, JobHandle};
+pub use crate::function::Function;
+pub use crate::isolate::IsolateBuilder;
+pub use crate::module::{ModuleRequest, ModuleSource};
+pub use crate::native::FastType;
+pub use crate::output::OutputFormat;
+pub use crate::pool::{IsolatePool, IsolatePoolBuilder, PoolMetrics, PooledIsolate, ResetPolicy};
+pub use crate::profiler::{PerfMap, enable_perf_map, set_v8_flags};
+pub use crate::promise::PromiseResolver;
+pub use crate::snapshot::Snapshot;
+pub use crate::source::ExternalSource;
+pub use crate::stats::{
+    Counters, GC_PAUSE_BUCKETS, GcStats, HeapSpaceStats, HeapStats, MemoryPressure,
+    ScriptCacheStats, SpanStats,
+};
+pub use crate::stream::ScriptStream;
+pub use crate::trace::{TraceSpan, instrumentation_enabled, set_trace_sink};
+pub use crate::value::{JsValue, JsValueRef};
 
 // Ensure temporal_capi symbols are linked even though they're only used by V8's C++ code
 extern crate temporal_capi;
 
 use std::env;
-use std::ffi::CString;
+use std::ffi::{CString, c_void};
+use std::io::Write;
 use std::os::raw::c_char;
+use std::path::Path;
 use std::ptr;
+use std::time::Duration;
 
+use crate::batch::BatchSource;
+use crate::code_cache::source_hash;
 use crate::ffi::{
-    V8ContextHandle, V8IsolateHandle, V8ScriptHandle, shim_compile_script,
-    shim_context_call_function, shim_context_eval, shim_context_register_host_function,
-    shim_context_set_global_number, shim_context_set_global_string, shim_create_context,
-    shim_create_isolate, shim_dispose_context, shim_dispose_isolate, shim_script_dispose,
-    shim_script_run, shim_v8_initialize,
+    SHIM_CONTEXT_RESET_BASELINE, SHIM_CONTEXT_RESET_RECREATE, SHIM_STATUS_OK, ShimBatchItem,
+    ShimBatchResult, ShimCounters, ShimGcStats, ShimGlobalEntry, ShimHeapSpaceStats, ShimHeapStats,
+    ShimScriptCacheStats, ShimValue, ShimWarmupCall, V8ContextHandle, V8IsolateHandle,
+    V8ScriptHandle, shim_compile_script_external, shim_compile_script_utf8,
+    shim_compile_script_with_options, shim_context_alloc_global_buffer,
+    shim_context_bind_host_function, shim_context_call_function_serialized,
+    shim_context_call_function_streamed, shim_context_call_function_values_utf8,
+    shim_context_counters, shim_context_cpu_time_used, shim_context_eval_batch,
+    shim_context_eval_external, shim_context_eval_serialized, shim_context_eval_streamed,
+    shim_context_eval_utf8, shim_context_eval_utf8_await, shim_context_load_module,
+    shim_context_pump, shim_context_record_baseline, shim_context_register_async_host_function,
+    shim_context_register_fast_host_function, shim_context_register_host_function,
+    shim_context_reset, shim_context_restore_baseline, shim_context_set_cpu_budget,
+    shim_context_set_global_buffer, shim_context_set_global_value_utf8, shim_context_set_globals,
+    shim_context_set_timeout, shim_context_start_cpu_profile, shim_context_stop_cpu_profile,
+    shim_create_context, shim_create_isolate, shim_create_isolate_from_snapshot,
+    shim_dispose_context, shim_dispose_isolate, shim_isolate_counters, shim_isolate_gc_stats,
+    shim_isolate_heap_stats, shim_isolate_is_poisoned, shim_isolate_low_memory_notification,
+    shim_isolate_memory_pressure, shim_isolate_script_cache_stats,
+    shim_isolate_set_script_cache_limit, shim_script_create_code_cache, shim_script_dispose,
+    shim_script_run_value, shim_script_warmup, shim_v8_initialize,
 };
-use crate::support::{take_error, take_string};
+use crate::output::{OutputSink, SinkState, StringSink, WriterSink};
+use crate::support::{take_buffer, take_error, take_serialized, take_status_error, take_value};
+use crate::value::ShimArgs;
+
+/// How [`Context::reset`] prepares a context for its next user.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum ResetMode {
+    /// Restore the globals recorded by [`Context::record_baseline`].
+    Baseline,
+    /// Replace the V8 context with a new one, created from the isolate's snapshot if it has
+    /// one. Host functions are installed again; globals, top-level bindings, loaded modules
+    /// and the recorded baseline are gone.
+    Recreate,
+}
+
+impl ResetMode {
+    fn mode(self) -> i32 {
+        match self {
+            ResetMode::Baseline => SHIM_CONTEXT_RESET_BASELINE,
+            ResetMode::Recreate => SHIM_CONTEXT_RESET_RECREATE,
+        }
+    }
+}
+
+enum HostFunctionKind<'a> {
+    Sync,
+    Async,
+    Fast {
+        args: &'a [FastType],
+        returns: FastType,
+    },
+}
 
-const NULL_BYTE_MESSAGE: &str = "input contained an interior null byte";
+type EvalFn = unsafe extern "C" fn(
+    V8ContextHandle,
+    *const c_char,
+    usize,
+    *mut ShimValue,
+    *mut *mut c_char,
+) -> i32;
+
+pub(crate) const NULL_BYTE_MESSAGE: &str = "input contained an interior null byte";
 
 pub struct Isolate {
     handle: V8IsolateHandle,
@@ -33,12 +134,12 @@ pub struct Isolate {
 pub struct Context {
     handle: V8ContextHandle,
     isolate: V8IsolateHandle,
-    host_functions: Vec<u64>,
 }
 
 pub struct Script {
     handle: V8ScriptHandle,
     isolate: V8IsolateHandle,
+    source_hash: u64,
 }
 
 fn resolve_icu_data_path() -> Option<String> {
@@ -74,10 +175,18 @@ fn initialize_v8(icu_path: Option<&str>) -> Result<()> {
     Ok(())
 }
 
+pub(crate) fn ensure_v8_initialized() -> Result<()> {
+    let icu_path = resolve_icu_data_path();
+    initialize_v8(icu_path.as_deref())
+}
+
 impl Isolate {
+    pub fn builder() -> IsolateBuilder {
+        IsolateBuilder::default()
+    }
+
     pub fn new() -> Result<Self> {
-        let icu_path = resolve_icu_data_path();
-        initialize_v8(icu_path.as_deref())?;
+        ensure_v8_initialized()?;
 
         let handle = unsafe { shim_create_isolate() };
         if handle.is_null() {
@@ -87,6 +196,22 @@ impl Isolate {
         Ok(Self { handle })
     }
 
+    pub fn from_snapshot(snapshot: &Snapshot) -> Result<Self> {
+        ensure_v8_initialized()?;
+
+        let blob = snapshot.as_bytes();
+        if blob.is_empty() {
+            return Err(V8Error::new("snapshot was empty"));
+        }
+
+        let handle = unsafe { shim_create_isolate_from_snapshot(blob.as_ptr(), blob.len()) };
+        if handle.is_null() {
+            return Err(V8Error::new("failed to create V8 isolate from snapshot"));
+        }
+
+        Ok(Self { handle })
+    }
+
     pub fn raw_handle(&self) -> V8IsolateHandle {
         self.handle
     }
@@ -104,10 +229,172 @@ impl Isolate {
         Ok(Context {
             handle,
             isolate: self.handle,
-            host_functions: Vec::new(),
         })
     }
 
+    /// True once a call on this isolate hit its heap limit. The memory that filled the heap
+    /// may still be reachable, so every later call fails with [`ErrorKind::HeapLimit`]; the
+    /// isolate should be disposed and replaced.
+    pub fn is_poisoned(&self) -> bool {
+        !self.handle.is_null() && unsafe { shim_isolate_is_poisoned(self.handle) } != 0
+    }
+
+    /// Caps the bytes held by the compiled-script cache shared by this isolate's contexts;
+    /// `0` disables caching.
+    pub fn set_script_cache_limit(&self, capacity_bytes: usize) -> Result<()> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("isolate was disposed"));
+        }
+
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status = unsafe {
+            shim_isolate_set_script_cache_limit(self.handle, capacity_bytes, &mut error_ptr)
+        };
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to set script cache limit") });
+        }
+        Ok(())
+    }
+
+    pub fn script_cache_stats(&self) -> Result<ScriptCacheStats> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("isolate was disposed"));
+        }
+
+        let mut stats = ShimScriptCacheStats::default();
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status =
+            unsafe { shim_isolate_script_cache_stats(self.handle, &mut stats, &mut error_ptr) };
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to read script cache stats") });
+        }
+        Ok(stats.into())
+    }
+
+    /// Builds the templates of a host class once, for instances in any of this isolate's
+    /// contexts; see [`Context::set_global_instance`].
+    pub fn define_class<T: Send + 'static>(&self, builder: ClassBuilder<T>) -> Result<Class<T>> {
+        Class::define(self, builder)
+    }
+
+    /// Counters of scripts compiled through [`Script::compile`] and its variants; evals are
+    /// counted on their context.
+    pub fn counters(&self) -> Result<Counters> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("isolate was disposed"));
+        }
+
+        let mut counters = ShimCounters::default();
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status = unsafe { shim_isolate_counters(self.handle, &mut counters, &mut error_ptr) };
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to read isolate counters") });
+        }
+        Ok(counters.into())
+    }
+
+    pub fn heap_stats(&self) -> Result<HeapStats> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("isolate was disposed"));
+        }
+
+        let mut stats = ShimHeapStats::default();
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status = unsafe {
+            shim_isolate_heap_stats(
+                self.handle,
+                &mut stats,
+                ptr::null_mut(),
+                0,
+                ptr::null_mut(),
+                &mut error_ptr,
+            )
+        };
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to read heap stats") });
+        }
+        Ok(stats.into())
+    }
+
+    /// Per-space breakdown of [`Isolate::heap_stats`].
+    pub fn heap_space_stats(&self) -> Result<Vec<HeapSpaceStats>> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("isolate was disposed"));
+        }
+
+        let mut stats = ShimHeapStats::default();
+        let mut spaces: Vec<ShimHeapSpaceStats> = Vec::new();
+        // The first pass only learns the number of spaces; grow and retry until they all fit.
+        loop {
+            let mut count = 0usize;
+            let mut error_ptr: *mut c_char = ptr::null_mut();
+            let status = unsafe {
+                shim_isolate_heap_stats(
+                    self.handle,
+                    &mut stats,
+                    spaces.as_mut_ptr(),
+                    spaces.len(),
+                    &mut count,
+                    &mut error_ptr,
+                )
+            };
+            if status == 0 {
+                return Err(unsafe { take_error(error_ptr, "failed to read heap space stats") });
+            }
+            if count <= spaces.len() {
+                spaces.truncate(count);
+                break;
+            }
+            spaces = vec![ShimHeapSpaceStats::default(); count];
+        }
+        Ok(spaces.into_iter().map(HeapSpaceStats::from).collect())
+    }
+
+    pub fn gc_stats(&self) -> Result<GcStats> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("isolate was disposed"));
+        }
+
+        let mut stats = ShimGcStats::default();
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status = unsafe { shim_isolate_gc_stats(self.handle, &mut stats, &mut error_ptr) };
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to read gc stats") });
+        }
+        Ok(stats.into())
+    }
+
+    /// Tells V8 how scarce memory is. At [`MemoryPressure::Critical`] it collects before
+    /// returning; the level stays in effect until it is lowered again.
+    pub fn memory_pressure(&self, level: MemoryPressure) -> Result<()> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("isolate was disposed"));
+        }
+
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status =
+            unsafe { shim_isolate_memory_pressure(self.handle, level.level(), &mut error_ptr) };
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to signal memory pressure") });
+        }
+        Ok(())
+    }
+
+    /// Runs full collections until nothing more can be freed, e.g. before parking an idle
+    /// isolate in a pool.
+    pub fn low_memory_notification(&self) -> Result<()> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("isolate was disposed"));
+        }
+
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status = unsafe { shim_isolate_low_memory_notification(self.handle, &mut error_ptr) };
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to collect garbage") });
+        }
+        Ok(())
+    }
+
     pub fn dispose(&mut self) {
         if self.handle.is_null() {
             return;
@@ -135,217 +422,1259 @@ impl Context {
     }
 
     pub fn eval(&self, source: &str) -> Result<JsValue> {
+        self.eval_with(source, shim_context_eval_utf8)
+    }
+
+    /// Like [`Context::eval`], but a returned promise is awaited.
+    ///
+    /// Completions of async host functions are applied as they arrive; the call blocks while
+    /// any are outstanding, for at most the context's timeout. A promise that nothing can
+    /// settle any more fails instead of blocking.
+    pub fn eval_and_await(&self, source: &str) -> Result<JsValue> {
+        self.eval_with(source, shim_context_eval_utf8_await)
+    }
+
+    /// Like [`Context::eval`], but the result is transferred with `v8::ValueSerializer`, so
+    /// objects and arrays arrive as [`JsValue::Object`] and [`JsValue::Array`] trees without
+    /// a JSON round trip. Values the serializer cannot clone, such as functions, fail.
+    pub fn eval_structured(&self, source: &str) -> Result<JsValue> {
         if self.handle.is_null() {
             return Err(V8Error::new("context was disposed"));
         }
 
-        let c_source = CString::new(source).map_err(|_| V8Error::new(NULL_BYTE_MESSAGE))?;
-        let mut result_ptr: *mut c_char = ptr::null_mut();
+        let mut data_ptr: *mut u8 = ptr::null_mut();
+        let mut length: usize = 0;
         let mut error_ptr: *mut c_char = ptr::null_mut();
 
         let status = unsafe {
-            shim_context_eval(
+            shim_context_eval_serialized(
                 self.handle,
-                c_source.as_ptr(),
-                &mut result_ptr,
+                source.as_ptr().cast(),
+                source.len(),
+                &mut data_ptr,
+                &mut length,
                 &mut error_ptr,
             )
         };
 
-        if status == 0 {
-            return Err(unsafe { take_error(error_ptr, "V8 evaluation failed") });
+        if status != SHIM_STATUS_OK {
+            return Err(unsafe { take_status_error(status, error_ptr, "V8 evaluation failed") });
         }
 
-        let value = unsafe { take_string(result_ptr).unwrap_or_default() };
-        Ok(JsValue::new(value))
+        unsafe { take_serialized(data_ptr, length) }
     }
 
-    pub fn set_global_str(&self, name: &str, value: &str) -> Result<()> {
+    /// Evaluates host-owned `source` without copying it into the V8 heap.
+    pub fn eval_external(&self, source: &ExternalSource) -> Result<JsValue> {
         if self.handle.is_null() {
             return Err(V8Error::new("context was disposed"));
         }
-        let c_name = CString::new(name).map_err(|_| V8Error::new(NULL_BYTE_MESSAGE))?;
-        let c_value = CString::new(value).map_err(|_| V8Error::new(NULL_BYTE_MESSAGE))?;
+
+        let shim_source = source.to_shim();
+        let mut result = ShimValue::default();
         let mut error_ptr: *mut c_char = ptr::null_mut();
 
         let status = unsafe {
-            shim_context_set_global_string(
-                self.handle,
-                c_name.as_ptr(),
-                c_value.as_ptr(),
-                &mut error_ptr,
-            )
+            shim_context_eval_external(self.handle, &shim_source, &mut result, &mut error_ptr)
         };
 
-        if status == 0 {
-            return Err(unsafe { take_error(error_ptr, "failed to set global string") });
+        if status != SHIM_STATUS_OK {
+            return Err(unsafe { take_status_error(status, error_ptr, "V8 evaluation failed") });
+        }
+
+        Ok(unsafe { take_value(&mut result) })
+    }
+
+    /// Evaluates `source` and writes its result to `writer` as UTF-8, returning the number of
+    /// bytes written.
+    ///
+    /// The text is handed over in chunks straight from the V8 heap instead of being copied
+    /// out as a whole first, which keeps peak memory at one copy for very large results. The
+    /// writer runs while the isolate is in use; an error it returns aborts the call.
+    pub fn eval_to_writer<W>(
+        &self,
+        source: &str,
+        format: OutputFormat,
+        writer: &mut W,
+    ) -> Result<usize>
+    where
+        W: Write + ?Sized,
+    {
+        let mut sink = WriterSink { writer, written: 0 };
+        self.stream_with(
+            &mut sink,
+            "V8 evaluation failed",
+            |handle, sink, error_ptr| unsafe {
+                shim_context_eval_streamed(
+                    handle,
+                    source.as_ptr().cast(),
+                    source.len(),
+                    format.flags(),
+                    sink,
+                    error_ptr,
+                )
+            },
+        )?;
+        Ok(sink.written)
+    }
+
+    /// Like [`Context::eval_to_writer`], into a `String` allocated once at the exact length.
+    pub fn eval_string(&self, source: &str, format: OutputFormat) -> Result<String> {
+        let mut sink = StringSink::default();
+        self.stream_with(
+            &mut sink,
+            "V8 evaluation failed",
+            |handle, sink, error_ptr| unsafe {
+                shim_context_eval_streamed(
+                    handle,
+                    source.as_ptr().cast(),
+                    source.len(),
+                    format.flags(),
+                    sink,
+                    error_ptr,
+                )
+            },
+        )?;
+        Ok(sink.into_string())
+    }
+
+    fn stream_with(
+        &self,
+        sink: &mut dyn OutputSink,
+        message: &str,
+        call: impl FnOnce(V8ContextHandle, *mut c_void, *mut *mut c_char) -> i32,
+    ) -> Result<()> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
         }
 
+        let mut state = SinkState::new(sink);
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status = call(self.handle, state.as_ptr(), &mut error_ptr);
+        if status != SHIM_STATUS_OK {
+            let error = unsafe { take_status_error(status, error_ptr, message) };
+            return Err(state.into_error(error));
+        }
         Ok(())
     }
 
-    pub fn set_global_number(&self, name: &str, value: f64) -> Result<()> {
+    fn eval_with(&self, source: &str, eval: EvalFn) -> Result<JsValue> {
         if self.handle.is_null() {
             return Err(V8Error::new("context was disposed"));
         }
 
-        let c_name = CString::new(name).map_err(|_| V8Error::new(NULL_BYTE_MESSAGE))?;
+        let mut result = ShimValue::default();
         let mut error_ptr: *mut c_char = ptr::null_mut();
 
         let status = unsafe {
-            shim_context_set_global_number(self.handle, c_name.as_ptr(), value, &mut error_ptr)
+            eval(
+                self.handle,
+                source.as_ptr().cast(),
+                source.len(),
+                &mut result,
+                &mut error_ptr,
+            )
         };
 
-        if status == 0 {
-            return Err(unsafe { take_error(error_ptr, "failed to set global number") });
+        if status != SHIM_STATUS_OK {
+            return Err(unsafe { take_status_error(status, error_ptr, "V8 evaluation failed") });
         }
 
-        Ok(())
+        Ok(unsafe { take_value(&mut result) })
     }
 
-    pub fn add_function<F>(&mut self, name: &str, func: F) -> Result<()>
+    /// Loads the ES module `name` with its import graph and evaluates it, returning its
+    /// default export. Top-level await is awaited like [`Context::eval_and_await`] does.
+    ///
+    /// Imports are resolved through `loader`, which receives every unresolved import of one
+    /// level of the graph in a single call, so it can fetch them concurrently, and returns one
+    /// [`ModuleSource`] per request, in order. A resolved name is loaded once per context;
+    /// loading an already loaded module only returns its default export again. Compiled code
+    /// is cached per isolate, so other contexts loading the same modules skip most of the
+    /// compile work.
+    pub fn load_module<F>(&self, name: &str, source: &str, mut loader: F) -> Result<JsValue>
     where
-        F: Fn(&[JsValue]) -> Result<Option<JsValue>> + Send + Sync + 'static,
+        F: FnMut(&[ModuleRequest<'_>]) -> Result<Vec<ModuleSource>>,
     {
         if self.handle.is_null() {
             return Err(V8Error::new("context was disposed"));
         }
 
-        let c_name = CString::new(name).map_err(|_| V8Error::new(NULL_BYTE_MESSAGE))?;
-        let function_id = native::register(func);
+        let mut loader: &mut module::ModuleLoader<'_> = &mut loader;
+        let mut result = ShimValue::default();
         let mut error_ptr: *mut c_char = ptr::null_mut();
 
         let status = unsafe {
-            shim_context_register_host_function(
+            shim_context_load_module(
                 self.handle,
-                c_name.as_ptr(),
-                function_id,
+                name.as_ptr().cast(),
+                name.len(),
+                source.as_ptr().cast(),
+                source.len(),
+                (&mut loader as *mut &mut module::ModuleLoader<'_>).cast(),
+                &mut result,
                 &mut error_ptr,
             )
         };
 
-        if status == 0 {
-            native::drop_function(function_id);
-            return Err(unsafe { take_error(error_ptr, "failed to register host function") });
+        if status != SHIM_STATUS_OK {
+            return Err(unsafe { take_status_error(status, error_ptr, "failed to load module") });
         }
 
-        self.host_functions.push(function_id);
-        Ok(())
+        Ok(unsafe { take_value(&mut result) })
     }
 
-    pub fn call_function(&self, fn_name: &str, args: &[&str]) -> Result<JsValue> {
+    /// Evaluates every item under a single scope entry and FFI crossing.
+    ///
+    /// The outer `Result` fails only if the batch could not run at all; each item carries its
+    /// own result. A timeout, exhausted CPU budget or heap limit fails the remaining items with
+    /// the same error instead of running them.
+    pub fn eval_many(&self, items: &[BatchItem<'_>]) -> Result<Vec<Result<JsValue>>> {
         if self.handle.is_null() {
             return Err(V8Error::new("context was disposed"));
         }
 
-        let c_name = CString::new(fn_name).map_err(|_| V8Error::new(NULL_BYTE_MESSAGE))?;
-        let arg_cstrings: Result<Vec<CString>> = args
-            .iter()
-            .map(|value| CString::new(*value).map_err(|_| V8Error::new(NULL_BYTE_MESSAGE)))
+        let mut shim_args: Vec<ShimArgs> = Vec::with_capacity(items.len());
+        let mut shim_items: Vec<ShimBatchItem> = Vec::with_capacity(items.len());
+        for item in items {
+            let (source, script) = match item.source {
+                BatchSource::Source(source) => (source, ptr::null_mut()),
+                BatchSource::Script(script) => {
+                    if script.handle.is_null() {
+                        return Err(V8Error::new("script was disposed"));
+                    }
+                    if script.isolate != self.isolate {
+                        return Err(V8Error::new(
+                            "script and context belong to different isolates",
+                        ));
+                    }
+                    ("", script.handle)
+                }
+            };
+            let args = ShimArgs::new(item.args);
+            shim_items.push(ShimBatchItem {
+                source: if script.is_null() {
+                    source.as_ptr().cast()
+                } else {
+                    ptr::null()
+                },
+                source_length: source.len(),
+                script,
+                args: if args.as_slice().is_empty() {
+                    ptr::null()
+                } else {
+                    args.as_slice().as_ptr()
+                },
+                arg_count: args.as_slice().len(),
+            });
+            shim_args.push(args);
+        }
+
+        let mut results: Vec<ShimBatchResult> = (0..items.len())
+            .map(|_| ShimBatchResult {
+                status: 0,
+                value: ShimValue::default(),
+                error: ptr::null_mut(),
+            })
             .collect();
-        let arg_cstrings = arg_cstrings?;
-        let arg_ptrs: Vec<*const c_char> =
-            arg_cstrings.iter().map(|value| value.as_ptr()).collect();
-        let arg_ptr = if arg_ptrs.is_empty() {
-            ptr::null()
-        } else {
-            arg_ptrs.as_ptr()
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+
+        let status = unsafe {
+            shim_context_eval_batch(
+                self.handle,
+                shim_items.as_ptr(),
+                shim_items.len(),
+                results.as_mut_ptr(),
+                &mut error_ptr,
+            )
         };
+        drop(shim_args);
+
+        if status != SHIM_STATUS_OK {
+            return Err(unsafe {
+                take_status_error(status, error_ptr, "V8 batch evaluation failed")
+            });
+        }
+
+        Ok(results
+            .iter_mut()
+            .map(|result| {
+                if result.status != SHIM_STATUS_OK {
+                    Err(unsafe {
+                        take_status_error(result.status, result.error, "V8 evaluation failed")
+                    })
+                } else {
+                    Ok(unsafe { take_value(&mut result.value) })
+                }
+            })
+            .collect())
+    }
+
+    pub fn set_global_str(&self, name: &str, value: &str) -> Result<()> {
+        self.set_global_shim(
+            name,
+            &ShimValue::borrowed_str(value),
+            "failed to set global string",
+        )
+    }
 
-        let mut result_ptr: *mut c_char = ptr::null_mut();
+    pub fn set_global_number(&self, name: &str, value: f64) -> Result<()> {
+        self.set_global_value(name, &JsValue::Number(value))
+    }
+
+    /// Assigns `value` to the dotted property path `name`, creating intermediate objects.
+    ///
+    /// Arrays and objects are rebuilt by a single `v8::ValueDeserializer` pass.
+    pub fn set_global_value(&self, name: &str, value: &JsValue) -> Result<()> {
+        let args = ShimArgs::new(std::slice::from_ref(value));
+        self.set_global_shim(name, &args.as_slice()[0], "failed to set global value")
+    }
+
+    fn set_global_shim(&self, name: &str, value: &ShimValue, fallback: &str) -> Result<()> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
+        }
         let mut error_ptr: *mut c_char = ptr::null_mut();
 
         let status = unsafe {
-            shim_context_call_function(
+            shim_context_set_global_value_utf8(
                 self.handle,
-                c_name.as_ptr(),
-                arg_ptr,
-                arg_ptrs.len(),
-                &mut result_ptr,
+                name.as_ptr().cast(),
+                name.len(),
+                value,
                 &mut error_ptr,
             )
         };
 
         if status == 0 {
-            return Err(unsafe { take_error(error_ptr, "failed to call function") });
+            return Err(unsafe { take_error(error_ptr, fallback) });
         }
 
-        let value = unsafe { take_string(result_ptr).unwrap_or_default() };
-        Ok(JsValue::new(value))
+        Ok(())
     }
 
-    pub fn dispose(&mut self) {
-        if !self.host_functions.is_empty() {
-            native::drop_many(self.host_functions.drain(..));
-        }
+    /// Assigns many dotted paths at once, as [`Context::set_global_value`] would one by one.
+    ///
+    /// The context is entered once and intermediate objects shared by several paths are
+    /// resolved once, which makes seeding hundreds of configuration values cheap. Stops at the
+    /// first failing entry; the entries before it stay assigned.
+    pub fn set_globals<'a, I>(&self, entries: I) -> Result<()>
+    where
+        I: IntoIterator<Item = (&'a str, &'a JsValue)>,
+    {
         if self.handle.is_null() {
-            return;
+            return Err(V8Error::new("context was disposed"));
         }
-        unsafe {
-            shim_dispose_context(self.handle);
+
+        let (paths, values): (Vec<&str>, Vec<&JsValue>) = entries.into_iter().unzip();
+        let args = ShimArgs::new(values);
+        let shim_entries: Vec<ShimGlobalEntry> = paths
+            .iter()
+            .zip(args.as_slice())
+            .map(|(path, value)| ShimGlobalEntry {
+                path: path.as_ptr().cast(),
+                path_length: path.len(),
+                value: *value,
+            })
+            .collect();
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+
+        let status = unsafe {
+            shim_context_set_globals(
+                self.handle,
+                shim_entries.as_ptr(),
+                shim_entries.len(),
+                &mut error_ptr,
+            )
+        };
+
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to set globals") });
         }
-        self.handle = ptr::null_mut();
-    }
-}
 
-impl Drop for Context {
-    fn drop(&mut self) {
-        self.dispose();
+        Ok(())
     }
-}
 
-impl Script {
-    pub fn compile(isolate: &Isolate, source: &str) -> Result<Self> {
-        if isolate.handle.is_null() {
-            return Err(V8Error::new("isolate was disposed"));
+    /// Exposes `buffer` as a `Uint8Array` at `name` without copying it into the V8 heap.
+    ///
+    /// The buffer is dropped once V8 garbage-collects the last view of it. Scripts may write
+    /// into the memory, which is why mutable access is required.
+    ///
+    /// When the prebuilt V8 enables its sandbox, V8 cannot reference memory outside the
+    /// sandbox: the bytes are copied once and `buffer` is dropped before this returns, so
+    /// later writes on either side are not shared. Use
+    /// [`Context::set_global_buffer_with`] to fill V8's memory directly in those builds.
+    pub fn set_global_buffer<B>(&self, name: &str, buffer: B) -> Result<()>
+    where
+        B: AsMut<[u8]> + Send + 'static,
+    {
+        if self.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
         }
 
-        let c_source = CString::new(source).map_err(|_| V8Error::new(NULL_BYTE_MESSAGE))?;
+        let c_name = CString::new(name).map_err(|_| V8Error::new(NULL_BYTE_MESSAGE))?;
+        let raw = buffer::into_raw(buffer);
         let mut error_ptr: *mut c_char = ptr::null_mut();
 
-        let handle =
-            unsafe { shim_compile_script(isolate.handle, c_source.as_ptr(), &mut error_ptr) };
+        let status = unsafe {
+            shim_context_set_global_buffer(
+                self.handle,
+                c_name.as_ptr(),
+                raw.data,
+                raw.length,
+                raw.token,
+                &mut error_ptr,
+            )
+        };
 
-        if handle.is_null() {
-            return Err(unsafe { take_error(error_ptr, "failed to compile script") });
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to set global buffer") });
         }
 
-        Ok(Self {
-            handle,
-            isolate: isolate.handle,
-        })
-    }
-
-    pub fn raw_handle(&self) -> V8ScriptHandle {
-        self.handle
+        Ok(())
     }
 
-    pub fn run(&self, context: &Context) -> Result<JsValue> {
+    /// Sets a zero-filled `Uint8Array` of `length` bytes at `name` and lets `fill` write
+    /// its contents in place.
+    ///
+    /// The memory is allocated by the isolate, so this avoids the copy that
+    /// [`Context::set_global_buffer`] makes when V8 runs with its sandbox enabled.
+    pub fn set_global_buffer_with<F>(&mut self, name: &str, length: usize, fill: F) -> Result<()>
+    where
+        F: FnOnce(&mut [u8]),
+    {
         if self.handle.is_null() {
-            return Err(V8Error::new("script was disposed"));
-        }
-        if context.handle.is_null() {
             return Err(V8Error::new("context was disposed"));
         }
-        if context.isolate != self.isolate {
-            return Err(V8Error::new(
-                "script and context belong to different isolates",
-            ));
-        }
 
-        let mut result_ptr: *mut c_char = ptr::null_mut();
+        let c_name = CString::new(name).map_err(|_| V8Error::new(NULL_BYTE_MESSAGE))?;
+        let mut data: *mut u8 = ptr::null_mut();
         let mut error_ptr: *mut c_char = ptr::null_mut();
 
         let status = unsafe {
-            shim_script_run(self.handle, context.handle, &mut result_ptr, &mut error_ptr)
+            shim_context_alloc_global_buffer(
+                self.handle,
+                c_name.as_ptr(),
+                length,
+                &mut data,
+                &mut error_ptr,
+            )
         };
 
         if status == 0 {
-            return Err(unsafe { take_error(error_ptr, "failed to run script") });
+            return Err(unsafe { take_error(error_ptr, "failed to set global buffer") });
+        }
+
+        if length > 0 && !data.is_null() {
+            // The global keeps the array alive, and `&mut self` keeps script and other
+            // context calls from running until `fill` returns.
+            fill(unsafe { std::slice::from_raw_parts_mut(data, length) });
+        } else {
+            fill(&mut []);
+        }
+        Ok(())
+    }
+
+    pub fn add_function<F>(&mut self, name: &str, func: F) -> Result<()>
+    where
+        F: Fn(&[JsValue]) -> Result<Option<JsValue>> + Send + Sync + 'static,
+    {
+        self.register_function(name, native::register(func), HostFunctionKind::Sync)
+    }
+
+    /// Like [`Context::add_function`], but string and byte arguments borrow V8's memory for
+    /// the duration of the call instead of being copied.
+    pub fn add_borrowing_function<F>(&mut self, name: &str, func: F) -> Result<()>
+    where
+        F: Fn(&[JsValueRef<'_>]) -> Result<Option<JsValue>> + Send + Sync + 'static,
+    {
+        self.register_function(
+            name,
+            native::register_borrowing(func),
+            HostFunctionKind::Sync,
+        )
+    }
+
+    /// Registers a host function with a numeric signature that optimized code can call
+    /// directly through V8's fast API instead of the generic trampoline.
+    ///
+    /// At most three `Int32` or `Float64` arguments are supported. Interpreted code and calls
+    /// with other argument types still take the regular path, so `func` must cope with any
+    /// value; on the fast path it receives exactly the declared types. Its result is checked
+    /// against `returns` on both paths alike: an `Int32` result may also be a
+    /// [`JsValue::Number`] holding an exact 32-bit integer, a `Void` result is discarded, and
+    /// any other mismatch throws in JavaScript.
+    pub fn add_fast_function<F>(
+        &mut self,
+        name: &str,
+        args: &[FastType],
+        returns: FastType,
+        func: F,
+    ) -> Result<()>
+    where
+        F: Fn(&[JsValue]) -> Result<Option<JsValue>> + Send + Sync + 'static,
+    {
+        let kind = HostFunctionKind::Fast { args, returns };
+        self.register_function(name, native::register(func), kind)
+    }
+
+    /// Registers a host function that returns a promise to JavaScript.
+    ///
+    /// The callback receives a [`PromiseResolver`] and may settle it later from any thread,
+    /// so slow host work such as network I/O does not block the isolate.
+    pub fn add_async_function<F>(&mut self, name: &str, func: F) -> Result<()>
+    where
+        F: Fn(&[JsValue], PromiseResolver) + Send + Sync + 'static,
+    {
+        self.register_function(name, native::register_async(func), HostFunctionKind::Async)
+    }
+
+    /// Applies host promise completions, then runs microtasks and pending platform tasks.
+    /// Never blocks.
+    pub fn pump(&self) -> Result<()> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
+        }
+
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status = unsafe { shim_context_pump(self.handle, &mut error_ptr) };
+
+        if status != SHIM_STATUS_OK {
+            return Err(unsafe { take_status_error(status, error_ptr, "failed to pump context") });
+        }
+
+        Ok(())
+    }
+
+    fn register_function(
+        &mut self,
+        name: &str,
+        function_id: u64,
+        kind: HostFunctionKind<'_>,
+    ) -> Result<()> {
+        if self.handle.is_null() {
+            unsafe { native::drop_function(function_id) };
+            return Err(V8Error::new("context was disposed"));
+        }
+
+        let c_name = match CString::new(name) {
+            Ok(value) => value,
+            Err(_) => {
+                unsafe { native::drop_function(function_id) };
+                return Err(V8Error::new(NULL_BYTE_MESSAGE));
+            }
+        };
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+
+        let status = match kind {
+            HostFunctionKind::Sync => unsafe {
+                shim_context_register_host_function(
+                    self.handle,
+                    c_name.as_ptr(),
+                    function_id,
+                    &mut error_ptr,
+                )
+            },
+            HostFunctionKind::Async => unsafe {
+                shim_context_register_async_host_function(
+                    self.handle,
+                    c_name.as_ptr(),
+                    function_id,
+                    &mut error_ptr,
+                )
+            },
+            HostFunctionKind::Fast { args, returns } => {
+                let arg_types: Vec<i32> = args.iter().map(|arg| arg.as_shim()).collect();
+                unsafe {
+                    shim_context_register_fast_host_function(
+                        self.handle,
+                        c_name.as_ptr(),
+                        function_id,
+                        returns.as_shim(),
+                        arg_types.as_ptr(),
+                        arg_types.len(),
+                        &mut error_ptr,
+                    )
+                }
+            }
+        };
+
+        if status == 0 {
+            unsafe { native::drop_function(function_id) };
+            return Err(unsafe { take_error(error_ptr, "failed to register host function") });
+        }
+
+        Ok(())
+    }
+
+    pub fn bind_function<F>(&mut self, name: &str, func: F) -> Result<()>
+    where
+        F: Fn(&[JsValue]) -> Result<Option<JsValue>> + Send + Sync + 'static,
+    {
+        if self.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
+        }
+
+        let c_name = CString::new(name).map_err(|_| V8Error::new(NULL_BYTE_MESSAGE))?;
+        let function_id = native::register(func);
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+
+        let status = unsafe {
+            shim_context_bind_host_function(
+                self.handle,
+                c_name.as_ptr(),
+                function_id,
+                &mut error_ptr,
+            )
+        };
+
+        if status == 0 {
+            unsafe { native::drop_function(function_id) };
+            return Err(unsafe { take_error(error_ptr, "failed to bind host function") });
+        }
+
+        Ok(())
+    }
+
+    /// Records the current global properties as the state [`Context::restore_baseline`] returns to.
+    pub fn record_baseline(&self) -> Result<()> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
+        }
+
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status = unsafe { shim_context_record_baseline(self.handle, &mut error_ptr) };
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to record context baseline") });
+        }
+        Ok(())
+    }
+
+    /// Deletes globals added since [`Context::record_baseline`] and restores overwritten ones.
+    ///
+    /// Top-level `let`, `const` and `class` bindings are not global properties and survive.
+    pub fn restore_baseline(&self) -> Result<()> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
+        }
+
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status = unsafe { shim_context_restore_baseline(self.handle, &mut error_ptr) };
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to restore context baseline") });
+        }
+        Ok(())
+    }
+
+    /// Cleans the context for reuse without disposing it: registered host functions and the
+    /// isolate's compile cache stay valid, so nothing has to be registered or compiled again.
+    ///
+    /// Both modes also discard promises of async host functions that are still unsettled and
+    /// zero [`Context::cpu_time_used`]. Fails while JavaScript is running, i.e. from a host
+    /// function.
+    pub fn reset(&self, mode: ResetMode) -> Result<()> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
+        }
+
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status = unsafe { shim_context_reset(self.handle, mode.mode(), &mut error_ptr) };
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to reset context") });
+        }
+        Ok(())
+    }
+
+    /// Resolves a (dotted) function path once for repeated calls through [`Function`].
+    ///
+    /// For `"pkg.resolve"`, `pkg` is bound as `this`; top-level functions get the global object.
+    pub fn function(&self, path: &str) -> Result<Function> {
+        Function::resolve(self, path)
+    }
+
+    /// Stores a new instance of `class` that wraps `value` at a (dotted) path. `value` is
+    /// dropped once the object is garbage collected or the context is disposed.
+    pub fn set_global_instance<T: Send + 'static>(
+        &self,
+        path: &str,
+        class: &Class<T>,
+        value: T,
+    ) -> Result<()> {
+        class.instantiate(self, path, value)
+    }
+
+    pub fn call_function(&self, fn_name: &str, args: &[&str]) -> Result<JsValue> {
+        let shim_args: Vec<ShimValue> = args
+            .iter()
+            .map(|value| ShimValue::borrowed_str(value))
+            .collect();
+        self.call_with_shim_args(fn_name, &shim_args)
+    }
+
+    pub fn call_function_values(&self, fn_name: &str, args: &[JsValue]) -> Result<JsValue> {
+        let shim_args = ShimArgs::new(args);
+        self.call_with_shim_args(fn_name, shim_args.as_slice())
+    }
+
+    /// Like [`Context::call_function_values`], with the result streamed the way
+    /// [`Context::eval_to_writer`] does.
+    pub fn call_function_to_writer<W>(
+        &self,
+        fn_name: &str,
+        args: &[JsValue],
+        format: OutputFormat,
+        writer: &mut W,
+    ) -> Result<usize>
+    where
+        W: Write + ?Sized,
+    {
+        let mut sink = WriterSink { writer, written: 0 };
+        self.call_streamed(fn_name, args, format, &mut sink)?;
+        Ok(sink.written)
+    }
+
+    /// Like [`Context::call_function_to_writer`], into a `String` allocated once at the
+    /// exact length.
+    pub fn call_function_string(
+        &self,
+        fn_name: &str,
+        args: &[JsValue],
+        format: OutputFormat,
+    ) -> Result<String> {
+        let mut sink = StringSink::default();
+        self.call_streamed(fn_name, args, format, &mut sink)?;
+        Ok(sink.into_string())
+    }
+
+    fn call_streamed(
+        &self,
+        fn_name: &str,
+        args: &[JsValue],
+        format: OutputFormat,
+        sink: &mut dyn OutputSink,
+    ) -> Result<()> {
+        let shim_args = ShimArgs::new(args);
+        let arg_ptr = if args.is_empty() {
+            ptr::null()
+        } else {
+            shim_args.as_slice().as_ptr()
+        };
+        self.stream_with(
+            sink,
+            "failed to call function",
+            |handle, sink, error_ptr| unsafe {
+                shim_context_call_function_streamed(
+                    handle,
+                    fn_name.as_ptr().cast(),
+                    fn_name.len(),
+                    arg_ptr,
+                    args.len(),
+                    format.flags(),
+                    sink,
+                    error_ptr,
+                )
+            },
+        )
+    }
+
+    /// Like [`Context::call_function_values`], with the result transferred the way
+    /// [`Context::eval_structured`] does.
+    pub fn call_function_structured(&self, fn_name: &str, args: &[JsValue]) -> Result<JsValue> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
+        }
+
+        let shim_args = ShimArgs::new(args);
+        let arg_ptr = if args.is_empty() {
+            ptr::null()
+        } else {
+            shim_args.as_slice().as_ptr()
+        };
+        let mut data_ptr: *mut u8 = ptr::null_mut();
+        let mut length: usize = 0;
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+
+        let status = unsafe {
+            shim_context_call_function_serialized(
+                self.handle,
+                fn_name.as_ptr().cast(),
+                fn_name.len(),
+                arg_ptr,
+                args.len(),
+                &mut data_ptr,
+                &mut length,
+                &mut error_ptr,
+            )
+        };
+
+        if status != SHIM_STATUS_OK {
+            return Err(unsafe { take_status_error(status, error_ptr, "failed to call function") });
+        }
+
+        unsafe { take_serialized(data_ptr, length) }
+    }
+
+    fn call_with_shim_args(&self, fn_name: &str, args: &[ShimValue]) -> Result<JsValue> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
+        }
+
+        let arg_ptr = if args.is_empty() {
+            ptr::null()
+        } else {
+            args.as_ptr()
+        };
+
+        let mut result = ShimValue::default();
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+
+        let status = unsafe {
+            shim_context_call_function_values_utf8(
+                self.handle,
+                fn_name.as_ptr().cast(),
+                fn_name.len(),
+                arg_ptr,
+                args.len(),
+                &mut result,
+                &mut error_ptr,
+            )
+        };
+
+        if status != SHIM_STATUS_OK {
+            return Err(unsafe { take_status_error(status, error_ptr, "failed to call function") });
+        }
+
+        Ok(unsafe { take_value(&mut result) })
+    }
+
+    /// Terminates any call into this context that runs longer than `timeout`.
+    ///
+    /// Deadlines are enforced by one watchdog thread shared by all isolates; a terminated call
+    /// fails with [`ErrorKind::Timeout`] and the context stays usable.
+    pub fn set_timeout(&self, timeout: Option<Duration>) -> Result<()> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
+        }
+
+        let timeout_ms = timeout.map_or(0, |value| {
+            u64::try_from(value.as_millis()).unwrap_or(u64::MAX).max(1)
+        });
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status = unsafe { shim_context_set_timeout(self.handle, timeout_ms, &mut error_ptr) };
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to set timeout") });
+        }
+        Ok(())
+    }
+
+    /// Limits the CPU time all calls into this context may use together and resets the time
+    /// used so far. Once exhausted, calls fail with [`ErrorKind::CpuBudget`].
+    pub fn set_cpu_budget(&self, budget: Option<Duration>) -> Result<()> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
+        }
+
+        let budget_us = budget.map_or(0, |value| {
+            u64::try_from(value.as_micros()).unwrap_or(u64::MAX).max(1)
+        });
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status = unsafe { shim_context_set_cpu_budget(self.handle, budget_us, &mut error_ptr) };
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to set CPU budget") });
+        }
+        Ok(())
+    }
+
+    pub fn cpu_time_used(&self) -> Result<Duration> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
+        }
+
+        let mut used_us: u64 = 0;
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status =
+            unsafe { shim_context_cpu_time_used(self.handle, &mut used_us, &mut error_ptr) };
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to read CPU time") });
+        }
+        Ok(Duration::from_micros(used_us))
+    }
+
+    pub fn counters(&self) -> Result<Counters> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
+        }
+
+        let mut counters = ShimCounters::default();
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status = unsafe { shim_context_counters(self.handle, &mut counters, &mut error_ptr) };
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to read context counters") });
+        }
+        Ok(counters.into())
+    }
+
+    /// Starts sampling JavaScript stacks into the CPU profile `title`; only frames of this
+    /// context are kept. A zero `sampling_interval` uses V8's default of 1ms. Titles are
+    /// shared by all contexts of the isolate, and while profiles overlap the interval of the
+    /// first one applies.
+    pub fn start_cpu_profile(&self, title: &str, sampling_interval: Duration) -> Result<()> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
+        }
+
+        let interval_us = u32::try_from(sampling_interval.as_micros())
+            .map_err(|_| V8Error::new("sampling interval was too long"))?;
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status = unsafe {
+            shim_context_start_cpu_profile(
+                self.handle,
+                title.as_ptr() as *const c_char,
+                title.len(),
+                interval_us,
+                &mut error_ptr,
+            )
+        };
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to start CPU profile") });
+        }
+        Ok(())
+    }
+
+    /// Stops the CPU profile `title` and returns it in the `.cpuprofile` JSON format that
+    /// Chrome DevTools and most flame graph tools load.
+    pub fn stop_cpu_profile(&self, title: &str) -> Result<String> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
+        }
+
+        let mut json_ptr: *mut u8 = ptr::null_mut();
+        let mut json_len: usize = 0;
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+        let status = unsafe {
+            shim_context_stop_cpu_profile(
+                self.handle,
+                title.as_ptr() as *const c_char,
+                title.len(),
+                &mut json_ptr,
+                &mut json_len,
+                &mut error_ptr,
+            )
+        };
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to stop CPU profile") });
+        }
+        let json = unsafe { take_buffer(json_ptr, json_len) };
+        String::from_utf8(json).map_err(|_| V8Error::new("CPU profile was not valid UTF-8"))
+    }
+
+    pub fn dispose(&mut self) {
+        if self.handle.is_null() {
+            return;
+        }
+        unsafe {
+            shim_dispose_context(self.handle);
+        }
+        self.handle = ptr::null_mut();
+    }
+}
+
+impl Drop for Context {
+    fn drop(&mut self) {
+        self.dispose();
+    }
+}
+
+impl Script {
+    pub fn compile(isolate: &Isolate, source: &str) -> Result<Self> {
+        if isolate.handle.is_null() {
+            return Err(V8Error::new("isolate was disposed"));
+        }
+
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+
+        let handle = unsafe {
+            shim_compile_script_utf8(
+                isolate.handle,
+                source.as_ptr().cast(),
+                source.len(),
+                ptr::null(),
+                0,
+                ptr::null_mut(),
+                &mut error_ptr,
+            )
+        };
+
+        if handle.is_null() {
+            return Err(unsafe { take_error(error_ptr, "failed to compile script") });
+        }
+
+        Ok(Self {
+            handle,
+            isolate: isolate.handle,
+            source_hash: source_hash(source),
+        })
+    }
+
+    /// Compiles `source` the way `options` asks for, e.g. eagerly for a script whose functions
+    /// all run on the first request.
+    pub fn compile_with_options(
+        isolate: &Isolate,
+        source: &str,
+        options: &CompileOptions,
+    ) -> Result<Self> {
+        if isolate.handle.is_null() {
+            return Err(V8Error::new("isolate was disposed"));
+        }
+
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+
+        let handle = unsafe {
+            shim_compile_script_with_options(
+                isolate.handle,
+                source.as_ptr().cast(),
+                source.len(),
+                ptr::null(),
+                0,
+                options.flags(),
+                ptr::null_mut(),
+                &mut error_ptr,
+            )
+        };
+
+        if handle.is_null() {
+            return Err(unsafe { take_error(error_ptr, "failed to compile script") });
+        }
+
+        Ok(Self {
+            handle,
+            isolate: isolate.handle,
+            source_hash: source_hash(source),
+        })
+    }
+
+    /// Compiles `source`, consuming `cache` when V8 accepts it.
+    ///
+    /// Returns the script together with a flag that is `true` when the cache was used. A
+    /// rejected cache (different V8 build, flags or source) falls back to a full compile.
+    pub fn compile_with_cache(
+        isolate: &Isolate,
+        source: &str,
+        cache: &CodeCache,
+    ) -> Result<(Self, bool)> {
+        if isolate.handle.is_null() {
+            return Err(V8Error::new("isolate was disposed"));
+        }
+        if !cache.matches(source) {
+            return Ok((Self::compile(isolate, source)?, false));
+        }
+
+        let mut rejected: i32 = 0;
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+
+        let handle = unsafe {
+            shim_compile_script_utf8(
+                isolate.handle,
+                source.as_ptr().cast(),
+                source.len(),
+                cache.as_bytes().as_ptr(),
+                cache.len(),
+                &mut rejected,
+                &mut error_ptr,
+            )
+        };
+
+        if handle.is_null() {
+            return Err(unsafe { take_error(error_ptr, "failed to compile script") });
+        }
+
+        let script = Self {
+            handle,
+            isolate: isolate.handle,
+            source_hash: source_hash(source),
+        };
+        Ok((script, rejected == 0))
+    }
+
+    /// Compiles `source` without copying it into the V8 heap; the compiled script keeps a
+    /// reference to the shared buffer instead.
+    pub fn compile_external(isolate: &Isolate, source: &ExternalSource) -> Result<Self> {
+        Ok(Self::compile_external_with(isolate, source, None)?.0)
+    }
+
+    /// Like [`Script::compile_with_cache`], for an [`ExternalSource`].
+    pub fn compile_external_with_cache(
+        isolate: &Isolate,
+        source: &ExternalSource,
+        cache: &CodeCache,
+    ) -> Result<(Self, bool)> {
+        if !cache.matches_hash(source.source_hash()) {
+            return Ok((Self::compile_external(isolate, source)?, false));
+        }
+        Self::compile_external_with(isolate, source, Some(cache))
+    }
+
+    fn compile_external_with(
+        isolate: &Isolate,
+        source: &ExternalSource,
+        cache: Option<&CodeCache>,
+    ) -> Result<(Self, bool)> {
+        if isolate.handle.is_null() {
+            return Err(V8Error::new("isolate was disposed"));
+        }
+
+        let (cache_data, cache_length) = cache.map_or((ptr::null(), 0), |cache| {
+            (cache.as_bytes().as_ptr(), cache.len())
+        });
+        let shim_source = source.to_shim();
+        let mut rejected: i32 = 0;
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+
+        let handle = unsafe {
+            shim_compile_script_external(
+                isolate.handle,
+                &shim_source,
+                cache_data,
+                cache_length,
+                &mut rejected,
+                &mut error_ptr,
+            )
+        };
+
+        if handle.is_null() {
+            return Err(unsafe { take_error(error_ptr, "failed to compile script") });
+        }
+
+        let script = Self {
+            handle,
+            isolate: isolate.handle,
+            source_hash: source.source_hash(),
+        };
+        Ok((script, cache.is_some() && rejected == 0))
+    }
+
+    /// Compiles `source` using the code cache stored at `path`, rewriting the file when it is
+    /// missing, stale or rejected by V8.
+    pub fn compile_cached(isolate: &Isolate, source: &str, path: impl AsRef<Path>) -> Result<Self> {
+        let path = path.as_ref();
+        if let Some(cache) = CodeCache::load(path, source)? {
+            let (script, accepted) = Self::compile_with_cache(isolate, source, &cache)?;
+            if accepted {
+                return Ok(script);
+            }
+            script.create_code_cache()?.write_to(path)?;
+            return Ok(script);
+        }
+
+        let script = Self::compile(isolate, source)?;
+        script.create_code_cache()?.write_to(path)?;
+        Ok(script)
+    }
+
+    pub fn create_code_cache(&self) -> Result<CodeCache> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("script was disposed"));
+        }
+
+        let mut data_ptr: *mut u8 = ptr::null_mut();
+        let mut length: usize = 0;
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+
+        let status = unsafe {
+            shim_script_create_code_cache(self.handle, &mut data_ptr, &mut length, &mut error_ptr)
+        };
+
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to create code cache") });
+        }
+
+        let data = unsafe { take_buffer(data_ptr, length) };
+        Ok(CodeCache::new(self.source_hash, data))
+    }
+
+    /// Runs the script in `context`, makes each warmup call, and returns a code cache that
+    /// also holds the bytecode of every function those calls compiled.
+    ///
+    /// A process that compiles with this cache skips parsing and compiling those functions on
+    /// its first request. Optimized machine code is never part of a code cache; hot functions
+    /// still tier up, but from bytecode that is already there.
+    pub fn warmup(&self, context: &Context, calls: &[WarmupCall<'_>]) -> Result<CodeCache> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("script was disposed"));
+        }
+        if context.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
+        }
+
+        let args: Vec<ShimArgs> = calls.iter().map(|call| ShimArgs::new(call.args)).collect();
+        let shim_calls: Vec<ShimWarmupCall> = calls
+            .iter()
+            .zip(&args)
+            .map(|(call, args)| ShimWarmupCall {
+                function: call.function.as_ptr().cast(),
+                function_length: call.function.len(),
+                args: if call.args.is_empty() {
+                    ptr::null()
+                } else {
+                    args.as_slice().as_ptr()
+                },
+                arg_count: call.args.len(),
+                iterations: call.iterations,
+            })
+            .collect();
+        let mut data_ptr: *mut u8 = ptr::null_mut();
+        let mut length: usize = 0;
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+
+        let status = unsafe {
+            shim_script_warmup(
+                self.handle,
+                context.handle,
+                shim_calls.as_ptr(),
+                shim_calls.len(),
+                &mut data_ptr,
+                &mut length,
+                &mut error_ptr,
+            )
+        };
+
+        if status != SHIM_STATUS_OK {
+            return Err(unsafe { take_status_error(status, error_ptr, "script warmup failed") });
+        }
+
+        let data = unsafe { take_buffer(data_ptr, length) };
+        Ok(CodeCache::new(self.source_hash, data))
+    }
+
+    pub fn raw_handle(&self) -> V8ScriptHandle {
+        self.handle
+    }
+
+    pub fn run(&self, context: &Context) -> Result<JsValue> {
+        if self.handle.is_null() {
+            return Err(V8Error::new("script was disposed"));
+        }
+        if context.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
+        }
+        if context.isolate != self.isolate {
+            return Err(V8Error::new(
+                "script and context belong to different isolates",
+            ));
+        }
+
+        let mut result = ShimValue::default();
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+
+        let status = unsafe {
+            shim_script_run_value(self.handle, context.handle, &mut result, &mut error_ptr)
+        };
+
+        if status != SHIM_STATUS_OK {
+            return Err(unsafe { take_status_error(status, error_ptr, "failed to run script") });
         }
 
-        let value = unsafe { take_string(result_ptr).unwrap_or_default() };
-        Ok(JsValue::new(value))
+        Ok(unsafe { take_value(&mut result) })
     }
 
     pub fn dispose(&mut self) {
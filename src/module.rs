@@ -0,0 +1,111 @@
+use std::os::raw::{c_char, c_void};
+use std::slice;
+
+use crate::error::{Result, V8Error};
+use crate::ffi::{ShimModuleRequest, ShimModuleSource};
+use crate::native::set_error;
+use crate::value::JsValue;
+
+/// An import the loader passed to [`Context::load_module`] is asked to resolve.
+///
+/// [`Context::load_module`]: crate::Context::load_module
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct ModuleRequest<'a> {
+    /// The specifier as written in the `import` statement.
+    pub specifier: &'a str,
+    /// Resolved name of the importing module.
+    pub referrer: &'a str,
+}
+
+/// A resolved import: the module's name, which identifies it within the context, and its
+/// source text.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct ModuleSource {
+    pub name: String,
+    pub source: String,
+}
+
+impl ModuleSource {
+    pub fn new(name: impl Into<String>, source: impl Into<String>) -> Self {
+        Self {
+            name: name.into(),
+            source: source.into(),
+        }
+    }
+}
+
+pub(crate) type ModuleLoader<'a> =
+    dyn FnMut(&[ModuleRequest<'_>]) -> Result<Vec<ModuleSource>> + 'a;
+
+unsafe fn shim_str<'a>(data: *const c_char, length: usize) -> Result<&'a str> {
+    if data.is_null() || length == 0 {
+        return Ok("");
+    }
+    let bytes = unsafe { slice::from_raw_parts(data.cast::<u8>(), length) };
+    std::str::from_utf8(bytes).map_err(|_| V8Error::new("module specifier was not valid UTF-8"))
+}
+
+unsafe fn load(
+    loader: *mut c_void,
+    requests: *const ShimModuleRequest,
+    count: usize,
+) -> Result<Vec<ModuleSource>> {
+    let loader = unsafe { (loader as *mut &mut ModuleLoader<'_>).as_mut() }
+        .ok_or_else(|| V8Error::new("no module loader was given"))?;
+    let requests = if requests.is_null() || count == 0 {
+        &[]
+    } else {
+        unsafe { slice::from_raw_parts(requests, count) }
+    };
+    let requests = requests
+        .iter()
+        .map(|request| unsafe {
+            Ok(ModuleRequest {
+                specifier: shim_str(request.specifier, request.specifier_length)?,
+                referrer: shim_str(request.referrer, request.referrer_length)?,
+            })
+        })
+        .collect::<Result<Vec<_>>>()?;
+
+    let sources = loader(&requests)?;
+    if sources.len() != requests.len() {
+        return Err(V8Error::new(
+            "module loader must return one source per request",
+        ));
+    }
+    Ok(sources)
+}
+
+// loader points at the `&mut ModuleLoader` borrowed by Context::load_module for the call.
+#[unsafe(no_mangle)]
+pub unsafe extern "C" fn pacm_v8__module_load(
+    loader: *mut c_void,
+    requests: *const ShimModuleRequest,
+    count: usize,
+    sources_out: *mut ShimModuleSource,
+    error_out: *mut *mut c_char,
+) -> i32 {
+    if !error_out.is_null() {
+        unsafe {
+            *error_out = std::ptr::null_mut();
+        }
+    }
+
+    match unsafe { load(loader, requests, count) } {
+        Ok(sources) => {
+            if sources_out.is_null() {
+                return 1;
+            }
+            let out = unsafe { slice::from_raw_parts_mut(sources_out, count) };
+            for (slot, source) in out.iter_mut().zip(sources) {
+                slot.name = JsValue::String(source.name).into_shim();
+                slot.source = JsValue::String(source.source).into_shim();
+            }
+            1
+        }
+        Err(error) => {
+            set_error(error_out, error.message(), "failed to load module imports");
+            0
+        }
+    }
+}
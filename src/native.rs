@@ -1,117 +1,239 @@
-use std::collections::HashMap;
-use std::ffi::{CStr, CString};
+use std::any::Any;
+use std::ffi::CString;
 use std::os::raw::c_char;
 use std::ptr;
 use std::slice;
-use std::sync::atomic::{AtomicU64, Ordering};
-use std::sync::{Arc, Mutex, OnceLock};
 
 use crate::error::{Result, V8Error};
-use crate::value::JsValue;
+use crate::ffi::{
+    SHIM_FAST_BOOL, SHIM_FAST_FLOAT64, SHIM_FAST_INT32, SHIM_FAST_VOID, ShimValue,
+    V8PromiseCompleterHandle,
+};
+use crate::promise::PromiseResolver;
+use crate::value::{JsValue, JsValueRef, release_owned_shim};
 
 type HostCallback = dyn Fn(&[JsValue]) -> Result<Option<JsValue>> + Send + Sync + 'static;
+type BorrowingHostCallback =
+    dyn Fn(&[JsValueRef<'_>]) -> Result<Option<JsValue>> + Send + Sync + 'static;
+type AsyncHostCallback = dyn Fn(&[JsValue], PromiseResolver) + Send + Sync + 'static;
+pub(crate) type MemberCallback =
+    dyn Fn(&(dyn Any + Send), &[JsValue]) -> Result<Option<JsValue>> + Send + Sync + 'static;
 
-struct HostFunctionEntry {
-    callback: Arc<HostCallback>,
+enum Callback {
+    Owned(Box<HostCallback>),
+    Borrowing(Box<BorrowingHostCallback>),
+    Async(Box<AsyncHostCallback>),
+    Member(Box<MemberCallback>),
 }
 
-static REGISTRY: OnceLock<Mutex<HashMap<u64, HostFunctionEntry>>> = OnceLock::new();
-static NEXT_ID: AtomicU64 = AtomicU64::new(1);
+type Instance = Box<dyn Any + Send>;
 
-fn registry() -> &'static Mutex<HashMap<u64, HostFunctionEntry>> {
-    REGISTRY.get_or_init(|| Mutex::new(HashMap::new()))
+/// C type of an argument or the result of a fast host function.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum FastType {
+    /// Only valid as a result.
+    Void,
+    /// Only valid as a result.
+    Bool,
+    Int32,
+    Float64,
 }
 
+impl FastType {
+    pub(crate) fn as_shim(self) -> i32 {
+        match self {
+            FastType::Void => SHIM_FAST_VOID,
+            FastType::Bool => SHIM_FAST_BOOL,
+            FastType::Int32 => SHIM_FAST_INT32,
+            FastType::Float64 => SHIM_FAST_FLOAT64,
+        }
+    }
+}
+
+// A function id is the address of its boxed callback, so a call needs no registry lookup
+// and no lock. Once a context has registered the id, the shim owns it: the context's
+// NativeCallbackData drops it exactly once, on the isolate's thread, which is also the
+// only thread that calls it. Replaced and disposed registrations are retired first, so
+// function objects that outlive them throw instead of calling a dropped id, and the drop
+// waits until no host call is running.
 pub(crate) fn register<F>(callback: F) -> u64
 where
     F: Fn(&[JsValue]) -> Result<Option<JsValue>> + Send + Sync + 'static,
 {
-    let id = NEXT_ID.fetch_add(1, Ordering::Relaxed);
-    let entry = HostFunctionEntry {
-        callback: Arc::from(Box::new(callback) as Box<HostCallback>),
-    };
-    let mut guard = registry().lock().unwrap();
-    guard.insert(id, entry);
-    id
+    into_id(Callback::Owned(Box::new(callback)))
 }
 
-pub(crate) fn drop_function(id: u64) {
-    let mut guard = match REGISTRY.get() {
-        Some(lock) => lock.lock().unwrap(),
-        None => return,
-    };
-    guard.remove(&id);
+pub(crate) fn register_borrowing<F>(callback: F) -> u64
+where
+    F: Fn(&[JsValueRef<'_>]) -> Result<Option<JsValue>> + Send + Sync + 'static,
+{
+    into_id(Callback::Borrowing(Box::new(callback)))
+}
+
+pub(crate) fn register_async<F>(callback: F) -> u64
+where
+    F: Fn(&[JsValue], PromiseResolver) + Send + Sync + 'static,
+{
+    into_id(Callback::Async(Box::new(callback)))
+}
+
+/// A class member; called with the host object of the instance it was invoked on.
+pub(crate) fn register_member(callback: Box<MemberCallback>) -> u64 {
+    into_id(Callback::Member(callback))
+}
+
+/// Boxes the host object of a class instance into the token the shim stores with it. The
+/// shim drops it through `pacm_v8__class_instance_drop`.
+pub(crate) fn into_instance(value: Instance) -> u64 {
+    Box::into_raw(Box::new(value)) as usize as u64
 }
 
-pub(crate) fn drop_many(ids: impl IntoIterator<Item = u64>) {
-    for id in ids {
-        drop_function(id);
+/// # Safety
+/// `token` must come from [`into_instance`] and not be used afterwards.
+pub(crate) unsafe fn drop_instance(token: u64) {
+    if token != 0 {
+        drop(unsafe { Box::from_raw(token as usize as *mut Instance) });
     }
 }
 
-fn invoke(id: u64, args: &[JsValue]) -> Result<Option<JsValue>> {
-    let callback = {
-        let guard = registry().lock().unwrap();
-        guard
-            .get(&id)
-            .map(|entry| Arc::clone(&entry.callback))
-            .ok_or_else(|| V8Error::new("native function not found"))?
-    };
-    (callback)(args)
+fn into_id(callback: Callback) -> u64 {
+    Box::into_raw(Box::new(callback)) as usize as u64
+}
+
+/// # Safety
+/// `id` must come from one of the `register` functions and not have been dropped, and no
+/// call through it may be running.
+pub(crate) unsafe fn drop_function(id: u64) {
+    if id != 0 {
+        drop(unsafe { Box::from_raw(id as usize as *mut Callback) });
+    }
 }
 
-unsafe fn convert_args(args: *const *const c_char, count: usize) -> Result<Vec<JsValue>> {
+unsafe fn lookup<'a>(id: u64) -> Result<&'a Callback> {
+    unsafe { (id as usize as *const Callback).as_ref() }
+        .ok_or_else(|| V8Error::new("native function not found"))
+}
+
+unsafe fn shim_args<'a>(args: *const ShimValue, count: usize) -> &'a [ShimValue] {
     if args.is_null() || count == 0 {
-        return Ok(Vec::new());
+        &[]
+    } else {
+        unsafe { slice::from_raw_parts(args, count) }
     }
+}
 
-    let arg_slice = unsafe { slice::from_raw_parts(args, count) };
-    let mut values = Vec::with_capacity(count);
+// Calls with few arguments, such as the numeric fast path, convert into a stack buffer.
+const INLINE_ARGS: usize = 4;
 
-    for &ptr in arg_slice {
-        if ptr.is_null() {
-            values.push(JsValue::new(String::new()));
-            continue;
-        }
+unsafe fn with_owned_args<R>(args: &[ShimValue], call: impl FnOnce(&[JsValue]) -> R) -> R {
+    let convert = |value: &ShimValue| unsafe { JsValue::from_shim(value) };
+    if args.len() <= INLINE_ARGS {
+        let inline: [JsValue; INLINE_ARGS] =
+            std::array::from_fn(|index| args.get(index).map_or(JsValue::Undefined, convert));
+        call(&inline[..args.len()])
+    } else {
+        call(&args.iter().map(convert).collect::<Vec<_>>())
+    }
+}
+
+unsafe fn invoke(id: u64, args: *const ShimValue, count: usize) -> Result<Option<JsValue>> {
+    let arg_slice = unsafe { shim_args(args, count) };
 
-        let value = unsafe { CStr::from_ptr(ptr) }
-            .to_string_lossy()
-            .into_owned();
-        values.push(JsValue::new(value));
+    match unsafe { lookup(id) }? {
+        Callback::Owned(callback) => unsafe {
+            with_owned_args(arg_slice, |values| callback(values))
+        },
+        Callback::Borrowing(callback) => {
+            let values = arg_slice
+                .iter()
+                .map(|value| unsafe { JsValueRef::from_shim(value) })
+                .collect::<Option<Vec<_>>>()
+                .ok_or_else(|| V8Error::new("argument was not valid UTF-8"))?;
+            (callback)(&values)
+        }
+        Callback::Async(_) => Err(V8Error::new(
+            "asynchronous host function was called synchronously",
+        )),
+        Callback::Member(_) => Err(V8Error::new("class member was called without an instance")),
     }
+}
 
-    Ok(values)
+unsafe fn invoke_member(
+    id: u64,
+    instance: u64,
+    args: *const ShimValue,
+    count: usize,
+) -> Result<Option<JsValue>> {
+    let Callback::Member(callback) = (unsafe { lookup(id) })? else {
+        return Err(V8Error::new("host function is not a class member"));
+    };
+    let instance = unsafe { (instance as usize as *const Instance).as_ref() }
+        .ok_or_else(|| V8Error::new("class instance was released"))?;
+    let arg_slice = unsafe { shim_args(args, count) };
+    unsafe { with_owned_args(arg_slice, |values| callback(instance.as_ref(), values)) }
 }
 
-unsafe fn set_string(out: *mut *mut c_char, value: Option<String>) -> Result<()> {
+pub(crate) fn set_error(out: *mut *mut c_char, message: &str, fallback: &str) {
     if out.is_null() {
-        return Ok(());
+        return;
     }
-
+    let message = CString::new(message).unwrap_or_else(|_| CString::new(fallback).unwrap());
     unsafe {
-        *out = ptr::null_mut();
+        *out = message.into_raw();
     }
-    if let Some(value) = value {
-        let cstring =
-            CString::new(value).map_err(|_| V8Error::new("string contained interior null byte"))?;
-        unsafe {
-            *out = cstring.into_raw();
-        }
-    }
-    Ok(())
 }
 
 #[unsafe(no_mangle)]
 pub unsafe extern "C" fn pacm_v8__host_function_invoke(
     id: u64,
-    args: *const *const c_char,
+    args: *const ShimValue,
     arg_count: usize,
-    result_out: *mut *mut c_char,
+    result_out: *mut ShimValue,
     error_out: *mut *mut c_char,
 ) -> i32 {
+    unsafe {
+        complete_call(result_out, error_out, "host function failed", || {
+            invoke(id, args, arg_count)
+        })
+    }
+}
+
+#[unsafe(no_mangle)]
+pub unsafe extern "C" fn pacm_v8__class_member_invoke(
+    id: u64,
+    instance: u64,
+    args: *const ShimValue,
+    arg_count: usize,
+    result_out: *mut ShimValue,
+    error_out: *mut *mut c_char,
+) -> i32 {
+    unsafe {
+        complete_call(result_out, error_out, "class member failed", || {
+            invoke_member(id, instance, args, arg_count)
+        })
+    }
+}
+
+#[unsafe(no_mangle)]
+pub unsafe extern "C" fn pacm_v8__class_instance_drop(instance: u64) {
+    unsafe { drop_instance(instance) };
+}
+
+unsafe fn complete_call(
+    result_out: *mut ShimValue,
+    error_out: *mut *mut c_char,
+    fallback: &str,
+    call: impl FnOnce() -> Result<Option<JsValue>>,
+) -> i32 {
+    // The shim may offer a scratch buffer for the result payload in data/length.
+    let mut scratch: &mut [u8] = &mut [];
     if !result_out.is_null() {
         unsafe {
-            *result_out = ptr::null_mut();
+            let offered = *result_out;
+            if !offered.data.is_null() && offered.length > 0 {
+                scratch = slice::from_raw_parts_mut(offered.data as *mut u8, offered.length);
+            }
+            *result_out = ShimValue::default();
         }
     }
     if !error_out.is_null() {
@@ -120,52 +242,53 @@ pub unsafe extern "C" fn pacm_v8__host_function_invoke(
         }
     }
 
-    let args = match unsafe { convert_args(args, arg_count) } {
-        Ok(values) => values,
-        Err(error) => {
-            if !error_out.is_null() {
-                let message = CString::new(error.message())
-                    .unwrap_or_else(|_| CString::new("failed to convert arguments").unwrap());
+    match call() {
+        Ok(Some(value)) => {
+            if !result_out.is_null() {
                 unsafe {
-                    *error_out = message.into_raw();
+                    *result_out = value.into_shim_in(scratch);
                 }
             }
-            return 0;
+            1
         }
-    };
-
-    match invoke(id, &args) {
-        Ok(Some(value)) => match unsafe { set_string(result_out, Some(value.into_string())) } {
-            Ok(_) => 1,
-            Err(error) => {
-                if !error_out.is_null() {
-                    let message = CString::new(error.message()).unwrap_or_else(|_| {
-                        CString::new("host function result contained interior null byte").unwrap()
-                    });
-                    unsafe {
-                        *error_out = message.into_raw();
-                    }
-                }
-                0
-            }
-        },
         Ok(None) => 1,
         Err(error) => {
-            if !error_out.is_null() {
-                let message = CString::new(error.message())
-                    .unwrap_or_else(|_| CString::new("host function failed").unwrap());
-                unsafe {
-                    *error_out = message.into_raw();
-                }
-            }
+            set_error(error_out, error.message(), fallback);
             0
         }
     }
 }
 
+// Arguments are copied before the callback runs, so it may hand them to another thread.
+#[unsafe(no_mangle)]
+pub unsafe extern "C" fn pacm_v8__host_function_invoke_async(
+    id: u64,
+    args: *const ShimValue,
+    arg_count: usize,
+    completer: V8PromiseCompleterHandle,
+) {
+    let resolver = PromiseResolver::new(completer);
+    match unsafe { lookup(id) } {
+        Ok(Callback::Async(callback)) => {
+            let arg_slice = unsafe { shim_args(args, arg_count) };
+            unsafe { with_owned_args(arg_slice, |values| callback(values, resolver)) }
+        }
+        Ok(_) => resolver.reject("host function is not asynchronous"),
+        Err(error) => resolver.reject(error.message()),
+    }
+}
+
+#[unsafe(no_mangle)]
+pub unsafe extern "C" fn pacm_v8__value_release(value: *mut ShimValue) {
+    if value.is_null() {
+        return;
+    }
+    unsafe { release_owned_shim(&mut *value) };
+}
+
 #[unsafe(no_mangle)]
 pub unsafe extern "C" fn pacm_v8__host_function_drop(id: u64) {
-    drop_function(id);
+    unsafe { drop_function(id) };
 }
 
 #[unsafe(no_mangle)]
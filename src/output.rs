@@ -0,0 +1,136 @@
+use std::ffi::c_void;
+use std::io::{self, Write};
+use std::os::raw::c_char;
+use std::slice;
+
+use crate::error::V8Error;
+use crate::ffi::{SHIM_OUTPUT_JSON, SHIM_OUTPUT_TEXT};
+
+/// How a streamed result is turned into text.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum OutputFormat {
+    /// The result's string conversion, as [`Context::eval`] returns it for non-scalar values.
+    ///
+    /// [`Context::eval`]: crate::Context::eval
+    #[default]
+    Text,
+    /// `JSON.stringify(result)`.
+    Json,
+}
+
+impl OutputFormat {
+    pub(crate) fn flags(self) -> i32 {
+        match self {
+            OutputFormat::Text => SHIM_OUTPUT_TEXT,
+            OutputFormat::Json => SHIM_OUTPUT_JSON,
+        }
+    }
+}
+
+/// Receives a streamed result: its exact UTF-8 length first, then the text in order.
+pub(crate) trait OutputSink {
+    fn begin(&mut self, length: usize) -> io::Result<()>;
+    fn write(&mut self, chunk: &[u8]) -> io::Result<()>;
+}
+
+pub(crate) struct WriterSink<'a, W: Write + ?Sized> {
+    pub(crate) writer: &'a mut W,
+    pub(crate) written: usize,
+}
+
+impl<W: Write + ?Sized> OutputSink for WriterSink<'_, W> {
+    fn begin(&mut self, _length: usize) -> io::Result<()> {
+        Ok(())
+    }
+
+    fn write(&mut self, chunk: &[u8]) -> io::Result<()> {
+        self.writer.write_all(chunk)?;
+        self.written += chunk.len();
+        Ok(())
+    }
+}
+
+// Reserves the announced length up front, so the text is copied out of V8 exactly once.
+#[derive(Default)]
+pub(crate) struct StringSink {
+    pub(crate) bytes: Vec<u8>,
+}
+
+impl StringSink {
+    pub(crate) fn into_string(self) -> String {
+        String::from_utf8(self.bytes)
+            .unwrap_or_else(|error| String::from_utf8_lossy(error.as_bytes()).into_owned())
+    }
+}
+
+impl OutputSink for StringSink {
+    fn begin(&mut self, length: usize) -> io::Result<()> {
+        self.bytes
+            .try_reserve_exact(length)
+            .map_err(|_| io::Error::new(io::ErrorKind::OutOfMemory, "result does not fit"))
+    }
+
+    fn write(&mut self, chunk: &[u8]) -> io::Result<()> {
+        self.bytes.extend_from_slice(chunk);
+        Ok(())
+    }
+}
+
+/// What the shim's `sink` pointer refers to for the duration of one streamed call.
+pub(crate) struct SinkState<'a> {
+    sink: &'a mut dyn OutputSink,
+    error: Option<io::Error>,
+}
+
+impl<'a> SinkState<'a> {
+    pub(crate) fn new(sink: &'a mut dyn OutputSink) -> Self {
+        Self { sink, error: None }
+    }
+
+    pub(crate) fn as_ptr(&mut self) -> *mut c_void {
+        (self as *mut Self).cast()
+    }
+
+    /// Prefers the sink's own I/O error over the shim's generic abort message.
+    pub(crate) fn into_error(self, error: V8Error) -> V8Error {
+        match self.error {
+            Some(io_error) => V8Error::new(format!("failed to write result: {io_error}")),
+            None => error,
+        }
+    }
+
+    fn run(&mut self, step: impl FnOnce(&mut dyn OutputSink) -> io::Result<()>) -> i32 {
+        match step(&mut *self.sink) {
+            Ok(()) => 1,
+            Err(error) => {
+                self.error = Some(error);
+                0
+            }
+        }
+    }
+}
+
+#[unsafe(no_mangle)]
+pub unsafe extern "C" fn pacm_v8__output_begin(sink: *mut c_void, length: usize) -> i32 {
+    let Some(state) = (unsafe { (sink as *mut SinkState<'_>).as_mut() }) else {
+        return 0;
+    };
+    state.run(|sink| sink.begin(length))
+}
+
+#[unsafe(no_mangle)]
+pub unsafe extern "C" fn pacm_v8__output_write(
+    sink: *mut c_void,
+    data: *const c_char,
+    length: usize,
+) -> i32 {
+    let Some(state) = (unsafe { (sink as *mut SinkState<'_>).as_mut() }) else {
+        return 0;
+    };
+    let chunk = if data.is_null() || length == 0 {
+        &[][..]
+    } else {
+        unsafe { slice::from_raw_parts(data.cast::<u8>(), length) }
+    };
+    state.run(|sink| sink.write(chunk))
+}
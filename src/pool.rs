@@ -0,0 +1,313 @@
+use std::cell::RefCell;
+use std::rc::Rc;
+use std::time::{Duration, Instant};
+
+use crate::error::Result;
+use crate::isolate::IsolateBuilder;
+use crate::snapshot::Snapshot;
+use crate::{Context, Isolate, ResetMode};
+
+type SetupFn = dyn Fn(&mut Context) -> Result<()>;
+
+/// What happens to a pooled context when it is returned.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum ResetPolicy {
+    /// Dispose the context and prepare a new one on the same isolate.
+    FreshContext,
+    /// Keep the context (and its compile cache) and restore the globals recorded after warmup.
+    RestoreGlobals,
+    /// Recreate the V8 context in place with [`ResetMode::Recreate`]: host functions registered
+    /// by the setup closure stay installed and the warmup sources run again from the compile
+    /// cache. The setup closure itself runs only once, so globals it sets are not restored.
+    RecreateContext,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub struct PoolMetrics {
+    pub size: usize,
+    pub idle: usize,
+    pub in_use: usize,
+    pub created: u64,
+    pub checkouts: u64,
+    pub resets: u64,
+    pub reset_failures: u64,
+    pub total_wait: Duration,
+    pub max_wait: Duration,
+}
+
+impl PoolMetrics {
+    pub fn average_wait(&self) -> Duration {
+        if self.checkouts == 0 {
+            return Duration::ZERO;
+        }
+        Duration::from_nanos((self.total_wait.as_nanos() / u128::from(self.checkouts)) as u64)
+    }
+}
+
+pub struct IsolatePoolBuilder {
+    size: usize,
+    reset_policy: ResetPolicy,
+    isolate: IsolateBuilder,
+    warmup_sources: Vec<String>,
+    setup: Option<Box<SetupFn>>,
+}
+
+impl IsolatePoolBuilder {
+    pub fn reset_policy(mut self, policy: ResetPolicy) -> Self {
+        self.reset_policy = policy;
+        self
+    }
+
+    /// Creates the pooled isolates from `snapshot` instead of an empty heap.
+    pub fn snapshot(mut self, snapshot: Snapshot) -> Self {
+        self.isolate = self.isolate.snapshot(snapshot);
+        self
+    }
+
+    /// Heap limits and other options for every pooled isolate; replaces an earlier snapshot.
+    pub fn isolate(mut self, isolate: IsolateBuilder) -> Self {
+        self.isolate = isolate;
+        self
+    }
+
+    /// Evaluated in every prepared context so its compile cache is warm before checkout.
+    pub fn warmup_source(mut self, source: impl Into<String>) -> Self {
+        self.warmup_sources.push(source.into());
+        self
+    }
+
+    /// Runs on every prepared context before the warmup sources, e.g. to register host functions.
+    pub fn setup<F>(mut self, setup: F) -> Self
+    where
+        F: Fn(&mut Context) -> Result<()> + 'static,
+    {
+        self.setup = Some(Box::new(setup));
+        self
+    }
+
+    pub fn build(self) -> Result<IsolatePool> {
+        let shared = Rc::new(Shared {
+            config: PoolConfig {
+                size: self.size,
+                reset_policy: self.reset_policy,
+                isolate: self.isolate,
+                warmup_sources: self.warmup_sources,
+                setup: self.setup,
+            },
+            state: RefCell::new(PoolState::default()),
+        });
+
+        let mut idle = Vec::with_capacity(shared.config.size);
+        for _ in 0..shared.config.size {
+            idle.push(shared.config.create_entry()?);
+        }
+        {
+            let mut state = shared.state.borrow_mut();
+            state.created = idle.len() as u64;
+            state.idle = idle;
+        }
+
+        Ok(IsolatePool { shared })
+    }
+}
+
+/// Keeps pre-warmed isolates, each with a ready context, for cheap checkout.
+///
+/// The pool is bound to the thread that built it, like the isolates it holds. When every
+/// isolate is checked out, [`IsolatePool::checkout`] creates an extra one; it is disposed on
+/// return if the pool is already full.
+pub struct IsolatePool {
+    shared: Rc<Shared>,
+}
+
+impl IsolatePool {
+    pub fn builder(size: usize) -> IsolatePoolBuilder {
+        IsolatePoolBuilder {
+            size,
+            reset_policy: ResetPolicy::FreshContext,
+            isolate: IsolateBuilder::default(),
+            warmup_sources: Vec::new(),
+            setup: None,
+        }
+    }
+
+    pub fn checkout(&self) -> Result<PooledIsolate> {
+        let started = Instant::now();
+        let pooled = self.shared.state.borrow_mut().idle.pop();
+        let entry = match pooled {
+            Some(entry) => entry,
+            None => {
+                let entry = self.shared.config.create_entry()?;
+                self.shared.state.borrow_mut().created += 1;
+                entry
+            }
+        };
+
+        let waited = started.elapsed();
+        let mut state = self.shared.state.borrow_mut();
+        state.in_use += 1;
+        state.checkouts += 1;
+        state.total_wait += waited;
+        state.max_wait = state.max_wait.max(waited);
+        drop(state);
+
+        Ok(PooledIsolate {
+            entry: Some(entry),
+            shared: Rc::clone(&self.shared),
+        })
+    }
+
+    pub fn metrics(&self) -> PoolMetrics {
+        let state = self.shared.state.borrow();
+        PoolMetrics {
+            size: self.shared.config.size,
+            idle: state.idle.len(),
+            in_use: state.in_use,
+            created: state.created,
+            checkouts: state.checkouts,
+            resets: state.resets,
+            reset_failures: state.reset_failures,
+            total_wait: state.total_wait,
+            max_wait: state.max_wait,
+        }
+    }
+}
+
+/// An isolate and its context on loan from an [`IsolatePool`]; returned on drop.
+pub struct PooledIsolate {
+    entry: Option<PoolEntry>,
+    shared: Rc<Shared>,
+}
+
+impl PooledIsolate {
+    pub fn isolate(&self) -> &Isolate {
+        &self.entry().isolate
+    }
+
+    pub fn context(&self) -> &Context {
+        &self.entry().context
+    }
+
+    pub fn context_mut(&mut self) -> &mut Context {
+        &mut self
+            .entry
+            .as_mut()
+            .expect("pooled isolate already returned")
+            .context
+    }
+
+    /// Drops the isolate instead of returning it, e.g. after a fatal script error.
+    pub fn discard(mut self) {
+        if self.entry.take().is_some() {
+            self.shared.state.borrow_mut().in_use -= 1;
+        }
+    }
+
+    fn entry(&self) -> &PoolEntry {
+        self.entry
+            .as_ref()
+            .expect("pooled isolate already returned")
+    }
+}
+
+impl Drop for PooledIsolate {
+    fn drop(&mut self) {
+        if let Some(entry) = self.entry.take() {
+            self.shared.release(entry);
+        }
+    }
+}
+
+// Field order matters: the context has to be disposed before its isolate.
+struct PoolEntry {
+    context: Context,
+    isolate: Isolate,
+}
+
+struct PoolConfig {
+    size: usize,
+    reset_policy: ResetPolicy,
+    isolate: IsolateBuilder,
+    warmup_sources: Vec<String>,
+    setup: Option<Box<SetupFn>>,
+}
+
+impl PoolConfig {
+    fn create_entry(&self) -> Result<PoolEntry> {
+        let isolate = self.isolate.build()?;
+        let context = self.prepare_context(&isolate)?;
+        Ok(PoolEntry { context, isolate })
+    }
+
+    fn prepare_context(&self, isolate: &Isolate) -> Result<Context> {
+        let mut context = isolate.create_context()?;
+        if let Some(setup) = &self.setup {
+            setup(&mut context)?;
+        }
+        self.warm_up(&context)?;
+        if self.reset_policy == ResetPolicy::RestoreGlobals {
+            context.record_baseline()?;
+        }
+        Ok(context)
+    }
+
+    fn warm_up(&self, context: &Context) -> Result<()> {
+        for source in &self.warmup_sources {
+            context.eval(source)?;
+        }
+        Ok(())
+    }
+
+    fn reset(&self, entry: &mut PoolEntry) -> Result<()> {
+        match self.reset_policy {
+            ResetPolicy::FreshContext => {
+                entry.context.dispose();
+                entry.context = self.prepare_context(&entry.isolate)?;
+                Ok(())
+            }
+            ResetPolicy::RestoreGlobals => entry.context.reset(ResetMode::Baseline),
+            ResetPolicy::RecreateContext => {
+                entry.context.reset(ResetMode::Recreate)?;
+                self.warm_up(&entry.context)
+            }
+        }
+    }
+}
+
+#[derive(Default)]
+struct PoolState {
+    idle: Vec<PoolEntry>,
+    in_use: usize,
+    created: u64,
+    checkouts: u64,
+    resets: u64,
+    reset_failures: u64,
+    total_wait: Duration,
+    max_wait: Duration,
+}
+
+struct Shared {
+    config: PoolConfig,
+    state: RefCell<PoolState>,
+}
+
+impl Shared {
+    fn release(&self, mut entry: PoolEntry) {
+        // A poisoned isolate refuses every call; a fresh one is created on a later checkout.
+        let keep =
+            self.state.borrow().idle.len() < self.config.size && !entry.isolate.is_poisoned();
+        let reset = keep && self.config.reset(&mut entry).is_ok();
+
+        let mut state = self.state.borrow_mut();
+        state.in_use -= 1;
+        if !keep {
+            return;
+        }
+        if reset {
+            state.resets += 1;
+            state.idle.push(entry);
+        } else {
+            state.reset_failures += 1;
+        }
+    }
+}
@@ -0,0 +1,40 @@
+use std::os::raw::c_char;
+use std::ptr;
+
+use crate::error::Result;
+use crate::ffi::shim_v8_set_flags;
+use crate::support::take_error;
+
+/// Symbol maps V8 writes for its JIT code, so Linux `perf` can name JavaScript frames.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum PerfMap {
+    /// `/tmp/perf-<pid>.map`, which `perf report` reads directly.
+    Basic,
+    /// `jit-<pid>.dump` files in the working directory, for `perf inject --jit`. Keeps code
+    /// that was moved or freed attributable, at a higher cost than [`PerfMap::Basic`].
+    JitDump,
+}
+
+/// Passes command-line style flags to V8, e.g. `"--max-lazy --no-opt"`.
+///
+/// Flags are process-wide and only take effect before the first isolate is created; after
+/// that this fails.
+pub fn set_v8_flags(flags: &str) -> Result<()> {
+    let mut error_ptr: *mut c_char = ptr::null_mut();
+    let status =
+        unsafe { shim_v8_set_flags(flags.as_ptr() as *const c_char, flags.len(), &mut error_ptr) };
+    if status == 0 {
+        return Err(unsafe { take_error(error_ptr, "failed to set V8 flags") });
+    }
+    Ok(())
+}
+
+/// Makes V8 write `map` for its JIT code, with interpreted functions given frames of their
+/// own so `perf` attributes bytecode time to JavaScript functions rather than to the
+/// interpreter. Must be called before the first isolate is created.
+pub fn enable_perf_map(map: PerfMap) -> Result<()> {
+    match map {
+        PerfMap::Basic => set_v8_flags("--perf-basic-prof --interpreted-frames-native-stack"),
+        PerfMap::JitDump => set_v8_flags("--perf-prof --interpreted-frames-native-stack"),
+    }
+}
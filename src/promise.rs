@@ -0,0 +1,61 @@
+use std::ffi::CString;
+use std::mem;
+use std::ptr;
+
+use crate::error::Result;
+use crate::ffi::{V8PromiseCompleterHandle, shim_promise_reject, shim_promise_resolve};
+use crate::value::JsValue;
+
+const DROPPED_MESSAGE: &str = "host function dropped its promise without settling it";
+
+/// Settles the promise an async host function returned to JavaScript.
+///
+/// The resolver can be moved to any thread and is used once. Its result is applied on the
+/// isolate's thread the next time the context is pumped, by [`Context::pump`] or while
+/// [`Context::eval_and_await`] waits. Dropping it unused rejects the promise.
+///
+/// [`Context::pump`]: crate::Context::pump
+/// [`Context::eval_and_await`]: crate::Context::eval_and_await
+pub struct PromiseResolver {
+    completer: V8PromiseCompleterHandle,
+}
+
+// The completer is only handed back to the shim, whose completion queue is thread-safe.
+unsafe impl Send for PromiseResolver {}
+
+impl PromiseResolver {
+    pub(crate) fn new(completer: V8PromiseCompleterHandle) -> Self {
+        Self { completer }
+    }
+
+    pub fn resolve(mut self, value: impl Into<JsValue>) {
+        let value = value.into().into_shim();
+        unsafe { shim_promise_resolve(self.take(), &value) };
+    }
+
+    pub fn reject(mut self, message: &str) {
+        let message = CString::new(message.replace('\0', " ")).unwrap_or_default();
+        unsafe { shim_promise_reject(self.take(), message.as_ptr()) };
+    }
+
+    /// Resolves with `Ok` values and rejects with the message of `Err` values.
+    pub fn settle(self, result: Result<JsValue>) {
+        match result {
+            Ok(value) => self.resolve(value),
+            Err(error) => self.reject(error.message()),
+        }
+    }
+
+    fn take(&mut self) -> V8PromiseCompleterHandle {
+        mem::replace(&mut self.completer, ptr::null_mut())
+    }
+}
+
+impl Drop for PromiseResolver {
+    fn drop(&mut self) {
+        if !self.completer.is_null() {
+            let message = CString::new(DROPPED_MESSAGE).unwrap_or_default();
+            unsafe { shim_promise_reject(self.take(), message.as_ptr()) };
+        }
+    }
+}
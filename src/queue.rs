@@ -0,0 +1,368 @@
+use std::ptr;
+use std::sync::atomic::{AtomicPtr, AtomicUsize, Ordering};
+
+/// Bounded lock-free MPMC queue of indices (Vyukov's ring).
+///
+/// Used as the per-worker run queue: the owner pushes and pops, idle workers steal by
+/// popping too. The executor never holds more entries than it has isolates, so a queue
+/// sized for all of them cannot fill up.
+pub(crate) struct RunQueue {
+    slots: Box<[Slot]>,
+    mask: usize,
+    enqueue_pos: AtomicUsize,
+    dequeue_pos: AtomicUsize,
+}
+
+struct Slot {
+    sequence: AtomicUsize,
+    value: AtomicUsize,
+}
+
+impl RunQueue {
+    pub(crate) fn with_capacity(capacity: usize) -> Self {
+        let capacity = capacity.max(2).next_power_of_two();
+        let slots = (0..capacity)
+            .map(|index| Slot {
+                sequence: AtomicUsize::new(index),
+                value: AtomicUsize::new(0),
+            })
+            .collect();
+        Self {
+            slots,
+            mask: capacity - 1,
+            enqueue_pos: AtomicUsize::new(0),
+            dequeue_pos: AtomicUsize::new(0),
+        }
+    }
+
+    /// Returns `false` if the queue is full.
+    pub(crate) fn push(&self, value: usize) -> bool {
+        let mut pos = self.enqueue_pos.load(Ordering::Relaxed);
+        loop {
+            let slot = &self.slots[pos & self.mask];
+            let sequence = slot.sequence.load(Ordering::Acquire);
+            let diff = sequence as isize - pos as isize;
+            if diff == 0 {
+                match self.enqueue_pos.compare_exchange_weak(
+                    pos,
+                    pos + 1,
+                    Ordering::Relaxed,
+                    Ordering::Relaxed,
+                ) {
+                    Ok(_) => {
+                        slot.value.store(value, Ordering::Relaxed);
+                        slot.sequence.store(pos + 1, Ordering::Release);
+                        return true;
+                    }
+                    Err(current) => pos = current,
+                }
+            } else if diff < 0 {
+                return false;
+            } else {
+                pos = self.enqueue_pos.load(Ordering::Relaxed);
+            }
+        }
+    }
+
+    pub(crate) fn pop(&self) -> Option<usize> {
+        let mut pos = self.dequeue_pos.load(Ordering::Relaxed);
+        loop {
+            let slot = &self.slots[pos & self.mask];
+            let sequence = slot.sequence.load(Ordering::Acquire);
+            let diff = sequence as isize - (pos + 1) as isize;
+            if diff == 0 {
+                match self.dequeue_pos.compare_exchange_weak(
+                    pos,
+                    pos + 1,
+                    Ordering::Relaxed,
+                    Ordering::Relaxed,
+                ) {
+                    Ok(_) => {
+                        let value = slot.value.load(Ordering::Relaxed);
+                        slot.sequence.store(pos + self.mask + 1, Ordering::Release);
+                        return Some(value);
+                    }
+                    Err(current) => pos = current,
+                }
+            } else if diff < 0 {
+                return None;
+            } else {
+                pos = self.dequeue_pos.load(Ordering::Relaxed);
+            }
+        }
+    }
+}
+
+/// Unbounded lock-free MPSC queue (Vyukov's linked queue with a stub node).
+///
+/// Any thread may push; only one thread at a time may pop, which the executor guarantees
+/// through each isolate's `scheduled` flag. `tail` is only written by that thread but is
+/// atomic so others can ask whether the queue is empty.
+pub(crate) struct JobQueue<T> {
+    head: AtomicPtr<Node<T>>,
+    tail: AtomicPtr<Node<T>>,
+}
+
+struct Node<T> {
+    next: AtomicPtr<Node<T>>,
+    value: Option<T>,
+}
+
+unsafe impl<T: Send> Send for JobQueue<T> {}
+unsafe impl<T: Send> Sync for JobQueue<T> {}
+
+impl<T> JobQueue<T> {
+    pub(crate) fn new() -> Self {
+        let stub = Box::into_raw(Box::new(Node {
+            next: AtomicPtr::new(ptr::null_mut()),
+            value: None,
+        }));
+        Self {
+            head: AtomicPtr::new(stub),
+            tail: AtomicPtr::new(stub),
+        }
+    }
+
+    pub(crate) fn push(&self, value: T) {
+        let node = Box::into_raw(Box::new(Node {
+            next: AtomicPtr::new(ptr::null_mut()),
+            value: Some(value),
+        }));
+        let previous = self.head.swap(node, Ordering::SeqCst);
+        unsafe { (*previous).next.store(node, Ordering::Release) };
+    }
+
+    /// May return `None` while a concurrent push is half done; check [`JobQueue::is_empty`]
+    /// to tell that apart from an empty queue.
+    ///
+    /// # Safety
+    /// Only one thread may pop at a time.
+    pub(crate) unsafe fn pop(&self) -> Option<T> {
+        unsafe {
+            let tail = self.tail.load(Ordering::Relaxed);
+            let next = (*tail).next.load(Ordering::Acquire);
+            if next.is_null() {
+                return None;
+            }
+            self.tail.store(next, Ordering::Release);
+            drop(Box::from_raw(tail));
+            (*next).value.take()
+        }
+    }
+
+    /// True when no push has started since the last pop. Exact for the popping thread;
+    /// a snapshot for everyone else.
+    pub(crate) fn is_empty(&self) -> bool {
+        self.head.load(Ordering::SeqCst) == self.tail.load(Ordering::Acquire)
+    }
+}
+
+impl<T> Drop for JobQueue<T> {
+    fn drop(&mut self) {
+        unsafe {
+            while self.pop().is_some() {}
+            drop(Box::from_raw(self.tail.load(Ordering::Relaxed)));
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    use std::sync::atomic::AtomicBool;
+    use std::sync::{Arc, Barrier};
+    use std::thread;
+
+    // Small enough for Miri, large enough to wrap the rings many times natively.
+    const PER_THREAD: usize = if cfg!(miri) { 64 } else { 20_000 };
+    const THREADS: usize = 4;
+
+    #[test]
+    fn run_queue_is_fifo_and_bounded() {
+        let queue = RunQueue::with_capacity(3);
+        for value in 0..4 {
+            assert!(queue.push(value));
+        }
+        assert!(!queue.push(4), "capacity rounds up to 4 and no further");
+        for round in 0..3 {
+            for value in 0..4 {
+                assert_eq!(queue.pop(), Some(value + round * 4));
+                assert!(queue.push(value + (round + 1) * 4));
+            }
+        }
+        for value in 12..16 {
+            assert_eq!(queue.pop(), Some(value));
+        }
+        assert_eq!(queue.pop(), None);
+    }
+
+    // Producers retry when the ring is full, consumers race for every slot: each value must
+    // come out exactly once, whichever thread takes it.
+    #[test]
+    fn run_queue_hands_out_every_value_once() {
+        let queue = Arc::new(RunQueue::with_capacity(16));
+        let seen: Arc<Vec<AtomicUsize>> = Arc::new(
+            (0..THREADS * PER_THREAD)
+                .map(|_| AtomicUsize::new(0))
+                .collect(),
+        );
+        let consumed = Arc::new(AtomicUsize::new(0));
+        let start = Arc::new(Barrier::new(THREADS * 2));
+
+        let mut threads = Vec::new();
+        for producer in 0..THREADS {
+            let (queue, start) = (Arc::clone(&queue), Arc::clone(&start));
+            threads.push(thread::spawn(move || {
+                start.wait();
+                for index in 0..PER_THREAD {
+                    let value = producer * PER_THREAD + index;
+                    while !queue.push(value) {
+                        thread::yield_now();
+                    }
+                }
+            }));
+        }
+        for _ in 0..THREADS {
+            let (queue, seen, consumed, start) = (
+                Arc::clone(&queue),
+                Arc::clone(&seen),
+                Arc::clone(&consumed),
+                Arc::clone(&start),
+            );
+            threads.push(thread::spawn(move || {
+                start.wait();
+                while consumed.load(Ordering::Relaxed) < THREADS * PER_THREAD {
+                    match queue.pop() {
+                        Some(value) => {
+                            seen[value].fetch_add(1, Ordering::Relaxed);
+                            consumed.fetch_add(1, Ordering::Relaxed);
+                        }
+                        None => thread::yield_now(),
+                    }
+                }
+            }));
+        }
+        for thread in threads {
+            thread.join().unwrap();
+        }
+
+        assert_eq!(queue.pop(), None);
+        assert!(seen.iter().all(|count| count.load(Ordering::Relaxed) == 1));
+    }
+
+    // The executor's pattern: one owner pushes and pops its own queue while idle workers
+    // steal from it.
+    #[test]
+    fn run_queue_owner_and_thieves_share_the_work() {
+        let queue = Arc::new(RunQueue::with_capacity(8));
+        let total = THREADS * PER_THREAD;
+        let seen: Arc<Vec<AtomicUsize>> =
+            Arc::new((0..total).map(|_| AtomicUsize::new(0)).collect());
+        let done = Arc::new(AtomicBool::new(false));
+
+        let thieves: Vec<_> = (0..THREADS)
+            .map(|_| {
+                let (queue, seen, done) =
+                    (Arc::clone(&queue), Arc::clone(&seen), Arc::clone(&done));
+                thread::spawn(move || {
+                    let mut stolen = 0;
+                    while !done.load(Ordering::Acquire) {
+                        match queue.pop() {
+                            Some(value) => {
+                                seen[value].fetch_add(1, Ordering::Relaxed);
+                                stolen += 1;
+                            }
+                            None => thread::yield_now(),
+                        }
+                    }
+                    stolen
+                })
+            })
+            .collect();
+
+        let mut kept = 0;
+        for value in 0..total {
+            while !queue.push(value) {
+                if let Some(taken) = queue.pop() {
+                    seen[taken].fetch_add(1, Ordering::Relaxed);
+                    kept += 1;
+                }
+            }
+            if value % 3 == 0
+                && let Some(taken) = queue.pop()
+            {
+                seen[taken].fetch_add(1, Ordering::Relaxed);
+                kept += 1;
+            }
+        }
+        while let Some(taken) = queue.pop() {
+            seen[taken].fetch_add(1, Ordering::Relaxed);
+            kept += 1;
+        }
+        done.store(true, Ordering::Release);
+        let stolen: usize = thieves.into_iter().map(|thief| thief.join().unwrap()).sum();
+        while let Some(taken) = queue.pop() {
+            seen[taken].fetch_add(1, Ordering::Relaxed);
+            kept += 1;
+        }
+
+        assert_eq!(kept + stolen, total);
+        assert!(seen.iter().all(|count| count.load(Ordering::Relaxed) == 1));
+    }
+
+    // Many producers, one consumer: nothing is lost or duplicated and each producer's values
+    // arrive in the order it pushed them, including across half-finished pushes.
+    #[test]
+    fn job_queue_keeps_each_producers_order() {
+        let queue = Arc::new(JobQueue::new());
+        let start = Arc::new(Barrier::new(THREADS + 1));
+
+        let producers: Vec<_> = (0..THREADS)
+            .map(|producer| {
+                let (queue, start) = (Arc::clone(&queue), Arc::clone(&start));
+                thread::spawn(move || {
+                    start.wait();
+                    for index in 0..PER_THREAD {
+                        queue.push((producer, index));
+                    }
+                })
+            })
+            .collect();
+
+        start.wait();
+        let mut next = [0usize; THREADS];
+        let mut received = 0;
+        while received < THREADS * PER_THREAD {
+            match unsafe { queue.pop() } {
+                Some((producer, index)) => {
+                    assert_eq!(index, next[producer], "producer {producer} out of order");
+                    next[producer] += 1;
+                    received += 1;
+                }
+                None => thread::yield_now(),
+            }
+        }
+        for producer in producers {
+            producer.join().unwrap();
+        }
+
+        assert!(queue.is_empty());
+        assert!(unsafe { queue.pop() }.is_none());
+        assert!(next.iter().all(|&count| count == PER_THREAD));
+    }
+
+    #[test]
+    fn job_queue_drops_what_was_never_popped() {
+        let value = Arc::new(());
+        {
+            let queue = JobQueue::new();
+            for _ in 0..10 {
+                queue.push(Arc::clone(&value));
+            }
+            drop(unsafe { queue.pop() });
+            assert_eq!(Arc::strong_count(&value), 10);
+        }
+        assert_eq!(Arc::strong_count(&value), 1);
+    }
+}
@@ -0,0 +1,802 @@
+//! Reader and writer for the `v8::ValueSerializer` wire format.
+//!
+//! Only the parts that map onto [`JsValue`] are supported: primitives, strings, plain
+//! objects, arrays, dates and primitive wrappers (as their primitive value), and
+//! `ArrayBuffer`s and their views (as [`JsValue::Bytes`]). Maps, sets, regular expressions,
+//! errors and host objects fail to decode.
+
+use crate::error::{Result, V8Error};
+use crate::value::JsValue;
+
+// The newest format every supported V8 release reads and writes.
+const FORMAT_VERSION: u32 = 15;
+// Array buffer views carry a flags field from this version on.
+const VIEW_FLAGS_VERSION: u32 = 14;
+// Bounds recursion on hostile or corrupt input, low enough for a 2 MiB thread stack even in
+// debug builds.
+const MAX_DEPTH: usize = 1024;
+// Sparse arrays are materialized densely up to this length.
+const MAX_SPARSE_LENGTH: usize = 1 << 20;
+// Back references are decoded again at every use, so a small input can describe a huge tree
+// (`v = [v, v]` forty times over). Decoding charges one unit per value plus every payload
+// byte and sparse array slot, and fails once this multiple of the input, plus a floor that
+// fits the largest sparse array, is used up. Input without shared objects needs at most
+// twice its length.
+const MAX_EXPANSION: usize = 16;
+const MIN_DECODE_BUDGET: usize = 2 * MAX_SPARSE_LENGTH;
+
+const TAG_VERSION: u8 = 0xFF;
+const TAG_PADDING: u8 = 0x00;
+const TAG_VERIFY_OBJECT_COUNT: u8 = b'?';
+const TAG_THE_HOLE: u8 = b'-';
+const TAG_UNDEFINED: u8 = b'_';
+const TAG_NULL: u8 = b'0';
+const TAG_TRUE: u8 = b'T';
+const TAG_FALSE: u8 = b'F';
+const TAG_INT32: u8 = b'I';
+const TAG_UINT32: u8 = b'U';
+const TAG_DOUBLE: u8 = b'N';
+const TAG_BIGINT: u8 = b'Z';
+const TAG_UTF8_STRING: u8 = b'S';
+const TAG_ONE_BYTE_STRING: u8 = b'"';
+const TAG_TWO_BYTE_STRING: u8 = b'c';
+const TAG_OBJECT_REFERENCE: u8 = b'^';
+const TAG_BEGIN_OBJECT: u8 = b'o';
+const TAG_END_OBJECT: u8 = b'{';
+const TAG_BEGIN_SPARSE_ARRAY: u8 = b'a';
+const TAG_END_SPARSE_ARRAY: u8 = b'@';
+const TAG_BEGIN_DENSE_ARRAY: u8 = b'A';
+const TAG_END_DENSE_ARRAY: u8 = b'$';
+const TAG_DATE: u8 = b'D';
+const TAG_TRUE_OBJECT: u8 = b'y';
+const TAG_FALSE_OBJECT: u8 = b'x';
+const TAG_NUMBER_OBJECT: u8 = b'n';
+const TAG_BIGINT_OBJECT: u8 = b'z';
+const TAG_STRING_OBJECT: u8 = b's';
+const TAG_ARRAY_BUFFER: u8 = b'B';
+const TAG_RESIZABLE_ARRAY_BUFFER: u8 = b'~';
+const TAG_ARRAY_BUFFER_VIEW: u8 = b'V';
+const VIEW_UINT8_ARRAY: u8 = b'B';
+
+pub(crate) fn encode(value: &JsValue) -> Vec<u8> {
+    let mut writer = Writer { out: Vec::new() };
+    writer.out.push(TAG_VERSION);
+    writer.varint(u64::from(FORMAT_VERSION));
+    writer.value(value);
+    writer.out
+}
+
+pub(crate) fn decode(bytes: &[u8]) -> Result<JsValue> {
+    let mut reader = Reader {
+        bytes,
+        offset: 0,
+        version: 0,
+        spans: Vec::new(),
+        next_id: 0,
+        buffer_only: false,
+        depth: 0,
+        budget: bytes
+            .len()
+            .saturating_mul(MAX_EXPANSION)
+            .saturating_add(MIN_DECODE_BUDGET),
+    };
+    reader.header()?;
+    reader.value()
+}
+
+struct Writer {
+    out: Vec<u8>,
+}
+
+impl Writer {
+    fn varint(&mut self, mut value: u64) {
+        loop {
+            let byte = (value & 0x7f) as u8;
+            value >>= 7;
+            if value == 0 {
+                self.out.push(byte);
+                return;
+            }
+            self.out.push(byte | 0x80);
+        }
+    }
+
+    fn value(&mut self, value: &JsValue) {
+        match value {
+            JsValue::Undefined => self.out.push(TAG_UNDEFINED),
+            JsValue::Null => self.out.push(TAG_NULL),
+            JsValue::Boolean(true) => self.out.push(TAG_TRUE),
+            JsValue::Boolean(false) => self.out.push(TAG_FALSE),
+            JsValue::Int32(value) => {
+                self.out.push(TAG_INT32);
+                self.varint(((value << 1) ^ (value >> 31)) as u32 as u64);
+            }
+            JsValue::Number(value) => {
+                self.out.push(TAG_DOUBLE);
+                self.out.extend_from_slice(&value.to_le_bytes());
+            }
+            JsValue::BigInt(value) => {
+                let magnitude = value.unsigned_abs();
+                let byte_length: u64 = if magnitude == 0 { 0 } else { 8 };
+                self.out.push(TAG_BIGINT);
+                self.varint((byte_length << 1) | u64::from(*value < 0));
+                if magnitude != 0 {
+                    self.out.extend_from_slice(&magnitude.to_le_bytes());
+                }
+            }
+            JsValue::String(value) => self.string(value),
+            JsValue::Bytes(bytes) => {
+                self.out.push(TAG_ARRAY_BUFFER);
+                self.varint(bytes.len() as u64);
+                self.out.extend_from_slice(bytes);
+                self.out.push(TAG_ARRAY_BUFFER_VIEW);
+                self.varint(u64::from(VIEW_UINT8_ARRAY));
+                self.varint(0);
+                self.varint(bytes.len() as u64);
+                self.varint(0);
+            }
+            JsValue::Array(items) => {
+                self.out.push(TAG_BEGIN_DENSE_ARRAY);
+                self.varint(items.len() as u64);
+                for item in items {
+                    self.value(item);
+                }
+                self.out.push(TAG_END_DENSE_ARRAY);
+                self.varint(0);
+                self.varint(items.len() as u64);
+            }
+            JsValue::Object(properties) => {
+                self.out.push(TAG_BEGIN_OBJECT);
+                for (key, value) in properties {
+                    self.string(key);
+                    self.value(value);
+                }
+                self.out.push(TAG_END_OBJECT);
+                self.varint(properties.len() as u64);
+            }
+        }
+    }
+
+    fn string(&mut self, value: &str) {
+        if value.is_ascii() {
+            self.out.push(TAG_ONE_BYTE_STRING);
+            self.varint(value.len() as u64);
+            self.out.extend_from_slice(value.as_bytes());
+            return;
+        }
+        if value.chars().all(|c| u32::from(c) <= 0xff) {
+            self.out.push(TAG_ONE_BYTE_STRING);
+            self.varint(value.chars().count() as u64);
+            self.out.extend(value.chars().map(|c| u32::from(c) as u8));
+            return;
+        }
+        let units: Vec<u16> = value.encode_utf16().collect();
+        let byte_length = (units.len() * 2) as u64;
+        // Like V8, keep the code units 2-byte aligned within the buffer.
+        if (self.out.len() + 1 + varint_len(byte_length)) % 2 != 0 {
+            self.out.push(TAG_PADDING);
+        }
+        self.out.push(TAG_TWO_BYTE_STRING);
+        self.varint(byte_length);
+        for unit in units {
+            self.out.extend_from_slice(&unit.to_le_bytes());
+        }
+    }
+}
+
+fn varint_len(mut value: u64) -> usize {
+    let mut length = 1;
+    while value >= 0x80 {
+        value >>= 7;
+        length += 1;
+    }
+    length
+}
+
+struct Reader<'a> {
+    bytes: &'a [u8],
+    offset: usize,
+    version: u32,
+    // Where each object, by serialization id, starts. A back reference decodes the object
+    // again from there rather than every object being kept around in case it is shared.
+    spans: Vec<Span>,
+    next_id: usize,
+    // Set while replaying a reference to an ArrayBuffer that is followed by its view.
+    buffer_only: bool,
+    depth: usize,
+    // What is left of the decoding budget, see MAX_EXPANSION.
+    budget: usize,
+}
+
+#[derive(Clone, Copy)]
+struct Span {
+    start: usize,
+    // Id of the object starting at `start`; a view is replayed from its buffer.
+    first_id: usize,
+    buffer_only: bool,
+    done: bool,
+}
+
+impl<'a> Reader<'a> {
+    fn header(&mut self) -> Result<()> {
+        if self.peek_byte() == Some(TAG_VERSION) {
+            self.offset += 1;
+            let version = self.varint()?;
+            if version > u64::from(FORMAT_VERSION) {
+                return Err(V8Error::new(
+                    "serialized data uses an unsupported format version",
+                ));
+            }
+            self.version = version as u32;
+        }
+        Ok(())
+    }
+
+    fn peek_byte(&self) -> Option<u8> {
+        self.bytes.get(self.offset).copied()
+    }
+
+    fn byte(&mut self) -> Result<u8> {
+        let byte = self.peek_byte().ok_or_else(truncated)?;
+        self.offset += 1;
+        Ok(byte)
+    }
+
+    fn charge(&mut self, cost: usize) -> Result<()> {
+        self.budget = self
+            .budget
+            .checked_sub(cost)
+            .ok_or_else(|| V8Error::new("serialized value expands beyond the decoding limit"))?;
+        Ok(())
+    }
+
+    fn take(&mut self, length: usize) -> Result<&'a [u8]> {
+        let end = self.offset.checked_add(length).ok_or_else(truncated)?;
+        let bytes = self.bytes.get(self.offset..end).ok_or_else(truncated)?;
+        self.charge(length)?;
+        self.offset = end;
+        Ok(bytes)
+    }
+
+    fn varint(&mut self) -> Result<u64> {
+        let mut value: u64 = 0;
+        let mut shift = 0;
+        loop {
+            let byte = self.byte()?;
+            if shift < 64 {
+                value |= u64::from(byte & 0x7f) << shift;
+            }
+            if byte & 0x80 == 0 {
+                return Ok(value);
+            }
+            shift += 7;
+        }
+    }
+
+    fn length(&mut self) -> Result<usize> {
+        usize::try_from(self.varint()?).map_err(|_| invalid())
+    }
+
+    fn double(&mut self) -> Result<f64> {
+        let mut buf = [0u8; 8];
+        buf.copy_from_slice(self.take(8)?);
+        Ok(f64::from_le_bytes(buf))
+    }
+
+    // Skips the tags V8 inserts for alignment and debugging.
+    fn peek_tag(&mut self) -> Result<u8> {
+        loop {
+            match self.peek_byte().ok_or_else(truncated)? {
+                TAG_PADDING => self.offset += 1,
+                TAG_VERIFY_OBJECT_COUNT => {
+                    self.offset += 1;
+                    self.varint()?;
+                }
+                tag => return Ok(tag),
+            }
+        }
+    }
+
+    fn tag(&mut self) -> Result<u8> {
+        let tag = self.peek_tag()?;
+        self.offset += 1;
+        Ok(tag)
+    }
+
+    fn value(&mut self) -> Result<JsValue> {
+        if self.depth >= MAX_DEPTH {
+            return Err(V8Error::new("serialized value is nested too deeply"));
+        }
+        self.charge(1)?;
+        self.depth += 1;
+        let value = self.value_inner();
+        self.depth -= 1;
+        value
+    }
+
+    // Containers and leaves are decoded out of line, so each level of nesting only costs a
+    // few small frames.
+    fn value_inner(&mut self) -> Result<JsValue> {
+        self.peek_tag()?;
+        let start = self.offset;
+        match self.byte()? {
+            TAG_OBJECT_REFERENCE => {
+                let id = self.length()?;
+                self.replay(id)
+            }
+            TAG_BEGIN_OBJECT => self.object(start),
+            TAG_BEGIN_DENSE_ARRAY => self.dense_array(start),
+            TAG_BEGIN_SPARSE_ARRAY => self.sparse_array(start),
+            tag => self.leaf(tag, start),
+        }
+    }
+
+    #[inline(never)]
+    fn leaf(&mut self, tag: u8, start: usize) -> Result<JsValue> {
+        let value = match tag {
+            TAG_UNDEFINED | TAG_THE_HOLE => JsValue::Undefined,
+            TAG_NULL => JsValue::Null,
+            TAG_TRUE => JsValue::Boolean(true),
+            TAG_FALSE => JsValue::Boolean(false),
+            TAG_INT32 => JsValue::Int32(self.int32()?),
+            TAG_UINT32 => uint32_value(self.varint()? as u32),
+            TAG_DOUBLE => JsValue::Number(self.double()?),
+            TAG_BIGINT => self.bigint()?,
+            TAG_UTF8_STRING | TAG_ONE_BYTE_STRING | TAG_TWO_BYTE_STRING => {
+                JsValue::String(self.string_body(tag)?)
+            }
+            TAG_DATE => {
+                let id = self.begin_object(start);
+                let value = JsValue::Number(self.double()?);
+                self.finish_object(id);
+                value
+            }
+            TAG_TRUE_OBJECT | TAG_FALSE_OBJECT | TAG_NUMBER_OBJECT | TAG_BIGINT_OBJECT
+            | TAG_STRING_OBJECT => {
+                let id = self.begin_object(start);
+                let value = match tag {
+                    TAG_TRUE_OBJECT => JsValue::Boolean(true),
+                    TAG_FALSE_OBJECT => JsValue::Boolean(false),
+                    TAG_NUMBER_OBJECT => JsValue::Number(self.double()?),
+                    TAG_BIGINT_OBJECT => self.bigint()?,
+                    _ => {
+                        let string_tag = self.tag()?;
+                        JsValue::String(self.string_body(string_tag)?)
+                    }
+                };
+                self.finish_object(id);
+                value
+            }
+            TAG_ARRAY_BUFFER | TAG_RESIZABLE_ARRAY_BUFFER => self.array_buffer(tag, start)?,
+            _ => {
+                return Err(V8Error::new(
+                    "serialized data contains an unsupported value",
+                ));
+            }
+        };
+        Ok(value)
+    }
+
+    #[inline(never)]
+    fn object(&mut self, start: usize) -> Result<JsValue> {
+        let id = self.begin_object(start);
+        let properties = self.properties(TAG_END_OBJECT)?;
+        self.varint()?;
+        self.finish_object(id);
+        Ok(JsValue::Object(properties))
+    }
+
+    #[inline(never)]
+    fn dense_array(&mut self, start: usize) -> Result<JsValue> {
+        let id = self.begin_object(start);
+        let length = self.length()?;
+        let mut items = Vec::with_capacity(length.min(self.bytes.len()));
+        for _ in 0..length {
+            items.push(self.value()?);
+        }
+        // Named properties of arrays have no place in a JsValue::Array.
+        self.properties(TAG_END_DENSE_ARRAY)?;
+        self.varint()?;
+        self.varint()?;
+        self.finish_object(id);
+        Ok(JsValue::Array(items))
+    }
+
+    #[inline(never)]
+    fn sparse_array(&mut self, start: usize) -> Result<JsValue> {
+        let id = self.begin_object(start);
+        let length = self.length()?;
+        if length > MAX_SPARSE_LENGTH {
+            return Err(V8Error::new("serialized sparse array is too long"));
+        }
+        self.charge(length)?;
+        let mut items = vec![JsValue::Undefined; length];
+        for (key, value) in self.properties(TAG_END_SPARSE_ARRAY)? {
+            if let Some(slot) = key.parse::<usize>().ok().and_then(|i| items.get_mut(i)) {
+                *slot = value;
+            }
+        }
+        self.varint()?;
+        self.varint()?;
+        self.finish_object(id);
+        Ok(JsValue::Array(items))
+    }
+
+    // Ids are handed out in serialization order, as V8 does; a replay reuses the original ids.
+    fn begin_object(&mut self, start: usize) -> usize {
+        let id = self.next_id;
+        self.next_id += 1;
+        if id == self.spans.len() {
+            self.spans.push(Span {
+                start,
+                first_id: id,
+                buffer_only: false,
+                done: false,
+            });
+        }
+        id
+    }
+
+    fn finish_object(&mut self, id: usize) {
+        self.spans[id].done = true;
+    }
+
+    fn replay(&mut self, id: usize) -> Result<JsValue> {
+        let span = *self.spans.get(id).ok_or_else(invalid)?;
+        if !span.done {
+            return Err(V8Error::new(
+                "serialized value is cyclic and cannot be represented",
+            ));
+        }
+        let (offset, next_id) = (self.offset, self.next_id);
+        self.offset = span.start;
+        self.next_id = span.first_id;
+        self.buffer_only = span.buffer_only;
+        let value = self.value();
+        self.offset = offset;
+        self.next_id = next_id;
+        self.buffer_only = false;
+        value
+    }
+
+    fn properties(&mut self, end_tag: u8) -> Result<Vec<(String, JsValue)>> {
+        let mut properties = Vec::new();
+        while self.peek_tag()? != end_tag {
+            let key = match self.value()? {
+                JsValue::String(key) => key,
+                key @ (JsValue::Int32(_) | JsValue::Number(_)) => key.to_string(),
+                _ => return Err(invalid()),
+            };
+            properties.push((key, self.value()?));
+        }
+        self.offset += 1;
+        Ok(properties)
+    }
+
+    fn int32(&mut self) -> Result<i32> {
+        let raw = self.varint()? as u32;
+        Ok(((raw >> 1) as i32) ^ -((raw & 1) as i32))
+    }
+
+    fn string_body(&mut self, tag: u8) -> Result<String> {
+        let length = self.length()?;
+        let bytes = self.take(length)?;
+        Ok(match tag {
+            TAG_ONE_BYTE_STRING => bytes.iter().map(|&byte| char::from(byte)).collect(),
+            TAG_TWO_BYTE_STRING => {
+                if length % 2 != 0 {
+                    return Err(invalid());
+                }
+                let units: Vec<u16> = bytes
+                    .chunks_exact(2)
+                    .map(|unit| u16::from_le_bytes([unit[0], unit[1]]))
+                    .collect();
+                String::from_utf16_lossy(&units)
+            }
+            TAG_UTF8_STRING => String::from_utf8_lossy(bytes).into_owned(),
+            _ => return Err(invalid()),
+        })
+    }
+
+    // BigInts outside the i64 range become decimal strings, as elsewhere in the crate.
+    fn bigint(&mut self) -> Result<JsValue> {
+        let bitfield = self.varint()?;
+        let negative = bitfield & 1 != 0;
+        let byte_length = usize::try_from(bitfield >> 1).map_err(|_| invalid())?;
+        let bytes = self.take(byte_length)?;
+        let mut digits: Vec<u64> = bytes
+            .chunks(8)
+            .map(|chunk| {
+                let mut buf = [0u8; 8];
+                buf[..chunk.len()].copy_from_slice(chunk);
+                u64::from_le_bytes(buf)
+            })
+            .collect();
+        while digits.last() == Some(&0) {
+            digits.pop();
+        }
+
+        match digits.as_slice() {
+            [] => return Ok(JsValue::BigInt(0)),
+            [magnitude] if !negative && *magnitude <= i64::MAX as u64 => {
+                return Ok(JsValue::BigInt(*magnitude as i64));
+            }
+            [magnitude] if negative && *magnitude <= 1 << 63 => {
+                return Ok(JsValue::BigInt((*magnitude as i64).wrapping_neg()));
+            }
+            _ => {}
+        }
+        let mut decimal = to_decimal(digits);
+        if negative {
+            decimal.insert(0, '-');
+        }
+        Ok(JsValue::String(decimal))
+    }
+
+    fn array_buffer(&mut self, tag: u8, start: usize) -> Result<JsValue> {
+        let buffer_only = std::mem::take(&mut self.buffer_only);
+        let id = self.begin_object(start);
+        self.spans[id].buffer_only = true;
+        let length = self.length()?;
+        if tag == TAG_RESIZABLE_ARRAY_BUFFER {
+            self.varint()?;
+        }
+        let buffer = self.take(length)?;
+        self.finish_object(id);
+        if buffer_only || self.peek_byte() != Some(TAG_ARRAY_BUFFER_VIEW) {
+            return Ok(JsValue::Bytes(buffer.to_vec()));
+        }
+
+        self.offset += 1;
+        let view_id = self.begin_object(start);
+        self.spans[view_id].first_id = id;
+        self.varint()?;
+        let offset = self.length()?;
+        let view_length = self.length()?;
+        if self.version >= VIEW_FLAGS_VERSION {
+            self.varint()?;
+        }
+        let end = offset.checked_add(view_length).ok_or_else(invalid)?;
+        let bytes = buffer.get(offset..end).ok_or_else(invalid)?.to_vec();
+        self.finish_object(view_id);
+        Ok(JsValue::Bytes(bytes))
+    }
+}
+
+fn uint32_value(value: u32) -> JsValue {
+    match i32::try_from(value) {
+        Ok(value) => JsValue::Int32(value),
+        Err(_) => JsValue::Number(f64::from(value)),
+    }
+}
+
+// Little-endian 64-bit digits to base 10, by repeated division by 10^19.
+fn to_decimal(mut digits: Vec<u64>) -> String {
+    const CHUNK: u64 = 10_000_000_000_000_000_000;
+    let mut chunks = Vec::new();
+    while !digits.is_empty() {
+        let mut remainder: u128 = 0;
+        for digit in digits.iter_mut().rev() {
+            let current = (remainder << 64) | u128::from(*digit);
+            *digit = (current / u128::from(CHUNK)) as u64;
+            remainder = current % u128::from(CHUNK);
+        }
+        chunks.push(remainder as u64);
+        while digits.last() == Some(&0) {
+            digits.pop();
+        }
+    }
+    let mut out = chunks
+        .pop()
+        .map(|chunk| chunk.to_string())
+        .unwrap_or_default();
+    for chunk in chunks.iter().rev() {
+        out.push_str(&format!("{chunk:019}"));
+    }
+    out
+}
+
+fn truncated() -> V8Error {
+    V8Error::new("serialized data ended unexpectedly")
+}
+
+fn invalid() -> V8Error {
+    V8Error::new("serialized data is malformed")
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn round_trip(value: JsValue) {
+        assert_eq!(decode(&encode(&value)).unwrap(), value);
+    }
+
+    fn varint(out: &mut Vec<u8>, value: u64) {
+        let mut writer = Writer {
+            out: std::mem::take(out),
+        };
+        writer.varint(value);
+        *out = writer.out;
+    }
+
+    // `let v = [1]; for (let i = 0; i < levels; i++) v = [v, v];` as V8 serializes it: every
+    // second element is a back reference to the array decoded just before it.
+    fn doubling_arrays(levels: usize) -> Vec<u8> {
+        let mut out = vec![TAG_VERSION];
+        varint(&mut out, u64::from(FORMAT_VERSION));
+        for _ in 0..levels {
+            out.push(TAG_BEGIN_DENSE_ARRAY);
+            varint(&mut out, 2);
+        }
+        out.push(TAG_BEGIN_DENSE_ARRAY);
+        varint(&mut out, 1);
+        out.push(TAG_INT32);
+        varint(&mut out, 2);
+        out.push(TAG_END_DENSE_ARRAY);
+        varint(&mut out, 0);
+        varint(&mut out, 1);
+        for level in (0..levels).rev() {
+            out.push(TAG_OBJECT_REFERENCE);
+            varint(&mut out, level as u64 + 1);
+            out.push(TAG_END_DENSE_ARRAY);
+            varint(&mut out, 0);
+            varint(&mut out, 2);
+        }
+        out
+    }
+
+    #[test]
+    fn round_trips_primitives() {
+        round_trip(JsValue::Undefined);
+        round_trip(JsValue::Null);
+        round_trip(JsValue::Boolean(true));
+        round_trip(JsValue::Boolean(false));
+        for value in [0, 1, -1, i32::MIN, i32::MAX] {
+            round_trip(JsValue::Int32(value));
+        }
+        for value in [0.5, -0.0, 1e300, f64::INFINITY, f64::MIN_POSITIVE] {
+            round_trip(JsValue::Number(value));
+        }
+        for value in [0, 1, -1, i64::MIN, i64::MAX] {
+            round_trip(JsValue::BigInt(value));
+        }
+        let nan = decode(&encode(&JsValue::Number(f64::NAN))).unwrap();
+        assert!(matches!(nan, JsValue::Number(value) if value.is_nan()));
+    }
+
+    #[test]
+    fn round_trips_strings() {
+        for value in [
+            "",
+            "plain",
+            "caf\u{e9}",
+            "\u{6f22}\u{5b57}",
+            "emoji \u{1f600}",
+        ] {
+            round_trip(JsValue::String(value.to_owned()));
+        }
+    }
+
+    #[test]
+    fn round_trips_containers() {
+        round_trip(JsValue::Bytes(Vec::new()));
+        round_trip(JsValue::Bytes((0..=255).collect()));
+        round_trip(JsValue::Array(vec![
+            JsValue::Int32(1),
+            JsValue::Array(vec![JsValue::Null, JsValue::String("x".to_owned())]),
+            JsValue::Bytes(vec![1, 2, 3]),
+        ]));
+        round_trip(JsValue::Object(vec![
+            ("a".to_owned(), JsValue::Int32(1)),
+            ("\u{6f22}".to_owned(), JsValue::Number(2.5)),
+            ("nested".to_owned(), JsValue::Object(Vec::new())),
+        ]));
+    }
+
+    #[test]
+    fn decodes_shared_references_as_copies() {
+        let inner = JsValue::Array(vec![JsValue::Int32(1)]);
+        let value = decode(&doubling_arrays(1)).unwrap();
+        assert_eq!(value, JsValue::Array(vec![inner.clone(), inner]));
+        assert!(decode(&doubling_arrays(8)).is_ok());
+    }
+
+    #[test]
+    fn rejects_exponential_expansion() {
+        let bytes = doubling_arrays(40);
+        assert!(bytes.len() < 512);
+        let error = decode(&bytes).unwrap_err();
+        assert!(error.to_string().contains("decoding limit"), "{error}");
+    }
+
+    #[test]
+    fn rejects_cycles() {
+        // `const a = []; a[0] = a;`
+        let bytes = [
+            TAG_VERSION,
+            15,
+            TAG_BEGIN_DENSE_ARRAY,
+            1,
+            TAG_OBJECT_REFERENCE,
+            0,
+        ];
+        let error = decode(&bytes).unwrap_err();
+        assert!(error.to_string().contains("cyclic"), "{error}");
+    }
+
+    #[test]
+    fn rejects_unknown_references() {
+        assert!(decode(&[TAG_VERSION, 15, TAG_OBJECT_REFERENCE, 7]).is_err());
+    }
+
+    #[test]
+    fn rejects_deep_nesting() {
+        let mut bytes = vec![TAG_VERSION, 15];
+        bytes.extend(std::iter::repeat_n([TAG_BEGIN_DENSE_ARRAY, 1], MAX_DEPTH + 1).flatten());
+        let error = decode(&bytes).unwrap_err();
+        assert!(error.to_string().contains("nested too deeply"), "{error}");
+    }
+
+    #[test]
+    fn rejects_oversized_sparse_arrays() {
+        let mut bytes = vec![TAG_VERSION, 15, TAG_BEGIN_SPARSE_ARRAY];
+        varint(&mut bytes, MAX_SPARSE_LENGTH as u64 + 1);
+        assert!(decode(&bytes).is_err());
+    }
+
+    #[test]
+    fn rejects_every_truncation() {
+        let bytes = encode(&JsValue::Object(vec![
+            (
+                "list".to_owned(),
+                JsValue::Array(vec![JsValue::Int32(7); 3]),
+            ),
+            (
+                "text".to_owned(),
+                JsValue::String("\u{6f22}\u{5b57}".to_owned()),
+            ),
+            ("bytes".to_owned(), JsValue::Bytes(vec![9; 5])),
+            ("big".to_owned(), JsValue::BigInt(i64::MIN)),
+        ]));
+        for length in 0..bytes.len() {
+            assert!(
+                decode(&bytes[..length]).is_err(),
+                "prefix of {length} bytes"
+            );
+        }
+    }
+
+    #[test]
+    fn survives_arbitrary_input() {
+        let tags = [
+            TAG_OBJECT_REFERENCE,
+            TAG_BEGIN_OBJECT,
+            TAG_END_OBJECT,
+            TAG_BEGIN_DENSE_ARRAY,
+            TAG_END_DENSE_ARRAY,
+            TAG_BEGIN_SPARSE_ARRAY,
+            TAG_ARRAY_BUFFER,
+            TAG_ARRAY_BUFFER_VIEW,
+            TAG_TWO_BYTE_STRING,
+            TAG_BIGINT,
+            0x80,
+            0xff,
+            0,
+            1,
+            2,
+        ];
+        // A fixed xorshift sequence keeps failures reproducible.
+        let mut state: u64 = 0x9e37_79b9_7f4a_7c15;
+        for _ in 0..2000 {
+            let mut bytes = vec![TAG_VERSION, 15];
+            for _ in 0..64 {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                bytes.push(tags[(state % tags.len() as u64) as usize]);
+            }
+            let _ = decode(&bytes);
+        }
+    }
+}
@@ -0,0 +1,70 @@
+use std::ffi::CString;
+use std::os::raw::c_char;
+use std::ptr;
+
+use crate::error::{Result, V8Error};
+use crate::ffi::shim_snapshot_create;
+use crate::support::{take_buffer, take_error};
+use crate::{NULL_BYTE_MESSAGE, ensure_v8_initialized};
+
+/// Serialized V8 startup snapshot produced by [`Snapshot::create`].
+///
+/// Host functions listed at creation time exist as stubs inside the snapshot and must be
+/// bound on every context through [`crate::Context::bind_function`] before they are called.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct Snapshot {
+    blob: Vec<u8>,
+}
+
+impl Snapshot {
+    pub fn create(bootstrap_sources: &[&str], host_functions: &[&str]) -> Result<Self> {
+        ensure_v8_initialized()?;
+
+        let sources = to_cstrings(bootstrap_sources)?;
+        let names = to_cstrings(host_functions)?;
+        let source_ptrs: Vec<*const c_char> = sources.iter().map(|value| value.as_ptr()).collect();
+        let name_ptrs: Vec<*const c_char> = names.iter().map(|value| value.as_ptr()).collect();
+
+        let mut blob_ptr: *mut u8 = ptr::null_mut();
+        let mut length: usize = 0;
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+
+        let status = unsafe {
+            shim_snapshot_create(
+                source_ptrs.as_ptr(),
+                source_ptrs.len(),
+                name_ptrs.as_ptr(),
+                name_ptrs.len(),
+                &mut blob_ptr,
+                &mut length,
+                &mut error_ptr,
+            )
+        };
+
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to create snapshot") });
+        }
+
+        let blob = unsafe { take_buffer(blob_ptr, length) };
+        Ok(Self { blob })
+    }
+
+    pub fn from_bytes(blob: Vec<u8>) -> Self {
+        Self { blob }
+    }
+
+    pub fn as_bytes(&self) -> &[u8] {
+        &self.blob
+    }
+
+    pub fn into_bytes(self) -> Vec<u8> {
+        self.blob
+    }
+}
+
+fn to_cstrings(values: &[&str]) -> Result<Vec<CString>> {
+    values
+        .iter()
+        .map(|value| CString::new(*value).map_err(|_| V8Error::new(NULL_BYTE_MESSAGE)))
+        .collect()
+}
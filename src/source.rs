@@ -0,0 +1,107 @@
+use std::os::raw::c_void;
+use std::sync::Arc;
+
+use crate::code_cache::source_hash;
+use crate::ffi::{SHIM_SOURCE_ONE_BYTE, SHIM_SOURCE_TWO_BYTE, ShimExternalSource};
+
+/// Source text that V8 references in place instead of copying it into the heap.
+///
+/// Clones share one buffer, so a bundle evaluated by many contexts and isolates exists only
+/// once in memory. ASCII text is handed to V8 as is; any other text is converted to UTF-16
+/// once, when the source is created, because V8 cannot reference UTF-8 directly.
+#[derive(Debug, Clone)]
+pub struct ExternalSource {
+    storage: Storage,
+    source_hash: u64,
+}
+
+#[derive(Debug, Clone)]
+enum Storage {
+    Static(&'static str),
+    Shared(Arc<str>),
+    Wide(Arc<[u16]>),
+}
+
+impl ExternalSource {
+    pub fn new(source: impl Into<Arc<str>>) -> Self {
+        let source: Arc<str> = source.into();
+        let source_hash = source_hash(&source);
+        let storage = if source.is_ascii() {
+            Storage::Shared(source)
+        } else {
+            Storage::Wide(source.encode_utf16().collect())
+        };
+        Self {
+            storage,
+            source_hash,
+        }
+    }
+
+    /// Borrows `source` for good; ASCII text is never copied.
+    pub fn from_static(source: &'static str) -> Self {
+        let storage = if source.is_ascii() {
+            Storage::Static(source)
+        } else {
+            Storage::Wide(source.encode_utf16().collect())
+        };
+        Self {
+            storage,
+            source_hash: source_hash(source),
+        }
+    }
+
+    /// Length in UTF-16 code units, as JavaScript counts it.
+    pub fn len(&self) -> usize {
+        match &self.storage {
+            Storage::Static(source) => source.len(),
+            Storage::Shared(source) => source.len(),
+            Storage::Wide(units) => units.len(),
+        }
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    pub(crate) fn source_hash(&self) -> u64 {
+        self.source_hash
+    }
+
+    // Each call hands the shim its own reference, released through
+    // pacm_v8__external_source_release.
+    pub(crate) fn to_shim(&self) -> ShimExternalSource {
+        let (data, length, encoding) = match &self.storage {
+            Storage::Static(source) => (source.as_ptr().cast(), source.len(), SHIM_SOURCE_ONE_BYTE),
+            Storage::Shared(source) => (source.as_ptr().cast(), source.len(), SHIM_SOURCE_ONE_BYTE),
+            Storage::Wide(units) => (units.as_ptr().cast(), units.len(), SHIM_SOURCE_TWO_BYTE),
+        };
+        ShimExternalSource {
+            data,
+            length,
+            encoding,
+            release_token: Box::into_raw(Box::new(self.storage.clone())) as *mut c_void,
+        }
+    }
+}
+
+impl From<&'static str> for ExternalSource {
+    fn from(source: &'static str) -> Self {
+        Self::from_static(source)
+    }
+}
+
+impl From<String> for ExternalSource {
+    fn from(source: String) -> Self {
+        Self::new(source)
+    }
+}
+
+// V8 disposes external strings from the garbage collector or isolate teardown, so this must
+// not touch thread-local state.
+#[unsafe(no_mangle)]
+pub unsafe extern "C" fn pacm_v8__external_source_release(token: *mut c_void) {
+    if token.is_null() {
+        return;
+    }
+    drop(unsafe { Box::from_raw(token as *mut Storage) });
+}
@@ -0,0 +1,269 @@
+use std::ffi::CStr;
+use std::time::Duration;
+
+use crate::ffi::{
+    SHIM_GC_PAUSE_BUCKETS, SHIM_MEMORY_PRESSURE_CRITICAL, SHIM_MEMORY_PRESSURE_MODERATE,
+    SHIM_MEMORY_PRESSURE_NONE, ShimCounters, ShimGcStats, ShimHeapSpaceStats, ShimHeapStats,
+    ShimScriptCacheStats, ShimSpanCounter,
+};
+
+/// Number of buckets in [`GcStats::pause_buckets`].
+pub const GC_PAUSE_BUCKETS: usize = SHIM_GC_PAUSE_BUCKETS;
+
+/// Counters of the compiled-script cache an isolate shares between its contexts.
+///
+/// `bytes` is an estimate: the source length of every cached script plus a fixed overhead.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub struct ScriptCacheStats {
+    pub hits: u64,
+    pub misses: u64,
+    pub insertions: u64,
+    pub evictions: u64,
+    pub entries: usize,
+    pub bytes: usize,
+    pub capacity_bytes: usize,
+}
+
+impl ScriptCacheStats {
+    pub fn hit_rate(&self) -> f64 {
+        let lookups = self.hits + self.misses;
+        if lookups == 0 {
+            return 0.0;
+        }
+        self.hits as f64 / lookups as f64
+    }
+}
+
+impl From<ShimScriptCacheStats> for ScriptCacheStats {
+    fn from(stats: ShimScriptCacheStats) -> Self {
+        Self {
+            hits: stats.hits,
+            misses: stats.misses,
+            insertions: stats.insertions,
+            evictions: stats.evictions,
+            entries: stats.entries,
+            bytes: stats.bytes,
+            capacity_bytes: stats.capacity_bytes,
+        }
+    }
+}
+
+/// Sizes reported by V8 for an isolate's whole heap, in bytes.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub struct HeapStats {
+    pub total_heap_size: usize,
+    pub total_heap_size_executable: usize,
+    pub total_physical_size: usize,
+    pub total_available_size: usize,
+    pub used_heap_size: usize,
+    pub heap_size_limit: usize,
+    pub malloced_memory: usize,
+    pub peak_malloced_memory: usize,
+    pub external_memory: usize,
+    pub native_contexts: usize,
+    /// Contexts that were disposed but not yet collected; a steadily growing count is a leak.
+    pub detached_contexts: usize,
+}
+
+impl HeapStats {
+    /// Fraction of the heap limit in use.
+    pub fn usage(&self) -> f64 {
+        if self.heap_size_limit == 0 {
+            return 0.0;
+        }
+        self.used_heap_size as f64 / self.heap_size_limit as f64
+    }
+}
+
+impl From<ShimHeapStats> for HeapStats {
+    fn from(stats: ShimHeapStats) -> Self {
+        Self {
+            total_heap_size: stats.total_heap_size,
+            total_heap_size_executable: stats.total_heap_size_executable,
+            total_physical_size: stats.total_physical_size,
+            total_available_size: stats.total_available_size,
+            used_heap_size: stats.used_heap_size,
+            heap_size_limit: stats.heap_size_limit,
+            malloced_memory: stats.malloced_memory,
+            peak_malloced_memory: stats.peak_malloced_memory,
+            external_memory: stats.external_memory,
+            native_contexts: stats.number_of_native_contexts,
+            detached_contexts: stats.number_of_detached_contexts,
+        }
+    }
+}
+
+/// Sizes of one V8 heap space, such as `new_space` or `old_space`, in bytes.
+#[derive(Debug, Clone, PartialEq, Eq, Default)]
+pub struct HeapSpaceStats {
+    pub name: String,
+    pub size: usize,
+    pub used_size: usize,
+    pub available_size: usize,
+    pub physical_size: usize,
+}
+
+impl From<ShimHeapSpaceStats> for HeapSpaceStats {
+    fn from(stats: ShimHeapSpaceStats) -> Self {
+        // V8's space names are static strings.
+        let name = if stats.space_name.is_null() {
+            String::new()
+        } else {
+            unsafe { CStr::from_ptr(stats.space_name) }
+                .to_string_lossy()
+                .into_owned()
+        };
+        Self {
+            name,
+            size: stats.space_size,
+            used_size: stats.space_used_size,
+            available_size: stats.space_available_size,
+            physical_size: stats.physical_space_size,
+        }
+    }
+}
+
+/// Garbage collections counted since the isolate was created.
+///
+/// Pauses are timed from V8's GC prologue to its epilogue on the isolate's thread, so they
+/// cover the time JavaScript was stopped, not concurrent marking or sweeping.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub struct GcStats {
+    pub collections: u64,
+    /// Scavenges and minor mark-sweeps of the young generation.
+    pub minor_collections: u64,
+    /// Full mark-compacts.
+    pub major_collections: u64,
+    pub total_pause: Duration,
+    pub max_pause: Duration,
+    /// Pause histogram: bucket 0 counts pauses under 1µs and bucket `i` pauses in
+    /// `[2^(i-1), 2^i)` µs; the last bucket also holds everything longer.
+    pub pause_buckets: [u64; GC_PAUSE_BUCKETS],
+}
+
+impl GcStats {
+    pub fn mean_pause(&self) -> Duration {
+        if self.collections == 0 {
+            return Duration::ZERO;
+        }
+        Duration::from_nanos(self.total_pause.as_nanos() as u64 / self.collections)
+    }
+
+    /// Upper bound of the pause at quantile `q` (clamped to 0..=1) from the histogram, or
+    /// [`GcStats::max_pause`] when it falls in the last bucket.
+    pub fn pause_quantile(&self, q: f64) -> Duration {
+        if self.collections == 0 {
+            return Duration::ZERO;
+        }
+        let target = ((self.collections as f64) * q.clamp(0.0, 1.0))
+            .ceil()
+            .max(1.0) as u64;
+        let mut seen = 0;
+        for (bucket, count) in self.pause_buckets.iter().enumerate() {
+            seen += count;
+            if seen >= target {
+                if bucket + 1 == GC_PAUSE_BUCKETS {
+                    break;
+                }
+                return Duration::from_micros(1 << bucket).min(self.max_pause);
+            }
+        }
+        self.max_pause
+    }
+}
+
+impl From<ShimGcStats> for GcStats {
+    fn from(stats: ShimGcStats) -> Self {
+        Self {
+            collections: stats.collections,
+            minor_collections: stats.minor_collections,
+            major_collections: stats.major_collections,
+            total_pause: Duration::from_nanos(stats.total_pause_ns),
+            max_pause: Duration::from_nanos(stats.max_pause_ns),
+            pause_buckets: stats.pause_buckets,
+        }
+    }
+}
+
+/// How hard V8 should try to give memory back, see [`Isolate::memory_pressure`].
+///
+/// [`Isolate::memory_pressure`]: crate::Isolate::memory_pressure
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum MemoryPressure {
+    #[default]
+    None,
+    /// Prefer collecting over growing the heap.
+    Moderate,
+    /// Collect as much as possible right away.
+    Critical,
+}
+
+impl MemoryPressure {
+    pub(crate) fn level(self) -> i32 {
+        match self {
+            MemoryPressure::None => SHIM_MEMORY_PRESSURE_NONE,
+            MemoryPressure::Moderate => SHIM_MEMORY_PRESSURE_MODERATE,
+            MemoryPressure::Critical => SHIM_MEMORY_PRESSURE_CRITICAL,
+        }
+    }
+}
+
+/// How often one of the shim's hot paths ran and the time spent in it.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub struct SpanStats {
+    pub count: u64,
+    pub total: Duration,
+}
+
+impl SpanStats {
+    pub fn mean(&self) -> Duration {
+        if self.count == 0 {
+            return Duration::ZERO;
+        }
+        Duration::from_nanos(self.total.as_nanos() as u64 / self.count)
+    }
+}
+
+impl From<ShimSpanCounter> for SpanStats {
+    fn from(counter: ShimSpanCounter) -> Self {
+        Self {
+            count: counter.count,
+            total: Duration::from_nanos(counter.total_ns),
+        }
+    }
+}
+
+/// Where the time of a context's or isolate's calls went.
+///
+/// Only collected when the crate is built with the `instrumentation` feature; see
+/// [`instrumentation_enabled`](crate::instrumentation_enabled). Spans nest: `run` and `call`
+/// include the `host` time of host functions they invoke.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub struct Counters {
+    /// Compiling scripts that were not in the script cache.
+    pub compile: SpanStats,
+    /// Running compiled scripts.
+    pub run: SpanStats,
+    /// Calling JavaScript functions.
+    pub call: SpanStats,
+    /// Converting arguments and results between host and JavaScript values.
+    pub marshal: SpanStats,
+    /// Inside host function callbacks.
+    pub host: SpanStats,
+    pub cache_hits: u64,
+    pub cache_misses: u64,
+}
+
+impl From<ShimCounters> for Counters {
+    fn from(counters: ShimCounters) -> Self {
+        Self {
+            compile: counters.compile.into(),
+            run: counters.run.into(),
+            call: counters.call.into(),
+            marshal: counters.marshal.into(),
+            host: counters.host.into(),
+            cache_hits: counters.cache_hits,
+            cache_misses: counters.cache_misses,
+        }
+    }
+}
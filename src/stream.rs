@@ -0,0 +1,132 @@
+use std::ffi::c_void;
+use std::os::raw::c_char;
+use std::ptr;
+
+use crate::code_cache::{SOURCE_HASH_SEED, extend_source_hash};
+use crate::error::{Result, V8Error};
+use crate::ffi::{
+    V8IsolateHandle, V8StreamHandle, shim_compile_stream_dispose, shim_compile_stream_finish,
+    shim_compile_stream_push, shim_compile_stream_start,
+};
+use crate::support::take_error;
+use crate::{Context, Isolate, Script};
+
+type ReadyCallback = Box<dyn FnOnce() + Send + 'static>;
+
+/// A script compiled while its source is still arriving.
+///
+/// Chunks of UTF-8 pushed with [`ScriptStream::push`] are parsed on one of V8's worker
+/// threads, so downloading or reading a bundle overlaps with parsing it. A chunk may end in
+/// the middle of a character. [`ScriptStream::finish`] completes the compile on the isolate's
+/// thread; dropping the stream unfinished abandons it.
+pub struct ScriptStream {
+    handle: V8StreamHandle,
+    isolate: V8IsolateHandle,
+    source_hash: u64,
+}
+
+// Pushing is thread-safe in the shim; finishing needs the isolate's context.
+unsafe impl Send for ScriptStream {}
+
+impl ScriptStream {
+    pub fn new(isolate: &Isolate) -> Result<Self> {
+        Self::start(isolate, None)
+    }
+
+    /// Like [`ScriptStream::new`]; `on_ready` runs on the worker thread once parsing is done,
+    /// after which [`ScriptStream::finish`] no longer blocks. It runs exactly once, also when
+    /// parsing fails or the stream is dropped; if starting the stream fails it runs on the
+    /// calling thread before the error is returned.
+    pub fn with_ready_callback<F>(isolate: &Isolate, on_ready: F) -> Result<Self>
+    where
+        F: FnOnce() + Send + 'static,
+    {
+        Self::start(isolate, Some(Box::new(on_ready)))
+    }
+
+    fn start(isolate: &Isolate, on_ready: Option<ReadyCallback>) -> Result<Self> {
+        if isolate.handle.is_null() {
+            if let Some(callback) = on_ready {
+                callback();
+            }
+            return Err(V8Error::new("isolate was disposed"));
+        }
+
+        let ready_token = on_ready.map_or(ptr::null_mut(), |callback| {
+            Box::into_raw(Box::new(callback)) as *mut c_void
+        });
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+
+        let handle =
+            unsafe { shim_compile_stream_start(isolate.handle, ready_token, &mut error_ptr) };
+        if handle.is_null() {
+            return Err(unsafe { take_error(error_ptr, "failed to start script stream") });
+        }
+
+        Ok(Self {
+            handle,
+            isolate: isolate.handle,
+            source_hash: SOURCE_HASH_SEED,
+        })
+    }
+
+    pub fn push(&mut self, chunk: &[u8]) -> Result<()> {
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+
+        let status = unsafe {
+            shim_compile_stream_push(self.handle, chunk.as_ptr(), chunk.len(), &mut error_ptr)
+        };
+        if status == 0 {
+            return Err(unsafe { take_error(error_ptr, "failed to push source chunk") });
+        }
+
+        self.source_hash = extend_source_hash(self.source_hash, chunk);
+        Ok(())
+    }
+
+    /// Ends the input, waits for the worker, and returns the compiled script.
+    ///
+    /// `context` only has to belong to the stream's isolate; the script can run in any of
+    /// its contexts.
+    pub fn finish(mut self, context: &Context) -> Result<Script> {
+        if context.handle.is_null() {
+            return Err(V8Error::new("context was disposed"));
+        }
+        if context.isolate != self.isolate {
+            return Err(V8Error::new(
+                "stream and context belong to different isolates",
+            ));
+        }
+
+        let stream = std::mem::replace(&mut self.handle, ptr::null_mut());
+        let mut error_ptr: *mut c_char = ptr::null_mut();
+
+        let handle = unsafe { shim_compile_stream_finish(stream, context.handle, &mut error_ptr) };
+        if handle.is_null() {
+            return Err(unsafe { take_error(error_ptr, "failed to compile script") });
+        }
+
+        Ok(Script {
+            handle,
+            isolate: self.isolate,
+            source_hash: self.source_hash,
+        })
+    }
+}
+
+impl Drop for ScriptStream {
+    fn drop(&mut self) {
+        if !self.handle.is_null() {
+            unsafe { shim_compile_stream_dispose(self.handle) };
+        }
+    }
+}
+
+#[unsafe(no_mangle)]
+pub unsafe extern "C" fn pacm_v8__compile_stream_ready(token: *mut c_void) {
+    if token.is_null() {
+        return;
+    }
+    let callback = unsafe { Box::from_raw(token as *mut ReadyCallback) };
+    callback();
+}
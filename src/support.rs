@@ -1,8 +1,12 @@
 use std::ffi::CStr;
 use std::os::raw::c_char;
 
-use crate::error::V8Error;
-use crate::ffi;
+use crate::error::{ErrorKind, Result, V8Error};
+use crate::ffi::{
+    self, SHIM_STATUS_CPU_BUDGET, SHIM_STATUS_HEAP_LIMIT, SHIM_STATUS_TIMEOUT, ShimValue,
+};
+use crate::serialize;
+use crate::value::JsValue;
 
 pub(crate) unsafe fn take_string(ptr: *mut c_char) -> Option<String> {
     if ptr.is_null() {
@@ -17,7 +21,49 @@ pub(crate) unsafe fn take_string(ptr: *mut c_char) -> Option<String> {
     Some(string)
 }
 
+pub(crate) unsafe fn take_buffer(ptr: *mut u8, length: usize) -> Vec<u8> {
+    if ptr.is_null() {
+        return Vec::new();
+    }
+    let bytes = unsafe { std::slice::from_raw_parts(ptr, length) }.to_vec();
+    unsafe {
+        ffi::shim_free_buffer(ptr);
+    }
+    bytes
+}
+
+// Decodes ValueSerializer output in place before freeing it.
+pub(crate) unsafe fn take_serialized(ptr: *mut u8, length: usize) -> Result<JsValue> {
+    if ptr.is_null() {
+        return Ok(JsValue::Undefined);
+    }
+    let value = serialize::decode(unsafe { std::slice::from_raw_parts(ptr, length) });
+    unsafe {
+        ffi::shim_free_buffer(ptr);
+    }
+    value
+}
+
 pub(crate) unsafe fn take_error(ptr: *mut c_char, fallback: &str) -> V8Error {
     let message = unsafe { take_string(ptr) }.unwrap_or_else(|| fallback.to_string());
     V8Error::new(message)
 }
+
+// For calls that run JavaScript and report why they failed through their status.
+pub(crate) unsafe fn take_status_error(status: i32, ptr: *mut c_char, fallback: &str) -> V8Error {
+    let error = unsafe { take_error(ptr, fallback) };
+    match status {
+        SHIM_STATUS_HEAP_LIMIT => error.with_kind(ErrorKind::HeapLimit),
+        SHIM_STATUS_TIMEOUT => error.with_kind(ErrorKind::Timeout),
+        SHIM_STATUS_CPU_BUDGET => error.with_kind(ErrorKind::CpuBudget),
+        _ => error,
+    }
+}
+
+pub(crate) unsafe fn take_value(value: &mut ShimValue) -> JsValue {
+    let converted = unsafe { JsValue::from_shim(value) };
+    unsafe {
+        ffi::shim_value_release(value);
+    }
+    converted
+}
@@ -0,0 +1,85 @@
+use std::ffi::{CStr, c_void};
+use std::os::raw::c_char;
+use std::ptr;
+use std::sync::RwLock;
+use std::time::Duration;
+
+use crate::error::Result;
+use crate::ffi::{shim_instrumentation_enabled, shim_set_trace_spans};
+use crate::support::take_error;
+
+/// One completed hot-path span, as counted in [`Counters`](crate::Counters).
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct TraceSpan<'a> {
+    /// `compile`, `run`, `call`, `marshal` or `host`.
+    pub name: &'a str,
+    /// Raw handle of the context or isolate the span was counted on, comparable with
+    /// [`Context::raw_handle`](crate::Context::raw_handle).
+    pub owner: usize,
+    /// Start on the monotonic clock; only meaningful relative to other spans.
+    pub start: Duration,
+    pub duration: Duration,
+}
+
+type TraceSink = Box<dyn Fn(&TraceSpan<'_>) + Send + Sync + 'static>;
+
+static TRACE_SINK: RwLock<Option<TraceSink>> = RwLock::new(None);
+
+/// Whether the shim was built with the `instrumentation` feature, i.e. whether counters are
+/// collected at all.
+pub fn instrumentation_enabled() -> bool {
+    unsafe { shim_instrumentation_enabled() != 0 }
+}
+
+/// Reports every completed span to `sink`, on the thread that ran it, until replaced or
+/// cleared with `None`. The sink runs inside V8 calls and must not call back into V8.
+/// Fails when the crate was built without the `instrumentation` feature.
+pub fn set_trace_sink<F>(sink: Option<F>) -> Result<()>
+where
+    F: Fn(&TraceSpan<'_>) + Send + Sync + 'static,
+{
+    let enabled = sink.is_some();
+    let mut error_ptr: *mut c_char = ptr::null_mut();
+    if enabled {
+        *TRACE_SINK
+            .write()
+            .unwrap_or_else(|error| error.into_inner()) =
+            sink.map(|sink| Box::new(sink) as TraceSink);
+    }
+    let status = unsafe { shim_set_trace_spans(i32::from(enabled), &mut error_ptr) };
+    if !enabled || status == 0 {
+        *TRACE_SINK
+            .write()
+            .unwrap_or_else(|error| error.into_inner()) = None;
+    }
+    if status == 0 {
+        return Err(unsafe { take_error(error_ptr, "failed to set trace sink") });
+    }
+    Ok(())
+}
+
+#[unsafe(no_mangle)]
+pub unsafe extern "C" fn pacm_v8__trace_span(
+    name: *const c_char,
+    owner: *const c_void,
+    start_ns: u64,
+    duration_ns: u64,
+) {
+    let Ok(sink) = TRACE_SINK.read() else {
+        return;
+    };
+    let Some(sink) = sink.as_ref() else {
+        return;
+    };
+    let name = if name.is_null() {
+        ""
+    } else {
+        unsafe { CStr::from_ptr(name) }.to_str().unwrap_or("")
+    };
+    sink(&TraceSpan {
+        name,
+        owner: owner as usize,
+        start: Duration::from_nanos(start_ns),
+        duration: Duration::from_nanos(duration_ns),
+    });
+}
@@ -1,32 +1,512 @@
 use std::fmt;
+use std::ptr;
+use std::slice;
 
-#[derive(Debug, Clone, PartialEq, Eq)]
-pub struct JsValue {
-    raw: String,
+use crate::buffer;
+use crate::ffi::{
+    SHIM_VALUE_BIGINT, SHIM_VALUE_BOOL, SHIM_VALUE_BYTES, SHIM_VALUE_DOUBLE,
+    SHIM_VALUE_EXTERNAL_BYTES, SHIM_VALUE_INT32, SHIM_VALUE_NULL, SHIM_VALUE_SERIALIZED,
+    SHIM_VALUE_STRING, SHIM_VALUE_UNDEFINED, ShimValue,
+};
+use crate::serialize;
+
+// Byte results at least this large are handed to V8 as external backing stores instead of
+// being copied into the V8 heap.
+const EXTERNAL_BYTES_THRESHOLD: usize = 64 * 1024;
+
+/// A JavaScript value marshalled across the shim without going through text.
+///
+/// BigInts that do not fit into an `i64` arrive as [`JsValue::String`] holding their decimal
+/// representation. Typed arrays and `ArrayBuffer`s arrive as [`JsValue::Bytes`].
+///
+/// Objects and arrays only arrive as [`JsValue::Object`] and [`JsValue::Array`] from the
+/// structured calls such as `Context::eval_structured`; elsewhere they are stringified.
+/// Both can always be passed into V8, where they are rebuilt through `v8::ValueDeserializer`.
+#[derive(Debug, Clone, PartialEq)]
+pub enum JsValue {
+    Undefined,
+    Null,
+    Boolean(bool),
+    Int32(i32),
+    Number(f64),
+    BigInt(i64),
+    String(String),
+    Bytes(Vec<u8>),
+    Array(Vec<JsValue>),
+    /// Own enumerable properties in their JavaScript order.
+    Object(Vec<(String, JsValue)>),
 }
 
 impl JsValue {
-    pub(crate) fn new(raw: String) -> Self {
-        Self { raw }
+    pub fn is_undefined(&self) -> bool {
+        matches!(self, JsValue::Undefined)
+    }
+
+    pub fn is_null(&self) -> bool {
+        matches!(self, JsValue::Null)
+    }
+
+    pub fn is_nullish(&self) -> bool {
+        matches!(self, JsValue::Undefined | JsValue::Null)
+    }
+
+    pub fn as_str(&self) -> Option<&str> {
+        match self {
+            JsValue::String(value) => Some(value),
+            _ => None,
+        }
+    }
+
+    pub fn as_bool(&self) -> Option<bool> {
+        match self {
+            JsValue::Boolean(value) => Some(*value),
+            _ => None,
+        }
+    }
+
+    pub fn as_i32(&self) -> Option<i32> {
+        match self {
+            JsValue::Int32(value) => Some(*value),
+            JsValue::Number(value) if value.fract() == 0.0 && value.abs() <= i32::MAX as f64 => {
+                Some(*value as i32)
+            }
+            _ => None,
+        }
     }
 
-    pub fn as_str(&self) -> &str {
-        &self.raw
+    pub fn as_f64(&self) -> Option<f64> {
+        match self {
+            JsValue::Int32(value) => Some(f64::from(*value)),
+            JsValue::Number(value) => Some(*value),
+            _ => None,
+        }
     }
 
+    pub fn as_i64(&self) -> Option<i64> {
+        match self {
+            JsValue::BigInt(value) => Some(*value),
+            JsValue::Int32(value) => Some(i64::from(*value)),
+            _ => None,
+        }
+    }
+
+    pub fn as_bytes(&self) -> Option<&[u8]> {
+        match self {
+            JsValue::Bytes(value) => Some(value),
+            _ => None,
+        }
+    }
+
+    /// Returns the string payload, or the value's JavaScript string form for other kinds.
     pub fn into_string(self) -> String {
-        self.raw
+        match self {
+            JsValue::String(value) => value,
+            other => other.to_string(),
+        }
+    }
+
+    // Copies a shim-provided value; the caller keeps ownership of any payload.
+    pub(crate) unsafe fn from_shim(value: &ShimValue) -> Self {
+        match value.kind {
+            SHIM_VALUE_NULL => JsValue::Null,
+            SHIM_VALUE_BOOL => JsValue::Boolean(value.integer != 0),
+            SHIM_VALUE_INT32 => JsValue::Int32(value.integer as i32),
+            SHIM_VALUE_DOUBLE => JsValue::Number(value.number),
+            SHIM_VALUE_BIGINT => JsValue::BigInt(value.integer),
+            SHIM_VALUE_STRING => {
+                let bytes = unsafe { payload(value) };
+                JsValue::String(String::from_utf8_lossy(bytes).into_owned())
+            }
+            SHIM_VALUE_BYTES | SHIM_VALUE_EXTERNAL_BYTES => {
+                JsValue::Bytes(unsafe { payload(value) }.to_vec())
+            }
+            _ => JsValue::Undefined,
+        }
+    }
+
+    pub fn as_array(&self) -> Option<&[JsValue]> {
+        match self {
+            JsValue::Array(items) => Some(items),
+            _ => None,
+        }
+    }
+
+    /// Looks up an own property of an [`JsValue::Object`].
+    pub fn get(&self, key: &str) -> Option<&JsValue> {
+        match self {
+            JsValue::Object(properties) => properties
+                .iter()
+                .find(|(name, _)| name == key)
+                .map(|(_, value)| value),
+            _ => None,
+        }
+    }
+
+    // Borrows this value's payload; the returned struct must not outlive `self` or `encoded`,
+    // which holds the serialized form of structured values.
+    fn as_shim_in(&self, encoded: &mut Vec<Vec<u8>>) -> ShimValue {
+        match self {
+            JsValue::String(value) => ShimValue::borrowed_str(value),
+            JsValue::Bytes(value) => ShimValue {
+                kind: SHIM_VALUE_BYTES,
+                data: value.as_ptr(),
+                length: value.len(),
+                ..ShimValue::default()
+            },
+            JsValue::Array(_) | JsValue::Object(_) => {
+                let bytes = serialize::encode(self);
+                let value = ShimValue {
+                    kind: SHIM_VALUE_SERIALIZED,
+                    data: bytes.as_ptr(),
+                    length: bytes.len(),
+                    ..ShimValue::default()
+                };
+                encoded.push(bytes);
+                value
+            }
+            other => other.scalar_shim(),
+        }
+    }
+
+    // Hands ownership of the payload to the shim; released through pacm_v8__value_release.
+    pub(crate) fn into_shim(self) -> ShimValue {
+        let (kind, bytes) = match self {
+            JsValue::String(value) => (SHIM_VALUE_STRING, value.into_bytes()),
+            JsValue::Bytes(value) if value.len() >= EXTERNAL_BYTES_THRESHOLD => {
+                let raw = buffer::into_raw(value);
+                return ShimValue {
+                    kind: SHIM_VALUE_EXTERNAL_BYTES,
+                    integer: raw.token as i64,
+                    data: raw.data,
+                    length: raw.length,
+                    ..ShimValue::default()
+                };
+            }
+            JsValue::Bytes(value) => (SHIM_VALUE_BYTES, value),
+            JsValue::Array(_) | JsValue::Object(_) => {
+                (SHIM_VALUE_SERIALIZED, serialize::encode(&self))
+            }
+            other => return other.scalar_shim(),
+        };
+        let boxed = bytes.into_boxed_slice();
+        let length = boxed.len();
+        let data = Box::into_raw(boxed) as *const u8;
+        ShimValue {
+            kind,
+            data,
+            length,
+            ..ShimValue::default()
+        }
+    }
+
+    // Like `into_shim`, but a payload that fits is copied into `scratch` and stays owned by
+    // whoever provided it.
+    pub(crate) fn into_shim_in(self, scratch: &mut [u8]) -> ShimValue {
+        let (kind, bytes) = match &self {
+            JsValue::String(value) => (SHIM_VALUE_STRING, value.as_bytes()),
+            JsValue::Bytes(value) => (SHIM_VALUE_BYTES, value.as_slice()),
+            _ => return self.into_shim(),
+        };
+        if scratch.is_empty() || bytes.len() > scratch.len() {
+            return self.into_shim();
+        }
+        scratch[..bytes.len()].copy_from_slice(bytes);
+        ShimValue {
+            kind,
+            data: scratch.as_ptr(),
+            length: bytes.len(),
+            ..ShimValue::default()
+        }
+    }
+
+    fn scalar_shim(&self) -> ShimValue {
+        let mut out = ShimValue::default();
+        match self {
+            JsValue::Undefined => out.kind = SHIM_VALUE_UNDEFINED,
+            JsValue::Null => out.kind = SHIM_VALUE_NULL,
+            JsValue::Boolean(value) => {
+                out.kind = SHIM_VALUE_BOOL;
+                out.integer = i64::from(*value);
+            }
+            JsValue::Int32(value) => {
+                out.kind = SHIM_VALUE_INT32;
+                out.integer = i64::from(*value);
+            }
+            JsValue::Number(value) => {
+                out.kind = SHIM_VALUE_DOUBLE;
+                out.number = *value;
+            }
+            JsValue::BigInt(value) => {
+                out.kind = SHIM_VALUE_BIGINT;
+                out.integer = *value;
+            }
+            JsValue::String(_) | JsValue::Bytes(_) | JsValue::Array(_) | JsValue::Object(_) => {
+                unreachable!("payload kinds are not scalar")
+            }
+        }
+        out
+    }
+}
+
+// Shim views of a slice of values, with the serialized form of any structured ones.
+pub(crate) struct ShimArgs {
+    values: Vec<ShimValue>,
+    _encoded: Vec<Vec<u8>>,
+}
+
+impl ShimArgs {
+    // The views borrow from `values`, which must outlive this.
+    pub(crate) fn new<'a>(values: impl IntoIterator<Item = &'a JsValue>) -> Self {
+        let mut encoded = Vec::new();
+        let values = values
+            .into_iter()
+            .map(|value| value.as_shim_in(&mut encoded))
+            .collect();
+        Self {
+            values,
+            _encoded: encoded,
+        }
+    }
+
+    pub(crate) fn as_slice(&self) -> &[ShimValue] {
+        &self.values
+    }
+}
+
+/// A host-function argument that borrows string and byte payloads from V8.
+///
+/// Byte payloads point directly at the `ArrayBuffer` backing store and are only valid for
+/// the duration of the callback.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum JsValueRef<'a> {
+    Undefined,
+    Null,
+    Boolean(bool),
+    Int32(i32),
+    Number(f64),
+    BigInt(i64),
+    String(&'a str),
+    Bytes(&'a [u8]),
+}
+
+impl<'a> JsValueRef<'a> {
+    pub fn as_str(&self) -> Option<&'a str> {
+        match self {
+            JsValueRef::String(value) => Some(value),
+            _ => None,
+        }
+    }
+
+    pub fn as_bytes(&self) -> Option<&'a [u8]> {
+        match self {
+            JsValueRef::Bytes(value) => Some(value),
+            _ => None,
+        }
+    }
+
+    pub fn as_f64(&self) -> Option<f64> {
+        match self {
+            JsValueRef::Int32(value) => Some(f64::from(*value)),
+            JsValueRef::Number(value) => Some(*value),
+            _ => None,
+        }
+    }
+
+    pub fn to_value(&self) -> JsValue {
+        match *self {
+            JsValueRef::Undefined => JsValue::Undefined,
+            JsValueRef::Null => JsValue::Null,
+            JsValueRef::Boolean(value) => JsValue::Boolean(value),
+            JsValueRef::Int32(value) => JsValue::Int32(value),
+            JsValueRef::Number(value) => JsValue::Number(value),
+            JsValueRef::BigInt(value) => JsValue::BigInt(value),
+            JsValueRef::String(value) => JsValue::String(value.to_string()),
+            JsValueRef::Bytes(value) => JsValue::Bytes(value.to_vec()),
+        }
+    }
+
+    // Utf8Value replaces lone surrogates, so a failure here means the shim handed us garbage.
+    pub(crate) unsafe fn from_shim(value: &'a ShimValue) -> Option<Self> {
+        Some(match value.kind {
+            SHIM_VALUE_NULL => JsValueRef::Null,
+            SHIM_VALUE_BOOL => JsValueRef::Boolean(value.integer != 0),
+            SHIM_VALUE_INT32 => JsValueRef::Int32(value.integer as i32),
+            SHIM_VALUE_DOUBLE => JsValueRef::Number(value.number),
+            SHIM_VALUE_BIGINT => JsValueRef::BigInt(value.integer),
+            SHIM_VALUE_STRING => {
+                JsValueRef::String(std::str::from_utf8(unsafe { payload(value) }).ok()?)
+            }
+            SHIM_VALUE_BYTES | SHIM_VALUE_EXTERNAL_BYTES => {
+                JsValueRef::Bytes(unsafe { payload(value) })
+            }
+            _ => JsValueRef::Undefined,
+        })
+    }
+}
+
+impl ShimValue {
+    pub(crate) fn borrowed_str(value: &str) -> Self {
+        ShimValue {
+            kind: SHIM_VALUE_STRING,
+            data: value.as_ptr(),
+            length: value.len(),
+            ..ShimValue::default()
+        }
+    }
+}
+
+impl Default for ShimValue {
+    fn default() -> Self {
+        ShimValue {
+            kind: SHIM_VALUE_UNDEFINED,
+            integer: 0,
+            number: 0.0,
+            data: ptr::null(),
+            length: 0,
+        }
+    }
+}
+
+unsafe fn payload(value: &ShimValue) -> &[u8] {
+    if value.data.is_null() || value.length == 0 {
+        return &[];
+    }
+    unsafe { slice::from_raw_parts(value.data, value.length) }
+}
+
+// Frees a payload produced by `JsValue::into_shim`.
+pub(crate) unsafe fn release_owned_shim(value: &mut ShimValue) {
+    if matches!(
+        value.kind,
+        SHIM_VALUE_STRING | SHIM_VALUE_BYTES | SHIM_VALUE_SERIALIZED
+    ) && !value.data.is_null()
+    {
+        let raw = ptr::slice_from_raw_parts_mut(value.data as *mut u8, value.length);
+        drop(unsafe { Box::from_raw(raw) });
+    }
+    *value = ShimValue::default();
+}
+
+// Number.prototype.toString: the shortest round-trip digits, switching to exponent form
+// outside 1e-7 < |value| < 1e21, and printing -0 as "0".
+fn fmt_number(value: f64, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+    if value.is_nan() {
+        return write!(f, "NaN");
+    }
+    if value.is_infinite() {
+        return write!(f, "{}", if value > 0.0 { "Infinity" } else { "-Infinity" });
+    }
+    if value == 0.0 {
+        return write!(f, "0");
+    }
+    if value < 0.0 {
+        write!(f, "-")?;
+    }
+    // `{:e}` already yields the shortest digits that round-trip, as "d.ddde<exp>".
+    let scientific = format!("{:e}", value.abs());
+    let (mantissa, exponent) = scientific.split_once('e').unwrap_or((&scientific, "0"));
+    let digits = mantissa.replace('.', "");
+    let k = digits.len() as i32;
+    let n = exponent.parse::<i32>().unwrap_or(0) + 1;
+    if k <= n && n <= 21 {
+        write!(f, "{digits}{}", "0".repeat((n - k) as usize))
+    } else if 0 < n && n <= 21 {
+        let (integer, fraction) = digits.split_at(n as usize);
+        write!(f, "{integer}.{fraction}")
+    } else if -6 < n && n <= 0 {
+        write!(f, "0.{}{digits}", "0".repeat((-n) as usize))
+    } else {
+        let sign = if n > 0 { '+' } else { '-' };
+        write!(f, "{mantissa}e{sign}{}", (n - 1).abs())
     }
 }
 
 impl fmt::Display for JsValue {
     fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
-        write!(f, "{}", self.raw)
+        match self {
+            JsValue::Undefined => write!(f, "undefined"),
+            JsValue::Null => write!(f, "null"),
+            JsValue::Boolean(value) => write!(f, "{value}"),
+            JsValue::Int32(value) => write!(f, "{value}"),
+            JsValue::Number(value) => fmt_number(*value, f),
+            JsValue::BigInt(value) => write!(f, "{value}"),
+            JsValue::String(value) => write!(f, "{value}"),
+            JsValue::Bytes(value) => {
+                for (index, byte) in value.iter().enumerate() {
+                    if index > 0 {
+                        write!(f, ",")?;
+                    }
+                    write!(f, "{byte}")?;
+                }
+                Ok(())
+            }
+            // Like Array.prototype.toString, which prints nullish elements as empty.
+            JsValue::Array(items) => {
+                for (index, item) in items.iter().enumerate() {
+                    if index > 0 {
+                        write!(f, ",")?;
+                    }
+                    if !item.is_nullish() {
+                        write!(f, "{item}")?;
+                    }
+                }
+                Ok(())
+            }
+            JsValue::Object(_) => write!(f, "[object Object]"),
+        }
     }
 }
 
 impl From<JsValue> for String {
     fn from(value: JsValue) -> Self {
-        value.raw
+        value.into_string()
+    }
+}
+
+impl From<&str> for JsValue {
+    fn from(value: &str) -> Self {
+        JsValue::String(value.to_string())
+    }
+}
+
+impl From<String> for JsValue {
+    fn from(value: String) -> Self {
+        JsValue::String(value)
+    }
+}
+
+impl From<bool> for JsValue {
+    fn from(value: bool) -> Self {
+        JsValue::Boolean(value)
+    }
+}
+
+impl From<i32> for JsValue {
+    fn from(value: i32) -> Self {
+        JsValue::Int32(value)
+    }
+}
+
+impl From<f64> for JsValue {
+    fn from(value: f64) -> Self {
+        JsValue::Number(value)
+    }
+}
+
+impl From<Vec<u8>> for JsValue {
+    fn from(value: Vec<u8>) -> Self {
+        JsValue::Bytes(value)
+    }
+}
+
+impl From<Vec<JsValue>> for JsValue {
+    fn from(value: Vec<JsValue>) -> Self {
+        JsValue::Array(value)
+    }
+}
+
+impl From<()> for JsValue {
+    fn from(_: ()) -> Self {
+        JsValue::Undefined
     }
 }